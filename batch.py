@@ -0,0 +1,231 @@
+"""Batch simulation API for parameter sweeps
+
+run_batch() simulates every combination of program x initial state x
+processor configuration and returns a columnar ResultTable of timing
+metrics. Programs are decoded once up front and the DecodedInstruction
+records are shared by every simulation instead of being re-parsed for
+each point. Simulations are independent, so with jobs > 1 they are spread
+over a process pool (each worker receives the decoded programs once).
+
+Example:
+    table = run_batch({'sum': program}, [
+        {'name': 'base'},
+        {'name': 'fwd', 'enable_forwarding': True},
+    ], jobs=4)
+    print(table)
+    print(table.where(config='fwd')['cpi'])
+"""
+
+import struct
+from concurrent.futures import ProcessPoolExecutor
+
+from instruction import DecodedInstruction, parse_instruction_text, decode_instruction_word
+from riscv import RISCVProcessor
+
+
+# Configuration keys and their defaults
+CONFIG_DEFAULTS = {
+    'name': None,
+    'enable_forwarding': False,
+    'branch_predictor': None,   # Used by MemoryProgram runs only
+    'icache': None,             # L1 caches (cache.make_cache configs); MemoryProgram runs only
+    'dcache': None,
+    'time_scale': 1,            # CLINT cycles per mtime tick
+    'mode': 'pipeline',
+}
+
+METRIC_COLUMNS = ('cycles', 'instructions', 'cpi', 'ipc', 'stall_count', 'flush_count', 'bubble_count')
+
+
+class MemoryProgram:
+    """Program image executed from memory (execute_from_memory) instead of fed as a list
+
+    Needed for sweeps over branch predictors and caches, which act on the memory
+    fetch engine.
+    """
+
+    def __init__(self, words, base=0, entry=None, max_cycles=100000):
+        """
+        Args:
+            words: 32-bit instruction/data words stored from base
+            base: Load address
+            entry: First PC (default: base)
+            max_cycles: Cycle limit for each run
+        """
+        self.words = list(words)
+        self.base = base
+        self.entry = base if entry is None else entry
+        self.max_cycles = max_cycles
+        self.decoded = None
+
+
+def _decode(item):
+    if isinstance(item, DecodedInstruction):
+        return item
+    if isinstance(item, str):
+        return parse_instruction_text(item)
+    return decode_instruction_word(item)
+
+
+def decode_program(program):
+    """Decode a program once for sharing between simulations
+
+    Args:
+        program: List of instruction words, assembly strings or
+                 DecodedInstruction records, or a MemoryProgram
+
+    Returns:
+        Tuple of DecodedInstruction for list programs; the MemoryProgram
+        (with .decoded filled in) otherwise
+    """
+    if isinstance(program, MemoryProgram):
+        program.decoded = tuple(decode_instruction_word(word) for word in program.words)
+        return program
+    return tuple(_decode(item) for item in program)
+
+
+class ResultTable:
+    """Column-oriented simulation results (one list per column, one row per run)"""
+
+    def __init__(self, columns):
+        """
+        Args:
+            columns: Dictionary of column name -> list of values (equal lengths)
+        """
+        self.columns = columns
+
+    def __len__(self):
+        return len(next(iter(self.columns.values()), ()))
+
+    def __getitem__(self, name):
+        return self.columns[name]
+
+    @property
+    def column_names(self):
+        return tuple(self.columns)
+
+    def rows(self):
+        """Iterate over rows as dictionaries"""
+        names = self.column_names
+        for values in zip(*self.columns.values()):
+            yield dict(zip(names, values))
+
+    def where(self, **criteria):
+        """Get the rows whose columns equal the given values, as a new table"""
+        keep = [i for i in range(len(self))
+                if all(self.columns[name][i] == value for name, value in criteria.items())]
+        return ResultTable({name: [values[i] for i in keep] for name, values in self.columns.items()})
+
+    def __str__(self):
+        names = self.column_names
+        cells = [[f"{v:.3f}" if isinstance(v, float) else str(v) for v in row] for row in zip(*self.columns.values())]
+        widths = [max([len(name)] + [len(row[i]) for row in cells]) for i, name in enumerate(names)]
+        lines = ["  ".join(name.ljust(w) for name, w in zip(names, widths)),
+                 "  ".join("-" * w for w in widths)]
+        lines += ["  ".join(cell.rjust(w) for cell, w in zip(row, widths)) for row in cells]
+        return "\n".join(lines)
+
+
+# Decoded programs of the current process (set once per pool worker)
+_programs = ()
+
+
+def _init_worker(programs):
+    global _programs
+    _programs = programs
+
+
+def _run_point(task):
+    """Run one (program, config, state) point and return its metrics tuple"""
+    program_index, config, state = task
+    program = _programs[program_index]
+
+    processor = RISCVProcessor(enable_forwarding=config['enable_forwarding'], mode=config['mode'],
+                               branch_predictor=config['branch_predictor'],
+                               icache=config['icache'], dcache=config['dcache'])
+    processor.pipeline.clint.time_scale = config['time_scale']
+    processor.pipeline.keep_retired = False  # Only counts are reported
+    if state.get('registers'):
+        processor.initialize_registers(state['registers'])
+    if state.get('memory'):
+        processor.initialize_memory(state['memory'])
+
+    if isinstance(program, MemoryProgram):
+        processor.memory.write_bytes(program.base, struct.pack(f'<{len(program.words)}I', *program.words))
+        insert = processor.pipeline.decode_cache.insert
+        for index, (word, decoded) in enumerate(zip(program.words, program.decoded)):
+            insert(program.base + index * 4, word, decoded)
+        info = processor.execute_from_memory(program.entry, max_cycles=program.max_cycles, verbose=False)
+        instructions = info['instructions_retired']
+    else:
+        info = processor.execute(list(program), verbose=False)
+        instructions = processor.pipeline.retired_count
+
+    return (int(info['total_cycles']), instructions, info['cpi'], info['ipc'],
+            info['stall_count'], processor.pipeline.flush_count, info['bubble_count'])
+
+
+def _labelled(items, kind):
+    if isinstance(items, dict):
+        return list(items.keys()), list(items.values())
+    items = list(items)
+    if kind == 'config':
+        return [c.get('name') if c.get('name') is not None else i for i, c in enumerate(items)], items
+    return list(range(len(items))), items
+
+
+def run_batch(programs, configs, initial_states=None, jobs=None):
+    """Simulate every program x initial state x configuration
+
+    Args:
+        programs: Dict of name -> program, or a list of programs (labelled
+                  by index); see decode_program() for program forms
+        configs: List of configuration dicts (keys from CONFIG_DEFAULTS;
+                 'name' labels the row) or a dict of name -> configuration
+        initial_states: Dict or list of {'registers': {...}, 'memory': {...}}
+                        (default: one empty state)
+        jobs: Worker processes (None or 1: run in this process)
+
+    Returns:
+        ResultTable with columns program, config, state and METRIC_COLUMNS
+    """
+    program_labels, program_list = _labelled(programs, 'program')
+    config_labels, config_list = _labelled(configs, 'config')
+    state_labels, state_list = _labelled(initial_states if initial_states is not None else [{}], 'state')
+
+    resolved = []
+    for config in config_list:
+        unknown = set(config) - set(CONFIG_DEFAULTS)
+        if unknown:
+            raise ValueError(f"Unknown batch configuration keys: {sorted(unknown)}")
+        resolved.append({**CONFIG_DEFAULTS, **config})
+
+    decoded = tuple(decode_program(program) for program in program_list)
+
+    points = []
+    tasks = []
+    for p, program_label in enumerate(program_labels):
+        for s, state_label in enumerate(state_labels):
+            for c, config_label in enumerate(config_labels):
+                points.append((program_label, config_label, state_label))
+                tasks.append((p, resolved[c], state_list[s]))
+
+    if jobs and jobs > 1 and len(tasks) > 1:
+        with ProcessPoolExecutor(max_workers=jobs, initializer=_init_worker, initargs=(decoded,)) as pool:
+            metrics = list(pool.map(_run_point, tasks, chunksize=max(1, len(tasks) // (jobs * 4))))
+    else:
+        saved = _programs
+        _init_worker(decoded)
+        try:
+            metrics = [_run_point(task) for task in tasks]
+        finally:
+            _init_worker(saved)
+
+    columns = {
+        'program': [point[0] for point in points],
+        'config': [point[1] for point in points],
+        'state': [point[2] for point in points],
+    }
+    for index, name in enumerate(METRIC_COLUMNS):
+        columns[name] = [row[index] for row in metrics]
+    return ResultTable(columns)
@@ -0,0 +1,334 @@
+"""Guest kernels for the host-side simulator benchmarks
+
+Each kernel is a small RV32I program built with utils/rv32_encoder. A
+kernel loads itself into a processor (setup), runs from memory and checks
+the architectural result afterwards (check), so a benchmark run that got
+faster by computing the wrong thing fails instead of looking good.
+
+Kernels take a scale (outer-loop iterations, words copied, interrupts
+taken) so the same code serves quick CI runs and long measurements.
+"""
+
+import os
+import sys
+
+PROJECT_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), '..'))
+sys.path.insert(0, PROJECT_DIR)
+
+from utils.rv32_encoder import (add, addi, lui, lw, sw, branch, jal, csr, i_type,
+                                load_program, MRET, HALT)
+
+
+# Branch funct3 values (rv32_encoder.branch)
+BEQ, BNE, BLT = 0x0, 0x1, 0x4
+
+DATA_BASE = 0x10000   # Data arrays (memcpy)
+HANDLER_BASE = 0x200  # Trap handler (CLINT kernel)
+UNROLL = 64           # Straight-line instructions per loop iteration
+
+
+def andi(rd, rs1, imm):
+    return i_type(imm, rs1, 0x7, rd)
+
+
+def load_immediate(rd, value):
+    """lui/addi pair materializing a 32-bit constant"""
+    upper = (value + 0x800) >> 12
+    return [lui(rd, upper & 0xFFFFF), addi(rd, rd, value - (upper << 12))]
+
+
+def counted_loop(body, iterations, counter=31):
+    """Wrap body in a loop running iterations times (counter register counts down)"""
+    words = [*load_immediate(counter, iterations)]
+    words += body
+    words += [addi(counter, counter, -1), branch(BNE, counter, 0, -4 * (len(body) + 1))]
+    return words
+
+
+class Kernel:
+    """Benchmark program: setup() loads it, check() validates the result"""
+
+    name = None
+    description = None
+
+    def __init__(self, scale):
+        self.scale = scale
+
+    def words(self):
+        raise NotImplementedError
+
+    def setup(self, processor):
+        load_program(processor.memory, self.words() + [HALT])
+        return 0  # Entry PC
+
+    def run_kwargs(self):
+        """Extra execute_from_memory arguments"""
+        return {}
+
+    def check(self, processor):
+        """Raise AssertionError if the run computed the wrong result"""
+
+
+class StraightLineALU(Kernel):
+    name = 'alu_straight'
+    description = 'Independent ALU operations, unrolled'
+
+    def words(self):
+        body = [addi(1 + i % 8, 1 + i % 8, 1) for i in range(UNROLL)]
+        return counted_loop(body, self.scale)
+
+    def check(self, processor):
+        expected = (self.scale * UNROLL // 8) & 0xFFFFFFFF
+        for reg in range(1, 9):
+            assert processor.register_file.read_index(reg) == expected, f"x{reg} != {expected}"
+
+
+class DependentChain(Kernel):
+    name = 'dependent_chain'
+    description = 'Back-to-back RAW dependences on one register'
+
+    def words(self):
+        return counted_loop([addi(1, 1, 1)] * UNROLL, self.scale)
+
+    def check(self, processor):
+        assert processor.register_file.read_index(1) == self.scale * UNROLL
+
+
+class BranchyLoop(Kernel):
+    name = 'branchy_loop'
+    description = 'Data-dependent branches taken every other iteration'
+
+    def words(self):
+        # x2 = i & 1; odd i add to x3, even i add to x4
+        body = [
+            andi(2, 31, 1),
+            branch(BEQ, 2, 0, 12),       # even: skip to the else arm
+            addi(3, 3, 1),
+            jal(0, 8),
+            addi(4, 4, 1),
+        ]
+        return counted_loop(body, self.scale)
+
+    def check(self, processor):
+        read = processor.register_file.read_index
+        odd = (self.scale + 1) // 2
+        assert read(3) == odd and read(4) == self.scale - odd, (read(3), read(4))
+
+
+class Memcpy(Kernel):
+    name = 'memcpy'
+    description = 'Word-by-word load/store copy'
+
+    def words(self):
+        count = self.scale
+        return [
+            *load_immediate(1, DATA_BASE),                  # x1 = src
+            *load_immediate(2, DATA_BASE + count * 4),      # x2 = dst
+            *load_immediate(3, count),                      # x3 = words left
+            lw(4, 1, 0),                                    # loop:
+            sw(4, 2, 0),
+            addi(1, 1, 4),
+            addi(2, 2, 4),
+            addi(3, 3, -1),
+            branch(BNE, 3, 0, -20),
+        ]
+
+    def setup(self, processor):
+        entry = super().setup(processor)
+        for i in range(self.scale):
+            processor.memory.write_word(DATA_BASE + i * 4, (i * 0x9E3779B1) & 0xFFFFFFFF)
+        return entry
+
+    def check(self, processor):
+        source = processor.memory.read_bytes(DATA_BASE, self.scale * 4)
+        copy = processor.memory.read_bytes(DATA_BASE + self.scale * 4, self.scale * 4)
+        assert source == copy, "destination differs from source"
+
+
+class ClintInterrupts(Kernel):
+    name = 'clint_interrupts'
+    description = 'Timer interrupt every 50 cycles, handler re-arms mtimecmp'
+
+    PERIOD = 50
+
+    def words(self):
+        # x10 counts interrupts (handler), x11 is the target count
+        return [
+            *load_immediate(1, HANDLER_BASE),
+            csr(0x1, 0, 0x305, 1),                          # mtvec = handler
+            *load_immediate(20, 0x02004000),                # x20 = &mtimecmp
+            *load_immediate(21, 0x0200BFF8),                # x21 = &mtime
+            sw(0, 20, 4),                                   # mtimecmp high = 0
+            addi(22, 0, self.PERIOD),
+            sw(22, 20, 0),                                  # mtimecmp low = PERIOD
+            addi(1, 0, 0x80),
+            csr(0x2, 0, 0x304, 1),                          # mie.MTIE
+            *load_immediate(11, self.scale),
+            addi(1, 0, 0x8),
+            csr(0x2, 0, 0x300, 1),                          # mstatus.MIE
+            branch(BLT, 10, 11, 0),                         # spin: while x10 < x11
+            csr(0x3, 0, 0x300, 1),                          # mstatus.MIE off, then halt
+        ]
+
+    def setup(self, processor):
+        entry = super().setup(processor)
+        load_program(processor.memory, [
+            lw(22, 21, 0),                                  # mtime
+            addi(22, 22, self.PERIOD),
+            sw(22, 20, 0),                                  # mtimecmp = mtime + PERIOD
+            addi(10, 10, 1),
+            MRET,
+        ], base=HANDLER_BASE)
+        return entry
+
+    def check(self, processor):
+        assert processor.register_file.read_index(10) == self.scale
+
+
+KERNELS = {kernel.name: kernel for kernel in
+           (StraightLineALU, DependentChain, BranchyLoop, Memcpy, ClintInterrupts)}
+
+# Scale giving each kernel a run of similar length (roughly 20-30k instructions)
+DEFAULT_SCALES = {
+    'alu_straight': 400,
+    'dependent_chain': 400,
+    'branchy_loop': 4000,
+    'memcpy': 4000,
+    'clint_interrupts': 150,
+}
+
+
+class ElfKernel(Kernel):
+    """Kernel loaded from a built ELF image (needs the file and pyelftools)"""
+
+    ELF_PATH = None
+
+    @classmethod
+    def available(cls):
+        """Get None if the benchmark can run, else the reason it cannot"""
+        if not os.path.exists(cls.ELF_PATH):
+            return f"{cls.ELF_PATH} not built (see freertos_demo/README.md)"
+        try:
+            import elftools  # noqa: F401
+            from elftools.elf.elffile import ELFFile  # noqa: F401
+        except ImportError:
+            return "pyelftools not installed"
+        return None
+
+    def setup(self, processor):
+        sys.path.insert(0, os.path.join(PROJECT_DIR, 'utils'))
+        from elf_loader import ELFTestLoader
+        loader = ELFTestLoader(self.ELF_PATH)
+        entry, self.symbols = loader.load_into(processor.memory)
+        stack = self.symbols.get('_stack_start', processor.memory.find_region(entry).end)
+        processor.register_file.write('R2', stack)
+        return entry
+
+
+class FreeRTOSBoot(ElfKernel):
+    """FreeRTOS demo ELF from reset to the first vTaskSwitchContext call
+
+    Needs a built freertos_demo/freertos_demo.elf and pyelftools; scale is
+    unused.
+    """
+
+    name = 'freertos_boot'
+    description = 'FreeRTOS demo to the first task switch'
+    ELF_PATH = os.path.join(PROJECT_DIR, 'freertos_demo', 'freertos_demo.elf')
+    STOP_SYMBOL = 'vTaskSwitchContext'
+
+    def setup(self, processor):
+        entry = super().setup(processor)
+        self.stop_pc = self.symbols.get(self.STOP_SYMBOL)
+        return entry
+
+    def run_kwargs(self):
+        return {'breakpoints': {self.stop_pc}} if self.stop_pc is not None else {}
+
+
+def parse_bench_lines(text):
+    """Parse the BENCH report lines printed by a guest benchmark image
+
+    See freertos_demo/bench.h for the format.
+
+    Args:
+        text: UART output
+
+    Returns:
+        List of dictionaries, one per BENCH line: 'name', the numeric fields
+        (iterations, mcycle_start, mcycle_end, minstret_start, minstret_end,
+        checksum) and 'cycles'/'instret', the counter deltas modulo 2**32
+    """
+    reports = []
+    for line in text.splitlines():
+        if not line.startswith('BENCH '):
+            continue
+        fields = dict(field.split('=', 1) for field in line.split()[1:])
+        report = {'name': fields.pop('name')}
+        report.update((key, int(value, 0)) for key, value in fields.items())
+        report['cycles'] = (report['mcycle_end'] - report['mcycle_start']) & 0xFFFFFFFF
+        report['instret'] = (report['minstret_end'] - report['minstret_start']) & 0xFFFFFFFF
+        reports.append(report)
+    return reports
+
+
+class GuestBenchmark(ElfKernel):
+    """Benchmark image from freertos_demo (make bench), run until it writes tohost
+
+    The image times its own workload with mcycle/minstret and prints BENCH
+    lines; check() fails unless it reported every measurement and exited
+    with the pass code. The parsed lines are kept in reports. Scale is unused.
+    """
+
+    def setup(self, processor):
+        entry = super().setup(processor)
+        self.uart = processor.pipeline.uart
+        self.uart.capture = True
+        self.tohost = self.symbols['tohost']
+        self.reports = []
+        return entry
+
+    def run_kwargs(self):
+        return {'tohost': self.tohost}
+
+    def check(self, processor):
+        output = self.uart.captured_text()
+        self.reports = parse_bench_lines(output)
+        failures = [line for line in output.splitlines() if line.startswith('BENCH_FAIL')]
+        assert not failures, f"guest self-check failed: {failures}"
+        assert self.reports, "no BENCH report printed"
+        code = processor.memory.read_word(self.tohost)
+        assert code == 1, f"guest exited with tohost = {code:#x}"
+
+
+BENCH_DIR = os.path.join(PROJECT_DIR, 'freertos_demo')
+
+
+class GuestCoremark(GuestBenchmark):
+    name = 'guest_coremark'
+    description = 'CoreMark-style list/matrix/state-machine kernel (bare metal)'
+    ELF_PATH = os.path.join(BENCH_DIR, 'bench_coremark.elf')
+
+
+class GuestLoop(GuestBenchmark):
+    name = 'guest_loop'
+    description = 'Tight branch and dependent/independent ALU loops (bare metal)'
+    ELF_PATH = os.path.join(BENCH_DIR, 'bench_loop.elf')
+
+
+class GuestMemcpy(GuestBenchmark):
+    name = 'guest_memcpy'
+    description = 'memset/memcpy over heap_4 buffers (FreeRTOS)'
+    ELF_PATH = os.path.join(BENCH_DIR, 'bench_memcpy.elf')
+
+
+class GuestPingPong(GuestBenchmark):
+    name = 'guest_pingpong'
+    description = 'Queue ping-pong between two tasks (FreeRTOS)'
+    ELF_PATH = os.path.join(BENCH_DIR, 'bench_pingpong.elf')
+
+
+# Kernels needing a built ELF image (see ElfKernel.available())
+ELF_KERNELS = (FreeRTOSBoot, GuestCoremark, GuestLoop, GuestMemcpy, GuestPingPong)
+KERNELS.update((kernel.name, kernel) for kernel in ELF_KERNELS)
+DEFAULT_SCALES.update((kernel.name, 1) for kernel in ELF_KERNELS)
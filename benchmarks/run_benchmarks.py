@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""
+Host-side benchmarks: how fast does the simulator itself run?
+
+Runs each guest kernel (benchmarks/kernels.py) on each simulation engine
+and records host wall time, simulated cycles/s, simulated instructions/s
+(MIPS) and peak RSS. Every (kernel, mode) point runs in a fresh process
+so peak RSS belongs to that point alone; with --repeat the fastest run is
+kept. Results can be saved as a JSON baseline and later runs compared
+against it.
+
+Usage:
+  python benchmarks/run_benchmarks.py                          # All kernels, every mode
+  python benchmarks/run_benchmarks.py -k memcpy -m functional  # One point
+  python benchmarks/run_benchmarks.py --save baseline.json     # Record a baseline
+  python benchmarks/run_benchmarks.py --baseline baseline.json # Compare (exit 1 on regression)
+"""
+
+import argparse
+import json
+import multiprocessing
+import os
+import platform
+import resource
+import sys
+import time
+from concurrent.futures import ProcessPoolExecutor
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+from kernels import KERNELS, DEFAULT_SCALES, ELF_KERNELS, PROJECT_DIR  # noqa: E402
+
+sys.path.insert(0, PROJECT_DIR)
+
+from riscv import RISCVProcessor  # noqa: E402
+
+MAX_CYCLES = 50_000_000
+DEFAULT_TOLERANCE = 0.10  # Relative instructions/s drop reported as a regression
+
+
+def run_benchmark(name, mode='pipeline', scale=None):
+    """Run one kernel in the current process
+
+    Args:
+        name: Kernel name (KERNELS key)
+        mode: RISCVProcessor mode
+        scale: Kernel scale (default: DEFAULT_SCALES)
+
+    Returns:
+        Result dictionary (kernel, mode, scale, wall_time, cycles,
+        instructions, cycles_per_sec, instructions_per_sec, peak_rss_kb,
+        halt_reason; guest benchmark images add 'guest', their parsed
+        BENCH lines)
+
+    Raises:
+        AssertionError: If the kernel computed the wrong result
+    """
+    scale = DEFAULT_SCALES[name] if scale is None else scale
+    kernel = KERNELS[name](scale)
+    processor = RISCVProcessor(mode=mode)
+    entry = kernel.setup(processor)
+
+    start = time.perf_counter()
+    info = processor.execute_from_memory(entry, max_cycles=MAX_CYCLES, verbose=False, **kernel.run_kwargs())
+    wall_time = time.perf_counter() - start
+
+    kernel.check(processor)
+    cycles = int(info['total_cycles'])
+    instructions = info['instructions_retired']
+    result = {
+        'kernel': name,
+        'mode': mode,
+        'scale': scale,
+        'wall_time': wall_time,
+        'cycles': cycles,
+        'instructions': instructions,
+        'cycles_per_sec': cycles / wall_time if wall_time else 0.0,
+        'instructions_per_sec': instructions / wall_time if wall_time else 0.0,
+        'peak_rss_kb': resource.getrusage(resource.RUSAGE_SELF).ru_maxrss,
+        'halt_reason': info['halt_reason'],
+    }
+    reports = getattr(kernel, 'reports', None)
+    if reports is not None:
+        result['guest'] = reports
+    return result
+
+
+def run_isolated(points, repeat=1):
+    """Run (name, mode, scale) points, each in a fresh process
+
+    Returns:
+        List of result dictionaries (fastest of repeat runs per point)
+    """
+    context = multiprocessing.get_context('spawn')
+    results = []
+    with ProcessPoolExecutor(max_workers=1, mp_context=context, max_tasks_per_child=1) as pool:
+        for name, mode, scale in points:
+            runs = [pool.submit(run_benchmark, name, mode, scale).result() for _ in range(repeat)]
+            results.append(min(runs, key=lambda r: r['wall_time']))
+    return results
+
+
+def make_report(results):
+    """Build the JSON-serializable report (results keyed 'kernel/mode')"""
+    return {
+        'host': {
+            'python': platform.python_version(),
+            'implementation': platform.python_implementation(),
+            'machine': platform.machine(),
+            'system': platform.system(),
+        },
+        'timestamp': time.strftime('%Y-%m-%dT%H:%M:%S'),
+        'results': {f"{r['kernel']}/{r['mode']}": r for r in results},
+    }
+
+
+def compare(baseline, report, tolerance=DEFAULT_TOLERANCE):
+    """Compare a report against a baseline report
+
+    Returns:
+        List of (key, baseline instructions/s, current instructions/s, ratio)
+        for every point present in both, sorted by key; ratio < 1 - tolerance
+        is a regression
+    """
+    rows = []
+    for key, current in sorted(report['results'].items()):
+        base = baseline['results'].get(key)
+        if base is None or not base['instructions_per_sec']:
+            continue
+        ratio = current['instructions_per_sec'] / base['instructions_per_sec']
+        rows.append((key, base['instructions_per_sec'], current['instructions_per_sec'], ratio))
+    return rows
+
+
+def print_results(results, stream=None):
+    stream = stream or sys.stdout
+    stream.write(f"{'kernel':18s} {'mode':10s} {'instr':>9s} {'cycles':>9s} {'wall s':>8s} "
+                 f"{'MIPS':>8s} {'Mcyc/s':>8s} {'RSS MB':>7s}\n")
+    stream.write("-" * 84 + "\n")
+    for r in results:
+        stream.write(f"{r['kernel']:18s} {r['mode']:10s} {r['instructions']:9d} {r['cycles']:9d} "
+                     f"{r['wall_time']:8.3f} {r['instructions_per_sec'] / 1e6:8.4f} "
+                     f"{r['cycles_per_sec'] / 1e6:8.4f} {r['peak_rss_kb'] / 1024:7.1f}\n")
+
+
+def print_guest_reports(results, stream=None):
+    """Print the timings guest benchmark images measured themselves (mcycle/minstret)"""
+    rows = [(r['mode'], report) for r in results for report in r.get('guest', ())]
+    if not rows:
+        return
+    stream = stream or sys.stdout
+    stream.write(f"\n{'guest measurement':22s} {'mode':10s} {'iters':>6s} {'instret':>9s} "
+                 f"{'cycles':>9s} {'CPI':>6s}\n")
+    stream.write("-" * 67 + "\n")
+    for mode, report in rows:
+        cpi = report['cycles'] / report['instret'] if report['instret'] else 0.0
+        stream.write(f"{report['name']:22s} {mode:10s} {report['iterations']:6d} {report['instret']:9d} "
+                     f"{report['cycles']:9d} {cpi:6.2f}\n")
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Measure simulator host throughput")
+    parser.add_argument('-k', '--kernel', action='append', choices=tuple(KERNELS),
+                        help="Kernel to run (repeatable; default: all available)")
+    parser.add_argument('-m', '--mode', action='append', choices=RISCVProcessor.MODES,
+                        help="Simulation engine (repeatable; default: all)")
+    parser.add_argument('--scale-factor', type=float, default=1.0,
+                        help="Multiply every kernel's default scale")
+    parser.add_argument('--repeat', type=int, default=1, help="Runs per point, fastest kept")
+    parser.add_argument('--save', metavar='FILE', help="Write the results as a JSON baseline")
+    parser.add_argument('--baseline', metavar='FILE', help="Compare against a saved baseline")
+    parser.add_argument('--tolerance', type=float, default=DEFAULT_TOLERANCE,
+                        help="Instructions/s drop counted as a regression (default: 0.10)")
+    args = parser.parse_args(argv)
+
+    names = args.kernel or list(KERNELS)
+    for kernel in ELF_KERNELS:
+        reason = kernel.available() if kernel.name in names else None
+        if reason is not None:
+            print(f"Skipping {kernel.name}: {reason}")
+            names.remove(kernel.name)
+    modes = args.mode or list(RISCVProcessor.MODES)
+    points = [(name, mode, max(1, int(DEFAULT_SCALES[name] * args.scale_factor)))
+              for name in names for mode in modes]
+
+    results = run_isolated(points, args.repeat)
+    print_results(results)
+    print_guest_reports(results)
+    report = make_report(results)
+
+    if args.save:
+        with open(args.save, 'w') as f:
+            json.dump(report, f, indent=2)
+        print(f"\nBaseline written to {args.save}")
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        rows = compare(baseline, report, args.tolerance)
+        print(f"\nAgainst {args.baseline} ({baseline.get('timestamp', '?')}):")
+        regressions = 0
+        for key, base, current, ratio in rows:
+            flag = "REGRESSION" if ratio < 1 - args.tolerance else ""
+            regressions += bool(flag)
+            print(f"  {key:30s} {base / 1e6:8.4f} -> {current / 1e6:8.4f} MIPS  {ratio:6.2f}x  {flag}")
+        return 1 if regressions else 0
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
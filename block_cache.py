@@ -0,0 +1,337 @@
+"""Basic-block translation cache for the functional RISC-V core
+
+Translates hot straight-line runs of guest code into generated Python
+functions so FunctionalCore pays dispatch overhead once per block instead
+of once per instruction. Each block is compiled from source with register
+indices, immediates and the PC baked in as constants:
+
+    def block(regs, tohost):
+        # 0x00000104: ADDI R1, R1, 1
+        regs[1] = (regs[1] + 0x1) & 0xFFFFFFFF
+        # 0x00000108: BNE R1, R2, -4
+        if regs[1] != regs[2]:
+            return 0x104, 2
+        return 0x10c, 2
+
+and returns (next PC, instructions executed).
+
+A block is a run of ALU, LUI/AUIPC, load, store and FENCE instructions,
+optionally ended by a branch, JAL or JALR. ECALL, EBREAK, MRET, CSR
+instructions, WFI, FENCE.I, illegal words and branches/jumps to themselves
+(idle loops) are never translated: the block ends before them and the
+interpreter runs them.
+
+A block leaves early (returning a count below its length) when:
+- a load or store hits the CLINT or the UART, or a store hits tohost:
+  before the access, so the interpreter performs it with time and
+  interrupts in sync
+- a store lands in a page holding decoded code: after the store, so the
+  core can drop blocks it just made stale
+- an access is misaligned or unmapped (the Memory call refuses it): before
+  the access, so the interpreter takes the exception
+
+Every block is built from DecodeCache records, so the cache's generation
+counter (bumped by code-page stores, FENCE.I and checkpoint restore) tells
+when translations may be stale; the whole translation cache is flushed
+then.
+"""
+
+import struct
+
+from instruction import Opcode, decode_instruction_word
+from exe import EXE
+from memory import PAGE_SHIFT, PAGE_MASK
+
+
+MASK_32 = 0xFFFFFFFF
+HOT_THRESHOLD = 8        # Interpreted entries to a PC before it is translated
+MAX_BLOCK_LENGTH = 64    # Instructions per block
+COLD = float('-inf')     # Heat of PCs that cannot start a block
+
+LOAD_CALLS = {
+    Opcode.LOAD: 'read_word({})',
+    Opcode.LW: 'read_word({})',
+    Opcode.LH: 'read_halfword({}, True)',
+    Opcode.LHU: 'read_halfword({}, False)',
+    Opcode.LB: 'read_byte({}, True)',
+    Opcode.LBU: 'read_byte({}, False)',
+}
+STORE_CALLS = {
+    Opcode.STORE: ('write_word({}, {})', 4),
+    Opcode.SW: ('write_word({}, {})', 4),
+    Opcode.SH: ('write_halfword({}, {} & 0xFFFF)', 2),
+    Opcode.SB: ('write_byte({}, {} & 0xFF)', 1),
+}
+BRANCH_TESTS = {
+    Opcode.BEQ: '{} == {}',
+    Opcode.BNE: '{} != {}',
+    Opcode.BLT: '({} ^ 0x80000000) < ({} ^ 0x80000000)',
+    Opcode.BGE: '({} ^ 0x80000000) >= ({} ^ 0x80000000)',
+    Opcode.BLTU: '{} < {}',
+    Opcode.BGEU: '{} >= {}',
+}
+ALU_IMMEDIATE_FORMS = {
+    Opcode.ADDI: Opcode.ADD, Opcode.ANDI: Opcode.AND, Opcode.ORI: Opcode.OR,
+    Opcode.XORI: Opcode.XOR, Opcode.SLTI: Opcode.SLT, Opcode.SLTIU: Opcode.SLTU,
+    Opcode.SLLI: Opcode.SLL, Opcode.SRLI: Opcode.SRL, Opcode.SRAI: Opcode.SRA,
+}
+
+
+def _reg(index):
+    return f'regs[{index}]' if index else '0'
+
+
+def _alu_expression(op, a, b):
+    """Python expression for an ALU result (a, b: 32-bit unsigned operand source)"""
+    if op == Opcode.ADD:
+        return f'({a} + {b}) & 0xFFFFFFFF'
+    if op == Opcode.SUB:
+        return f'({a} - {b}) & 0xFFFFFFFF'
+    if op == Opcode.AND:
+        return f'{a} & {b}'
+    if op == Opcode.OR:
+        return f'{a} | {b}'
+    if op == Opcode.XOR:
+        return f'{a} ^ {b}'
+    if op == Opcode.SLT:
+        return f'1 if ({a} ^ 0x80000000) < ({b} ^ 0x80000000) else 0'
+    if op == Opcode.SLTU:
+        return f'1 if {a} < {b} else 0'
+    if op == Opcode.SLL:
+        return f'({a} << ({b} & 0x1F)) & 0xFFFFFFFF'
+    if op == Opcode.SRL:
+        return f'{a} >> ({b} & 0x1F)'
+    return f'((({a} ^ 0x80000000) - 0x80000000) >> ({b} & 0x1F)) & 0xFFFFFFFF'  # SRA
+
+
+def _emit_guarded(emit, indent, statement, pc, index):
+    """Emit a Memory call that leaves the block before instruction index if the access is refused"""
+    emit(f'{indent}try:')
+    emit(f'{indent}    {statement}')
+    emit(f'{indent}except ValueError:')
+    emit(f'{indent}    return 0x{pc:x}, {index}')
+
+
+class TranslatedBlock:
+    """One compiled basic block"""
+
+    __slots__ = ('pc', 'length', 'function', 'pcs', 'source')
+
+    def __init__(self, pc, length, function, source):
+        self.pc = pc
+        self.length = length          # Instructions in the block
+        self.function = function      # function(regs, tohost) -> (next_pc, executed)
+        self.pcs = frozenset(range(pc, pc + 4 * length, 4))
+        self.source = source          # Generated Python (for debugging)
+
+    def __repr__(self):
+        return f"TranslatedBlock(0x{self.pc:08x}, {self.length} instructions)"
+
+
+class BlockCache:
+    """PC-indexed cache of translated blocks, filled once a PC turns hot"""
+
+    def __init__(self, memory, decode_cache, clint, threshold=HOT_THRESHOLD,
+                 max_length=MAX_BLOCK_LENGTH):
+        """Initialize an empty translation cache
+
+        Args:
+            memory: Memory the blocks read and write
+            decode_cache: DecodeCache the blocks are built from (and kept
+                          coherent with)
+            clint: CLINT whose registers end a block (as do memory's UART's)
+            threshold: Interpreted entries to a PC before it is translated
+            max_length: Instruction limit per block
+        """
+        self.memory = memory
+        self.decode_cache = decode_cache
+        self.threshold = threshold
+        self.max_length = max_length
+        self.blocks = {}    # pc -> TranslatedBlock
+        self.heat = {}      # pc -> interpreted entries (COLD: untranslatable)
+        self.generation = decode_cache.generation
+
+        # Device windows whose registers depend on time end a block
+        self.timed_ranges = [(clint.MSIP_BASE, clint.MTIME_BASE + 8)]
+        if memory.uart is not None:
+            self.timed_ranges.append((memory.uart.TX_DATA_REG, memory.uart.TX_DATA_REG + memory.uart.WINDOW_SIZE))
+        word = struct.Struct('<I')
+        self.namespace = {
+            # Word accesses to plain RAM pages inline Memory.read_word/write_word's fast path
+            'read_pages': memory._read_pages,
+            'write_pages': memory._write_pages,
+            'unpack_word': word.unpack_from,
+            'pack_word': word.pack_into,
+            'read_word': memory.read_word,
+            'read_halfword': memory.read_halfword,
+            'read_byte': memory.read_byte,
+            'write_word': memory.write_word,
+            'write_halfword': memory.write_halfword,
+            'write_byte': memory.write_byte,
+            'invalidate': decode_cache.invalidate,
+            'code_pages': decode_cache.code_pages,
+        }
+
+        # Statistics
+        self.translated = 0
+        self.flushes = 0
+
+    def flush(self):
+        """Drop every translation (decoded code changed)"""
+        if self.blocks:
+            self.flushes += 1
+        self.blocks.clear()
+        self.heat.clear()
+        self.generation = self.decode_cache.generation
+
+    def touch(self, pc):
+        """Count an interpreted entry to pc, translating it once hot
+
+        Returns:
+            TranslatedBlock starting at pc, or None
+        """
+        heat = self.heat.get(pc, 0) + 1
+        if heat < self.threshold:
+            self.heat[pc] = heat
+            return None
+        block = self.translate(pc)
+        if block is None:
+            self.heat[pc] = COLD
+        return block
+
+    def translate(self, pc):
+        """Translate the block starting at pc
+
+        Returns:
+            TranslatedBlock, or None if the instruction at pc cannot be translated
+        """
+        instructions = self._scan(pc)
+        if not instructions:
+            return None
+        source = self._generate(instructions)
+        scope = {}
+        exec(compile(source, f'<block 0x{pc:08x}>', 'exec'), self.namespace, scope)
+        block = TranslatedBlock(pc, len(instructions), scope['block'], source)
+        self.blocks[pc] = block
+        self.translated += 1
+        return block
+
+    def _scan(self, pc):
+        """Collect (pc, decoded) of the block at pc, terminator included"""
+        decode_cache = self.decode_cache
+        instructions = []
+        while len(instructions) < self.max_length:
+            decoded = decode_cache.get(pc)
+            if decoded is None:
+                try:
+                    word = self.memory.read_word(pc)
+                except ValueError:
+                    break  # Fetch fault: the interpreter raises it
+                decoded = decode_cache.lookup(pc, word, decode_instruction_word)
+            op = decoded.opcode
+            if Opcode.ADD <= op <= Opcode.AUIPC or op == Opcode.FENCE:
+                instructions.append((pc, decoded))
+                pc = (pc + 4) & MASK_32
+                continue
+            if Opcode.BEQ <= op <= Opcode.JALR and (op == Opcode.JALR or decoded.offset != 0):
+                instructions.append((pc, decoded))
+            break
+        return instructions
+
+    def _generate(self, instructions):
+        """Python source of a block function"""
+        device_test = ' or '.join(f'0x{low:x} <= a < 0x{high:x}' for low, high in self.timed_ranges)
+        lines = ['def block(regs, tohost):']
+        emit = lines.append
+        count = len(instructions)
+        next_pc = None
+
+        for index, (pc, decoded) in enumerate(instructions):
+            op = decoded.opcode
+            rd = decoded.rd
+            srcs = decoded.src_indices
+            next_pc = (pc + 4) & MASK_32
+            emit(f'    # 0x{pc:08x}: {decoded.text}')
+
+            if Opcode.ADD <= op <= Opcode.SRAI:
+                if not rd:
+                    continue
+                if decoded.has_immediate:
+                    b = f'0x{decoded.immediate & MASK_32:x}'
+                    op = ALU_IMMEDIATE_FORMS[op]
+                else:
+                    b = _reg(srcs[1])
+                emit(f'    regs[{rd}] = {_alu_expression(op, _reg(srcs[0]), b)}')
+
+            elif Opcode.LOAD <= op <= Opcode.LBU:
+                emit(f'    a = ({_reg(srcs[0])} + {decoded.offset}) & 0xFFFFFFFF')
+                emit(f'    if {device_test}:')
+                emit(f'        return 0x{pc:x}, {index}')
+                call = LOAD_CALLS[op].format('a')
+                if op == Opcode.LW or op == Opcode.LOAD:
+                    target = f'regs[{rd}]' if rd else 'v'
+                    emit(f'    p = read_pages.get(a >> {PAGE_SHIFT})')
+                    emit('    if p is not None and not a & 0x3:')
+                    emit(f'        {target}, = unpack_word(p, a & 0x{PAGE_MASK:x})')
+                    emit('    else:')
+                    _emit_guarded(emit, '        ', f'{target} = {call}', pc, index)
+                else:
+                    _emit_guarded(emit, '    ', f'regs[{rd}] = {call} & 0xFFFFFFFF' if rd else call, pc, index)
+
+            elif Opcode.STORE <= op <= Opcode.SB:
+                call, size = STORE_CALLS[op]
+                emit(f'    a = ({_reg(srcs[1])} + {decoded.offset}) & 0xFFFFFFFF')
+                emit(f'    if a == tohost or {device_test}:')
+                emit(f'        return 0x{pc:x}, {index}')
+                if size == 4:
+                    emit(f'    p = write_pages.get(a >> {PAGE_SHIFT})')
+                    emit('    if p is not None and not a & 0x3:')
+                    emit(f'        pack_word(p, a & 0x{PAGE_MASK:x}, {_reg(srcs[0])})')
+                    emit('    else:')
+                    _emit_guarded(emit, '        ', call.format("a", _reg(srcs[0])), pc, index)
+                else:
+                    _emit_guarded(emit, '    ', call.format("a", _reg(srcs[0])), pc, index)
+                emit(f'    if (a >> {self.decode_cache.PAGE_SHIFT}) in code_pages:')
+                emit(f'        invalidate(a, {size})')
+                emit(f'        return 0x{next_pc:x}, {index + 1}')
+
+            elif op == Opcode.LUI or op == Opcode.AUIPC:
+                if rd:
+                    value = (EXE.execute_lui(decoded.immediate) if op == Opcode.LUI
+                             else EXE.execute_auipc(decoded.immediate, pc))
+                    emit(f'    regs[{rd}] = 0x{value:x}')
+
+            elif Opcode.BEQ <= op <= Opcode.BGEU:
+                test = BRANCH_TESTS[op].format(_reg(srcs[0]), _reg(srcs[1]))
+                emit(f'    if {test}:')
+                emit(f'        return 0x{(pc + decoded.offset) & MASK_32:x}, {count}')
+
+            elif op == Opcode.JAL:
+                if rd:
+                    emit(f'    regs[{rd}] = 0x{next_pc:x}')
+                emit(f'    return 0x{(pc + decoded.offset) & MASK_32:x}, {count}')
+                return '\n'.join(lines) + '\n'
+
+            elif op == Opcode.JALR:
+                emit(f'    t = ({_reg(srcs[0])} + {decoded.offset}) & 0xFFFFFFFE')
+                if rd:
+                    emit(f'    regs[{rd}] = 0x{next_pc:x}')
+                emit(f'    return t, {count}')
+                return '\n'.join(lines) + '\n'
+
+            # FENCE is a no-op on a single in-order core
+
+        emit(f'    return 0x{next_pc:x}, {count}')
+        return '\n'.join(lines) + '\n'
+
+    def get_stats(self):
+        """Get translation cache statistics
+
+        Returns:
+            Dictionary with live block count, blocks translated and flushes
+        """
+        return {
+            'blocks': len(self.blocks),
+            'translated': self.translated,
+            'flushes': self.flushes,
+        }
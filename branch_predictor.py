@@ -0,0 +1,379 @@
+"""Branch prediction unit for the RISC-V pipeline fetch engine
+
+Consulted at Fetch for every control-transfer instruction, so fetch can
+continue down the predicted path instead of falling through and flushing
+when the instruction resolves in Execute. A misprediction is recovered with
+the pipeline's normal flush to the correct PC.
+
+Components:
+- Direction predictor for conditional branches (static not-taken, BTFN,
+  bimodal or gshare), selected by name
+- Branch target buffer (BTB) supplying targets of taken branches and jumps
+- Return-address stack (RAS) for JAL/JALR call/return pairs
+
+Calls and returns follow the RISC-V hint convention (see ras_hints()): a
+JAL/JALR writing a link register (x1/x5) pushes the return address, a JALR
+through one that writes any other register pops it, and a JALR from one
+link register to the other (a coroutine swap) pops, then pushes.
+"""
+
+from instruction import Opcode, BRANCH_OPCODES
+
+MASK_32 = 0xFFFFFFFF
+LINK_REGISTERS = (1, 5)  # ra, t0
+
+# Cycles a flush costs the memory fetch engine: the control instruction
+# resolves at the end of Execute, and the squashed Fetch/Decode slots still
+# occupy the single-entry front-end buffers (measured on the SimPy pipeline).
+# Only the flush_cycles_saved_estimate statistic uses it: a flush overlapping
+# a stall (a load-use hazard, a slow memory access) costs fewer cycles
+MISPREDICT_PENALTY = 5
+
+
+def ras_hints(decoded):
+    """Get the RAS action of a JAL/JALR from its rd/rs1 (the RISC-V hint table)
+
+    rd link   rs1 link   action
+    no        no         none
+    no        yes        pop
+    yes       no         push
+    yes       yes        pop, then push (rd != rs1); push (rd == rs1)
+
+    Args:
+        decoded: DecodedInstruction of a JAL or JALR
+
+    Returns:
+        Tuple of (pop, push)
+    """
+    push = decoded.rd in LINK_REGISTERS
+    if decoded.opcode != Opcode.JALR or decoded.rs1 not in LINK_REGISTERS:
+        return False, push
+    return not push or decoded.rd != decoded.rs1, push
+
+
+class StaticNotTakenPredictor:
+    """Predicts every conditional branch not taken"""
+
+    name = 'static'
+
+    def predict(self, pc, target):
+        """Predict a branch direction
+
+        Args:
+            pc: Branch address
+            target: Branch target (pc + offset)
+
+        Returns:
+            Tuple of (taken, index) where index is passed back to update()
+        """
+        return False, None
+
+    def update(self, index, taken):
+        """Train on a resolved branch"""
+
+
+class BTFNPredictor(StaticNotTakenPredictor):
+    """Backward taken, forward not taken (loops predicted taken)"""
+
+    name = 'btfn'
+
+    def predict(self, pc, target):
+        return target < pc, None
+
+
+class BimodalPredictor:
+    """PC-indexed table of 2-bit saturating counters"""
+
+    name = 'bimodal'
+
+    def __init__(self, entries=1024):
+        """Initialize bimodal predictor
+
+        Args:
+            entries: Counter table size (power of two)
+        """
+        self.mask = entries - 1
+        self.counters = [1] * entries  # Weakly not-taken
+
+    def _index(self, pc):
+        return (pc >> 2) & self.mask
+
+    def predict(self, pc, target):
+        index = self._index(pc)
+        return self.counters[index] >= 2, index
+
+    def update(self, index, taken):
+        counter = self.counters[index]
+        if taken:
+            if counter < 3:
+                self.counters[index] = counter + 1
+        elif counter > 0:
+            self.counters[index] = counter - 1
+
+
+class GSharePredictor(BimodalPredictor):
+    """2-bit counters indexed by PC XOR global branch history"""
+
+    name = 'gshare'
+
+    def __init__(self, entries=1024, history_bits=10):
+        """Initialize gshare predictor
+
+        Args:
+            entries: Counter table size (power of two)
+            history_bits: Number of resolved branch outcomes in the history
+        """
+        super().__init__(entries)
+        self.history_mask = (1 << history_bits) - 1
+        self.history = 0
+
+    def _index(self, pc):
+        return ((pc >> 2) ^ self.history) & self.mask
+
+    def update(self, index, taken):
+        super().update(index, taken)
+        self.history = ((self.history << 1) | int(taken)) & self.history_mask
+
+
+DIRECTION_PREDICTORS = {
+    cls.name: cls for cls in (StaticNotTakenPredictor, BTFNPredictor, BimodalPredictor, GSharePredictor)
+}
+
+
+class BranchTargetBuffer:
+    """Direct-mapped, fully tagged table of control-transfer targets"""
+
+    def __init__(self, entries=256):
+        """Initialize BTB
+
+        Args:
+            entries: Number of entries (power of two)
+        """
+        self.mask = entries - 1
+        self.tags = [None] * entries
+        self.targets = [0] * entries
+
+    def lookup(self, pc):
+        """Get the predicted target for pc, or None on a miss"""
+        index = (pc >> 2) & self.mask
+        if self.tags[index] == pc:
+            return self.targets[index]
+        return None
+
+    def update(self, pc, target):
+        """Record the resolved target of a taken control transfer"""
+        index = (pc >> 2) & self.mask
+        self.tags[index] = pc
+        self.targets[index] = target
+
+
+class ReturnAddressStack:
+    """Fixed-depth stack of return addresses; overflow drops the oldest"""
+
+    def __init__(self, depth=16):
+        """Initialize RAS
+
+        Args:
+            depth: Maximum number of return addresses held
+        """
+        self.depth = depth
+        self.stack = []
+
+    def push(self, address):
+        if len(self.stack) == self.depth:
+            del self.stack[0]
+        self.stack.append(address)
+
+    def pop(self):
+        """Pop the predicted return address, or None if empty"""
+        return self.stack.pop() if self.stack else None
+
+    def checkpoint(self):
+        return tuple(self.stack)
+
+    def restore(self, checkpoint):
+        self.stack = list(checkpoint)
+
+
+class Prediction:
+    """Fetch-time prediction carried by one dynamic control instruction"""
+
+    __slots__ = ('next_pc', 'taken', 'index', 'ras_checkpoint', 'used_ras')
+
+    def __init__(self, next_pc, taken, index, ras_checkpoint, used_ras):
+        self.next_pc = next_pc                # PC fetch continued from
+        self.taken = taken                    # Predicted direction (branches)
+        self.index = index                    # Direction table index to train
+        self.ras_checkpoint = ras_checkpoint  # RAS contents before this fetch (None without a RAS)
+        self.used_ras = used_ras              # Target came from the RAS
+
+
+class BranchPredictionUnit:
+    """Direction predictor, BTB and RAS consulted by the fetch engine"""
+
+    def __init__(self, direction='bimodal', btb_entries=256, ras_depth=16, **direction_args):
+        """Initialize branch prediction unit
+
+        Args:
+            direction: 'static' (not taken), 'btfn', 'bimodal' or 'gshare'
+            btb_entries: BTB size (0 disables the BTB: taken branches and
+                         jumps then always mispredict)
+            ras_depth: RAS depth (0 disables the RAS)
+            **direction_args: Passed to the direction predictor (entries,
+                              history_bits)
+        """
+        predictor_class = DIRECTION_PREDICTORS.get(direction)
+        if predictor_class is None:
+            raise ValueError(f"Unknown branch predictor: {direction!r} "
+                             f"(expected one of {tuple(DIRECTION_PREDICTORS)})")
+        self.direction = predictor_class(**direction_args)
+        self.btb = BranchTargetBuffer(btb_entries) if btb_entries else None
+        self.ras = ReturnAddressStack(ras_depth) if ras_depth else None
+
+        # Statistics
+        self.branches = 0
+        self.branch_mispredicts = 0
+        self.jumps = 0
+        self.jump_mispredicts = 0
+        self.btb_hits = 0
+        self.btb_lookups = 0
+        self.ras_returns = 0
+        self.ras_mispredicts = 0
+        self.flushes_avoided = 0  # Taken control transfers followed without a flush
+        self.flushes_added = 0    # Not-taken branches flushed by a taken prediction
+
+    def _target(self, pc):
+        if self.btb is None:
+            return None
+        self.btb_lookups += 1
+        target = self.btb.lookup(pc)
+        if target is not None:
+            self.btb_hits += 1
+        return target
+
+    def predict(self, pc, decoded):
+        """Predict the next fetch PC after the instruction at pc
+
+        Args:
+            pc: Address of the fetched instruction
+            decoded: Its DecodedInstruction
+
+        Returns:
+            Prediction for control instructions, None for everything else
+            (fetch falls through to pc + 4)
+        """
+        opcode = decoded.opcode
+        fall_through = (pc + 4) & MASK_32
+        if opcode not in BRANCH_OPCODES and opcode != Opcode.JAL and opcode != Opcode.JALR:
+            return None
+        checkpoint = self.ras.checkpoint() if self.ras is not None else None
+
+        if opcode in BRANCH_OPCODES:
+            taken, index = self.direction.predict(pc, (pc + decoded.offset) & MASK_32)
+            target = self._target(pc) if taken else None
+            next_pc = target if target is not None else fall_through
+            return Prediction(next_pc, taken, index, checkpoint, False)
+
+        target = None
+        used_ras = False
+        pop, push = ras_hints(decoded) if self.ras is not None else (False, False)
+        if pop:
+            target = self.ras.pop()
+            used_ras = True
+        if target is None:
+            target = self._target(pc)
+        if push:
+            self.ras.push(fall_through)
+        return Prediction(target if target is not None else fall_through, True, None, checkpoint, used_ras)
+
+    def resolve(self, pc, decoded, prediction, taken, actual_pc):
+        """Train on a resolved control instruction
+
+        Args:
+            pc: Address of the instruction
+            decoded: Its DecodedInstruction
+            prediction: Prediction made when it was fetched
+            taken: Whether control left the sequential path
+            actual_pc: Correct next PC
+
+        Returns:
+            True if the prediction was correct (no flush needed)
+        """
+        correct = prediction.next_pc == actual_pc
+        if decoded.opcode in BRANCH_OPCODES:
+            self.branches += 1
+            self.direction.update(prediction.index, taken)
+            if not correct:
+                self.branch_mispredicts += 1
+        else:
+            self.jumps += 1
+            if prediction.used_ras:
+                self.ras_returns += 1
+                if not correct:
+                    self.ras_mispredicts += 1
+            if not correct:
+                self.jump_mispredicts += 1
+
+        # Wrong-path calls and returns may have changed the RAS: rewind it to
+        # this instruction, then redo its own pop/push
+        if not correct and self.ras is not None:
+            self.ras.restore(prediction.ras_checkpoint)
+            if decoded.opcode not in BRANCH_OPCODES:
+                pop, push = ras_hints(decoded)
+                if pop:
+                    self.ras.pop()
+                if push:
+                    self.ras.push((pc + 4) & MASK_32)
+
+        if taken and self.btb is not None:
+            self.btb.update(pc, actual_pc)
+        if correct and taken:
+            self.flushes_avoided += 1
+        elif not correct and not taken:
+            self.flushes_added += 1
+        return correct
+
+    def get_stats(self):
+        """Get prediction statistics
+
+        Returns:
+            Dictionary with per-class accuracy, BTB/RAS hit rates and an
+            estimate of the net flush cycles saved against fetching without
+            prediction (MISPREDICT_PENALTY per flush avoided or added; run
+            without a predictor for the measured difference)
+        """
+        predictions = self.branches + self.jumps
+        mispredicts = self.branch_mispredicts + self.jump_mispredicts
+        return {
+            'predictor': self.direction.name,
+            'predictions': predictions,
+            'mispredicts': mispredicts,
+            'accuracy': (1 - mispredicts / predictions) if predictions else 0.0,
+            'branches': self.branches,
+            'branch_accuracy': (1 - self.branch_mispredicts / self.branches) if self.branches else 0.0,
+            'jumps': self.jumps,
+            'jump_accuracy': (1 - self.jump_mispredicts / self.jumps) if self.jumps else 0.0,
+            'btb_hit_rate': (self.btb_hits / self.btb_lookups) if self.btb_lookups else 0.0,
+            'ras_returns': self.ras_returns,
+            'ras_accuracy': (1 - self.ras_mispredicts / self.ras_returns) if self.ras_returns else 0.0,
+            'flushes_avoided': self.flushes_avoided,
+            'flushes_added': self.flushes_added,
+            'flush_cycles_saved_estimate': (self.flushes_avoided - self.flushes_added) * MISPREDICT_PENALTY,
+        }
+
+
+def make_branch_predictor(config):
+    """Build a BranchPredictionUnit from a configuration
+
+    Args:
+        config: None (no prediction), a direction predictor name, or a dict
+                of BranchPredictionUnit keyword arguments
+
+    Returns:
+        BranchPredictionUnit, or None
+    """
+    if config is None:
+        return None
+    if isinstance(config, str):
+        return BranchPredictionUnit(config)
+    return BranchPredictionUnit(**config)
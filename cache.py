@@ -0,0 +1,280 @@
+"""L1 instruction/data cache timing model for the memory fetch engine
+
+The caches keep tags only: instructions and data always come from Memory,
+so they change how long accesses take, never what they return (self-
+modifying code, DMA-style test stores and checkpoints need no coherence).
+
+A Cache is set-associative with a configurable size, associativity, line
+size, replacement policy (LRU, FIFO or random) and write policy (write-back
+or write-through, with or without write-allocate). A hit costs nothing over
+the stage's cycle; a miss adds miss_latency cycles for the line fill, and
+every write to memory (a dirty line evicted by a write-back cache, or each
+store through a write-through one) adds write_latency.
+
+CacheHierarchy puts an I-cache in front of instruction fetch and a D-cache
+in front of loads and stores. Accesses to memory-mapped devices (UART,
+CLINT, anything added with Memory.map_device()) bypass the caches as
+uncached and keep their single-cycle timing. The caches are blocking: the
+cycles an access adds stall the whole pipeline, starting with the cycle
+after the one that missed (see CacheHierarchy.stall()), as on a simple
+in-order core waiting on its memory bus.
+"""
+
+import random
+
+REPLACEMENT_POLICIES = ('lru', 'fifo', 'random')
+WRITE_POLICIES = ('write-back', 'write-through')
+
+
+class Cache:
+    """Set-associative cache (tags and dirty bits only)"""
+
+    def __init__(self, name='cache', size=4096, ways=2, line_size=32, replacement='lru',
+                 write_policy='write-back', write_allocate=None, miss_latency=10,
+                 write_latency=None, seed=0):
+        """
+        Args:
+            name: Name used in reports ('icache', 'dcache')
+            size: Capacity in bytes
+            ways: Associativity (size // line_size for fully associative)
+            line_size: Line size in bytes (power of two, at least 4)
+            replacement: 'lru', 'fifo' or 'random' (seeded, so runs repeat)
+            write_policy: 'write-back' or 'write-through'
+            write_allocate: Allocate a line on a store miss (default: True
+                            for write-back, False for write-through)
+            miss_latency: Cycles a line fill adds to the access
+            write_latency: Cycles a write to memory adds (default: miss_latency)
+            seed: Random replacement seed
+
+        Raises:
+            ValueError: For an unknown policy or an impossible geometry
+        """
+        if replacement not in REPLACEMENT_POLICIES:
+            raise ValueError(f"Unknown replacement policy: {replacement!r} (expected one of {REPLACEMENT_POLICIES})")
+        if write_policy not in WRITE_POLICIES:
+            raise ValueError(f"Unknown write policy: {write_policy!r} (expected one of {WRITE_POLICIES})")
+        if line_size < 4 or line_size & (line_size - 1):
+            raise ValueError(f"Line size must be a power of two of at least 4 bytes: {line_size}")
+        num_sets, remainder = divmod(size, line_size * max(ways, 1))
+        if ways < 1 or remainder or num_sets == 0 or num_sets & (num_sets - 1):
+            raise ValueError(f"{size}-byte cache cannot be split into a power-of-two number of "
+                             f"{ways}-way sets of {line_size}-byte lines")
+        self.name = name
+        self.size = size
+        self.ways = ways
+        self.line_size = line_size
+        self.replacement = replacement
+        self.write_policy = write_policy
+        self.write_back = write_policy == 'write-back'
+        self.write_allocate = self.write_back if write_allocate is None else write_allocate
+        self.miss_latency = miss_latency
+        self.write_latency = miss_latency if write_latency is None else write_latency
+        self.rng = random.Random(seed)
+
+        self.line_shift = line_size.bit_length() - 1
+        self.set_mask = num_sets - 1
+        self._move_on_hit = replacement == 'lru'
+        # One dict per set: line number -> dirty, oldest (fill or use) first
+        self.sets = [{} for _ in range(num_sets)]
+
+        # Statistics
+        self.reads = 0
+        self.writes = 0
+        self.hits = 0
+        self.misses = 0
+        self.writebacks = 0     # Dirty lines written back on eviction
+        self.memory_writes = 0  # Stores written through (or around) to memory
+        self.uncached = 0       # Device accesses that bypassed the cache
+        self.stall_cycles = 0
+
+    @property
+    def num_sets(self):
+        return self.set_mask + 1
+
+    def access(self, address, write=False):
+        """Look up (and on a miss, fill) the line holding address
+
+        Args:
+            address: Byte address accessed
+            write: Store (True) or load/fetch (False)
+
+        Returns:
+            Cycles the access adds to its stage (0 for a hit that writes
+            nothing to memory)
+        """
+        line = address >> self.line_shift
+        lines = self.sets[line & self.set_mask]
+        if write:
+            self.writes += 1
+        else:
+            self.reads += 1
+
+        dirty = lines.get(line)
+        if dirty is not None:
+            self.hits += 1
+            if self._move_on_hit:
+                del lines[line]
+                lines[line] = dirty
+            if not write:
+                return 0
+            if self.write_back:
+                lines[line] = True
+                return 0
+            self.memory_writes += 1
+            return self._stall(self.write_latency)
+
+        self.misses += 1
+        if write and not self.write_allocate:
+            self.memory_writes += 1
+            return self._stall(self.write_latency)
+        cycles = self.miss_latency
+        if len(lines) >= self.ways:
+            victim = self.rng.choice(list(lines)) if self.replacement == 'random' else next(iter(lines))
+            if lines.pop(victim):
+                self.writebacks += 1
+                cycles += self.write_latency
+        lines[line] = write and self.write_back
+        if write and not self.write_back:
+            self.memory_writes += 1
+            cycles += self.write_latency
+        return self._stall(cycles)
+
+    def _stall(self, cycles):
+        self.stall_cycles += cycles
+        return cycles
+
+    def contains(self, address):
+        """Check whether the line holding address is present (no side effects)"""
+        line = address >> self.line_shift
+        return line in self.sets[line & self.set_mask]
+
+    def invalidate_all(self):
+        """Drop every line (dirty lines are discarded, not written back)"""
+        for lines in self.sets:
+            lines.clear()
+
+    def get_stats(self, instructions=0):
+        """Get access statistics
+
+        Args:
+            instructions: Instructions retired, for misses per kilo-instruction
+
+        Returns:
+            Dictionary with hit/miss counts, hit rate, MPKI, write-backs,
+            uncached accesses and the stall cycles the cache added
+        """
+        accesses = self.hits + self.misses
+        return {
+            'accesses': accesses,
+            'reads': self.reads,
+            'writes': self.writes,
+            'hits': self.hits,
+            'misses': self.misses,
+            'hit_rate': self.hits / accesses if accesses else 0.0,
+            'mpki': 1000 * self.misses / instructions if instructions else 0.0,
+            'writebacks': self.writebacks,
+            'memory_writes': self.memory_writes,
+            'uncached': self.uncached,
+            'stall_cycles': self.stall_cycles,
+        }
+
+    def __repr__(self):
+        return (f"Cache({self.name}, {self.size} B, {self.ways}-way, {self.line_size} B lines, "
+                f"{self.replacement}, {self.write_policy})")
+
+
+class CacheHierarchy:
+    """I-cache and D-cache in front of Memory, and the pipeline stall they cause
+
+    Used by the pipeline engines: fetch() and data() are called where the
+    fetch engine and the Memory stage access memory, and every pipeline
+    process asks wait() before doing its work for a cycle.
+    """
+
+    def __init__(self, env, memory, icache=None, dcache=None):
+        """
+        Args:
+            env: SimPy environment (the clock)
+            memory: Memory the caches sit in front of (for the uncached regions)
+            icache: Cache for instruction fetch (None: fetch is uncached)
+            dcache: Cache for loads and stores (None: data is uncached)
+        """
+        self.env = env
+        self.memory = memory
+        self.icache = icache
+        self.dcache = dcache
+        # Cycles [stall_start, stall_end) in which the pipeline is held
+        self.stall_start = 0
+        self.stall_end = 0
+        self.stall_cycles = 0
+
+    def fetch(self, pc):
+        """Instruction fetch at pc"""
+        if self.icache is not None:
+            self._access(self.icache, pc, False)
+
+    def data(self, address, write):
+        """Load (write=False) or store at address"""
+        if self.dcache is not None:
+            self._access(self.dcache, address, write)
+
+    def _access(self, cache, address, write):
+        region = self.memory.find_region(address)
+        if region is None or region.device is not None:
+            cache.uncached += 1  # Device registers (or a faulting address)
+            return
+        cycles = cache.access(address, write)
+        if cycles:
+            self.stall(cycles)
+
+    def stall(self, cycles):
+        """Hold the pipeline for cycles after the current one
+
+        This cycle's work completes; nothing in the pipeline moves for the
+        next cycles. Stalls requested in the same cycle (an I-cache and a
+        D-cache miss) are served one after the other.
+        """
+        now = int(self.env.now)
+        if self.stall_end > now:
+            self.stall_end += cycles
+        else:
+            self.stall_start = now + 1
+            self.stall_end = now + 1 + cycles
+        self.stall_cycles += cycles
+
+    def wait(self):
+        """Get the cycles the pipeline is still held for (0: not stalled)"""
+        now = self.env.now
+        if self.stall_start <= now < self.stall_end:
+            return self.stall_end - now
+        return 0
+
+    def get_stats(self, instructions=0):
+        """Get per-cache statistics (None for an absent cache) and the total stall
+
+        Args:
+            instructions: Instructions retired, for MPKI
+        """
+        return {
+            'icache': self.icache.get_stats(instructions) if self.icache is not None else None,
+            'dcache': self.dcache.get_stats(instructions) if self.dcache is not None else None,
+            'stall_cycles': self.stall_cycles,
+        }
+
+
+def make_cache(name, config):
+    """Build a Cache from a configuration
+
+    Args:
+        name: Cache name ('icache', 'dcache')
+        config: None (no cache), True (default geometry), or a dict of
+                Cache keyword arguments
+
+    Returns:
+        Cache, or None
+    """
+    if config is None or config is False:
+        return None
+    if config is True:
+        return Cache(name)
+    return Cache(name, **config)
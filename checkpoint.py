@@ -0,0 +1,205 @@
+"""Checkpoint/restore of full RISC-V machine state
+
+A checkpoint captures the architectural state shared by the pipeline and
+the functional core, so a run can be restored in milliseconds instead of
+re-running the boot that produced it (e.g. to sample several regions of a
+FreeRTOS run from the same starting point).
+
+Saved state:
+- RegisterFile GPRs, pc and next_pc
+- CSRBank contents (cycle/instret/time synced first)
+- InterruptController trigger modes and latched edges (pending bits live in mip)
+- TrapController legacy pending interrupt codes
+- CLINT mtime (with its time-scale remainder), mtimecmp, msip
+- UART captured output, character count, control register and TX FIFO
+  drain time (buffered host output is written out first)
+- Functional core cycle/instret totals
+- Memory pages holding data (untouched pages are never allocated)
+
+Microarchitectural state (pipeline contents, branch predictor tables,
+decode cache) is not saved; it is rebuilt as the restored run warms up.
+
+File format (little-endian):
+    magic b'PYSIMCKP', u16 version
+    sections: 4-byte tag, u32 payload length, payload
+Sections with unknown tags are skipped on load. The MEM section payload
+is zlib-compressed.
+"""
+
+import struct
+import zlib
+
+from memory import PAGE_SIZE, PAGE_SHIFT
+
+
+MAGIC = b'PYSIMCKP'
+VERSION = 1
+
+_HEADER = struct.Struct('<8sH')
+_SECTION = struct.Struct('<4sI')
+_REGS = struct.Struct('<34I')
+_CSR = struct.Struct('<HI')
+_CLINT = struct.Struct('<QQQIBQ')
+_CORE = struct.Struct('<QQ')
+
+
+def _bits(values):
+    """Pack a set of small bit positions into a mask"""
+    mask = 0
+    for bit in values:
+        mask |= 1 << bit
+    return mask
+
+
+def _unbits(mask):
+    return {bit for bit in range(mask.bit_length()) if (mask >> bit) & 1}
+
+
+def _encode_sections(processor):
+    """Build (tag, payload) pairs for a processor's state"""
+    pipeline = processor.pipeline
+    core = processor.functional
+    register_file = processor.register_file
+    clint = pipeline.clint
+    uart = pipeline.uart
+    interrupts = pipeline.interrupt_controller
+
+    # Bring counter CSRs and CLINT time up to date with both engines
+    core.sync_counters()
+    pipeline.sync_counters()
+
+    yield b'REGS', _REGS.pack(*register_file.regs, register_file.pc, register_file.next_pc)
+
+    csrs = sorted(pipeline.csr_bank.csrs.items())
+    yield b'CSRS', struct.pack('<I', len(csrs)) + b''.join(
+        _CSR.pack(addr, value & 0xFFFFFFFF) for addr, value in csrs)
+
+    yield b'INTC', struct.pack('<III', _bits(interrupts.edge_triggered),
+                               _bits(interrupts.level_triggered), _bits(interrupts.latched_edges))
+
+    codes = sorted(pipeline.trap_controller.pending_interrupts)
+    yield b'TRAP', struct.pack(f'<I{len(codes)}I', len(codes), *codes)
+
+    yield b'CLNT', _CLINT.pack(clint.mtime, clint.cycle_count, clint.mtimecmp,
+                               clint.msip, int(clint.timer_enabled), clint.time_scale)
+
+    uart.flush()
+    yield b'UART', struct.pack('<II', uart.char_count, len(uart.captured)) + bytes(uart.captured)
+    ctrl, remaining, irq = uart.get_fifo_state()
+    yield b'UTXF', struct.pack('<IQB', ctrl, remaining, int(irq))
+
+    yield b'CORE', _CORE.pack(core.cycles, core.instret)
+
+    pages = [(address >> PAGE_SHIFT, page) for address, page in processor.memory.iter_pages()
+             if page.count(0) != PAGE_SIZE]
+    body = struct.pack('<I', len(pages)) + b''.join(
+        struct.pack('<I', number) + bytes(page) for number, page in pages)
+    yield b'MEM ', zlib.compress(body, 1)
+
+
+def save_checkpoint(processor, path):
+    """Write a processor's machine state to a checkpoint file
+
+    Args:
+        processor: RISCVProcessor to save
+        path: Output file path
+    """
+    with open(path, 'wb') as f:
+        f.write(_HEADER.pack(MAGIC, VERSION))
+        for tag, payload in _encode_sections(processor):
+            f.write(_SECTION.pack(tag, len(payload)))
+            f.write(payload)
+
+
+def _read_sections(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if len(data) < _HEADER.size:
+        raise ValueError(f"Not a checkpoint file: {path}")
+    magic, version = _HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise ValueError(f"Not a checkpoint file: {path}")
+    if version != VERSION:
+        raise ValueError(f"Unsupported checkpoint version {version} (expected {VERSION})")
+
+    sections = {}
+    offset = _HEADER.size
+    while offset < len(data):
+        tag, length = _SECTION.unpack_from(data, offset)
+        offset += _SECTION.size
+        sections[tag] = memoryview(data)[offset:offset + length]
+        offset += length
+    return sections
+
+
+def load_checkpoint(processor, path):
+    """Restore a processor's machine state from a checkpoint file
+
+    The processor must have the same memory map as the one saved. A
+    following execute_from_memory() (with entry_pc=None) or fast_forward()
+    continues from the checkpointed PC. After the restore no page is dirty,
+    so memory.dirty_pages then lists the pages changed since the checkpoint.
+
+    Args:
+        processor: RISCVProcessor to overwrite
+        path: Checkpoint file path
+
+    Raises:
+        ValueError: If the file is not a checkpoint of a supported version
+    """
+    sections = _read_sections(path)
+    pipeline = processor.pipeline
+    core = processor.functional
+    register_file = processor.register_file
+    clint = pipeline.clint
+    uart = pipeline.uart
+    interrupts = pipeline.interrupt_controller
+
+    values = _REGS.unpack(sections[b'REGS'])
+    register_file.regs[:] = values[:32]
+    register_file.regs[0] = 0
+    register_file.pc, register_file.next_pc = values[32], values[33]
+
+    payload = sections[b'CSRS']
+    count, = struct.unpack_from('<I', payload)
+    csrs = pipeline.csr_bank.csrs
+    csrs.clear()
+    for addr, value in _CSR.iter_unpack(payload[4:4 + count * _CSR.size]):
+        csrs[addr] = value
+
+    edge, level, latched = struct.unpack('<III', sections[b'INTC'])
+    interrupts.edge_triggered = _unbits(edge)
+    interrupts.level_triggered = _unbits(level)
+    interrupts.latched_edges = _unbits(latched)
+
+    payload = sections[b'TRAP']
+    count, = struct.unpack_from('<I', payload)
+    pipeline.trap_controller.pending_interrupts = set(struct.unpack_from(f'<{count}I', payload, 4))
+
+    mtime, cycle_count, mtimecmp, msip, timer_enabled, time_scale = _CLINT.unpack(sections[b'CLNT'])
+    clint.time_scale = time_scale
+    clint.timer_enabled = bool(timer_enabled)
+    clint.msip = msip
+    clint.set_time(mtime, cycle_count)
+    clint.mtimecmp = mtimecmp
+
+    payload = sections[b'UART']
+    uart.char_count, length = struct.unpack_from('<II', payload)
+    uart.captured[:] = payload[8:8 + length]
+    if b'UTXF' in sections:
+        uart.set_fifo_state(*struct.unpack('<IQB', sections[b'UTXF']))
+
+    core.set_counts(*_CORE.unpack(sections[b'CORE']))
+
+    memory = processor.memory
+    body = zlib.decompress(sections[b'MEM '])
+    count, = struct.unpack_from('<I', body)
+    memory.clear()
+    offset = 4
+    for _ in range(count):
+        number, = struct.unpack_from('<I', body, offset)
+        memory.install_page(number, body[offset + 4:offset + 4 + PAGE_SIZE])
+        offset += 4 + PAGE_SIZE
+
+    # Cached decodes may describe the pre-restore code
+    pipeline.decode_cache.invalidate_all()
@@ -5,14 +5,37 @@ Implements the RISC-V CLINT peripheral providing:
 - Software interrupts (msip) for inter-processor interrupts
 
 Memory Map (standard RISC-V CLINT):
-- 0x02000000: msip (Machine Software Interrupt Pending) - 4 bytes
-- 0x02004000: mtimecmp (Machine Timer Compare) - 8 bytes  
-- 0x0200bff8: mtime (Machine Time) - 8 bytes
+- 0x02000000 + 4*hart: msip (Machine Software Interrupt Pending) - 4 bytes
+- 0x02004000 + 8*hart: mtimecmp (Machine Timer Compare) - 8 bytes  
+- 0x0200bff8: mtime (Machine Time, shared by all harts) - 8 bytes
 
 This is essential for FreeRTOS and other RTOS implementations that rely
 on periodic timer interrupts for task scheduling.
+
+Time keeping is lazy: mtime is computed from a cycle count when read
+instead of being incremented every cycle. The cycle count is the SimPy
+clock (once attach() has been called) plus any cycles advanced with
+tick(). When attached, a single timeout is scheduled for the cycle at
+which mtime reaches mtimecmp, and rescheduled whenever mtime or mtimecmp
+is written, so the timer costs nothing between interrupts.
+
+Other devices that raise interrupts after a delay (the UART's TX FIFO)
+schedule callbacks on the same clock with schedule(). They count as timer
+events in cycles_until_timer(), so every engine ticks, wakes from idle and
+re-checks interrupts for them just as for mtimecmp.
+
+Harts beyond the first are added with add_hart(), each with its own
+interrupt controller, msip and mtimecmp; mtime is shared. The msip,
+mtimecmp and interrupt_controller attributes are hart 0's. A quantum
+scheduler (multihart.py) runs one hart at a time over the same span of
+cycles: it sets active_hart so only that hart's compare fires while it
+runs, and rewind()s the clock to the start of the quantum for the next.
 """
 
+import heapq
+
+MTIME_MASK = 0xFFFFFFFFFFFFFFFF
+
 
 class CLINT:
     """Core Local Interruptor peripheral
@@ -34,75 +57,327 @@ class CLINT:
                        1 = increment every cycle
                        1000 = increment every 1000 cycles (for ms timing)
         """
-        self.interrupt_controller = interrupt_controller
+        self.interrupt_controller = interrupt_controller  # Hart 0's
+        self.interrupt_controllers = [interrupt_controller]
         self.time_scale = time_scale
         
-        # Timer registers (64-bit)
-        self.mtime = 0          # Current time counter
-        self.mtimecmp = 0xFFFFFFFFFFFFFFFF  # Timer compare (default: max value, no interrupt)
+        # Clock: SimPy environment (attach()) plus cycles advanced by tick()
+        self.env = None
+        self._ticked_cycles = 0
         
-        # Software interrupt register (32-bit)
-        self.msip = 0           # Software interrupt pending
+        # Timer registers (64-bit): mtime = _mtime_base + elapsed cycles / time_scale
+        self._mtime_base = 0
+        self._cycle_base = 0
+        # Per hart: timer compare (default: max value, no interrupt), and a
+        # generation bumped to cancel the scheduled timer event
+        self._mtimecmps = [MTIME_MASK]
+        self._timer_generations = [0]
+        self.active_hart = None  # Only hart whose compare fires (None: every hart)
+        
+        # Device callbacks (see schedule()): heap of (due cycle, sequence, callback)
+        self._device_events = []
+        self._device_sequence = 0
+        
+        # Software interrupt registers (32-bit), per hart
+        self.msips = [0]
         
         # Internal state
-        self.cycle_count = 0    # Cycle counter for time scaling
         self.timer_enabled = True
+    
+    def add_hart(self, interrupt_controller):
+        """Add a hart with its own msip and mtimecmp
+        
+        Args:
+            interrupt_controller: The hart's InterruptController
+        
+        Returns:
+            Hart number (its register offsets in the memory map)
+        """
+        self.interrupt_controllers.append(interrupt_controller)
+        self._mtimecmps.append(MTIME_MASK)
+        self._timer_generations.append(0)
+        self.msips.append(0)
+        return len(self.msips) - 1
+    
+    @property
+    def num_harts(self):
+        """Number of harts the CLINT serves"""
+        return len(self.msips)
+    
+    @property
+    def msip(self):
+        """Hart 0's software interrupt pending register"""
+        return self.msips[0]
+    
+    @msip.setter
+    def msip(self, value):
+        self.msips[0] = value
+    
+    def _now(self):
+        """Current cycle count of the CLINT clock"""
+        # env.now is a float once env.run(until=...) has returned
+        return (int(self.env.now) if self.env is not None else 0) + self._ticked_cycles
+    
+    @property
+    def now(self):
+        """Current cycle of the CLINT clock (the time base of schedule())"""
+        return self._now()
+    
+    @property
+    def mtime(self):
+        """Current time counter"""
+        elapsed = self._now() - self._cycle_base
+        return (self._mtime_base + elapsed // self.time_scale) & MTIME_MASK
+    
+    @mtime.setter
+    def mtime(self, value):
+        self._rebase(value, self.cycle_count)
+    
+    @property
+    def cycle_count(self):
+        """Cycles since mtime last incremented (time scaling remainder)"""
+        return (self._now() - self._cycle_base) % self.time_scale
+    
+    @property
+    def mtimecmp(self):
+        """Hart 0's timer compare register"""
+        return self._mtimecmps[0]
+    
+    @mtimecmp.setter
+    def mtimecmp(self, value):
+        self.set_mtimecmp(0, value)
+    
+    def get_mtimecmp(self, hart):
+        """Get a hart's timer compare register"""
+        return self._mtimecmps[hart]
+    
+    def set_mtimecmp(self, hart, value):
+        """Set a hart's timer compare register (the pending timer interrupt is left as is)"""
+        self._mtimecmps[hart] = value
+        self._schedule_hart_timer(hart)
+    
+    def rewind(self, cycle):
+        """Move the clock back to an earlier cycle of a quantum
+        
+        Lets the next hart of a quantum run over the same cycles (see
+        multihart.py). mtime and device due times are not changed: a hart
+        sees the others' register and device writes as soon as they were
+        made, up to a quantum early.
+        
+        Args:
+            cycle: Cycle to return to (CLINT clock, see now)
+        """
+        self._ticked_cycles -= self._now() - cycle
+    
+    def _rebase(self, mtime, cycle_count=0):
+        """Set mtime (and the scaling remainder) as of the current cycle"""
+        self._mtime_base = mtime & MTIME_MASK
+        self._cycle_base = self._now() - cycle_count
+        self._schedule_timer()
+    
+    def set_time(self, mtime, cycle_count=0):
+        """Set mtime and the time-scaling remainder as of the current cycle
+        
+        Args:
+            mtime: New 64-bit time value
+            cycle_count: Cycles already elapsed towards the next increment
+        """
+        self._rebase(mtime, cycle_count)
+    
+    def attach(self, env):
+        """Drive time from a SimPy environment's clock
         
+        mtime carries on from its current value. Call again (with the same
+        environment) before simulating after tick() has advanced time, to
+        reschedule the timer event.
+        
+        Args:
+            env: simpy.Environment whose now is the cycle count
+        """
+        if env is self.env:
+            self._schedule_timer()
+            self._schedule_device_events()
+            return
+        mtime, cycle_count = self.mtime, self.cycle_count
+        now = self._now()
+        self.env = env
+        self._ticked_cycles = 0
+        self._rebase(mtime, cycle_count)
+        # Device callbacks keep their remaining delay on the new clock
+        shift = self._now() - now
+        self._device_events = [(due + shift, sequence, callback)
+                               for due, sequence, callback in self._device_events]
+        self._schedule_device_events()
+    
+    def _schedule_timer(self):
+        """Schedule every hart's timer interrupt"""
+        for hart in range(len(self._mtimecmps)):
+            self._schedule_hart_timer(hart)
+    
+    def _schedule_hart_timer(self, hart):
+        """Schedule a hart's timer interrupt for the cycle mtime reaches its mtimecmp"""
+        self._timer_generations[hart] += 1
+        mtimecmp = self._mtimecmps[hart]
+        if self.env is None or not self.timer_enabled or mtimecmp == MTIME_MASK:
+            return
+        due_cycle = self._cycle_base + (mtimecmp - self._mtime_base) * self.time_scale
+        delay = max(0, due_cycle - self._now())
+        event = self.env.timeout(delay, value=(hart, self._timer_generations[hart]))
+        event.callbacks.append(self._timer_event)
+    
+    def schedule(self, delay, callback):
+        """Call callback() once delay cycles have passed on the CLINT clock
+        
+        Args:
+            delay: Cycles from now (at least 1)
+            callback: Called with no arguments; it re-checks its device's
+                      state, as an earlier request may have been superseded
+        """
+        due = self._now() + max(1, delay)
+        heapq.heappush(self._device_events, (due, self._device_sequence, callback))
+        self._device_sequence += 1
+        if self.env is not None:
+            self.env.timeout(due - self._now()).callbacks.append(self._device_event)
+    
+    def _schedule_device_events(self):
+        """Schedule a SimPy timeout for every pending device callback"""
+        if self.env is None:
+            return
+        now = self._now()
+        for due, _, _ in self._device_events:
+            self.env.timeout(max(0, due - now)).callbacks.append(self._device_event)
+    
+    def _device_event(self, event):
+        self._run_device_events()
+    
+    def _run_device_events(self):
+        """Call the device callbacks that have come due"""
+        events = self._device_events
+        now = self._now()
+        while events and events[0][0] <= now:
+            heapq.heappop(events)[2]()
+    
+    def cycles_until_timer(self):
+        """Cycles until the timer or a device callback next raises its interrupt
+        
+        Returns:
+            Cycle count, or None when neither can: see
+            cycles_until_compare() and schedule()
+        """
+        cycles = self.cycles_until_compare()
+        if self._device_events:
+            device = max(1, self._device_events[0][0] - self._now())
+            cycles = device if cycles is None else min(cycles, device)
+        return cycles
+    
+    def cycles_until_compare(self):
+        """Cycles until the timer next raises an interrupt (the active hart's only, if set)
+        
+        Returns:
+            Cycle count (1 if it is due but not raised yet), or None when
+            it cannot fire: disabled, no compare set, or already pending
+            (only a mtimecmp write re-arms it)
+        """
+        if not self.timer_enabled:
+            return None
+        harts = range(len(self._mtimecmps)) if self.active_hart is None else (self.active_hart,)
+        cycles = None
+        for hart in harts:
+            mtimecmp = self._mtimecmps[hart]
+            if mtimecmp == MTIME_MASK:
+                continue
+            remaining = mtimecmp - self.mtime
+            if remaining <= 0:
+                controller = self.interrupt_controllers[hart]
+                if controller.is_pending(controller.INT_TIMER):
+                    continue
+                hart_cycles = 1
+            else:
+                hart_cycles = remaining * self.time_scale - self.cycle_count
+            if cycles is None or hart_cycles < cycles:
+                cycles = hart_cycles
+        return cycles
+    
+    def _timer_event(self, event):
+        hart, generation = event.value
+        if generation == self._timer_generations[hart]:
+            self._check_hart_timer(hart)
+    
     def tick(self, cycles=1):
         """Advance the timer by specified cycles
         
-        Should be called each simulation cycle to update mtime and check
-        for timer interrupt conditions.
+        Standalone CLINTs (and the functional core, which does not advance
+        the SimPy clock) call this to move time forward; attached CLINTs
+        also advance with the SimPy clock on their own. The scheduled timer
+        event is not moved: call attach() again before simulating.
         
         Args:
             cycles: Number of cycles to advance (default: 1)
         """
         if not self.timer_enabled:
             return
-            
-        self.cycle_count += cycles
         
-        # Update mtime based on time scale
-        if self.cycle_count >= self.time_scale:
-            mtime_increment = self.cycle_count // self.time_scale
-            self.mtime = (self.mtime + mtime_increment) & 0xFFFFFFFFFFFFFFFF
-            self.cycle_count = self.cycle_count % self.time_scale
-            
-            # Check for timer interrupt
+        old_mtime = self.mtime
+        self._ticked_cycles += cycles
+        if self._device_events:
+            self._run_device_events()
+        
+        # Check for timer interrupt when mtime advanced
+        if self.mtime != old_mtime:
             self._check_timer_interrupt()
     
     def _check_timer_interrupt(self):
-        """Check if timer interrupt should be triggered"""
-        if self.mtime >= self.mtimecmp:
+        """Check if timer interrupts should be triggered (the active hart's only, if set)"""
+        if self.active_hart is not None:
+            self._check_hart_timer(self.active_hart)
+            return
+        for hart in range(len(self._mtimecmps)):
+            self._check_hart_timer(hart)
+    
+    def _check_hart_timer(self, hart):
+        if self.mtime >= self._mtimecmps[hart]:
             # Trigger timer interrupt
-            self.interrupt_controller.set_pending(self.interrupt_controller.INT_TIMER)
+            controller = self.interrupt_controllers[hart]
+            controller.set_pending(controller.INT_TIMER)
+    
+    def _decode_hart(self, address):
+        """Map a msip/mtimecmp address to (register base, hart), or (address, None)"""
+        if self.MSIP_BASE <= address < self.MSIP_BASE + 4 * len(self.msips):
+            offset = address - self.MSIP_BASE
+            return self.MSIP_BASE + (offset & 0x3), offset >> 2
+        if self.MTIMECMP_BASE <= address < self.MTIMECMP_BASE + 8 * len(self._mtimecmps):
+            offset = address - self.MTIMECMP_BASE
+            return self.MTIMECMP_BASE + (offset & 0x7), offset >> 3
+        return address, None
     
     def read_register(self, address):
         """Read from CLINT memory-mapped register
         
         Args:
-            address: Register address
+            address: Register address (msip and mtimecmp of any hart)
             
         Returns:
             Register value (32-bit or 64-bit depending on register)
         """
-        if address == self.MSIP_BASE:
+        register, hart = self._decode_hart(address)
+        
+        if register == self.MSIP_BASE:
             # Read msip (32-bit)
-            return self.msip & 0xFFFFFFFF
+            return self.msips[hart] & 0xFFFFFFFF
             
-        elif address == self.MTIMECMP_BASE:
+        elif register == self.MTIMECMP_BASE:
             # Read lower 32 bits of mtimecmp
-            return self.mtimecmp & 0xFFFFFFFF
+            return self._mtimecmps[hart] & 0xFFFFFFFF
             
-        elif address == self.MTIMECMP_BASE + 4:
+        elif register == self.MTIMECMP_BASE + 4:
             # Read upper 32 bits of mtimecmp
-            return (self.mtimecmp >> 32) & 0xFFFFFFFF
+            return (self._mtimecmps[hart] >> 32) & 0xFFFFFFFF
             
-        elif address == self.MTIME_BASE:
+        elif register == self.MTIME_BASE:
             # Read lower 32 bits of mtime
             return self.mtime & 0xFFFFFFFF
             
-        elif address == self.MTIME_BASE + 4:
+        elif register == self.MTIME_BASE + 4:
             # Read upper 32 bits of mtime
             return (self.mtime >> 32) & 0xFFFFFFFF
             
@@ -114,39 +389,43 @@ class CLINT:
         """Write to CLINT memory-mapped register
         
         Args:
-            address: Register address
+            address: Register address (msip and mtimecmp of any hart)
             value: Value to write (32-bit)
         """
         value = value & 0xFFFFFFFF  # Ensure 32-bit
+        register, hart = self._decode_hart(address)
         
-        if address == self.MSIP_BASE:
+        if register == self.MSIP_BASE:
             # Write msip (only bit 0 is significant)
-            old_msip = self.msip
-            self.msip = value & 0x1
+            old_msip = self.msips[hart]
+            self.msips[hart] = msip = value & 0x1
             
             # Trigger/clear software interrupt
-            if self.msip and not old_msip:
-                self.interrupt_controller.set_pending(self.interrupt_controller.INT_SOFTWARE)
-            elif not self.msip and old_msip:
-                self.interrupt_controller.clear_pending(self.interrupt_controller.INT_SOFTWARE)
+            controller = self.interrupt_controllers[hart]
+            if msip and not old_msip:
+                controller.set_pending(controller.INT_SOFTWARE)
+            elif not msip and old_msip:
+                controller.clear_pending(controller.INT_SOFTWARE)
                 
-        elif address == self.MTIMECMP_BASE:
+        elif register == self.MTIMECMP_BASE:
             # Write lower 32 bits of mtimecmp
-            self.mtimecmp = (self.mtimecmp & 0xFFFFFFFF00000000) | value
+            self.set_mtimecmp(hart, (self._mtimecmps[hart] & 0xFFFFFFFF00000000) | value)
             # Clear timer interrupt when mtimecmp is written
-            self.interrupt_controller.clear_pending(self.interrupt_controller.INT_TIMER)
+            controller = self.interrupt_controllers[hart]
+            controller.clear_pending(controller.INT_TIMER)
             
-        elif address == self.MTIMECMP_BASE + 4:
+        elif register == self.MTIMECMP_BASE + 4:
             # Write upper 32 bits of mtimecmp
-            self.mtimecmp = (self.mtimecmp & 0xFFFFFFFF) | (value << 32)
+            self.set_mtimecmp(hart, (self._mtimecmps[hart] & 0xFFFFFFFF) | (value << 32))
             # Clear timer interrupt when mtimecmp is written
-            self.interrupt_controller.clear_pending(self.interrupt_controller.INT_TIMER)
+            controller = self.interrupt_controllers[hart]
+            controller.clear_pending(controller.INT_TIMER)
             
-        elif address == self.MTIME_BASE:
+        elif register == self.MTIME_BASE:
             # Write lower 32 bits of mtime
             self.mtime = (self.mtime & 0xFFFFFFFF00000000) | value
             
-        elif address == self.MTIME_BASE + 4:
+        elif register == self.MTIME_BASE + 4:
             # Write upper 32 bits of mtime
             self.mtime = (self.mtime & 0xFFFFFFFF) | (value << 32)
     
@@ -164,7 +443,7 @@ class CLINT:
         Args:
             value: 64-bit value to write
         """
-        self.mtime = value & 0xFFFFFFFFFFFFFFFF
+        self.mtime = value
     
     def read_mtimecmp_64(self):
         """Read full 64-bit mtimecmp value
@@ -180,7 +459,7 @@ class CLINT:
         Args:
             value: 64-bit value to write
         """
-        self.mtimecmp = value & 0xFFFFFFFFFFFFFFFF
+        self.mtimecmp = value & MTIME_MASK
         # Clear timer interrupt when mtimecmp is written
         self.interrupt_controller.clear_pending(self.interrupt_controller.INT_TIMER)
     
@@ -194,7 +473,7 @@ class CLINT:
     
     def clear_timer_interrupt(self):
         """Clear pending timer interrupt by setting mtimecmp to max"""
-        self.mtimecmp = 0xFFFFFFFFFFFFFFFF
+        self.mtimecmp = MTIME_MASK
         self.interrupt_controller.clear_pending(self.interrupt_controller.INT_TIMER)
     
     def trigger_software_interrupt(self):
@@ -208,13 +487,14 @@ class CLINT:
         self.interrupt_controller.clear_pending(self.interrupt_controller.INT_SOFTWARE)
     
     def reset(self):
-        """Reset CLINT to initial state"""
-        self.mtime = 0
-        self.mtimecmp = 0xFFFFFFFFFFFFFFFF
-        self.msip = 0
-        self.cycle_count = 0
-        self.interrupt_controller.clear_pending(self.interrupt_controller.INT_TIMER)
-        self.interrupt_controller.clear_pending(self.interrupt_controller.INT_SOFTWARE)
+        """Reset CLINT to initial state (every hart's msip and mtimecmp)"""
+        self._rebase(0)
+        self._device_events.clear()
+        for hart, controller in enumerate(self.interrupt_controllers):
+            self.set_mtimecmp(hart, MTIME_MASK)
+            self.msips[hart] = 0
+            controller.clear_pending(controller.INT_TIMER)
+            controller.clear_pending(controller.INT_SOFTWARE)
     
     def get_status(self):
         """Get current CLINT status
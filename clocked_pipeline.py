@@ -0,0 +1,277 @@
+"""
+Clocked pipeline engine: explicit stage latches, one tick() per cycle
+
+ClockedPipeline runs programs from memory with the same stages, hazard
+checks, squash/flush logic, traps, interrupts and counters as the SimPy
+engine (Pipeline.run_from_memory), but keeps the pipeline contents in latch
+registers and advances them itself. A cycle costs one SimPy event (the
+clock) instead of a dozen or so per stage; SimPy is left scheduling the
+clock and peripheral events such as the CLINT timer; while the fetch
+engine sleeps through idle time (Pipeline.sleep()), or a cache miss holds
+the pipeline (cache.CacheHierarchy), the clock skips ahead.
+
+Each tick() does, in this order, what the SimPy engine does within a cycle:
+1. Work done at the end of the cycle: WriteBack, Memory and Execute finish
+   their instruction (in that order), Decode reads its operands, and a
+   stalled Decode re-checks its hazard against last cycle's stage contents
+   (so a stall lasts a cycle longer than the producer takes to clear MEM).
+   The fetch engine fetches before this stage work, or after it when its
+   previous fetch had to wait for room in the fetch buffer; the first
+   re-check after a new stall also comes after it.
+2. Stage bookkeeping in reverse order: retirement, the tohost check and
+   the flush/redirect decisions after Execute.
+3. Latches move forward: WB <- MEM <- EX <- ID (wrong-path instructions are
+   squashed on entering Decode or Execute), Decode checks a newly arrived
+   instruction against this cycle's EX/MEM contents, and the single-entry
+   fetch buffers refill from the fetch side.
+
+Results (cycle counts, registers, memory, CSRs, counters) are identical to
+the SimPy engine's for run_from_memory(); run() on instruction lists still
+uses the SimPy stage processes.
+"""
+
+from instruction import Instruction, BUBBLE_DECODED
+from pipeline import Pipeline
+
+
+class ClockedPipeline(Pipeline):
+    """5-stage pipeline advanced by explicit per-cycle ticks (run_from_memory)"""
+
+    def __init__(self, env, enable_forwarding=False, trace=None, predictor=None, icache=None, dcache=None):
+        super().__init__(env, enable_forwarding, trace, predictor, icache, dcache)
+
+        # Front end: single-entry buffers as in the SimPy engine's Stores
+        self.fetch_pending = None   # Fetched, waiting for room in fetch_buffer
+        self.fetch_buffer = None    # Fetch engine -> Fetch
+        self.fetch_latch = None     # In Fetch; stays there while decode_buffer is full
+        self.decode_buffer = None   # Fetch -> Decode
+        self.fetch_late = False     # Fetch engine runs after this cycle's stage work
+        self.fetch_retried = False  # A fetch that had to wait has re-run this cycle
+
+        # Stage latches: what each stage holds this cycle (Instruction, bubble or None)
+        self.decode_latch = None
+        self.decode_stalled = None  # Instruction held in Decode by a hazard
+        self.recheck_late = False   # Its first re-check comes after the stage work
+        self.execute_latch = None
+        self.memory_latch = None
+        self.writeback_latch = None
+
+    def reset_run_state(self):
+        """Start a new run with empty latches (see Pipeline.reset_run_state())"""
+        super().reset_run_state()
+        self.fetch_pending = self.fetch_buffer = self.fetch_latch = self.decode_buffer = None
+        self.fetch_late = self.fetch_retried = False
+        self.decode_latch = self.decode_stalled = None
+        self.recheck_late = False
+        self.execute_latch = self.memory_latch = self.writeback_latch = None
+
+    def run_from_memory(self, entry_pc=None, max_cycles=100000, max_instret=None,
+                        breakpoints=(), halt_on=(), tohost=None):
+        """Run the program loaded in memory, fetching at the real PC
+
+        Same arguments, stop conditions and results as
+        Pipeline.run_from_memory().
+        """
+        self.configure_memory_run(entry_pc, max_instret, breakpoints, halt_on, tohost)
+
+        self.clint.attach(self.env)
+        self.stop_event = self.env.event()
+        self.deadline = int(self.env.now) + max_cycles
+        self.env.process(self.clock(self.deadline))
+        self.env.run(until=self.stop_event)
+        self.uart.flush()
+
+        return self.completed_instructions
+
+    def clock(self, deadline):
+        """SimPy process ticking the pipeline once per cycle until the run ends"""
+        self.start_fetch()
+        env = self.env
+        stop_event = self.stop_event
+        caches = self.caches
+        run = self.run_id
+        while self.run_id == run:
+            self.tick(env.now >= deadline)
+            if stop_event.triggered:
+                return
+            # Nothing moves while the fetch engine sleeps (the pipeline is empty)
+            yield env.timeout(max(1, min(self.idle_until, deadline) - env.now))
+            if caches is not None and caches.wait() and env.now < deadline:
+                # Held by a cache miss: wait again from the held cycle, as
+                # every SimPy process does, so events keep their order
+                yield env.timeout(min(caches.wait(), deadline - env.now))
+
+    def tick(self, last_cycle=False):
+        """Simulate one cycle
+
+        Args:
+            last_cycle: The cycle limit is reached; only the end-of-cycle
+                        work is done before the run stops ('max_cycles')
+        """
+        if last_cycle:
+            # Stop first: events this cycle's stage work schedules for now never run
+            if self.halt_reason is None:
+                self.halt_reason = 'max_cycles'
+            self._stop(self.halt_reason)
+            if self.caches is not None and self.caches.wait():
+                return  # Held by a cache miss: no stage finishes this cycle
+
+        writeback = self.writeback_latch
+        memory = self.memory_latch
+        execute = self.execute_latch
+        decoded = self.decode_latch  # Enters Execute this cycle
+        stalled = self.decode_stalled
+        if self.fetch_retried:
+            # Already run this cycle, ahead of peripheral events that the
+            # last cycle's stage work scheduled
+            fetching = self.fetch_retried = False
+        else:
+            fetching = self.fetch_pending is None and self.halt_reason is None
+        if fetching and not self.fetch_late:
+            self.fetch_cycle(early=True)
+
+        # A stalled Decode sees the stage contents of the previous cycle
+        if stalled is not None and not self.recheck_late:
+            self.recheck_hazard(stalled)
+
+        # End-of-cycle stage work
+        if writeback is not None and not writeback.is_bubble:
+            self.write_back.finish(writeback)
+        if memory is not None and not memory.is_bubble:
+            self.memory_stage.finish(memory)
+        if execute is not None and not execute.is_bubble:
+            self.execute.finish(execute)
+        if decoded is not None and not decoded.is_bubble:
+            self.decode.finish(decoded)
+        if stalled is not None and self.recheck_late:
+            self.recheck_hazard(stalled)
+
+        if fetching and self.fetch_late:
+            self.fetch_cycle()
+
+        if last_cycle:
+            return
+
+        # Leaving WriteBack, Memory and Execute
+        if writeback is not None and not writeback.is_bubble:
+            self.retire(writeback)
+        if memory is not None:
+            self.after_memory(memory)
+            if self.flush_signal:
+                if self.trace.flush:
+                    self.trace.event('flush', self.env.now, "FLUSH: Clearing flush signal")
+                self.flush_signal = False
+                self.flush_target_pc = None
+        if execute is not None and not execute.is_bubble:
+            self.after_execute(execute)
+        if self.stop_event.triggered:
+            return
+
+        # Back end latches move on
+        if decoded is not None and not decoded.is_bubble and decoded.epoch != self.flush_epoch:
+            decoded = self.squash(decoded, 'execute')
+        self.writeback_latch = memory
+        self.memory_latch = execute
+        self.execute_latch = decoded
+        state = self.pipeline_state
+        state['writeback'] = memory
+        state['memory'] = execute
+        state['execute'] = decoded
+        if self.trace.stage:
+            for stage, instruction in ((self.write_back, memory), (self.memory_stage, execute),
+                                       (self.execute, decoded)):
+                if instruction is not None:
+                    stage.start(instruction)
+        stage_trace = self.stage_trace
+        if stage_trace is not None:
+            for name, instruction in (('WriteBack', memory), ('Memory', execute), ('Execute', decoded)):
+                if instruction is not None and not instruction.is_bubble:
+                    stage_trace.enter(name, instruction, self.env.now)
+
+        # Decode takes the next instruction unless it is held by a hazard
+        fetched = self.fetch_latch
+        if stalled is None:
+            incoming = self.decode_buffer
+            if incoming is not None:
+                self.decode_buffer = None
+            elif fetched is not None:
+                incoming = fetched
+                fetched = self.fetch_latch = None
+            if incoming is not None and not incoming.is_bubble:
+                if incoming.epoch != self.flush_epoch:
+                    incoming = self.squash(incoming, 'decode')
+                else:
+                    if stage_trace is not None:
+                        stage_trace.enter('Decode', incoming, self.env.now)
+                    if self.check_hazard(incoming):
+                        self.decode_stalled = incoming
+                        self.recheck_late = True
+                        incoming = self.stall_bubble()
+                    elif self.trace.stage:
+                        self.decode.start(incoming)
+            self.decode_latch = incoming
+
+        # Front end buffers refill towards Decode
+        if fetched is not None and self.decode_buffer is None:
+            self.decode_buffer = fetched
+            fetched = self.fetch_latch = None
+        if fetched is None:
+            fetched = self.fetch_latch = self.fetch_buffer
+            if fetched is not None:
+                if self.trace.stage:
+                    self.fetch.start(fetched)
+                if stage_trace is not None:
+                    stage_trace.enter('Fetch', fetched, self.env.now)
+            self.fetch_buffer = self.fetch_pending
+            if self.fetch_pending is not None:
+                self.fetch_pending = None
+                self.fetch_late = True
+
+    def fetch_cycle(self, early=False):
+        """Run the fetch engine for this cycle (a full fetch buffer makes it wait)
+
+        Args:
+            early: Running ahead of this cycle's stage work. A fetch that
+                   returns nothing here retries next cycle before any event
+                   the stage work schedules, as the SimPy fetcher's timeout
+                   would, so it sees e.g. a CLINT timer firing then as late.
+        """
+        self.fetch_late = False
+        instruction = self.fetch_next()
+        if instruction is not None:
+            if self.fetch_buffer is None:
+                self.fetch_buffer = instruction
+            else:
+                self.fetch_pending = instruction
+        elif early and self.halt_reason is None:
+            wait = max(1, self.idle_until - self.env.now)
+            self.env.timeout(wait).callbacks.append(self.retry_fetch)
+
+    def retry_fetch(self, event):
+        """SimPy callback: this cycle's fetch, ahead of the tick"""
+        if self.halt_reason is not None or self.env.now >= self.deadline:
+            return  # Halted, or the tick stops the run before fetching
+        if self.caches is not None and self.caches.wait():
+            self.env.timeout(self.caches.wait()).callbacks.append(self.retry_fetch)
+            return  # Held by a cache miss
+        self.fetch_cycle(early=True)
+        self.fetch_retried = True
+
+    def recheck_hazard(self, instruction):
+        """Re-check the hazard holding instruction in Decode; issue it once clear"""
+        self.recheck_late = False
+        if self.check_hazard(instruction):
+            self.decode_latch = self.stall_bubble()
+        else:
+            self.decode_stalled = None
+            self.decode_latch = instruction
+            if self.trace.stage:
+                self.decode.start(instruction)
+
+    def stall_bubble(self):
+        """Count a hazard stall; get the bubble Decode sends to Execute instead"""
+        if self.trace.hazard:
+            self.trace.event('hazard', self.env.now, "STALL: Inserting bubble into Execute stage")
+        self.stall_count += 1
+        self.bubble_count += 1
+        return Instruction.from_decoded(BUBBLE_DECODED)
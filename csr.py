@@ -1,5 +1,11 @@
 """CSR (Control and Status Register) Bank for RISC-V simulator"""
 
+# mie/mip bits of the machine software, timer and external interrupts
+INTERRUPT_BITS = (1 << 3) | (1 << 7) | (1 << 11)
+
+# CSRs the deliverable-interrupt mask depends on: mstatus, mie, mip
+INTERRUPT_CSRS = frozenset((0x300, 0x304, 0x344))
+
 
 class CSRBank:
     """Control and Status Register Bank
@@ -37,15 +43,19 @@ class CSRBank:
         0xC02: 'instret',     # Instructions-retired counter (user-mode)
     }
     
-    def __init__(self):
-        """Initialize CSR bank with default values"""
+    def __init__(self, hartid=0):
+        """Initialize CSR bank with default values
+        
+        Args:
+            hartid: Value of mhartid (the hart's number in a multi-hart system)
+        """
         self.csrs = {}
         
         # Initialize with default values
         self.csrs[0xF11] = 0x0         # mvendorid (not implemented)
         self.csrs[0xF12] = 0x0         # marchid (not implemented)
         self.csrs[0xF13] = 0x0         # mimpid (not implemented)
-        self.csrs[0xF14] = 0x0         # mhartid (hart 0)
+        self.csrs[0xF14] = hartid      # mhartid
         
         self.csrs[0x300] = 0x00000000  # mstatus
         self.csrs[0x301] = 0x40000100  # misa (RV32I)
@@ -63,6 +73,14 @@ class CSRBank:
         self.csrs[0xC00] = 0x0         # cycle
         self.csrs[0xC01] = 0x0         # time
         self.csrs[0xC02] = 0x0         # instret
+        
+        # Interrupts raised without a mip bit (TrapController's legacy
+        # pending set), as mie/mip bits
+        self.extra_pending = 0
+        # Interrupts that would be taken now: (mip | extra_pending) & mie,
+        # or 0 while mstatus.MIE is clear. Kept up to date by every write
+        # to mstatus/mie/mip so the per-fetch check is one integer test
+        self.deliverable = 0
     
     def read(self, csr_addr):
         """Read from CSR
@@ -97,8 +115,22 @@ class CSRBank:
             return old_value
         
         self.csrs[csr_addr] = value
+        if csr_addr in INTERRUPT_CSRS:
+            self.update_deliverable()
         return old_value
     
+    def update_deliverable(self):
+        """Recompute the deliverable-interrupt mask
+        
+        Called on writes to mstatus, mie and mip; call it after changing
+        csrs or extra_pending directly (e.g. restoring a checkpoint).
+        """
+        csrs = self.csrs
+        if csrs.get(0x300, 0) & (1 << 3):
+            self.deliverable = (csrs.get(0x344, 0) | self.extra_pending) & csrs.get(0x304, 0) & INTERRUPT_BITS
+        else:
+            self.deliverable = 0
+    
     def set_bits(self, csr_addr, mask):
         """Set bits in CSR (CSRRS operation)
         
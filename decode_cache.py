@@ -0,0 +1,130 @@
+"""Decoded-instruction cache for RISC-V pipeline simulator
+
+Caches DecodedInstruction records by PC so each static instruction is
+parsed once, no matter how many times it is fetched. Each entry remembers
+the key it was decoded from (instruction text or 32-bit word) so a lookup
+with a different key at the same PC re-decodes instead of returning a
+stale record.
+
+Self-modifying code is handled by explicit invalidation:
+- Stores into a page that holds cached code drop the affected entries
+- FENCE.I drops the whole cache
+- Writes through a Memory the cache watches (Memory.watch_code()), host
+  writes included, drop the entries they overwrite
+The generation counter changes whenever a record is dropped or replaced,
+so derived caches (block translations) know when to start over.
+"""
+
+
+class DecodeCache:
+    """PC-indexed cache of immutable DecodedInstruction records"""
+
+    PAGE_SHIFT = 12  # Track code at 4 KiB page granularity
+
+    def __init__(self):
+        """Initialize an empty decode cache"""
+        self.entries = {}     # pc -> (key, decoded)
+        self.code_pages = {}  # page number -> set of cached PCs in that page
+        self.generation = 0   # Bumped when any record is dropped or replaced
+        self.memory = None    # Memory reporting writes into code (Memory.watch_code())
+
+        # Statistics
+        self.hits = 0
+        self.misses = 0
+        self.invalidations = 0
+
+    def lookup(self, pc, key, decoder):
+        """Return the decoded record for the instruction at pc
+
+        Args:
+            pc: Address of the instruction
+            key: Instruction text or 32-bit word at pc
+            decoder: Callable turning key into a DecodedInstruction (on miss)
+
+        Returns:
+            DecodedInstruction for key
+        """
+        entry = self.entries.get(pc)
+        if entry is not None and entry[0] == key:
+            self.hits += 1
+            return entry[1]
+
+        self.misses += 1
+        decoded = decoder(key)
+        self.insert(pc, key, decoded)
+        return decoded
+
+    def get(self, pc):
+        """Return the cached record at pc without validating its key
+
+        Safe only while every write into code goes through invalidate(),
+        as it does once the cache watches the Memory (Memory.watch_code()).
+
+        Returns:
+            DecodedInstruction, or None on a miss
+        """
+        entry = self.entries.get(pc)
+        if entry is None:
+            return None
+        self.hits += 1
+        return entry[1]
+
+    def insert(self, pc, key, decoded):
+        """Add (or replace) the record for pc"""
+        if pc in self.entries:
+            self.generation += 1
+        self.entries[pc] = (key, decoded)
+        page = pc >> self.PAGE_SHIFT
+        pcs = self.code_pages.get(page)
+        if pcs is None:
+            pcs = self.code_pages[page] = set()
+            if self.memory is not None:
+                self.memory.watch_page(page)
+        pcs.add(pc)
+
+    def invalidate(self, address, size=4):
+        """Drop entries overlapping a store to [address, address + size)
+
+        Cheap for stores to data pages: a single dict membership test.
+        """
+        code_pages = self.code_pages
+        first_page = address >> self.PAGE_SHIFT
+        last_page = (address + size - 1) >> self.PAGE_SHIFT
+        if first_page not in code_pages and last_page not in code_pages:
+            return
+
+        # An entry at pc covers [pc, pc + 4)
+        for page in {first_page, last_page}:
+            pcs = code_pages.get(page)
+            if not pcs:
+                continue
+            stale = [pc for pc in pcs if pc < address + size and address < pc + 4]
+            for pc in stale:
+                pcs.discard(pc)
+                del self.entries[pc]
+                self.invalidations += 1
+                self.generation += 1
+            if not pcs:
+                del code_pages[page]
+
+    def invalidate_all(self):
+        """Drop every entry (FENCE.I)"""
+        self.invalidations += len(self.entries)
+        self.generation += 1
+        self.entries.clear()
+        self.code_pages.clear()
+
+    def get_stats(self):
+        """Get decode cache statistics
+
+        Returns:
+            Dictionary with entry count, hits, misses and invalidations
+        """
+        lookups = self.hits + self.misses
+        return {
+            'entries': len(self.entries),
+            'hits': self.hits,
+            'misses': self.misses,
+            'invalidations': self.invalidations,
+            'hit_rate': (self.hits / lookups) if lookups else 0.0,
+        }
@@ -1,4 +1,78 @@
 """EXE (Execution Unit) for RISC-V pipeline simulator"""
+from instruction import Opcode, OPCODE_BY_NAME, STORE_OPCODES
+from trap import TrapController
+
+
+MASK_32 = 0xFFFFFFFF
+
+# Bytes each load/store accesses
+ACCESS_SIZES = {
+    Opcode.LOAD: 4, Opcode.LW: 4, Opcode.LH: 2, Opcode.LHU: 2, Opcode.LB: 1, Opcode.LBU: 1,
+    Opcode.STORE: 4, Opcode.SW: 4, Opcode.SH: 2, Opcode.SB: 1,
+}
+
+
+def memory_fault(memory, opcode, address):
+    """Get the exception a load/store takes instead of accessing memory
+
+    Args:
+        memory: Memory the access goes to
+        opcode: Load/store Opcode
+        address: Effective address
+
+    Returns:
+        (cause, mtval) for a misaligned access or one to an unmapped address,
+        None if the access can be performed
+    """
+    size = ACCESS_SIZES[opcode]
+    store = opcode in STORE_OPCODES
+    if address & (size - 1):
+        cause = TrapController.EXCEPTION_STORE_MISALIGNED if store else TrapController.EXCEPTION_LOAD_MISALIGNED
+    elif memory.is_mapped(address, size):
+        return None
+    else:
+        cause = TrapController.EXCEPTION_STORE_ACCESS_FAULT if store else TrapController.EXCEPTION_LOAD_ACCESS_FAULT
+    return cause, address
+
+
+def _to_signed(value):
+    """Convert 32-bit unsigned value to signed integer"""
+    return value - 0x100000000 if value & 0x80000000 else value
+
+
+def _sra(operand1, operand2):
+    """Shift right arithmetic: the sign bit fills from the left"""
+    return (_to_signed(operand1) >> (operand2 & 0x1F)) & MASK_32
+
+
+# ALU functions by opcode id (operands are 32-bit unsigned; shifts use the low 5 bits)
+ALU_FUNCTIONS = {
+    Opcode.ADD: lambda a, b: (a + b) & MASK_32,
+    Opcode.SUB: lambda a, b: (a - b) & MASK_32,
+    Opcode.AND: lambda a, b: a & b,
+    Opcode.OR: lambda a, b: a | b,
+    Opcode.XOR: lambda a, b: a ^ b,
+    Opcode.SLT: lambda a, b: 1 if _to_signed(a) < _to_signed(b) else 0,
+    Opcode.SLTU: lambda a, b: 1 if a < b else 0,
+    Opcode.SLL: lambda a, b: (a << (b & 0x1F)) & MASK_32,
+    Opcode.SRL: lambda a, b: a >> (b & 0x1F),
+    Opcode.SRA: _sra,
+}
+# Immediate forms share the register-register functions
+for _imm_op, _reg_op in [(Opcode.ADDI, Opcode.ADD), (Opcode.ANDI, Opcode.AND), (Opcode.ORI, Opcode.OR),
+                         (Opcode.XORI, Opcode.XOR), (Opcode.SLTI, Opcode.SLT), (Opcode.SLTIU, Opcode.SLTU),
+                         (Opcode.SLLI, Opcode.SLL), (Opcode.SRLI, Opcode.SRL), (Opcode.SRAI, Opcode.SRA)]:
+    ALU_FUNCTIONS[_imm_op] = ALU_FUNCTIONS[_reg_op]
+
+# Branch conditions by opcode id (operands are 32-bit unsigned)
+BRANCH_CONDITIONS = {
+    Opcode.BEQ: lambda a, b: a == b,
+    Opcode.BNE: lambda a, b: a != b,
+    Opcode.BLT: lambda a, b: _to_signed(a) < _to_signed(b),
+    Opcode.BGE: lambda a, b: _to_signed(a) >= _to_signed(b),
+    Opcode.BLTU: lambda a, b: a < b,
+    Opcode.BGEU: lambda a, b: a >= b,
+}
 
 
 class EXE:
@@ -15,71 +89,29 @@ class EXE:
         Returns:
             Result of the operation (32-bit value)
         """
-        op = operation.upper()
-        
-        # Ensure 32-bit operations (mask to 32 bits)
-        MASK_32 = 0xFFFFFFFF
-        operand1 = operand1 & MASK_32
-        operand2 = operand2 & MASK_32
+        function = ALU_FUNCTIONS.get(OPCODE_BY_NAME.get(operation.upper()))
+        if function is None:
+            return 0
+        return function(operand1 & MASK_32, operand2 & MASK_32)
+    
+    @staticmethod
+    def execute_alu(opcode, operand1, operand2):
+        """Execute ALU operation by opcode id (hot path, no string handling)
         
-        # Basic arithmetic
-        if op == 'ADD' or op == 'ADDI':
-            result = (operand1 + operand2) & MASK_32
-        elif op == 'SUB':
-            result = (operand1 - operand2) & MASK_32
-            
-        # Logical operations
-        elif op == 'AND' or op == 'ANDI':
-            result = operand1 & operand2
-        elif op == 'OR' or op == 'ORI':
-            result = operand1 | operand2
-        elif op == 'XOR' or op == 'XORI':
-            result = operand1 ^ operand2
-            
-        # Comparison (signed)
-        elif op == 'SLT' or op == 'SLTI':  # Set Less Than
-            # Convert to signed for comparison
-            op1_signed = EXE._to_signed(operand1)
-            op2_signed = EXE._to_signed(operand2)
-            result = 1 if op1_signed < op2_signed else 0
-            
-        # Comparison (unsigned)
-        elif op == 'SLTU' or op == 'SLTIU':  # Set Less Than Unsigned
-            result = 1 if operand1 < operand2 else 0
-            
-        # Shift operations
-        elif op == 'SLL' or op == 'SLLI':  # Shift Left Logical
-            shift_amount = operand2 & 0x1F  # Only lower 5 bits
-            result = (operand1 << shift_amount) & MASK_32
-            
-        elif op == 'SRL' or op == 'SRLI':  # Shift Right Logical
-            shift_amount = operand2 & 0x1F
-            result = operand1 >> shift_amount
-            
-        elif op == 'SRA' or op == 'SRAI':  # Shift Right Arithmetic
-            shift_amount = operand2 & 0x1F
-            # Arithmetic shift preserves sign bit
-            if operand1 & 0x80000000:  # If sign bit is set
-                # Fill with 1s from the left
-                result = operand1 >> shift_amount
-                # Create mask of 1s for the high bits
-                mask = ((1 << shift_amount) - 1) << (32 - shift_amount)
-                result = result | mask
-                result = result & MASK_32
-            else:
-                result = operand1 >> shift_amount
-                
-        else:
-            result = 0
+        Args:
+            opcode: Opcode id of an ALU instruction
+            operand1: First operand
+            operand2: Second operand (register value or immediate)
             
-        return result
+        Returns:
+            Result of the operation (32-bit value)
+        """
+        return ALU_FUNCTIONS[opcode](operand1 & MASK_32, operand2 & MASK_32)
     
     @staticmethod
     def _to_signed(value):
         """Convert 32-bit unsigned value to signed integer"""
-        if value & 0x80000000:  # If sign bit is set
-            return value - 0x100000000
-        return value
+        return _to_signed(value)
     
     @staticmethod
     def calculate_memory_address(base_value, offset):
@@ -318,22 +350,8 @@ class EXE:
         Returns:
             True if branch should be taken, False otherwise
         """
-        op = operation.upper()
-        
-        if op == 'BEQ':
-            return val1 == val2
-        elif op == 'BNE':
-            return val1 != val2
-        elif op == 'BLT':
-            return EXE._to_signed(val1) < EXE._to_signed(val2)
-        elif op == 'BGE':
-            return EXE._to_signed(val1) >= EXE._to_signed(val2)
-        elif op == 'BLTU':
-            return val1 < val2
-        elif op == 'BGEU':
-            return val1 >= val2
-        else:
-            return False
+        condition = BRANCH_CONDITIONS.get(OPCODE_BY_NAME.get(operation.upper()))
+        return condition(val1, val2) if condition is not None else False
     
     @staticmethod
     def execute_instruction(instruction, pc=0):
@@ -348,80 +366,85 @@ class EXE:
         """
         if instruction.is_bubble:
             return None, None
-        
-        op = instruction.operation
-        result = None
-        mem_address = None
-        
-        # Memory operations
-        if op in ['LOAD', 'LW', 'LH', 'LB', 'LBU', 'LHU']:
-            # LOAD: src_regs[0] is base address
-            base_value = instruction.src_values[0] if instruction.src_values else 0
-            mem_address = EXE.calculate_memory_address(base_value, instruction.offset)
-            
-        elif op in ['STORE', 'SW', 'SH', 'SB']:
-            # STORE: src_regs[0] is value to store, src_regs[1] is base address
-            base_value = instruction.src_values[1] if len(instruction.src_values) > 1 else 0
-            mem_address = EXE.calculate_memory_address(base_value, instruction.offset)
-            
-        # Upper immediate instructions
-        elif op == 'LUI':
-            result = EXE.execute_lui(instruction.immediate)
-            
-        elif op == 'AUIPC':
-            result = EXE.execute_auipc(instruction.immediate, pc)
-        
-        # System instructions
-        elif op == 'ECALL':
-            # ECALL needs access to registers - return special marker
-            result = {'type': 'ecall'}
-        
-        elif op == 'EBREAK':
-            # EBREAK signals breakpoint
-            result = {'type': 'ebreak'}
-        
-        elif op == 'MRET':
-            # MRET needs access to CSR bank - return special marker
-            result = {'type': 'mret'}
-        
-        # Memory ordering instructions
-        elif op in ['FENCE', 'FENCE.I']:
-            # For single-core simulator without separate I-cache, these are NOPs
-            result = None
-        
-        # CSR instructions
-        elif op in ['CSRRW', 'CSRRS', 'CSRRC', 'CSRRWI', 'CSRRSI', 'CSRRCI']:
-            # CSR operations return special marker that needs CSR bank access
-            result = {'type': 'csr', 'operation': op, 'csr_addr': instruction.csr_addr}
-            
-        # Branch instructions
-        elif op in ['BEQ', 'BNE', 'BLT', 'BGE', 'BLTU', 'BGEU']:
-            val1 = instruction.src_values[0] if len(instruction.src_values) > 0 else 0
-            val2 = instruction.src_values[1] if len(instruction.src_values) > 1 else 0
-            branch_taken = EXE.evaluate_branch(op, val1, val2)
-            result = 1 if branch_taken else 0
-            
-        # Jump instructions
-        elif op == 'JAL':
-            return_addr, jump_target = EXE.execute_jal(instruction.offset, pc)
-            result = return_addr  # Return address stored in rd
-            instruction.jump_target = jump_target
-            
-        elif op == 'JALR':
-            base_value = instruction.src_values[0] if instruction.src_values else 0
-            return_addr, jump_target = EXE.execute_jalr(base_value, instruction.offset, pc)
-            result = return_addr  # Return address stored in rd
-            instruction.jump_target = jump_target
-            
-        # ALU operations (including immediate)
-        elif op:
-            operand1 = instruction.src_values[0] if len(instruction.src_values) > 0 else 0
-            
-            if instruction.has_immediate:
-                operand2 = instruction.immediate
-            else:
-                operand2 = instruction.src_values[1] if len(instruction.src_values) > 1 else 0
-            
-            result = EXE.execute(op, operand1, operand2)
-        
-        return result, mem_address
+        return _EXECUTE_HANDLERS[instruction.opcode](instruction, pc)
+
+
+# Per-class execute handlers: (instruction, pc) -> (result, mem_address)
+
+def _execute_alu(instruction, pc):
+    decoded = instruction.decoded
+    src_values = instruction.src_values
+    operand1 = src_values[0] if src_values else 0
+    if decoded.has_immediate:
+        operand2 = decoded.immediate
+    else:
+        operand2 = src_values[1] if len(src_values) > 1 else 0
+    return ALU_FUNCTIONS[decoded.opcode](operand1 & MASK_32, operand2 & MASK_32), None
+
+
+def _execute_load(instruction, pc):
+    # LOAD: src_regs[0] is base address
+    base_value = instruction.src_values[0] if instruction.src_values else 0
+    return None, (base_value + instruction.decoded.offset) & MASK_32
+
+
+def _execute_store(instruction, pc):
+    # STORE: src_regs[0] is value to store, src_regs[1] is base address
+    base_value = instruction.src_values[1] if len(instruction.src_values) > 1 else 0
+    return None, (base_value + instruction.decoded.offset) & MASK_32
+
+
+def _execute_branch(instruction, pc):
+    src_values = instruction.src_values
+    val1 = src_values[0] if len(src_values) > 0 else 0
+    val2 = src_values[1] if len(src_values) > 1 else 0
+    return (1 if BRANCH_CONDITIONS[instruction.opcode](val1, val2) else 0), None
+
+
+def _execute_jal(instruction, pc):
+    return_addr, instruction.jump_target = EXE.execute_jal(instruction.decoded.offset, pc)
+    return return_addr, None  # Return address stored in rd
+
+
+def _execute_jalr(instruction, pc):
+    base_value = instruction.src_values[0] if instruction.src_values else 0
+    return_addr, instruction.jump_target = EXE.execute_jalr(base_value, instruction.decoded.offset, pc)
+    return return_addr, None  # Return address stored in rd
+
+
+def _execute_csr(instruction, pc):
+    # CSR operations return special marker that needs CSR bank access (done in WriteBack)
+    decoded = instruction.decoded
+    return {'type': 'csr', 'operation': decoded.operation, 'csr_addr': decoded.csr_addr}, None
+
+
+def _execute_unknown(instruction, pc):
+    # Unrecognized mnemonics behave as an ALU op with result 0 (as before)
+    return (0 if instruction.decoded.operation else None), None
+
+
+_EXECUTE_HANDLERS = [_execute_unknown] * len(Opcode)
+for _op in ALU_FUNCTIONS:
+    _EXECUTE_HANDLERS[_op] = _execute_alu
+for _op in (Opcode.LOAD, Opcode.LW, Opcode.LH, Opcode.LHU, Opcode.LB, Opcode.LBU):
+    _EXECUTE_HANDLERS[_op] = _execute_load
+for _op in (Opcode.STORE, Opcode.SW, Opcode.SH, Opcode.SB):
+    _EXECUTE_HANDLERS[_op] = _execute_store
+for _op in BRANCH_CONDITIONS:
+    _EXECUTE_HANDLERS[_op] = _execute_branch
+for _op in (Opcode.CSRRW, Opcode.CSRRS, Opcode.CSRRC, Opcode.CSRRWI, Opcode.CSRRSI, Opcode.CSRRCI):
+    _EXECUTE_HANDLERS[_op] = _execute_csr
+_EXECUTE_HANDLERS[Opcode.LUI] = lambda instruction, pc: (EXE.execute_lui(instruction.decoded.immediate), None)
+_EXECUTE_HANDLERS[Opcode.AUIPC] = lambda instruction, pc: (EXE.execute_auipc(instruction.decoded.immediate, pc), None)
+_EXECUTE_HANDLERS[Opcode.JAL] = _execute_jal
+_EXECUTE_HANDLERS[Opcode.JALR] = _execute_jalr
+# System instructions return markers; the pipeline completes them with trap/CSR state
+_EXECUTE_HANDLERS[Opcode.ECALL] = lambda instruction, pc: ({'type': 'ecall'}, None)
+_EXECUTE_HANDLERS[Opcode.EBREAK] = lambda instruction, pc: ({'type': 'ebreak'}, None)
+_EXECUTE_HANDLERS[Opcode.MRET] = lambda instruction, pc: ({'type': 'mret'}, None)
+# WFI executes as a NOP; the fetch engine then idles until an interrupt wakes the core
+_EXECUTE_HANDLERS[Opcode.WFI] = lambda instruction, pc: (None, None)
+# Single core without separate I-cache: FENCE/FENCE.I are NOPs here
+_EXECUTE_HANDLERS[Opcode.FENCE] = lambda instruction, pc: (None, None)
+_EXECUTE_HANDLERS[Opcode.FENCE_I] = lambda instruction, pc: (None, None)
+_EXECUTE_HANDLERS = tuple(_EXECUTE_HANDLERS)
@@ -0,0 +1,70 @@
+/*
+ * Guest benchmark support (see bench.h)
+ */
+
+#include "bench.h"
+
+/* UART addresses */
+#define UART_BASE 0x10000000
+#define UART_TX_DATA (*(volatile unsigned int *)UART_BASE)
+
+/* Host interface word: the simulator stops at the first store to it */
+volatile unsigned int tohost __attribute__((section(".tohost")));
+
+void bench_putc(char c)
+{
+    UART_TX_DATA = (unsigned int)c;
+}
+
+void bench_puts(const char *str)
+{
+    while (*str) {
+        bench_putc(*str++);
+    }
+}
+
+void bench_puthex(unsigned int value)
+{
+    int shift;
+
+    bench_puts("0x");
+    for (shift = 28; shift >= 0; shift -= 4) {
+        bench_putc("0123456789abcdef"[(value >> shift) & 0xF]);
+    }
+}
+
+static void bench_field(const char *key, unsigned int value)
+{
+    bench_putc(' ');
+    bench_puts(key);
+    bench_putc('=');
+    bench_puthex(value);
+}
+
+void bench_report(const char *name, unsigned int iterations, const bench_sample_t *start,
+                  const bench_sample_t *end, unsigned int checksum)
+{
+    bench_puts("BENCH name=");
+    bench_puts(name);
+    bench_field("iterations", iterations);
+    bench_field("mcycle_start", start->mcycle);
+    bench_field("mcycle_end", end->mcycle);
+    bench_field("minstret_start", start->minstret);
+    bench_field("minstret_end", end->minstret);
+    bench_field("checksum", checksum);
+    bench_putc('\n');
+}
+
+void bench_fail(const char *name, unsigned int code)
+{
+    bench_puts("BENCH_FAIL name=");
+    bench_puts(name);
+    bench_field("code", code);
+    bench_putc('\n');
+}
+
+void bench_exit(unsigned int code)
+{
+    tohost = (code << 1) | 1;
+    for (;;);
+}
@@ -0,0 +1,48 @@
+/*
+ * Guest benchmark support: counter sampling, UART reports and exit
+ *
+ * Every benchmark image samples mcycle/minstret around the code it measures
+ * and prints one report line per measurement, e.g.
+ *
+ *   BENCH name=coremark iterations=10 mcycle_start=0x00000a1c mcycle_end=0x0004f3e0
+ *         minstret_start=0x000007d2 minstret_end=0x0003c118 checksum=0x8a3f
+ *
+ * (on one line): space-separated key=value fields after "BENCH", numbers
+ * in hex. The counters are 32 bits wide, so take end - start modulo 2^32.
+ * bench_exit() then stores to tohost, which ends the run under
+ * run_freertos.py (riscv-tests convention: 1 = pass, (code << 1) | 1 = fail).
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+typedef struct {
+    unsigned int mcycle;
+    unsigned int minstret;
+} bench_sample_t;
+
+/* Read both counters (mcycle first) */
+static inline void bench_sample(bench_sample_t *sample)
+{
+    unsigned int cycle, instret;
+    __asm__ volatile ("csrr %0, mcycle" : "=r"(cycle));
+    __asm__ volatile ("csrr %0, minstret" : "=r"(instret));
+    sample->mcycle = cycle;
+    sample->minstret = instret;
+}
+
+void bench_putc(char c);
+void bench_puts(const char *str);
+void bench_puthex(unsigned int value);
+
+/* Print a BENCH line for one measurement */
+void bench_report(const char *name, unsigned int iterations, const bench_sample_t *start,
+                  const bench_sample_t *end, unsigned int checksum);
+
+/* Print "BENCH_FAIL name=... code=..." for a self-check that failed */
+void bench_fail(const char *name, unsigned int code);
+
+/* End the run: 0 = pass, anything else is a failure code */
+void bench_exit(unsigned int code) __attribute__((noreturn));
+
+#endif /* BENCH_H */
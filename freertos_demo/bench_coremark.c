@@ -0,0 +1,263 @@
+/*
+ * CoreMark-style integer kernel (bare metal)
+ *
+ * Each iteration runs the three CoreMark workloads on small data sets and
+ * folds their results into a CRC-16:
+ * - linked list: reverse, search and insertion-sort a 32-node list
+ * - matrix: 8x8 multiply, add a constant and sum under a mask
+ * - state machine: classify the comma-separated tokens of a string
+ *
+ * Not the EEMBC CoreMark (its results are not comparable), but the same mix
+ * of pointer chasing, multiply-accumulate loops, data-dependent branches and
+ * byte loads. The final CRC is checked against the value for the default
+ * iteration count, so an image that computed it wrong exits with a failure.
+ */
+
+#include "bench.h"
+
+#ifndef ITERATIONS
+#define ITERATIONS 10
+#endif
+
+/* Final CRC for ITERATIONS == 10 */
+#define EXPECTED_CRC_10 0xace6
+
+#define LIST_SIZE 32
+#define MATRIX_N 8
+
+typedef struct list_node {
+    struct list_node *next;
+    unsigned short index;
+    unsigned short value;
+} list_node_t;
+
+static list_node_t nodes[LIST_SIZE];
+static short matrix_a[MATRIX_N * MATRIX_N];
+static short matrix_b[MATRIX_N * MATRIX_N];
+static int matrix_c[MATRIX_N * MATRIX_N];
+
+static const char state_input[] =
+    "5012,1234,-874,+122,7.02,-13.5e3,3e+9,0x1f,,--1,1.2.3,+.5,9999,e4,-0,42e-1,abc,17,";
+
+static unsigned int seed;
+
+static unsigned int next_random(void)
+{
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 16;
+}
+
+static unsigned short crc16(unsigned int value, unsigned short crc)
+{
+    int bit;
+
+    for (bit = 0; bit < 32; bit++) {
+        unsigned int mix = (value ^ crc) & 1;
+        crc >>= 1;
+        if (mix) {
+            crc ^= 0xA001;
+        }
+        value >>= 1;
+    }
+    return crc;
+}
+
+/* Linked list ------------------------------------------------------------- */
+
+static list_node_t *list_build(void)
+{
+    int i;
+
+    for (i = 0; i < LIST_SIZE; i++) {
+        nodes[i].next = (i + 1 < LIST_SIZE) ? &nodes[i + 1] : 0;
+        nodes[i].index = (unsigned short)i;
+        nodes[i].value = (unsigned short)next_random();
+    }
+    return &nodes[0];
+}
+
+static list_node_t *list_reverse(list_node_t *head)
+{
+    list_node_t *previous = 0;
+
+    while (head) {
+        list_node_t *next = head->next;
+        head->next = previous;
+        previous = head;
+        head = next;
+    }
+    return previous;
+}
+
+static int list_find(list_node_t *head, unsigned short value)
+{
+    int position = 0;
+
+    for (; head; head = head->next, position++) {
+        if ((head->value & 0xFF) == (value & 0xFF)) {
+            return position;
+        }
+    }
+    return -1;
+}
+
+static list_node_t *list_sort(list_node_t *head)
+{
+    list_node_t *sorted = 0;
+
+    while (head) {
+        list_node_t *node = head;
+        list_node_t **link = &sorted;
+        head = head->next;
+        while (*link && (*link)->value < node->value) {
+            link = &(*link)->next;
+        }
+        node->next = *link;
+        *link = node;
+    }
+    return sorted;
+}
+
+static unsigned short bench_list(unsigned short crc)
+{
+    list_node_t *head = list_build();
+    int i;
+
+    head = list_reverse(head);
+    for (i = 0; i < 4; i++) {
+        crc = crc16((unsigned int)list_find(head, (unsigned short)next_random()), crc);
+    }
+    head = list_sort(head);
+    for (; head; head = head->next) {
+        crc = crc16(((unsigned int)head->index << 16) | head->value, crc);
+    }
+    return crc;
+}
+
+/* Matrix ------------------------------------------------------------------ */
+
+static unsigned short bench_matrix(unsigned short crc)
+{
+    int i, j, k;
+    unsigned int sum = 0;
+    short constant = (short)(next_random() & 0xFF);
+
+    for (i = 0; i < MATRIX_N * MATRIX_N; i++) {
+        matrix_a[i] = (short)((next_random() & 0x1FF) - 0x100);
+        matrix_b[i] = (short)((next_random() & 0x1FF) - 0x100);
+    }
+    for (i = 0; i < MATRIX_N; i++) {
+        for (j = 0; j < MATRIX_N; j++) {
+            int acc = 0;
+            for (k = 0; k < MATRIX_N; k++) {
+                acc += matrix_a[i * MATRIX_N + k] * matrix_b[k * MATRIX_N + j];
+            }
+            matrix_c[i * MATRIX_N + j] = acc + constant;
+        }
+    }
+    for (i = 0; i < MATRIX_N * MATRIX_N; i++) {
+        if (matrix_c[i] > 0) {
+            sum += (unsigned int)matrix_c[i] & 0xFFF;
+        } else {
+            sum ^= (unsigned int)i;
+        }
+    }
+    return crc16(sum, crc);
+}
+
+/* State machine ----------------------------------------------------------- */
+
+enum { STATE_START, STATE_INT, STATE_FLOAT, STATE_EXPONENT, STATE_SCIENTIFIC, STATE_INVALID, STATE_COUNT };
+
+static int is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static int next_state(int state, char c)
+{
+    switch (state) {
+    case STATE_START:
+        if (is_digit(c)) {
+            return STATE_INT;
+        }
+        if (c == '+' || c == '-') {
+            return STATE_START;  /* Sign: still no digits */
+        }
+        return c == '.' ? STATE_FLOAT : STATE_INVALID;
+    case STATE_INT:
+        if (is_digit(c)) {
+            return STATE_INT;
+        }
+        if (c == '.') {
+            return STATE_FLOAT;
+        }
+        return (c == 'e' || c == 'E') ? STATE_EXPONENT : STATE_INVALID;
+    case STATE_FLOAT:
+        if (is_digit(c)) {
+            return STATE_FLOAT;
+        }
+        return (c == 'e' || c == 'E') ? STATE_EXPONENT : STATE_INVALID;
+    case STATE_EXPONENT:
+        if (c == '+' || c == '-' || is_digit(c)) {
+            return STATE_SCIENTIFIC;
+        }
+        return STATE_INVALID;
+    case STATE_SCIENTIFIC:
+        return is_digit(c) ? STATE_SCIENTIFIC : STATE_INVALID;
+    default:
+        return STATE_INVALID;
+    }
+}
+
+static unsigned short bench_state(unsigned short crc, unsigned int iteration)
+{
+    unsigned int counts[STATE_COUNT] = {0};
+    const char *p = state_input;
+    int state = STATE_START;
+    int i;
+
+    /* Skip a different number of leading tokens each iteration */
+    for (i = 0; i < (int)(iteration & 3); i++) {
+        while (*p && *p++ != ',');
+    }
+    for (; *p; p++) {
+        if (*p == ',') {
+            counts[state]++;
+            state = STATE_START;
+        } else {
+            state = next_state(state, *p);
+        }
+    }
+    for (i = 0; i < STATE_COUNT; i++) {
+        crc = crc16(counts[i], crc);
+    }
+    return crc;
+}
+
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    bench_sample_t start, end;
+    unsigned short crc = 0;
+    unsigned int iteration;
+
+    bench_sample(&start);
+    for (iteration = 0; iteration < ITERATIONS; iteration++) {
+        seed = 0x1234u + iteration;
+        crc = bench_list(crc);
+        crc = bench_matrix(crc);
+        crc = bench_state(crc, iteration);
+    }
+    bench_sample(&end);
+
+    bench_report("coremark", ITERATIONS, &start, &end, crc);
+#if ITERATIONS == 10
+    if (crc != EXPECTED_CRC_10) {
+        bench_fail("coremark", crc);
+        bench_exit(1);
+    }
+#endif
+    bench_exit(0);
+}
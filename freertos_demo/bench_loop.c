@@ -0,0 +1,75 @@
+/*
+ * Tight-loop calibration kernels (bare metal)
+ *
+ * Hand-written loops whose retired instruction counts are known exactly, so
+ * the reported mcycle delta isolates one timing effect:
+ * - loop_branch: ADDI + taken BNE per iteration (branch predictor, redirects)
+ * - loop_dependent: four back-to-back dependent ADDIs per iteration
+ *   (forwarding or RAW stalls)
+ * - loop_independent: four independent ADDIs per iteration (ideal CPI)
+ * The checksum is the final register value, checked in the guest.
+ */
+
+#include "bench.h"
+
+#ifndef ITERATIONS
+#define ITERATIONS 1000
+#endif
+
+static int report(const char *name, const bench_sample_t *start, const bench_sample_t *end,
+                  unsigned int value, unsigned int expected)
+{
+    bench_report(name, ITERATIONS, start, end, value);
+    if (value != expected) {
+        bench_fail(name, value);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    bench_sample_t start, end;
+    unsigned int count, value;
+    unsigned int a = 0, b = 0, c = 0, d = 0;
+    int failures = 0;
+
+    count = ITERATIONS;
+    bench_sample(&start);
+    __asm__ volatile (
+        "1: addi %0, %0, -1\n"
+        "   bnez %0, 1b\n"
+        : "+r"(count));
+    bench_sample(&end);
+    failures += report("loop_branch", &start, &end, count, 0);
+
+    count = ITERATIONS;
+    value = 0;
+    bench_sample(&start);
+    __asm__ volatile (
+        "1: addi %1, %1, 1\n"
+        "   addi %1, %1, 1\n"
+        "   addi %1, %1, 1\n"
+        "   addi %1, %1, 1\n"
+        "   addi %0, %0, -1\n"
+        "   bnez %0, 1b\n"
+        : "+r"(count), "+r"(value));
+    bench_sample(&end);
+    failures += report("loop_dependent", &start, &end, value, 4 * ITERATIONS);
+
+    count = ITERATIONS;
+    bench_sample(&start);
+    __asm__ volatile (
+        "1: addi %1, %1, 1\n"
+        "   addi %2, %2, 1\n"
+        "   addi %3, %3, 1\n"
+        "   addi %4, %4, 1\n"
+        "   addi %0, %0, -1\n"
+        "   bnez %0, 1b\n"
+        : "+r"(count), "+r"(a), "+r"(b), "+r"(c), "+r"(d));
+    bench_sample(&end);
+    value = a + b + c + d;
+    failures += report("loop_independent", &start, &end, value, 4 * ITERATIONS);
+
+    bench_exit(failures);
+}
@@ -0,0 +1,101 @@
+/*
+ * Queue ping-pong between two tasks (FreeRTOS)
+ *
+ * The ping task sends a counter on one queue and blocks on a second queue
+ * for the pong task's reply (the counter plus one), so every round trip is
+ * two blocking queue operations and two context switches:
+ * - pingpong_queue: back-to-back round trips, switching through the
+ *   yield ECALL (portYIELD)
+ * - pingpong_tick: the ping task sleeps one tick (vTaskDelay) before each
+ *   round, so every round starts from a CLINT timer interrupt and the
+ *   idle task runs in between
+ * The checksum is the sum of the replies, checked in the guest.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "bench.h"
+
+#ifndef ROUNDS
+#define ROUNDS 200
+#endif
+
+#ifndef TICK_ROUNDS
+#define TICK_ROUNDS 20
+#endif
+
+static QueueHandle_t xPingQueue;
+static QueueHandle_t xPongQueue;
+
+static void vPongTask(void *pvParameters)
+{
+    unsigned int value;
+    (void)pvParameters;
+
+    for (;;) {
+        xQueueReceive(xPingQueue, &value, portMAX_DELAY);
+        value++;
+        xQueueSend(xPongQueue, &value, portMAX_DELAY);
+    }
+}
+
+/* Run rounds round trips, sleeping delay ticks before each; 1 if a reply was wrong */
+static int run_rounds(const char *name, unsigned int rounds, TickType_t delay)
+{
+    bench_sample_t start, end;
+    unsigned int i, reply, sum = 0, expected = 0;
+    int failed = 0;
+
+    bench_sample(&start);
+    for (i = 0; i < rounds; i++) {
+        if (delay) {
+            vTaskDelay(delay);
+        }
+        xQueueSend(xPingQueue, &i, portMAX_DELAY);
+        xQueueReceive(xPongQueue, &reply, portMAX_DELAY);
+        failed |= reply != i + 1;
+        sum += reply;
+    }
+    bench_sample(&end);
+
+    bench_report(name, rounds, &start, &end, sum);
+    for (i = 1; i <= rounds; i++) {
+        expected += i;
+    }
+    if (failed || sum != expected) {
+        bench_fail(name, sum);
+        return 1;
+    }
+    return 0;
+}
+
+static void vPingTask(void *pvParameters)
+{
+    int failures;
+    (void)pvParameters;
+
+    failures = run_rounds("pingpong_queue", ROUNDS, 0);
+    failures += run_rounds("pingpong_tick", TICK_ROUNDS, 1);
+    bench_exit((unsigned int)failures);
+}
+
+int main(void)
+{
+    bench_puts("pingpong benchmark: starting scheduler\n");
+    xPingQueue = xQueueCreate(1, sizeof(unsigned int));
+    xPongQueue = xQueueCreate(1, sizeof(unsigned int));
+    if (xPingQueue == NULL || xPongQueue == NULL) {
+        bench_fail("pingpong", 1);
+        bench_exit(1);
+    }
+
+    /* Same priority: a send does not preempt, each blocking receive switches tasks */
+    xTaskCreate(vPingTask, "Ping", configMINIMAL_STACK_SIZE * 2, NULL, 2, NULL);
+    xTaskCreate(vPongTask, "Pong", configMINIMAL_STACK_SIZE, NULL, 2, NULL);
+    vTaskStartScheduler();
+
+    bench_fail("pingpong", 2);  /* Scheduler did not start */
+    bench_exit(2);
+}
@@ -0,0 +1,528 @@
+"""Functional (non-timing) instruction-set simulator for RISC-V
+
+Executes one instruction per step directly against the same RegisterFile,
+Memory, CSRBank, TrapController and CLINT objects the pipeline uses, with
+no SimPy processes or stage hand-offs. Intended for boot, warm-up and
+regression sweeps where stage-accurate timing is not needed.
+
+Timing model: every instruction costs one cycle. The cycle/instret CSRs
+and the CLINT are brought up to date in bulk rather than per instruction:
+- CLINT time is advanced only when the next timer compare is due, before
+  an access to the CLINT registers, and at the end of a run
+- Counter CSRs are synced before CSR instructions and at the end of a run
+
+Idle time is skipped rather than stepped through. A branch or jump to
+itself (an idle loop only an interrupt can leave) runs all its iterations
+up to the next timer compare in one step, counting them as executed and
+retired exactly as interpreting would. WFI sleeps until an enabled
+interrupt is pending, with time jumping straight to the timer compare.
+Either way the cycles skipped are also counted in idle_cycles, and count
+towards the instruction budget: a run with max_instructions never covers
+more cycles than that, so a quantum scheduler (multihart.py) can bound
+each hart's share of time.
+
+Hot code runs as translated basic blocks (block_cache.py) rather than one
+instruction at a time. A block is only entered when no stop point, budget
+limit or timer compare falls inside it, and everything that can make an
+interrupt deliverable either ends a block (CLINT accesses) or is never
+translated (CSR instructions, MRET), so results are instruction-for-
+instruction the same as interpreting: interrupts are still taken at the
+exact instruction boundary through TrapController.check_pending_interrupts.
+
+Because the architectural state is shared, a run can stop at a chosen PC
+or instret value and the pipelined model continues from there
+(see RISCVProcessor.fast_forward()).
+"""
+
+from instruction import Opcode, decode_instruction_word
+from decode_cache import DecodeCache
+from block_cache import BlockCache
+from exe import EXE, ALU_FUNCTIONS, BRANCH_CONDITIONS, memory_fault
+
+
+MASK_32 = 0xFFFFFFFF
+NEVER = float('inf')
+
+
+class FunctionalCore:
+    """Instruction-at-a-time interpreter over shared architectural state"""
+
+    def __init__(self, register_file, memory, csr_bank, trap_controller, clint, decode_cache=None,
+                 translate=True):
+        """Initialize functional core
+
+        Args:
+            register_file: RegisterFile holding GPRs and the PC
+            memory: Memory (with UART/CLINT mapped in)
+            csr_bank: CSRBank instance
+            trap_controller: TrapController for exceptions and interrupts
+            clint: CLINT timer
+            decode_cache: DecodeCache shared with the pipeline (optional)
+            translate: Run hot code as translated basic blocks
+        """
+        self.register_file = register_file
+        self.memory = memory
+        self.csr_bank = csr_bank
+        self.trap_controller = trap_controller
+        self.clint = clint
+        self.decode_cache = decode_cache if decode_cache is not None else DecodeCache()
+        memory.watch_code(self.decode_cache)  # Fetch trusts the cache (decode_cache.get)
+        self.block_cache = BlockCache(memory, self.decode_cache, clint) if translate else None
+        # Other harts can raise this hart's interrupts (msip), so a WFI with
+        # no timer to wait for sleeps out the budget instead of halting
+        self.multi_hart = False
+
+        # Statistics
+        self.cycles = 0
+        self.instret = 0
+        self.traps_taken = 0
+        self.interrupts_taken = 0
+        self.idle_cycles = 0      # Cycles skipped in idle loops and WFI
+        self.halt_reason = None
+        self.tohost_value = None  # Word stored to the tohost address by the last run
+
+        # Bulk-update bookkeeping
+        self._synced_cycles = 0
+        self._synced_instret = 0
+        self._unticked = 0
+
+    @classmethod
+    def from_pipeline(cls, pipeline, translate=True):
+        """Create a functional core sharing a Pipeline's architectural state"""
+        return cls(pipeline.register_file, pipeline.memory, pipeline.csr_bank,
+                   pipeline.trap_controller, pipeline.clint, pipeline.decode_cache, translate)
+
+    # ------------------------------------------------------------------
+    # Bulk time/counter updates
+    # ------------------------------------------------------------------
+
+    def _cycles_until_timer(self):
+        """Cycles until the CLINT timer compare can next fire"""
+        cycles = self.clint.cycles_until_timer()
+        return NEVER if cycles is None else cycles
+
+    def _sync_time(self):
+        """Apply cycles not yet ticked into the CLINT"""
+        if self._unticked:
+            self.clint.tick(self._unticked)
+            self._unticked = 0
+
+    def sync_counters(self):
+        """Bring CLINT time and the cycle/instret CSRs up to date"""
+        self._sync_time()
+        csrs = self.csr_bank.csrs
+        cycle_delta = self.cycles - self._synced_cycles
+        instret_delta = self.instret - self._synced_instret
+        for addr, delta in ((0xB00, cycle_delta), (0xC00, cycle_delta),
+                            (0xB02, instret_delta), (0xC02, instret_delta)):
+            csrs[addr] = (csrs.get(addr, 0) + delta) & MASK_32
+        csrs[0xC01] = self.clint.mtime & MASK_32
+        self._synced_cycles = self.cycles
+        self._synced_instret = self.instret
+
+    def set_counts(self, cycles, instret):
+        """Set the cycle/instret totals (e.g. on checkpoint restore)
+        
+        The counter CSRs and CLINT are taken to be in sync with them already.
+        """
+        self.cycles = cycles
+        self.instret = instret
+        self._synced_cycles = cycles
+        self._synced_instret = instret
+        self._unticked = 0
+    
+    def _is_timed_address(self, address):
+        """Check for a register of a device that keeps time: the CLINT, or the UART (TX FIFO)"""
+        clint = self.clint
+        if clint.MSIP_BASE <= address < clint.MTIME_BASE + 8:
+            return True
+        uart = self.memory.uart
+        return uart is not None and uart.TX_DATA_REG <= address < uart.TX_DATA_REG + uart.WINDOW_SIZE
+
+    # ------------------------------------------------------------------
+    # Execution
+    # ------------------------------------------------------------------
+
+    def run(self, max_instructions=None, stop_pc=None, stop_instret=None, breakpoints=(), halt_on=(),
+            tohost=None):
+        """Execute instructions from the current PC
+
+        Stops (before executing the instruction at the stop point) when:
+        - the PC reaches stop_pc
+        - the PC reaches a breakpoint (ignored at the starting PC)
+        - instret reaches stop_instret
+        - max_instructions have been executed
+        - an ECALL/EBREAK listed in halt_on is reached
+        Stops after the instruction when:
+        - the program branches or jumps to itself, or executes WFI, and no
+          interrupt can ever take it out of there
+        - a store writes the tohost address (value kept in tohost_value)
+
+        Args:
+            max_instructions: Instruction budget for this call (None: unlimited)
+            stop_pc: PC to stop at
+            stop_instret: Absolute instret value to stop at
+            breakpoints: PCs to stop at
+            halt_on: Subset of ('ecall', 'ebreak') that stop instead of trapping
+            tohost: Address whose store ends the run (None: disabled)
+
+        Returns:
+            Halt reason: 'stop_pc', 'breakpoint', 'stop_instret', 'max_instructions',
+            'ecall', 'ebreak', 'tohost' or 'self_loop'
+        """
+        register_file = self.register_file
+        regs = register_file.regs
+        memory = self.memory
+        csr_bank = self.csr_bank
+        trap_controller = self.trap_controller
+        decode_cache = self.decode_cache
+        cache_get = decode_cache.get
+        block_cache = self.block_cache
+        blocks = block_cache.blocks if block_cache is not None else None
+        alu_ops = ALU_FUNCTIONS
+        branch_ops = BRANCH_CONDITIONS
+
+        limit = NEVER if max_instructions is None else max_instructions
+        stop_instret = NEVER if stop_instret is None else stop_instret
+        breakpoints = frozenset(breakpoints)
+        halt_ecall = 'ecall' in halt_on
+        halt_ebreak = 'ebreak' in halt_on
+        stop_points = breakpoints | {stop_pc} if stop_pc is not None else breakpoints
+        self.tohost_value = None
+
+        pc = register_file.pc
+        start_pc = pc
+        executed = 0
+        timer_due = self._cycles_until_timer() - self._unticked
+        check_interrupts = True
+        reason = None
+
+        while True:
+            if pc == stop_pc:
+                reason = 'stop_pc'
+                break
+            if pc in breakpoints and (executed or pc != start_pc):
+                reason = 'breakpoint'
+                break
+            if executed >= limit:
+                reason = 'max_instructions'
+                break
+            if self.instret >= stop_instret:
+                reason = 'stop_instret'
+                break
+
+            # Timer compare due - tick the CLINT in one step
+            if timer_due <= 0:
+                self._sync_time()
+                timer_due = self._cycles_until_timer()
+                check_interrupts = True
+
+            # Interrupt state only changes on ticks, CSR writes, MRET and CLINT stores
+            if check_interrupts:
+                check_interrupts = False
+                if trap_controller.has_deliverable_interrupt():
+                    interrupt_info = trap_controller.check_pending_interrupts(pc)
+                    if interrupt_info:
+                        pc = interrupt_info['handler_pc']
+                        self.interrupts_taken += 1
+                        continue
+
+            # Translated blocks, chained by target PC while the next one fits in
+            # the budget with no stop point inside and no CLINT/UART/code write
+            if blocks is not None:
+                if decode_cache.generation != block_cache.generation:
+                    block_cache.flush()
+                block = blocks.get(pc) or block_cache.touch(pc)
+                budget = min(timer_due, limit - executed, stop_instret - self.instret)
+                ran = 0
+                while (block is not None and block.length <= budget
+                       and (not stop_points or stop_points.isdisjoint(block.pcs))):
+                    pc, count = block.function(regs, tohost)
+                    ran += count
+                    if count < block.length:
+                        break  # Left early: let the loop re-check the caches
+                    budget -= count
+                    block = blocks.get(pc)
+                if ran:
+                    executed += ran
+                    timer_due -= ran
+                    self.cycles += ran
+                    self._unticked += ran
+                    self.instret += ran
+                    continue
+
+            # Fetch (decode only on a cache miss)
+            decoded = cache_get(pc)
+            if decoded is None:
+                try:
+                    word = memory.read_word(pc)
+                except ValueError:
+                    pc = self._trap(trap_controller.EXCEPTION_INSTRUCTION_ACCESS_FAULT, pc, pc)
+                    check_interrupts = True
+                    continue
+                decoded = decode_cache.lookup(pc, word, decode_instruction_word)
+
+            op = decoded.opcode
+            next_pc = (pc + 4) & MASK_32
+            executed += 1
+            self.cycles += 1
+            self._unticked += 1
+            timer_due -= 1
+
+            if Opcode.ADD <= op <= Opcode.SRAI:
+                srcs = decoded.src_indices
+                a = regs[srcs[0]]
+                b = (decoded.immediate & MASK_32) if decoded.has_immediate else regs[srcs[1]]
+                rd = decoded.rd
+                if rd:
+                    regs[rd] = alu_ops[op](a, b)
+
+            elif Opcode.LOAD <= op <= Opcode.LBU:
+                address = (regs[decoded.src_indices[0]] + decoded.offset) & MASK_32
+                if self._is_timed_address(address):
+                    self._sync_time()
+                try:
+                    if op == Opcode.LW or op == Opcode.LOAD:
+                        value = memory.read_word(address)
+                    elif op == Opcode.LH:
+                        value = memory.read_halfword(address, signed=True)
+                    elif op == Opcode.LHU:
+                        value = memory.read_halfword(address, signed=False)
+                    elif op == Opcode.LB:
+                        value = memory.read_byte(address, signed=True)
+                    else:
+                        value = memory.read_byte(address, signed=False)
+                except ValueError:
+                    pc = self._memory_trap(op, address, pc)
+                    check_interrupts = True
+                    continue
+                rd = decoded.rd
+                if rd:
+                    regs[rd] = value & MASK_32
+
+            elif Opcode.STORE <= op <= Opcode.SB:
+                srcs = decoded.src_indices
+                value = regs[srcs[0]]
+                address = (regs[srcs[1]] + decoded.offset) & MASK_32
+                try:
+                    if op == Opcode.SW or op == Opcode.STORE:
+                        size = 4
+                        memory.write_word(address, value)
+                    elif op == Opcode.SH:
+                        size = 2
+                        memory.write_halfword(address, value & 0xFFFF)
+                    else:
+                        size = 1
+                        memory.write_byte(address, value & 0xFF)
+                except ValueError:
+                    pc = self._memory_trap(op, address, pc)
+                    check_interrupts = True
+                    continue
+                decode_cache.invalidate(address, size)
+                if address == tohost:
+                    self.tohost_value = memory.read_word(address & ~0x3)
+                    self.instret += 1
+                    pc = next_pc
+                    reason = 'tohost'
+                    break
+                if self._is_timed_address(address):
+                    # mtimecmp/msip or the UART changed: re-plan the timer and re-check interrupts
+                    self._sync_time()
+                    timer_due = self._cycles_until_timer()
+                    check_interrupts = True
+
+            elif Opcode.BEQ <= op <= Opcode.BGEU:
+                srcs = decoded.src_indices
+                if branch_ops[op](regs[srcs[0]], regs[srcs[1]]):
+                    next_pc = (pc + decoded.offset) & MASK_32
+
+            elif op == Opcode.JAL:
+                target = (pc + decoded.offset) & MASK_32
+                rd = decoded.rd
+                if rd:
+                    regs[rd] = next_pc
+                next_pc = target
+
+            elif op == Opcode.JALR:
+                target = (regs[decoded.src_indices[0]] + decoded.offset) & 0xFFFFFFFE
+                rd = decoded.rd
+                if rd:
+                    regs[rd] = next_pc
+                next_pc = target
+
+            elif op == Opcode.LUI:
+                rd = decoded.rd
+                if rd:
+                    regs[rd] = EXE.execute_lui(decoded.immediate)
+
+            elif op == Opcode.AUIPC:
+                rd = decoded.rd
+                if rd:
+                    regs[rd] = EXE.execute_auipc(decoded.immediate, pc)
+
+            elif Opcode.CSRRW <= op <= Opcode.CSRRCI:
+                self.sync_counters()
+                self._execute_csr(decoded, op, regs)
+                timer_due = self._cycles_until_timer()
+                check_interrupts = True
+
+            elif op == Opcode.ECALL:
+                if halt_ecall:
+                    self.cycles -= 1  # Not executed
+                    self._unticked -= 1
+                    reason = 'ecall'
+                    break
+                pc = self._trap(trap_controller.EXCEPTION_ECALL_FROM_M, pc)
+                continue
+
+            elif op == Opcode.EBREAK:
+                if halt_ebreak:
+                    self.cycles -= 1  # Not executed
+                    self._unticked -= 1
+                    reason = 'ebreak'
+                    break
+                pc = self._trap(trap_controller.EXCEPTION_BREAKPOINT, pc)
+                continue
+
+            elif op == Opcode.MRET:
+                next_pc = EXE.execute_mret(csr_bank)['new_pc']
+                check_interrupts = True
+
+            elif op == Opcode.WFI:
+                timer_due, slept = self._wait_for_interrupt(timer_due, limit - executed)
+                executed += slept
+                if timer_due is None:
+                    self.instret += 1
+                    pc = next_pc
+                    reason = 'self_loop'  # Nothing can wake the core
+                    break
+                if not csr_bank.read(0x344) & csr_bank.read(0x304):
+                    reason = 'max_instructions'  # Still asleep: the WFI executes again next run
+                    break
+                check_interrupts = True
+
+            elif op == Opcode.FENCE_I:
+                decode_cache.invalidate_all()
+
+            elif op == Opcode.UNKNOWN:
+                pc = self._trap(trap_controller.EXCEPTION_ILLEGAL_INSTRUCTION, pc,
+                                memory.read_word(pc) if pc & 0x3 == 0 else 0)
+                check_interrupts = True
+                continue
+
+            # FENCE is a no-op on a single in-order core
+            self.instret += 1
+
+            # Idle loop: a branch/jump to itself changes nothing until an interrupt
+            if next_pc == pc and Opcode.BEQ <= op <= Opcode.JAL:
+                if not self._interrupts_possible():
+                    reason = 'self_loop'
+                    break
+                if pc not in stop_points:
+                    skip = min(timer_due, limit - executed, stop_instret - self.instret)
+                    if skip == NEVER:
+                        reason = 'self_loop'  # No timer, no budget: it spins forever
+                        break
+                    if skip > 0:
+                        executed += skip
+                        timer_due -= skip
+                        self.cycles += skip
+                        self._unticked += skip
+                        self.instret += skip
+                        self.idle_cycles += skip
+            pc = next_pc
+
+        register_file.write_pc(pc)
+        self.sync_counters()
+        if memory.uart is not None:
+            memory.uart.flush()
+        self.halt_reason = reason
+        return reason
+
+    def _trap(self, cause, pc, trap_value=0):
+        """Take a synchronous exception; the instruction does not retire"""
+        self.traps_taken += 1
+        return self.trap_controller.trigger_exception(cause, pc, trap_value)['handler_pc']
+
+    def _memory_trap(self, op, address, pc):
+        """Take the exception of a load/store the memory refused (misaligned or unmapped)"""
+        fault = memory_fault(self.memory, op, address)
+        if fault is None:
+            raise  # Refused for another reason: a simulator error, not a guest fault
+        return self._trap(fault[0], pc, fault[1])
+
+    def _wait_for_interrupt(self, timer_due, budget=NEVER):
+        """Sleep (WFI) until an enabled interrupt is pending
+        
+        Only the CLINT timer can raise one while the core sleeps, so time
+        jumps straight to its compare.
+        
+        Args:
+            timer_due: Cycles until the timer compare is due
+            budget: Cycles the core may sleep (the rest of the run's budget)
+        
+        Returns:
+            (timer_due, slept): cycles until the timer is next due, or None
+            if no enabled interrupt can ever wake the core, and the cycles
+            slept. Still asleep (no interrupt pending) once the budget is spent
+        """
+        csr_bank = self.csr_bank
+        slept = 0
+        while not csr_bank.read(0x344) & csr_bank.read(0x304):
+            if timer_due == NEVER and not (self.multi_hart and budget != NEVER):
+                return None, slept
+            if timer_due > 0:
+                step = min(timer_due, budget - slept)
+                if step <= 0:
+                    return timer_due, slept
+                self.cycles += step
+                self._unticked += step
+                self.idle_cycles += step
+                slept += step
+                timer_due -= step
+                if timer_due > 0:
+                    continue
+            self._sync_time()
+            timer_due = self._cycles_until_timer()
+        return timer_due, slept
+    
+    def _interrupts_possible(self):
+        """Check whether any interrupt could ever be taken (mstatus.MIE and mie)"""
+        return bool((self.csr_bank.read(0x300) >> 3) & 0x1) and self.csr_bank.read(0x304) != 0
+
+    def _execute_csr(self, decoded, op, regs):
+        """Execute a CSR read-modify-write and write the old value to rd"""
+        csr_bank = self.csr_bank
+        if decoded.has_immediate:
+            src_value = decoded.immediate
+        else:
+            src_value = regs[decoded.src_indices[0]] if decoded.src_indices else 0
+
+        if op == Opcode.CSRRW or op == Opcode.CSRRWI:
+            old_value = EXE.execute_csr_read_write(csr_bank, decoded.csr_addr, src_value)
+        elif op == Opcode.CSRRS or op == Opcode.CSRRSI:
+            old_value = EXE.execute_csr_read_set(csr_bank, decoded.csr_addr, src_value)
+        else:
+            old_value = EXE.execute_csr_read_clear(csr_bank, decoded.csr_addr, src_value)
+
+        rd = decoded.rd
+        if rd:
+            regs[rd] = old_value & MASK_32
+
+    def get_stats(self):
+        """Get functional run statistics
+
+        Returns:
+            Dictionary with cycles, instret, trap/interrupt counts, idle
+            cycles skipped, halt reason and block translation statistics
+            (None when translation is off)
+        """
+        return {
+            'cycles': self.cycles,
+            'instret': self.instret,
+            'traps_taken': self.traps_taken,
+            'interrupts_taken': self.interrupts_taken,
+            'idle_cycles': self.idle_cycles,
+            'halt_reason': self.halt_reason,
+            'translation': self.block_cache.get_stats() if self.block_cache is not None else None,
+        }
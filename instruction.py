@@ -1,188 +1,562 @@
 """Instruction class for RISC-V pipeline simulator"""
 import re
+from collections import namedtuple
+from enum import IntEnum
+
+
+class Opcode(IntEnum):
+    """Integer opcode ids resolved once at decode time"""
+    UNKNOWN = 0
+    BUBBLE = 1
+
+    # R-type / I-type ALU operations
+    ADD = 2
+    SUB = 3
+    AND = 4
+    OR = 5
+    XOR = 6
+    SLT = 7
+    SLTU = 8
+    SLL = 9
+    SRL = 10
+    SRA = 11
+    ADDI = 12
+    ANDI = 13
+    ORI = 14
+    XORI = 15
+    SLTI = 16
+    SLTIU = 17
+    SLLI = 18
+    SRLI = 19
+    SRAI = 20
+
+    # Loads and stores (LOAD/STORE are the legacy word aliases)
+    LOAD = 21
+    LW = 22
+    LH = 23
+    LHU = 24
+    LB = 25
+    LBU = 26
+    STORE = 27
+    SW = 28
+    SH = 29
+    SB = 30
+
+    # Upper immediate
+    LUI = 31
+    AUIPC = 32
+
+    # Branches and jumps
+    BEQ = 33
+    BNE = 34
+    BLT = 35
+    BGE = 36
+    BLTU = 37
+    BGEU = 38
+    JAL = 39
+    JALR = 40
+
+    # System, memory ordering and CSR
+    ECALL = 41
+    EBREAK = 42
+    MRET = 43
+    FENCE = 44
+    FENCE_I = 45
+    CSRRW = 46
+    CSRRS = 47
+    CSRRC = 48
+    CSRRWI = 49
+    CSRRSI = 50
+    CSRRCI = 51
+    WFI = 52
+
+
+# Map mnemonic (as produced by the parser) to opcode id
+OPCODE_BY_NAME = {op.name: op for op in Opcode}
+OPCODE_BY_NAME['FENCE.I'] = Opcode.FENCE_I
+
+# Opcode classes used by the pipeline stages (membership tests, no per-call lists)
+ALU_OPCODES = frozenset(op for op in Opcode if Opcode.ADD <= op <= Opcode.SRAI)
+LOAD_OPCODES = frozenset({Opcode.LOAD, Opcode.LW, Opcode.LH, Opcode.LHU, Opcode.LB, Opcode.LBU})
+STORE_OPCODES = frozenset({Opcode.STORE, Opcode.SW, Opcode.SH, Opcode.SB})
+BRANCH_OPCODES = frozenset({Opcode.BEQ, Opcode.BNE, Opcode.BLT, Opcode.BGE, Opcode.BLTU, Opcode.BGEU})
+CSR_OPCODES = frozenset({Opcode.CSRRW, Opcode.CSRRS, Opcode.CSRRC,
+                         Opcode.CSRRWI, Opcode.CSRRSI, Opcode.CSRRCI})
+REDIRECT_OPCODES = frozenset({Opcode.JAL, Opcode.JALR, Opcode.MRET})
+
+# RISC-V ABI register names, indexed by register number
+REG_ABI_NAMES = [
+    'zero', 'ra', 'sp', 'gp', 'tp', 't0', 't1', 't2',  # x0-x7
+    's0', 's1', 'a0', 'a1', 'a2', 'a3', 'a4', 'a5',    # x8-x15
+    'a6', 'a7', 's2', 's3', 's4', 's5', 's6', 's7',    # x16-x23
+    's8', 's9', 's10', 's11', 't3', 't4', 't5', 't6'   # x24-x31
+]
+_ABI_INDEX = {name: i for i, name in enumerate(REG_ABI_NAMES)}
+_ABI_INDEX['fp'] = 8
+
+
+def register_index(reg_name):
+    """Convert a register name ('R5', 'x5', 'a0', ...) to its number
+
+    Returns:
+        Register number 0-31, or None if the name is not a GPR
+    """
+    if reg_name is None:
+        return None
+    name = reg_name.lower()
+    if name[:1] in ('r', 'x') and name[1:].isdigit():
+        index = int(name[1:])
+        return index if index < 32 else None
+    return _ABI_INDEX.get(name)
+
+
+# Compact immutable decoded record shared by every dynamic instance of the
+# same static instruction. Per-instance state lives on Instruction.
+DecodedInstruction = namedtuple('DecodedInstruction', [
+    'text',           # Source text (or disassembly)
+    'opcode',         # Opcode enum
+    'operation',      # Upper-case mnemonic string
+    'dest_reg',       # Destination register name or None
+    'src_regs',       # Tuple of source register names
+    'rd',             # Destination register number or None
+    'rs1',            # Encoded rs1 field (a store's base) or None
+    'rs2',            # Encoded rs2 field (a store's value) or None
+    'src_indices',    # Tuple of source register numbers, in src_regs order
+                      # (stores: value, then base)
+    'offset',         # Load/store/branch/jump offset
+    'immediate',      # Immediate value or None
+    'has_immediate',  # True if immediate is used as an operand
+    'csr_addr',       # CSR address for CSR instructions
+    'is_jump',        # True for JAL/JALR
+    'is_bubble',      # True for pipeline bubbles
+])
+
+
+def _source_fields(opcode, srcs):
+    """Get (rs1, rs2) from source register numbers in src_regs order
+
+    Stores list the value (rs2) before the base address (rs1).
+    """
+    if opcode in STORE_OPCODES and len(srcs) == 2:
+        return srcs[1], srcs[0]
+    return (srcs[0] if len(srcs) > 0 else None), (srcs[1] if len(srcs) > 1 else None)
+
+
+def _make_decoded(text, operation, dest_reg=None, src_regs=None, offset=0,
+                  immediate=None, has_immediate=False, csr_addr=None, is_jump=False):
+    """Build a DecodedInstruction, resolving opcode id and register numbers"""
+    src_regs = tuple(src_regs) if src_regs is not None else ()
+    opcode = OPCODE_BY_NAME.get(operation, Opcode.UNKNOWN) if operation else Opcode.UNKNOWN
+    rs1, rs2 = _source_fields(opcode, [register_index(reg) for reg in src_regs])
+    return DecodedInstruction(
+        text=text,
+        opcode=opcode,
+        operation=operation,
+        dest_reg=dest_reg,
+        src_regs=src_regs,
+        rd=register_index(dest_reg),
+        rs1=rs1,
+        rs2=rs2,
+        # Names that are not a GPR read as x0 (always 0)
+        src_indices=tuple(register_index(reg) or 0 for reg in src_regs),
+        offset=offset,
+        immediate=immediate,
+        has_immediate=has_immediate,
+        csr_addr=csr_addr,
+        is_jump=is_jump,
+        is_bubble=False,
+    )
+
+
+BUBBLE_DECODED = DecodedInstruction(
+    text="BUBBLE", opcode=Opcode.BUBBLE, operation=None, dest_reg=None,
+    src_regs=(), rd=None, rs1=None, rs2=None, src_indices=(), offset=0, immediate=None,
+    has_immediate=False, csr_addr=None, is_jump=False, is_bubble=True,
+)
+
+
+def _parse_immediate(imm_str):
+    """Parse immediate value (supports decimal and hex)"""
+    imm_str = imm_str.strip()
+    if imm_str.startswith('0x') or imm_str.startswith('0X'):
+        return int(imm_str, 16)
+    else:
+        return int(imm_str)
+
+
+def parse_instruction_text(text):
+    """Parse assembly text into a DecodedInstruction
+
+    Handles different instruction formats:
+    R-type: OP dest, src1, src2 (e.g., ADD R1, R2, R3)
+    I-type: OP dest, src1, imm (e.g., ADDI R1, R2, 100)
+    Load: LOAD dest, offset(base) (e.g., LOAD R1, 100(R2))
+    Store: STORE src, offset(base) (e.g., STORE R1, 100(R2))
+    Upper Immediate: LUI/AUIPC dest, imm (e.g., LUI R1, 0x12345)
+    Branch: BEQ src1, src2, offset (e.g., BEQ R1, R2, 100)
+    """
+    if text == "BUBBLE":
+        return BUBBLE_DECODED
+
+    text_upper = text.upper()
+
+    # Memory operations (Load/Store)
+    if "LOAD" in text_upper or "LW" in text_upper or "LB" in text_upper or "LH" in text_upper or "LBU" in text_upper or "LHU" in text_upper:
+        match = re.search(r'(\w+)\s+(\w+),\s*(-?\d+)\((\w+)\)', text, re.IGNORECASE)
+        if match:
+            return _make_decoded(text, match.group(1).upper(),
+                                 dest_reg=match.group(2),
+                                 offset=int(match.group(3)),
+                                 src_regs=[match.group(4)])  # base register
+
+    elif "STORE" in text_upper or "SW" in text_upper or "SB" in text_upper or "SH" in text_upper:
+        match = re.search(r'(\w+)\s+(\w+),\s*(-?\d+)\((\w+)\)', text, re.IGNORECASE)
+        if match:
+            # STORE doesn't write to register; sources are value and base register
+            return _make_decoded(text, match.group(1).upper(),
+                                 offset=int(match.group(3)),
+                                 src_regs=[match.group(2), match.group(4)])
+
+    # Upper Immediate instructions (LUI, AUIPC)
+    elif text_upper.startswith('LUI') or text_upper.startswith('AUIPC'):
+        match = re.search(r'(\w+)\s+(\w+),\s*(-?(?:0x)?[0-9a-fA-F]+)', text, re.IGNORECASE)
+        if match:
+            return _make_decoded(text, match.group(1).upper(),
+                                 dest_reg=match.group(2),
+                                 immediate=_parse_immediate(match.group(3)),
+                                 has_immediate=True)
+
+    # System instructions (ECALL, EBREAK), privileged (MRET, WFI)
+    # and memory ordering (FENCE, FENCE.I) have no register operands
+    elif text_upper in ['ECALL', 'EBREAK', 'MRET', 'WFI', 'FENCE', 'FENCE.I']:
+        return _make_decoded(text, text_upper)
+
+    # CSR instructions (CSRRW, CSRRS, CSRRC, CSRRWI, CSRRSI, CSRRCI)
+    elif text_upper.startswith('CSR'):
+        # CSR format: CSRXX rd, csr, rs1/uimm
+        # Examples: CSRRW R1, 0x300, R2  or  CSRRWI R1, 0x300, 5
+        match = re.search(r'(\w+)\s+(\w+),\s*(-?(?:0x)?[0-9a-fA-F]+),\s*(\w+)', text, re.IGNORECASE)
+        if match:
+            operation = match.group(1).upper()
+            last_operand = match.group(4)
+            if operation.endswith('I'):
+                # Immediate variants (CSRRWI, CSRRSI, CSRRCI)
+                return _make_decoded(text, operation,
+                                     dest_reg=match.group(2),
+                                     csr_addr=_parse_immediate(match.group(3)),
+                                     immediate=_parse_immediate(last_operand) & 0x1F,  # 5-bit unsigned
+                                     has_immediate=True)
+            # Register variants (CSRRW, CSRRS, CSRRC)
+            return _make_decoded(text, operation,
+                                 dest_reg=match.group(2),
+                                 csr_addr=_parse_immediate(match.group(3)),
+                                 src_regs=[last_operand])
+
+    # Branch instructions
+    elif text_upper.startswith('B'):
+        match = re.search(r'(\w+)\s+(\w+),\s*(\w+),\s*(-?\d+)', text, re.IGNORECASE)
+        if match:
+            # Branches don't write to register
+            return _make_decoded(text, match.group(1).upper(),
+                                 src_regs=[match.group(2), match.group(3)],
+                                 offset=int(match.group(4)))
+
+    # Jump instructions
+    elif text_upper.startswith('JAL'):
+        if 'JALR' in text_upper:
+            # JALR: dest, src, offset
+            match = re.search(r'JALR\s+(\w+),\s*(\w+),\s*(-?\d+)', text, re.IGNORECASE)
+            if match:
+                return _make_decoded(text, 'JALR',
+                                     dest_reg=match.group(1),
+                                     src_regs=[match.group(2)],
+                                     offset=int(match.group(3)),
+                                     is_jump=True)
+        else:
+            # JAL: dest, offset
+            match = re.search(r'JAL\s+(\w+),\s*(-?\d+)', text, re.IGNORECASE)
+            if match:
+                return _make_decoded(text, 'JAL',
+                                     dest_reg=match.group(1),
+                                     offset=int(match.group(2)),
+                                     is_jump=True)
+        return _make_decoded(text, None, is_jump=True)
+
+    # I-type instructions (immediate operations) - CHECK BEFORE R-type!
+    elif re.search(r'I\b', text_upper):  # Instructions ending with 'I' (ADDI, ANDI, etc.)
+        # Match pattern: OPCODE dest, src, immediate
+        match = re.search(r'(\w+)\s+(\w+),\s*(\w+),\s*(-?(?:0x)?[0-9a-fA-F]+)', text, re.IGNORECASE)
+        if match:
+            # If the third operand starts with R followed by more, it's a register;
+            # otherwise it's an immediate disguised as register name
+            third_operand = match.group(3)
+            if third_operand.upper().startswith('R') and len(third_operand) > 1:
+                src_regs = [third_operand]
+            else:
+                src_regs = []
+            return _make_decoded(text, match.group(1).upper(),
+                                 dest_reg=match.group(2),
+                                 src_regs=src_regs,
+                                 immediate=_parse_immediate(match.group(4)),
+                                 has_immediate=True)
+
+    # R-type instructions (register-register operations)
+    else:
+        match = re.search(r'(\w+)\s+(\w+),\s*(\w+),\s*(\w+)', text, re.IGNORECASE)
+        if match:
+            # Check if operands look like registers (start with R or are x0-x31)
+            src1 = match.group(3)
+            src2 = match.group(4)
+            # If second operand is a number, it's actually an immediate (I-type)
+            if not ((src1.upper().startswith('R') or src1.startswith('x')) and
+                    (src2.upper().startswith('R') or src2.startswith('x'))) and \
+               (src2.isdigit() or (src2.startswith('-') and src2[1:].isdigit()) or src2.startswith('0x')):
+                return _make_decoded(text, match.group(1).upper(),
+                                     dest_reg=match.group(2),
+                                     src_regs=[src1],
+                                     immediate=_parse_immediate(src2),
+                                     has_immediate=True)
+            return _make_decoded(text, match.group(1).upper(),
+                                 dest_reg=match.group(2),
+                                 src_regs=[src1, src2])
+
+    # Unrecognized format: no operation, no operands
+    return _make_decoded(text, None)
+
+
+# Binary decode tables (funct3 -> mnemonic) for RV32I major opcodes
+_OP_IMM_NAMES = {0x0: 'ADDI', 0x2: 'SLTI', 0x3: 'SLTIU', 0x4: 'XORI', 0x6: 'ORI', 0x7: 'ANDI'}
+_OP_NAMES = {0x0: 'ADD', 0x1: 'SLL', 0x2: 'SLT', 0x3: 'SLTU', 0x4: 'XOR', 0x5: 'SRL', 0x6: 'OR', 0x7: 'AND'}
+_LOAD_NAMES = {0x0: 'LB', 0x1: 'LH', 0x2: 'LW', 0x4: 'LBU', 0x5: 'LHU'}
+_STORE_NAMES = {0x0: 'SB', 0x1: 'SH', 0x2: 'SW'}
+_BRANCH_NAMES = {0x0: 'BEQ', 0x1: 'BNE', 0x4: 'BLT', 0x5: 'BGE', 0x6: 'BLTU', 0x7: 'BGEU'}
+_CSR_NAMES = {0x1: 'CSRRW', 0x2: 'CSRRS', 0x3: 'CSRRC', 0x5: 'CSRRWI', 0x6: 'CSRRSI', 0x7: 'CSRRCI'}
+
+# Register names in the simulator's R0-R31 format
+_REG_NAMES = [f'R{i}' for i in range(32)]
+
+
+def _sign_extend(value, bits):
+    """Sign-extend a bits-wide field to a Python int"""
+    sign_bit = 1 << (bits - 1)
+    return (value & (sign_bit - 1)) - (value & sign_bit)
+
+
+def _make_word_decoded(text, operation, rd=None, srcs=(), offset=0,
+                       immediate=None, has_immediate=False, csr_addr=None, is_jump=False):
+    """Build a DecodedInstruction from already-extracted binary fields"""
+    src_regs = tuple(_REG_NAMES[r] for r in srcs)
+    opcode = OPCODE_BY_NAME[operation]
+    rs1, rs2 = _source_fields(opcode, srcs)
+    return DecodedInstruction(
+        text=text,
+        opcode=opcode,
+        operation=operation,
+        dest_reg=_REG_NAMES[rd] if rd is not None else None,
+        src_regs=src_regs,
+        rd=rd,
+        rs1=rs1,
+        rs2=rs2,
+        src_indices=tuple(srcs),
+        offset=offset,
+        immediate=immediate,
+        has_immediate=has_immediate,
+        csr_addr=csr_addr,
+        is_jump=is_jump,
+        is_bubble=False,
+    )
+
+
+def _unknown_word(word):
+    """Decoded record for an instruction word outside the supported ISA"""
+    return _make_decoded(f"UNKNOWN(0x{word:08x})", None)
+
+
+def decode_instruction_word(word):
+    """Decode a 32-bit RV32I instruction word into a DecodedInstruction
+
+    Fields are extracted with shifts and masks; no text is parsed. The
+    record's text is a disassembly in the simulator's R0-R31 syntax
+    (e.g. "LW R5, -4(R2)") so traces read the same as hand-written programs.
+    Register operands follow the text path's order: stores list the value
+    register before the base register.
+
+    Args:
+        word: 32-bit instruction word
+
+    Returns:
+        DecodedInstruction (opcode Opcode.UNKNOWN if the word is not RV32I)
+    """
+    word &= 0xFFFFFFFF
+    major = word & 0x7F
+    rd = (word >> 7) & 0x1F
+    funct3 = (word >> 12) & 0x7
+    rs1 = (word >> 15) & 0x1F
+    rs2 = (word >> 20) & 0x1F
+    funct7 = word >> 25
+
+    if major == 0x13:  # OP-IMM
+        imm = _sign_extend(word >> 20, 12)
+        if funct3 == 0x1:
+            if funct7 != 0:
+                return _unknown_word(word)
+            op, imm = 'SLLI', rs2
+        elif funct3 == 0x5:
+            if funct7 == 0x00:
+                op = 'SRLI'
+            elif funct7 == 0x20:
+                op = 'SRAI'
+            else:
+                return _unknown_word(word)
+            imm = rs2
+        else:
+            op = _OP_IMM_NAMES[funct3]
+        return _make_word_decoded(f"{op} R{rd}, R{rs1}, {imm}", op, rd, (rs1,),
+                                  immediate=imm, has_immediate=True)
+
+    if major == 0x33:  # OP
+        if funct7 == 0x00:
+            op = _OP_NAMES[funct3]
+        elif funct7 == 0x20 and funct3 == 0x0:
+            op = 'SUB'
+        elif funct7 == 0x20 and funct3 == 0x5:
+            op = 'SRA'
+        else:
+            return _unknown_word(word)
+        return _make_word_decoded(f"{op} R{rd}, R{rs1}, R{rs2}", op, rd, (rs1, rs2))
+
+    if major == 0x03:  # LOAD
+        op = _LOAD_NAMES.get(funct3)
+        if op is None:
+            return _unknown_word(word)
+        imm = _sign_extend(word >> 20, 12)
+        return _make_word_decoded(f"{op} R{rd}, {imm}(R{rs1})", op, rd, (rs1,), offset=imm)
+
+    if major == 0x23:  # STORE
+        op = _STORE_NAMES.get(funct3)
+        if op is None:
+            return _unknown_word(word)
+        imm = _sign_extend((funct7 << 5) | rd, 12)
+        return _make_word_decoded(f"{op} R{rs2}, {imm}(R{rs1})", op, None, (rs2, rs1), offset=imm)
+
+    if major == 0x63:  # BRANCH
+        op = _BRANCH_NAMES.get(funct3)
+        if op is None:
+            return _unknown_word(word)
+        imm = _sign_extend(((word >> 31) << 12) | (((word >> 7) & 0x1) << 11) |
+                           (((word >> 25) & 0x3F) << 5) | (((word >> 8) & 0xF) << 1), 13)
+        return _make_word_decoded(f"{op} R{rs1}, R{rs2}, {imm}", op, None, (rs1, rs2), offset=imm)
+
+    if major == 0x37 or major == 0x17:  # LUI / AUIPC
+        op = 'LUI' if major == 0x37 else 'AUIPC'
+        imm = word >> 12
+        return _make_word_decoded(f"{op} R{rd}, {imm:#x}", op, rd,
+                                  immediate=imm, has_immediate=True)
+
+    if major == 0x6F:  # JAL
+        imm = _sign_extend(((word >> 31) << 20) | (((word >> 12) & 0xFF) << 12) |
+                           (((word >> 20) & 0x1) << 11) | (((word >> 21) & 0x3FF) << 1), 21)
+        return _make_word_decoded(f"JAL R{rd}, {imm}", 'JAL', rd, offset=imm, is_jump=True)
+
+    if major == 0x67 and funct3 == 0x0:  # JALR
+        imm = _sign_extend(word >> 20, 12)
+        return _make_word_decoded(f"JALR R{rd}, R{rs1}, {imm}", 'JALR', rd, (rs1,),
+                                  offset=imm, is_jump=True)
+
+    if major == 0x73:  # SYSTEM
+        csr = word >> 20
+        if funct3 == 0x0:
+            if rd != 0 or rs1 != 0:
+                return _unknown_word(word)
+            if csr == 0x000:
+                return _make_word_decoded("ECALL", 'ECALL')
+            if csr == 0x001:
+                return _make_word_decoded("EBREAK", 'EBREAK')
+            if csr == 0x302:
+                return _make_word_decoded("MRET", 'MRET')
+            if csr == 0x105:
+                return _make_word_decoded("WFI", 'WFI')
+            return _unknown_word(word)
+        op = _CSR_NAMES.get(funct3)
+        if op is None:
+            return _unknown_word(word)
+        if funct3 & 0x4:
+            # Immediate variants: rs1 field holds a 5-bit unsigned immediate
+            return _make_word_decoded(f"{op} R{rd}, {csr:#x}, {rs1}", op, rd,
+                                      immediate=rs1, has_immediate=True, csr_addr=csr)
+        return _make_word_decoded(f"{op} R{rd}, {csr:#x}, R{rs1}", op, rd, (rs1,), csr_addr=csr)
+
+    if major == 0x0F:  # MISC-MEM
+        if funct3 == 0x0:
+            return _make_word_decoded("FENCE", 'FENCE')
+        if funct3 == 0x1:
+            return _make_word_decoded("FENCE.I", 'FENCE.I')
+
+    return _unknown_word(word)
 
 
 class Instruction:
-    """Represents a parsed instruction with register dependencies"""
-    def __init__(self, text):
-        self.text = text
-        self.is_bubble = (text == "BUBBLE")
-        self.dest_reg = None
-        self.src_regs = []
-        self.operation = None
-        self.offset = 0
-        self.immediate = None  # For immediate values in I-type instructions
-        self.has_immediate = False
-        
+    """Represents a parsed instruction with register dependencies
+
+    Static fields (operation, registers, immediates) come from a shared
+    DecodedInstruction record; only the per-instance execution state is
+    allocated for each dynamic instance. The opcode and bubble flag every
+    stage tests are copied into slots; hot paths read the other fields
+    from decoded.
+    """
+    __slots__ = ('decoded', 'opcode', 'is_bubble', 'src_values', 'result', 'mem_address',
+                 'jump_target', 'trap_info', 'pc', 'word', 'epoch', 'fault', 'forwards',
+                 'prediction')
+
+    def __init__(self, text, decoded=None):
+        self.decoded = decoded = decoded if decoded is not None else parse_instruction_text(text)
+        self.opcode = decoded.opcode
+        self.is_bubble = decoded.is_bubble
+
         # For storing computed values during execution
         self.src_values = []
         self.result = None
         self.mem_address = None
         self.jump_target = None  # For JAL/JALR jump target address
-        self.is_jump = False  # Flag for jump instructions
-        self.csr_addr = None  # For CSR instructions (12-bit immediate)
-        
-        if not self.is_bubble:
-            self.parse()
-    
-    def parse(self):
-        """Parse instruction to extract destination and source registers"""
-        # Handle different instruction formats:
-        # R-type: OP dest, src1, src2 (e.g., ADD R1, R2, R3)
-        # I-type: OP dest, src1, imm (e.g., ADDI R1, R2, 100)
-        # Load: LOAD dest, offset(base) (e.g., LOAD R1, 100(R2))
-        # Store: STORE src, offset(base) (e.g., STORE R1, 100(R2))
-        # Upper Immediate: LUI/AUIPC dest, imm (e.g., LUI R1, 0x12345)
-        # Branch: BEQ src1, src2, offset (e.g., BEQ R1, R2, 100)
-        
-        text_upper = self.text.upper()
+        self.trap_info = None    # Set when this instruction raises a trap
         
-        # Memory operations (Load/Store)
-        if "LOAD" in text_upper or "LW" in text_upper or "LB" in text_upper or "LH" in text_upper or "LBU" in text_upper or "LHU" in text_upper:
-            match = re.search(r'(\w+)\s+(\w+),\s*(-?\d+)\((\w+)\)', self.text, re.IGNORECASE)
-            if match:
-                self.operation = match.group(1).upper()
-                self.dest_reg = match.group(2)
-                self.offset = int(match.group(3))
-                self.src_regs = [match.group(4)]  # base register
-                
-        elif "STORE" in text_upper or "SW" in text_upper or "SB" in text_upper or "SH" in text_upper:
-            match = re.search(r'(\w+)\s+(\w+),\s*(-?\d+)\((\w+)\)', self.text, re.IGNORECASE)
-            if match:
-                self.operation = match.group(1).upper()
-                self.dest_reg = None  # STORE doesn't write to register
-                self.offset = int(match.group(3))
-                self.src_regs = [match.group(2), match.group(4)]  # value and base register
-                
-        # Upper Immediate instructions (LUI, AUIPC)
-        elif text_upper.startswith('LUI') or text_upper.startswith('AUIPC'):
-            match = re.search(r'(\w+)\s+(\w+),\s*(-?(?:0x)?[0-9a-fA-F]+)', self.text, re.IGNORECASE)
-            if match:
-                self.operation = match.group(1).upper()
-                self.dest_reg = match.group(2)
-                self.immediate = self._parse_immediate(match.group(3))
-                self.has_immediate = True
-                self.src_regs = []
-                
-        # System instructions (ECALL, EBREAK)
-        elif text_upper in ['ECALL', 'EBREAK']:
-            self.operation = text_upper
-            self.dest_reg = None  # System instructions don't write to register
-            self.src_regs = []
+        # Set by the memory fetch engine (None/0 for list-fed programs)
+        self.pc = None           # Address this instance was fetched from
+        self.word = None         # Instruction word fetched there
+        self.epoch = 0           # Flush epoch at fetch time (stale epochs are squashed)
+        self.fault = None        # (exception code, trap value) raised at Execute
         
-        # Privileged instructions (MRET)
-        elif text_upper == 'MRET':
-            self.operation = 'MRET'
-            self.dest_reg = None  # MRET doesn't write to register
-            self.src_regs = []
-        
-        # Memory ordering instructions (FENCE, FENCE.I)
-        elif text_upper in ['FENCE', 'FENCE.I']:
-            self.operation = text_upper
-            self.dest_reg = None  # FENCE instructions don't write to register
-            self.src_regs = []
-        
-        # CSR instructions (CSRRW, CSRRS, CSRRC, CSRRWI, CSRRSI, CSRRCI)
-        elif text_upper.startswith('CSR'):
-            # CSR format: CSRXX rd, csr, rs1/uimm
-            # Examples: CSRRW R1, 0x300, R2  or  CSRRWI R1, 0x300, 5
-            match = re.search(r'(\w+)\s+(\w+),\s*(-?(?:0x)?[0-9a-fA-F]+),\s*(\w+)', self.text, re.IGNORECASE)
-            if match:
-                self.operation = match.group(1).upper()
-                self.dest_reg = match.group(2)
-                self.csr_addr = self._parse_immediate(match.group(3))
-                
-                # Check if last operand is register or immediate
-                last_operand = match.group(4)
-                if self.operation.endswith('I'):
-                    # Immediate variants (CSRRWI, CSRRSI, CSRRCI)
-                    self.immediate = self._parse_immediate(last_operand) & 0x1F  # 5-bit unsigned
-                    self.has_immediate = True
-                    self.src_regs = []
-                else:
-                    # Register variants (CSRRW, CSRRS, CSRRC)
-                    self.src_regs = [last_operand]
-            
-        # Branch instructions
-        elif text_upper.startswith('B'):
-            match = re.search(r'(\w+)\s+(\w+),\s*(\w+),\s*(-?\d+)', self.text, re.IGNORECASE)
-            if match:
-                self.operation = match.group(1).upper()
-                self.dest_reg = None  # Branches don't write to register
-                self.src_regs = [match.group(2), match.group(3)]
-                self.offset = int(match.group(4))
-                
-        # Jump instructions
-        elif text_upper.startswith('JAL'):
-            self.is_jump = True
-            if 'JALR' in text_upper:
-                # JALR: dest, src, offset
-                match = re.search(r'JALR\s+(\w+),\s*(\w+),\s*(-?\d+)', self.text, re.IGNORECASE)
-                if match:
-                    self.operation = 'JALR'
-                    self.dest_reg = match.group(1)
-                    self.src_regs = [match.group(2)]
-                    self.offset = int(match.group(3))
-            else:
-                # JAL: dest, offset
-                match = re.search(r'JAL\s+(\w+),\s*(-?\d+)', self.text, re.IGNORECASE)
-                if match:
-                    self.operation = 'JAL'
-                    self.dest_reg = match.group(1)
-                    self.offset = int(match.group(2))
-                    self.src_regs = []
-                    
-        # I-type instructions (immediate operations) - CHECK BEFORE R-type!
-        elif re.search(r'I\b', text_upper):  # Instructions ending with 'I' (ADDI, ANDI, etc.)
-            # Match pattern: OPCODE dest, src, immediate
-            match = re.search(r'(\w+)\s+(\w+),\s*(\w+),\s*(-?(?:0x)?[0-9a-fA-F]+)', self.text, re.IGNORECASE)
-            if match:
-                self.operation = match.group(1).upper()
-                self.dest_reg = match.group(2)
-                # Check if third operand is a register or already parsed
-                third_operand = match.group(3)
-                # If it starts with R and is followed by digit, it's a register
-                if third_operand.upper().startswith('R') and len(third_operand) > 1:
-                    self.src_regs = [third_operand]
-                else:
-                    # It's an immediate disguised as register name
-                    self.src_regs = []
-                self.immediate = self._parse_immediate(match.group(4))
-                self.has_immediate = True
-                
-        # R-type instructions (register-register operations)
-        else:
-            match = re.search(r'(\w+)\s+(\w+),\s*(\w+),\s*(\w+)', self.text, re.IGNORECASE)
-            if match:
-                self.operation = match.group(1).upper()
-                self.dest_reg = match.group(2)
-                # Check if operands look like registers (start with R or are x0-x31)
-                src1 = match.group(3)
-                src2 = match.group(4)
-                # If both operands start with R or x, they're registers
-                if (src1.upper().startswith('R') or src1.startswith('x')) and \
-                   (src2.upper().startswith('R') or src2.startswith('x')):
-                    self.src_regs = [src1, src2]
-                # If second operand is a number, it's actually an immediate (I-type)
-                elif src2.isdigit() or (src2.startswith('-') and src2[1:].isdigit()) or src2.startswith('0x'):
-                    self.operation = match.group(1).upper()
-                    self.dest_reg = match.group(2)
-                    self.src_regs = [src1]
-                    self.immediate = self._parse_immediate(src2)
-                    self.has_immediate = True
-                else:
-                    self.src_regs = [src1, src2]
-    
-    def _parse_immediate(self, imm_str):
-        """Parse immediate value (supports decimal and hex)"""
-        imm_str = imm_str.strip()
-        if imm_str.startswith('0x') or imm_str.startswith('0X'):
-            return int(imm_str, 16)
-        else:
-            return int(imm_str)
-    
+        # Set by Decode when forwarding is enabled: (source index, producer) pairs
+        # whose results replace the register values read at Decode
+        self.forwards = None
+        self.prediction = None   # Fetch-time branch prediction (branch_predictor.Prediction)
+
+    @classmethod
+    def from_decoded(cls, decoded):
+        """Create a dynamic instance from a cached DecodedInstruction"""
+        return cls(decoded.text, decoded)
+
+    @classmethod
+    def from_word(cls, word):
+        """Create an instruction straight from a 32-bit instruction word"""
+        decoded = decode_instruction_word(word)
+        return cls(decoded.text, decoded)
+
+    # Other static fields are read-only views onto the decoded record
+    text = property(lambda self: self.decoded.text)
+    operation = property(lambda self: self.decoded.operation)
+    dest_reg = property(lambda self: self.decoded.dest_reg)
+    src_regs = property(lambda self: self.decoded.src_regs)
+    rd = property(lambda self: self.decoded.rd)
+    src_indices = property(lambda self: self.decoded.src_indices)
+    offset = property(lambda self: self.decoded.offset)
+    immediate = property(lambda self: self.decoded.immediate)
+    has_immediate = property(lambda self: self.decoded.has_immediate)
+    csr_addr = property(lambda self: self.decoded.csr_addr)
+    is_jump = property(lambda self: self.decoded.is_jump)
+
     def __str__(self):
         return self.text
-    
+
     def __repr__(self):
         return f"Instruction({self.text})"
@@ -5,6 +5,27 @@ masking, priority resolution, and edge/level triggering.
 """
 
 
+# Interrupt bits by priority, highest first (see InterruptController.PRIORITY)
+PRIORITY_ORDER = (11, 3, 7)
+
+
+def highest_priority_bit(mask):
+    """Get the highest priority interrupt bit set in a mie/mip-style mask
+    
+    Args:
+        mask: Interrupt bitmask (e.g. CSRBank.deliverable)
+        
+    Returns:
+        Interrupt bit position (11, 3 or 7), or None if none is set
+    """
+    if not mask:
+        return None
+    for bit in PRIORITY_ORDER:
+        if mask & (1 << bit):
+            return bit
+    return None
+
+
 class InterruptController:
     """Interrupt Controller with enable/pending logic
     
@@ -149,21 +170,9 @@ class InterruptController:
         Returns:
             List of interrupt bit positions ready for delivery
         """
-        if not self.is_globally_enabled():
-            return []
-        
-        mip = self.csr_bank.read(0x344)
-        mie = self.csr_bank.read(0x304)
-        
-        # Mask pending with enabled
-        deliverable_mask = mip & mie
-        
-        deliverable = []
-        for bit in [self.INT_SOFTWARE, self.INT_TIMER, self.INT_EXTERNAL]:
-            if deliverable_mask & (1 << bit):
-                deliverable.append(bit)
-        
-        return deliverable
+        deliverable_mask = self.csr_bank.deliverable
+        return [bit for bit in (self.INT_SOFTWARE, self.INT_TIMER, self.INT_EXTERNAL)
+                if deliverable_mask & (1 << bit)]
     
     def get_highest_priority_interrupt(self):
         """Get highest priority deliverable interrupt
@@ -174,15 +183,7 @@ class InterruptController:
             Interrupt bit position of highest priority interrupt,
             or None if no interrupts are deliverable
         """
-        deliverable = self.get_deliverable_interrupts()
-        
-        if not deliverable:
-            return None
-        
-        # Sort by priority (highest first)
-        deliverable.sort(key=lambda bit: self.PRIORITY.get(bit, 0), reverse=True)
-        
-        return deliverable[0]
+        return highest_priority_bit(self.csr_bank.deliverable)
     
     def acknowledge_interrupt(self, interrupt_bit):
         """Acknowledge (clear) an interrupt after delivery
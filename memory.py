@@ -1,50 +1,364 @@
-"""Memory module for RISC-V pipeline simulator"""
+"""Memory module for RISC-V pipeline simulator
+
+Guest memory is sparse and page-granular: RAM regions are address windows
+backed by 4 KiB pages that are allocated on first touch, so a RAM region
+at 0x80000000 (riscv-tests) costs nothing until the program uses it.
+
+Loads and stores are routed through an address-decoded bus: a hit in the
+table of already-touched RAM pages is the fast path, and only the
+remaining addresses are looked up in a sorted table of regions (RAM
+windows plus memory-mapped devices such as the UART, the CLINT, and any
+device added with Memory.map_device()). Every access width (byte,
+halfword, word) goes through the same decode, so a byte store to the UART
+TX register transmits just like a word store.
+
+Pages written since the last clear_dirty() are tracked as dirty, so state
+dumps and snapshots only need to visit pages that were actually used.
+Pages are private bytearrays unless a page factory is set
+(set_page_factory()), e.g. to back RAM with shared memory so that harts
+running in other processes see the same bytes (multihart.py).
+
+Memory is shared by every hart of a multi-hart system (multihart.py) and
+provides the hooks the A extension needs: load_reserved() and
+store_conditional() for LR/SC, and amo_word() for AMOs. Harts run one at a
+time in a process, so accesses are sequentially consistent and the aq/rl
+bits and FENCE need nothing more. Pages holding a reservation are kept out of the
+fast write table, so every store to them is checked against it.
+
+Likewise, once a decode cache watches a Memory (watch_code()), the pages
+it holds code for stay out of the fast write table, and any write to them
+(a guest store or a host write_word()/write_bytes()/install_page()) drops
+the cached records it overwrites.
+"""
+
+import bisect
+
+PAGE_SHIFT = 12
+PAGE_SIZE = 1 << PAGE_SHIFT
+PAGE_MASK = PAGE_SIZE - 1
+
+
+class MemoryRegion:
+    """RAM window or memory-mapped device window on the bus
+
+    RAM regions have device None and are backed by the Memory page table.
+    A device implements read_register(address) -> value (None for an
+    unhandled address) and write_register(address, value).
+
+    register_width selects how sub-register accesses reach the device:
+    - 1: byte-wide registers; every access passes its own address and the
+         value masked to the access size (UART)
+    - 4: word-wide registers; narrower loads extract their byte lane from
+         the containing word and narrower stores read-modify-write it (CLINT)
+    """
+
+    __slots__ = ('start', 'end', 'device', 'name', 'register_width')
+
+    def __init__(self, start, size, device, name=None, register_width=4):
+        if register_width not in (1, 4):
+            raise ValueError(f"Unsupported register width: {register_width}")
+        self.start = start
+        self.end = start + size  # Exclusive
+        self.device = device
+        self.name = name or type(device).__name__
+        self.register_width = register_width
+
+    @property
+    def is_ram(self):
+        return self.device is None
+
+    def read(self, address, access_size):
+        """Load access_size bytes (zero-extended) from the device"""
+        mask = (1 << (access_size * 8)) - 1
+        if self.register_width == 1 or access_size == 4:
+            value = self.device.read_register(address)
+            return (value if value is not None else 0) & mask
+        word = self.device.read_register(address & ~0x3)
+        shift = (address & 0x3) * 8
+        return ((word if word is not None else 0) >> shift) & mask
+
+    def write(self, address, value, access_size):
+        """Store the low access_size bytes of value to the device"""
+        mask = (1 << (access_size * 8)) - 1
+        if self.register_width == 1 or access_size == 4:
+            self.device.write_register(address, value & mask)
+            return
+        word_address = address & ~0x3
+        word = self.device.read_register(word_address) or 0
+        shift = (address & 0x3) * 8
+        word = (word & ~(mask << shift)) | ((value & mask) << shift)
+        self.device.write_register(word_address, word & 0xFFFFFFFF)
+
+    def __repr__(self):
+        return f"MemoryRegion({self.name}, 0x{self.start:08x}-0x{self.end - 1:08x})"
 
 
 class Memory:
     """Byte-addressable data memory for LOAD/STORE operations
     
     Supports:
-    - Configurable memory size (default 1MB)
+    - Configurable memory size (default 1MB), plus extra RAM windows (map_ram())
     - Byte, halfword (2 bytes), and word (4 bytes) access
     - Little-endian byte ordering
     - Sign extension for signed loads (LB, LH)
+    - Memory-mapped devices at any access width (see map_device())
+    - Pages allocated on first touch, with dirty-page tracking
     """
     def __init__(self, size=1*1024*1024, base_address=0, uart=None, clint=None):
         """Initialize memory
         
         Args:
-            size: Memory size in bytes (default 1MB)
-            base_address: Base address offset (default 0)
+            size: Size in bytes of the RAM region at base_address (default 1MB)
+            base_address: Base address of that region (default 0)
             uart: Optional UART peripheral for memory-mapped I/O
             clint: Optional CLINT peripheral for memory-mapped timer
         """
         self.size = size
         self.base_address = base_address
-        self.data = bytearray(size)
         self.uart = uart
         self.clint = clint
+        
+        # Regions sorted by start address (starts kept for bisect)
+        self.regions = []
+        self._region_starts = []
+        
+        # Page number -> bytearray(PAGE_SIZE) (or a page_factory page) for
+        # every allocated page. Pages lying wholly inside one RAM region are
+        # also entered in the fast read table, and in the fast write table
+        # while dirty; partial pages always take the decoded path so region
+        # bounds are still enforced.
+        self.pages = {}
+        self.dirty_pages = set()
+        self._read_pages = {}
+        self._write_pages = {}
+        self.page_factory = None  # page number -> PAGE_SIZE buffer (None: bytearray)
+        
+        # LR/SC: hart -> reserved word address, and the pages holding one
+        self.reservations = {}
+        self._reserved_pages = set()
+        
+        # Decode cache watching writes into code (watch_code()), and its code pages
+        self.code_cache = None
+        self._code_pages = {}
+        
+        self.map_ram(base_address, size, name='ram')
+        if uart is not None:
+            self.map_device(uart.TX_DATA_REG, uart.WINDOW_SIZE, uart, name='uart', register_width=1)
+        if clint is not None:
+            self.map_device(clint.MSIP_BASE, clint.MTIME_BASE + 8 - clint.MSIP_BASE, clint, name='clint')
+    
+    # Region table
+    def _insert_region(self, region):
+        """Add a region to the sorted table, rejecting overlaps"""
+        index = bisect.bisect_left(self._region_starts, region.start)
+        for neighbour in self.regions[max(0, index - 1):index + 1]:
+            if region.start < neighbour.end and neighbour.start < region.end:
+                raise ValueError(f"Region {region.name} at 0x{region.start:08x} overlaps {neighbour.name}")
+        self.regions.insert(index, region)
+        self._region_starts.insert(index, region.start)
+        return region
     
-    def _check_address(self, address, access_size=1):
-        """Validate memory address and alignment
+    def map_ram(self, start, size, name=None):
+        """Map a RAM window into the address space
+        
+        No storage is allocated until the window is accessed.
         
         Args:
-            address: Memory address to check
-            access_size: Size of access in bytes (1, 2, or 4)
-            
+            start: First address of the window
+            size: Window size in bytes
+            name: Region name (default: 'ram@<start>')
+        
+        Returns:
+            The new MemoryRegion
+        
         Raises:
-            ValueError: If address is out of bounds or misaligned
+            ValueError: If the window overlaps another region
         """
-        offset = address - self.base_address
-        if offset < 0 or offset + access_size > self.size:
+        return self._insert_region(MemoryRegion(start, size, None, name or f"ram@0x{start:08x}"))
+    
+    def map_device(self, start, size, device, name=None, register_width=4):
+        """Map a device into the address space
+        
+        Args:
+            start: First address of the device window
+            size: Window size in bytes
+            device: Object with read_register(address)/write_register(address, value)
+            name: Region name (default: device class name)
+            register_width: 1 for byte-wide registers, 4 for word-wide
+                            registers (see MemoryRegion)
+        
+        Returns:
+            The new MemoryRegion
+        
+        Raises:
+            ValueError: If the window overlaps RAM or another device
+        """
+        return self._insert_region(MemoryRegion(start, size, device, name, register_width))
+    
+    def find_region(self, address):
+        """Get the region containing address, or None"""
+        index = bisect.bisect_right(self._region_starts, address) - 1
+        if index >= 0:
+            region = self.regions[index]
+            if address < region.end:
+                return region
+        return None
+    
+    def is_mapped(self, address, access_size=1):
+        """Check whether an access of access_size bytes at address reaches RAM or a device"""
+        if address >> PAGE_SHIFT in self._read_pages and (address & PAGE_MASK) + access_size <= PAGE_SIZE:
+            return True
+        region = self.find_region(address)
+        return region is not None and address + access_size <= region.end
+    
+    @property
+    def ram_regions(self):
+        """RAM regions in address order"""
+        return [region for region in self.regions if region.is_ram]
+    
+    def _decode(self, address, access_size):
+        """Find the region handling an access that missed the fast page tables
+        
+        Raises:
+            ValueError: If nothing is mapped there (out of bounds) or the
+                        access is misaligned
+        """
+        region = self.find_region(address)
+        if region is None or address + access_size > region.end:
             raise ValueError(f"Memory access out of bounds: 0x{address:08x} "
-                           f"(valid range: 0x{self.base_address:08x}-0x{self.base_address + self.size - 1:08x})")
+                           f"(mapped: {', '.join(map(repr, self.regions))})")
+        if address & (access_size - 1):
+            kind = 'halfword' if access_size == 2 else 'word'
+            raise ValueError(f"Misaligned {kind} access at 0x{address:08x}")
+        return region
+    
+    # Page table
+    def _page(self, page_number, region, dirty):
+        """Get (allocating on first touch) the page backing a RAM region address"""
+        page = self.pages.get(page_number)
+        if page is None:
+            factory = self.page_factory
+            page = self.pages[page_number] = bytearray(PAGE_SIZE) if factory is None else factory(page_number)
+        page_start = page_number << PAGE_SHIFT
+        whole = region.start <= page_start and page_start + PAGE_SIZE <= region.end
+        if whole:
+            self._read_pages[page_number] = page
+        if dirty:
+            self.dirty_pages.add(page_number)
+            if whole and page_number not in self._reserved_pages and page_number not in self._code_pages:
+                self._write_pages[page_number] = page
+        return page
+    
+    def watch_code(self, decode_cache):
+        """Invalidate a decode cache's records of code written through this Memory
         
-        # Check alignment for halfword and word access
-        if access_size == 2 and offset % 2 != 0:
-            raise ValueError(f"Misaligned halfword access at 0x{address:08x}")
-        elif access_size == 4 and offset % 4 != 0:
-            raise ValueError(f"Misaligned word access at 0x{address:08x}")
+        Lets decode_cache.get() skip checking the word it was decoded
+        from: pages holding cached code take the checked write path.
+        
+        Args:
+            decode_cache: DecodeCache (decode_cache.py); it calls
+                          watch_page() for each page it starts caching
+        """
+        self.code_cache = decode_cache
+        self._code_pages = decode_cache.code_pages
+        decode_cache.memory = self
+        for page_number in self._code_pages:
+            self.watch_page(page_number)
+    
+    def watch_page(self, page_number):
+        """Move a page that now holds cached code out of the fast write table"""
+        self._write_pages.pop(page_number, None)
+    
+    def install_page(self, page_number, data):
+        """Replace a whole page's contents (e.g. checkpoint restore), leaving it clean
+        
+        Args:
+            page_number: Address >> PAGE_SHIFT
+            data: PAGE_SIZE bytes
+        """
+        address = page_number << PAGE_SHIFT
+        region = self.find_region(address) or self.find_region(address + PAGE_SIZE - 1)
+        if region is None or not region.is_ram or len(data) != PAGE_SIZE:
+            raise ValueError(f"Cannot install page at 0x{address:08x}: no RAM mapped there")
+        self._page(page_number, region, dirty=False)[:] = data
+        if self.code_cache is not None:
+            self.code_cache.invalidate(address, PAGE_SIZE)
+    
+    def set_page_factory(self, factory):
+        """Change how pages are allocated, moving the allocated pages over
+        
+        Args:
+            factory: Callable taking a page number and returning a zeroed,
+                     writable PAGE_SIZE buffer for it (e.g. a memoryview into
+                     shared memory), or None for private bytearrays
+        """
+        self.page_factory = factory
+        pages = list(self.pages.items())
+        self.pages.clear()
+        self._read_pages.clear()   # Refilled from pages on the next access
+        self._write_pages.clear()
+        for page_number, old in pages:
+            page = self.pages[page_number] = bytearray(PAGE_SIZE) if factory is None else factory(page_number)
+            page[:] = old
+    
+    def mark_dirty(self, page_number):
+        """Record a page as written by something other than this Memory
+        
+        E.g. a hart in another process sharing the page's storage. Breaks
+        reservations on the page; cached decodes of code on it are the
+        caller's to invalidate.
+        
+        Args:
+            page_number: Address >> PAGE_SHIFT (of a RAM page)
+        """
+        address = page_number << PAGE_SHIFT
+        region = self.find_region(address)
+        if region is None or not region.is_ram:
+            raise ValueError(f"Cannot mark page at 0x{address:08x} dirty: no RAM mapped there")
+        self._page(page_number, region, dirty=True)
+        if self.reservations:
+            self.break_reservations(address, PAGE_SIZE)
+    
+    def clear_dirty(self):
+        """Mark every page clean (e.g. after a snapshot has been taken)"""
+        self.dirty_pages.clear()
+        self._write_pages.clear()
+    
+    def iter_pages(self, dirty_only=False):
+        """Iterate over allocated pages in address order
+        
+        Args:
+            dirty_only: Only pages written since the last clear_dirty()
+        
+        Yields:
+            (page_address, page) where page is the live bytearray(PAGE_SIZE)
+            (or page_factory buffer)
+        """
+        numbers = self.dirty_pages if dirty_only else self.pages
+        for page_number in sorted(numbers):
+            yield page_number << PAGE_SHIFT, self.pages[page_number]
+    
+    def _slow_read(self, address, access_size):
+        region = self._decode(address, access_size)
+        if region.device is not None:
+            return region.read(address, access_size)
+        page = self._page(address >> PAGE_SHIFT, region, dirty=False)
+        offset = address & PAGE_MASK
+        return int.from_bytes(page[offset:offset + access_size], 'little')
+    
+    def _slow_write(self, address, value, access_size):
+        region = self._decode(address, access_size)
+        if region.device is not None:
+            region.write(address, value, access_size)
+            return
+        page = self._page(address >> PAGE_SHIFT, region, dirty=True)
+        offset = address & PAGE_MASK
+        mask = (1 << (access_size * 8)) - 1
+        page[offset:offset + access_size] = (value & mask).to_bytes(access_size, 'little')
+        if self.reservations:
+            self.break_reservations(address, access_size)
+        if self.code_cache is not None:
+            self.code_cache.invalidate(address, access_size)
     
     # Byte access (8-bit)
     def read_byte(self, address, signed=False):
@@ -53,13 +367,15 @@ class Memory:
         Args:
             address: Memory address
             signed: If True, sign-extend to 32 bits
-            
+        
         Returns:
             Byte value (sign-extended to 32 bits if signed=True)
         """
-        self._check_address(address, 1)
-        offset = address - self.base_address
-        value = self.data[offset]
+        page = self._read_pages.get(address >> PAGE_SHIFT)
+        if page is not None:
+            value = page[address & PAGE_MASK]
+        else:
+            value = self._slow_read(address, 1)
         
         if signed and (value & 0x80):  # Sign bit set
             return value | 0xFFFFFF00  # Sign extend to 32 bits
@@ -72,9 +388,11 @@ class Memory:
             address: Memory address
             value: Byte value to write (only lower 8 bits used)
         """
-        self._check_address(address, 1)
-        offset = address - self.base_address
-        self.data[offset] = value & 0xFF
+        page = self._write_pages.get(address >> PAGE_SHIFT)
+        if page is not None:
+            page[address & PAGE_MASK] = value & 0xFF
+        else:
+            self._slow_write(address, value, 1)
     
     # Halfword access (16-bit, little-endian)
     def read_halfword(self, address, signed=False):
@@ -83,15 +401,17 @@ class Memory:
         Args:
             address: Memory address (must be 2-byte aligned)
             signed: If True, sign-extend to 32 bits
-            
+        
         Returns:
             Halfword value (sign-extended to 32 bits if signed=True)
         """
-        self._check_address(address, 2)
-        offset = address - self.base_address
-        
-        # Little-endian: LSB first
-        value = self.data[offset] | (self.data[offset + 1] << 8)
+        page = self._read_pages.get(address >> PAGE_SHIFT)
+        if page is not None and not address & 0x1:
+            # Little-endian: LSB first
+            offset = address & PAGE_MASK
+            value = page[offset] | (page[offset + 1] << 8)
+        else:
+            value = self._slow_read(address, 2)
         
         if signed and (value & 0x8000):  # Sign bit set
             return value | 0xFFFF0000  # Sign extend to 32 bits
@@ -104,12 +424,14 @@ class Memory:
             address: Memory address (must be 2-byte aligned)
             value: Halfword value to write (only lower 16 bits used)
         """
-        self._check_address(address, 2)
-        offset = address - self.base_address
-        
-        # Little-endian: LSB first
-        self.data[offset] = value & 0xFF
-        self.data[offset + 1] = (value >> 8) & 0xFF
+        page = self._write_pages.get(address >> PAGE_SHIFT)
+        if page is not None and not address & 0x1:
+            # Little-endian: LSB first
+            offset = address & PAGE_MASK
+            page[offset] = value & 0xFF
+            page[offset + 1] = (value >> 8) & 0xFF
+        else:
+            self._slow_write(address, value, 2)
     
     # Word access (32-bit, little-endian)
     def read_word(self, address):
@@ -117,29 +439,19 @@ class Memory:
         
         Args:
             address: Memory address (must be 4-byte aligned)
-            
+        
         Returns:
             Word value (32 bits)
         """
-        # Check for UART memory-mapped I/O
-        if self.uart and self.uart.is_uart_address(address):
-            value = self.uart.read_register(address)
-            return value if value is not None else 0
-        
-        # Check for CLINT memory-mapped I/O
-        if self.clint and self.clint.MSIP_BASE <= address < self.clint.MTIME_BASE + 8:
-            value = self.clint.read_register(address)
-            return value if value is not None else 0
-        
-        self._check_address(address, 4)
-        offset = address - self.base_address
-        
-        # Little-endian: LSB first
-        value = (self.data[offset] |
-                (self.data[offset + 1] << 8) |
-                (self.data[offset + 2] << 16) |
-                (self.data[offset + 3] << 24))
-        return value & 0xFFFFFFFF
+        page = self._read_pages.get(address >> PAGE_SHIFT)
+        if page is not None and not address & 0x3:
+            # Little-endian: LSB first
+            offset = address & PAGE_MASK
+            return (page[offset] |
+                    (page[offset + 1] << 8) |
+                    (page[offset + 2] << 16) |
+                    (page[offset + 3] << 24))
+        return self._slow_read(address, 4)
     
     def write_word(self, address, value):
         """Write word (4 bytes) to memory
@@ -148,24 +460,83 @@ class Memory:
             address: Memory address (must be 4-byte aligned)
             value: Word value to write (only lower 32 bits used)
         """
-        # Check for UART memory-mapped I/O
-        if self.uart and self.uart.is_uart_address(address):
-            self.uart.write_register(address, value)
-            return
+        page = self._write_pages.get(address >> PAGE_SHIFT)
+        if page is not None and not address & 0x3:
+            # Little-endian: LSB first
+            offset = address & PAGE_MASK
+            page[offset] = value & 0xFF
+            page[offset + 1] = (value >> 8) & 0xFF
+            page[offset + 2] = (value >> 16) & 0xFF
+            page[offset + 3] = (value >> 24) & 0xFF
+        else:
+            self._slow_write(address, value, 4)
+    
+    # Atomics (hooks for the A extension)
+    def load_reserved(self, hart, address):
+        """Load a word and reserve it for a hart (LR.W)
         
-        # Check for CLINT memory-mapped I/O
-        if self.clint and self.clint.MSIP_BASE <= address < self.clint.MTIME_BASE + 8:
-            self.clint.write_register(address, value)
-            return
+        Args:
+            hart: Hart number
+            address: Word address (must be 4-byte aligned)
+        
+        Returns:
+            The word loaded
+        """
+        value = self.read_word(address)
+        self.reservations[hart] = address
+        page_number = address >> PAGE_SHIFT
+        self._reserved_pages.add(page_number)
+        self._write_pages.pop(page_number, None)
+        return value
+    
+    def store_conditional(self, hart, address, value):
+        """Store a word if the hart's reservation on it still holds (SC.W)
         
-        self._check_address(address, 4)
-        offset = address - self.base_address
+        A store by any hart to the reserved word breaks the reservation;
+        the hart's reservation is released whether or not the store happens.
         
-        # Little-endian: LSB first
-        self.data[offset] = value & 0xFF
-        self.data[offset + 1] = (value >> 8) & 0xFF
-        self.data[offset + 2] = (value >> 16) & 0xFF
-        self.data[offset + 3] = (value >> 24) & 0xFF
+        Args:
+            hart: Hart number
+            address: Word address (must be 4-byte aligned)
+            value: Word value to store
+        
+        Returns:
+            True if the word was stored (SC.W writes 0 to rd), else False
+        """
+        reserved = self.reservations.pop(hart, None)
+        self._update_reserved_pages()
+        if reserved != address:
+            return False
+        self.write_word(address, value)
+        return True
+    
+    def amo_word(self, address, operation):
+        """Read-modify-write a word in one step (AMO*.W)
+        
+        Args:
+            address: Word address (must be 4-byte aligned)
+            operation: Function of the old word returning the new one
+                       (e.g. lambda old: old + 1 for AMOADD.W)
+        
+        Returns:
+            The old word (AMO*.W writes it to rd)
+        """
+        old = self.read_word(address)
+        self.write_word(address, operation(old) & 0xFFFFFFFF)
+        return old
+    
+    def break_reservations(self, address, length):
+        """Drop every reservation on a word overlapping [address, address + length)"""
+        broken = [hart for hart, reserved in self.reservations.items()
+                  if reserved < address + length and address < reserved + 4]
+        if broken:
+            for hart in broken:
+                del self.reservations[hart]
+            self._update_reserved_pages()
+    
+    def _update_reserved_pages(self):
+        """Recompute the reserved pages (the others rejoin the fast write table on their next store)"""
+        self._reserved_pages = {reserved >> PAGE_SHIFT for reserved in self.reservations.values()}
     
     # Legacy methods for backward compatibility
     def read(self, address):
@@ -182,6 +553,59 @@ class Memory:
         except ValueError:
             pass
     
+    # Bulk RAM access (bypasses devices)
+    def _ram_region(self, address, length):
+        """Get the RAM region holding all of [address, address + length)"""
+        region = self.find_region(address)
+        if region is None or not region.is_ram or address + length > region.end:
+            raise ValueError(f"RAM range out of bounds: 0x{address:08x} + {length} bytes")
+        return region
+    
+    def write_bytes(self, address, data):
+        """Copy bytes into RAM a page at a time
+        
+        Args:
+            address: First address
+            data: bytes-like object or list of byte values
+        """
+        region = self._ram_region(address, len(data))
+        if isinstance(data, list):
+            data = bytes(data)
+        view = memoryview(data).cast('B')
+        position = 0
+        while position < len(view):
+            offset = (address + position) & PAGE_MASK
+            chunk = min(PAGE_SIZE - offset, len(view) - position)
+            page = self._page((address + position) >> PAGE_SHIFT, region, dirty=True)
+            page[offset:offset + chunk] = view[position:position + chunk]
+            if self.code_cache is not None:
+                self.code_cache.invalidate(address + position, chunk)
+            position += chunk
+        if self.reservations:
+            self.break_reservations(address, len(view))
+    
+    def read_bytes(self, address, length):
+        """Copy bytes out of RAM (untouched pages read as zero and stay unallocated)
+        
+        Args:
+            address: First address
+            length: Number of bytes
+        
+        Returns:
+            bytes
+        """
+        self._ram_region(address, length)
+        result = bytearray(length)
+        position = 0
+        while position < length:
+            offset = (address + position) & PAGE_MASK
+            chunk = min(PAGE_SIZE - offset, length - position)
+            page = self.pages.get((address + position) >> PAGE_SHIFT)
+            if page is not None:
+                result[position:position + chunk] = page[offset:offset + chunk]
+            position += chunk
+        return bytes(result)
+    
     def load_program(self, program_data, start_address=0):
         """Load program data into memory
         
@@ -189,11 +613,10 @@ class Memory:
             program_data: List of bytes or bytearray
             start_address: Starting address to load program
         """
-        offset = start_address - self.base_address
-        if offset < 0 or offset + len(program_data) > self.size:
-            raise ValueError(f"Program too large or invalid start address")
-        
-        self.data[offset:offset + len(program_data)] = program_data
+        try:
+            self.write_bytes(start_address, program_data)
+        except ValueError:
+            raise ValueError(f"Program too large or invalid start address") from None
     
     def dump(self, start_address, length, bytes_per_line=16):
         """Dump memory contents in hexadecimal format
@@ -207,48 +630,57 @@ class Memory:
         
         for i in range(0, length, bytes_per_line):
             addr = start_address + i
-            offset = addr - self.base_address
+            region = self.find_region(addr)
             
-            if offset < 0 or offset >= self.size:
+            if region is None or not region.is_ram:
                 continue
+            line = self.read_bytes(addr, min(bytes_per_line, region.end - addr))
             
             # Print address
             print(f"0x{addr:08x}:", end=" ")
             
             # Print hex bytes
             for j in range(bytes_per_line):
-                if offset + j < self.size:
-                    print(f"{self.data[offset + j]:02x}", end=" ")
+                if j < len(line):
+                    print(f"{line[j]:02x}", end=" ")
                 else:
                     print("  ", end=" ")
             
             print(" |", end=" ")
             
             # Print ASCII representation
-            for j in range(bytes_per_line):
-                if offset + j < self.size:
-                    byte = self.data[offset + j]
-                    if 32 <= byte < 127:
-                        print(chr(byte), end="")
-                    else:
-                        print(".", end="")
+            for byte in line:
+                if 32 <= byte < 127:
+                    print(chr(byte), end="")
+                else:
+                    print(".", end="")
             
             print()
         print("=" * 70)
     
     def clear(self):
-        """Clear all memory (set to zero)"""
-        self.data = bytearray(self.size)
+        """Clear all memory (set to zero, releasing every page)"""
+        if self.page_factory is not None:
+            for page in self.pages.values():
+                page[:] = bytes(PAGE_SIZE)  # The factory may hand the same storage out again
+        self.pages.clear()
+        self._read_pages.clear()
+        self.reservations.clear()
+        self._reserved_pages.clear()
+        self.clear_dirty()
     
     def get_stats(self):
         """Get memory statistics"""
-        non_zero = sum(1 for b in self.data if b != 0)
+        size = sum(region.end - region.start for region in self.ram_regions)
+        non_zero = sum(PAGE_SIZE - bytes(page).count(0) for page in self.pages.values())
         return {
-            'size': self.size,
+            'size': size,
             'base_address': self.base_address,
             'bytes_used': non_zero,
-            'bytes_free': self.size - non_zero,
-            'utilization': (non_zero / self.size) * 100
+            'bytes_free': size - non_zero,
+            'utilization': (non_zero / size) * 100,
+            'pages_allocated': len(self.pages),
+            'pages_dirty': len(self.dirty_pages),
         }
     
     def __str__(self):
@@ -257,4 +689,3 @@ class Memory:
                 f"base=0x{stats['base_address']:08x}, "
                 f"used={stats['bytes_used']} bytes, "
                 f"{stats['utilization']:.2f}% utilized)")
-
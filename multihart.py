@@ -0,0 +1,442 @@
+"""Multi-hart simulation: N harts sharing one memory bus, run in quanta
+
+Every hart has its own RegisterFile, CSRBank (mhartid = hart number),
+TrapController and FunctionalCore; the harts share one Memory with the
+UART and a CLINT serving all of them (per-hart msip at 0x02000000 + 4*hart
+and mtimecmp at 0x02004000 + 8*hart, one mtime). Decoded instructions are
+shared too, so a store by any hart to code invalidates them for all.
+
+Scheduling is quantum-based: each quantum of cycles, every hart runs for
+up to that many cycles from the quantum's start (only the running hart's
+timer compare fires), then time moves to the end of the quantum. Quantum
+boundaries are the only synchronization points, so an inter-processor
+interrupt is taken at most a quantum late. Smaller quanta track the harts
+more closely; larger ones run faster, as each hart keeps its translated
+blocks hot for longer and synchronizes less often.
+
+By default the harts of a quantum run one after another on the calling
+thread (the CLINT clock is rewound between them), which keeps runs
+deterministic: a hart sees another's stores and msip writes once both have
+run past them. With parallel=True each hart runs in its own forked worker
+process instead, so the harts use separate host cores:
+- RAM lives in shared memory (SharedRAM): stores reach the other harts as
+  they happen, so harts racing on the same words within a quantum make a
+  run timing-dependent
+- each worker has its own copy of the CLINT, UART and decode cache. At a
+  quantum boundary the workers report their msip/mtimecmp values, the
+  pages they wrote and their UART output; the coordinator merges the
+  registers (in hart order, as the serial schedule would), prints the
+  output, and hands the registers and pages to the other workers, which
+  drop their decodes of code on those pages and their LR reservations
+- at the end of run() each worker sends its hart's state back, so the
+  harts read the same as after a serial run
+Within a quantum the A-extension hooks (Memory.load_reserved(),
+store_conditional(), amo_word()) are atomic only between harts of one
+process, and the UART TX FIFO and its interrupt (to hart 0) only follow
+hart 0's own writes; run code relying on either serially. Every boundary
+costs each worker a pipe round trip, so parallel runs want quanta of tens
+of thousands of cycles.
+
+Example:
+    system = MultiHartSystem(num_harts=4, quantum=20000, parallel=True)
+    load_program(system.memory, program)
+    system.run(max_cycles=10**7, entry_pc=0)
+    print(system.get_stats())
+    system.close()
+"""
+
+import multiprocessing
+import sys
+import traceback
+import weakref
+from multiprocessing import shared_memory
+
+from register_file import RegisterFile
+from csr import CSRBank
+from trap import TrapController
+from clint import CLINT
+from uart import UART
+from memory import Memory, PAGE_SHIFT, PAGE_SIZE, PAGE_MASK
+from decode_cache import DecodeCache
+from functional import FunctionalCore
+from pipeline import DRAM_BASE, DRAM_SIZE
+
+
+class Hart:
+    """Architectural state of one hart and the core executing it"""
+
+    def __init__(self, hart_id):
+        """
+        Args:
+            hart_id: Hart number (mhartid, and its CLINT register offsets)
+        """
+        self.hart_id = hart_id
+        self.register_file = RegisterFile()
+        self.csr_bank = CSRBank(hartid=hart_id)
+        self.trap_controller = TrapController(self.csr_bank)
+        self.interrupt_controller = self.trap_controller.interrupt_controller
+        self.core = None           # FunctionalCore on the shared bus (MultiHartSystem)
+        self.halt_reason = None    # Why the hart stopped for good (None: still running)
+        self.translation_stats = None  # Block translation stats of the last parallel run
+
+    @property
+    def done(self):
+        """Whether the hart has stopped ('self_loop' or 'tohost')"""
+        return self.halt_reason is not None
+
+    def get_state(self):
+        """Get the architectural state and core counters as plain values (see set_state())"""
+        core = self.core
+        csr_bank = self.csr_bank
+        interrupts = self.interrupt_controller
+        return {
+            'registers': (list(self.register_file.regs), self.register_file.pc, self.register_file.next_pc),
+            'csrs': (dict(csr_bank.csrs), csr_bank.extra_pending),
+            'interrupts': (set(interrupts.edge_triggered), set(interrupts.level_triggered),
+                           set(interrupts.latched_edges)),
+            'core': (core.cycles, core.instret, core.traps_taken, core.interrupts_taken,
+                     core.idle_cycles, core.halt_reason, core.tohost_value),
+            'translation': core.block_cache.get_stats() if core.block_cache is not None else None,
+        }
+
+    def set_state(self, state):
+        """Install get_state() values (e.g. from the worker process that ran the hart)"""
+        register_file = self.register_file
+        regs, register_file.pc, register_file.next_pc = state['registers']
+        register_file.regs[:] = regs
+        csrs, self.csr_bank.extra_pending = state['csrs']
+        self.csr_bank.csrs.clear()
+        self.csr_bank.csrs.update(csrs)
+        self.csr_bank.update_deliverable()
+        interrupts = self.interrupt_controller
+        interrupts.edge_triggered, interrupts.level_triggered, interrupts.latched_edges = state['interrupts']
+        core = self.core
+        cycles, instret, core.traps_taken, core.interrupts_taken, core.idle_cycles, \
+            core.halt_reason, core.tohost_value = state['core']
+        core.set_counts(cycles, instret)
+        self.translation_stats = state['translation']
+
+
+class SharedRAM:
+    """RAM of a Memory backed by shared memory, one segment per RAM region
+
+    Installed as the Memory's page factory, so every page (still allocated
+    on first touch) is a memoryview into a segment, and processes forked
+    afterwards read and write the same bytes.
+    """
+
+    def __init__(self, memory):
+        """
+        Args:
+            memory: Memory whose RAM regions (page-aligned) to share; pages
+                    already allocated are moved into the segments
+
+        Raises:
+            ValueError: If a RAM region does not start and end on a page boundary
+        """
+        self.memory = memory
+        self.segments = []  # (start, end, SharedMemory) by region
+        for region in memory.ram_regions:
+            if region.start & PAGE_MASK or region.end & PAGE_MASK:
+                raise ValueError(f"RAM region {region.name} is not page-aligned")
+            segment = shared_memory.SharedMemory(create=True, size=region.end - region.start)
+            self.segments.append((region.start, region.end, segment))
+        # Unlink the segments even if close() is never called
+        self._finalizer = weakref.finalize(self, SharedRAM._unlink, [segment for _, _, segment in self.segments])
+        memory.set_page_factory(self.page)
+
+    def page(self, page_number):
+        """Page factory: the view of a page's storage in its region's segment"""
+        address = page_number << PAGE_SHIFT
+        for start, end, segment in self.segments:
+            if start <= address < end:
+                offset = address - start
+                return segment.buf[offset:offset + PAGE_SIZE]
+        return bytearray(PAGE_SIZE)  # RAM mapped after sharing stays private
+
+    def close(self):
+        """Move the pages back into private memory and free the segments"""
+        self.memory.set_page_factory(None)
+        for _, _, segment in self.segments:
+            try:
+                segment.close()
+            except BufferError:
+                pass  # A view is still referenced; the mapping goes with the process
+        self._finalizer()
+
+    @staticmethod
+    def _unlink(segments):
+        for segment in segments:
+            try:
+                segment.unlink()
+            except FileNotFoundError:
+                pass
+
+
+class MultiHartSystem:
+    """Harts sharing a Memory bus, UART and CLINT, scheduled in quanta"""
+
+    def __init__(self, num_harts=2, quantum=1000, translate=True, parallel=False):
+        """
+        Args:
+            num_harts: Number of harts (at least 1)
+            quantum: Cycles each hart runs between synchronization points
+            translate: Run hot code as translated basic blocks
+            parallel: Run each hart in its own worker process, with RAM in
+                      shared memory (call close() when done)
+
+        Raises:
+            ValueError: If num_harts or quantum is less than 1
+        """
+        if num_harts < 1 or quantum < 1:
+            raise ValueError(f"Need at least one hart and a quantum of at least one cycle "
+                             f"(got {num_harts} harts, quantum {quantum})")
+        self.quantum = quantum
+        self.harts = [Hart(hart_id) for hart_id in range(num_harts)]
+
+        # Shared devices; the UART's interrupt goes to hart 0
+        self.clint = CLINT(self.harts[0].interrupt_controller, time_scale=1)
+        for hart in self.harts[1:]:
+            self.clint.add_hart(hart.interrupt_controller)
+        self.uart = UART()
+        self.uart.connect(self.clint)
+        self.memory = Memory(uart=self.uart, clint=self.clint)
+        self.memory.map_ram(DRAM_BASE, DRAM_SIZE, name='dram')
+        self.decode_cache = DecodeCache()
+        self.parallel = parallel
+        self.shared_ram = SharedRAM(self.memory) if parallel else None
+
+        for hart in self.harts:
+            hart.core = FunctionalCore(hart.register_file, self.memory, hart.csr_bank, hart.trap_controller,
+                                       self.clint, self.decode_cache, translate)
+            hart.core.multi_hart = True
+
+        # Statistics
+        self.cycles = 0            # Cycles simulated (quanta run x quantum)
+        self.quanta = 0
+        self.tohost_value = None   # Word stored to tohost, ending the run
+
+    @property
+    def num_harts(self):
+        return len(self.harts)
+
+    def run(self, max_cycles=100000, entry_pc=None, tohost=None):
+        """Run every hart until all have stopped or max_cycles have passed
+
+        Harts stop for good when they can never leave an idle loop or WFI
+        (see FunctionalCore.run(), 'self_loop'); a store to tohost by any
+        hart ends the run for all of them at that hart's quantum.
+
+        Args:
+            max_cycles: Cycles to simulate in this call (the last quantum is
+                        cut short to fit)
+            entry_pc: PC every hart starts from (None: carry on where they are)
+            tohost: Address whose store ends the run (None: disabled)
+
+        Returns:
+            List of the harts' halt reasons (None for harts still running)
+        """
+        if entry_pc is not None:
+            for hart in self.harts:
+                hart.register_file.write_pc(entry_pc)
+                hart.halt_reason = None
+        target = self.cycles + max_cycles
+        if self.parallel:
+            self._run_parallel(target, tohost)
+        else:
+            self._run_serial(target, tohost)
+        self.uart.flush()
+        return [hart.halt_reason for hart in self.harts]
+
+    def _run_serial(self, target, tohost):
+        """Run the harts of each quantum one after another on this thread"""
+        clint = self.clint
+        stopped = False
+        try:
+            while self.cycles < target and not stopped and not all(hart.done for hart in self.harts):
+                start = clint.now
+                window = min(self.quantum, target - self.cycles)
+                for hart in self.harts:
+                    if hart.done:
+                        continue
+                    clint.active_hart = hart.hart_id
+                    clint.rewind(start)
+                    reason = hart.core.run(max_instructions=window, tohost=tohost)
+                    if reason == 'tohost':
+                        self.tohost_value = hart.core.tohost_value
+                        stopped = True
+                    if reason in ('self_loop', 'tohost'):
+                        hart.halt_reason = reason
+                # End of the quantum: every hart's timer compare is checked
+                clint.active_hart = None
+                clint.rewind(start)
+                clint.tick(window)
+                self.cycles += window
+                self.quanta += 1
+        finally:
+            clint.active_hart = None
+
+    def _run_parallel(self, target, tohost):
+        """Run each hart still running in a worker process, synchronizing at quantum boundaries"""
+        clint = self.clint
+        memory = self.memory
+        context = multiprocessing.get_context('fork')
+        # Nothing buffered may be written twice, by the coordinator and a worker
+        sys.stdout.flush()
+        sys.stderr.flush()
+        self.uart.flush()
+        workers = []
+        try:
+            for hart in self.harts:
+                if not hart.done:
+                    connection, child = context.Pipe()
+                    process = context.Process(target=self._serve, args=(hart, child, tohost), daemon=True)
+                    process.start()
+                    child.close()
+                    workers.append((hart, connection, process))
+            written = {}  # Hart number -> pages it wrote in the last quantum
+            stopped = False
+            while self.cycles < target and not stopped and not all(hart.done for hart, _, _ in workers):
+                start = clint.now
+                window = min(self.quantum, target - self.cycles)
+                registers = self._clint_registers()
+                active = [(hart, connection) for hart, connection, _ in workers if not hart.done]
+                for hart, connection in active:
+                    pages = set()
+                    for hart_id, hart_pages in written.items():
+                        if hart_id != hart.hart_id:
+                            pages.update(hart_pages)
+                    connection.send((start, window, registers, sorted(pages)))
+
+                # Merge in hart order: a later hart's write wins, as in a serial quantum
+                msips, mtimecmps = (list(values) for values in registers)
+                written = {}
+                for hart, connection in active:
+                    reason, hart_msips, hart_mtimecmps, pages, output, tohost_value = self._receive(connection)
+                    for merged, start_values, hart_values in ((msips, registers[0], hart_msips),
+                                                              (mtimecmps, registers[1], hart_mtimecmps)):
+                        for index, value in enumerate(hart_values):
+                            if value != start_values[index]:
+                                merged[index] = value
+                    written[hart.hart_id] = pages
+                    for page_number in pages:
+                        memory.mark_dirty(page_number)
+                        self.decode_cache.invalidate(page_number << PAGE_SHIFT, PAGE_SIZE)
+                    self.uart.emit(output)
+                    if reason == 'tohost':
+                        self.tohost_value = tohost_value
+                        stopped = True
+                    if reason in ('self_loop', 'tohost'):
+                        hart.halt_reason = reason
+                self._apply_clint_registers(msips, mtimecmps)
+                clint.tick(window)
+                self.cycles += window
+                self.quanta += 1
+
+            for hart, connection, _ in workers:
+                connection.send(None)
+                hart.set_state(self._receive(connection))
+        finally:
+            for _, connection, process in workers:
+                connection.close()
+                process.join(timeout=5)
+                if process.is_alive():
+                    process.terminate()
+
+    def _serve(self, hart, connection, tohost):
+        """Worker process body: run one hart's quanta as the coordinator sends them
+
+        Each message is (start, window, (msips, mtimecmps), pages written by
+        the other harts), answered with the quantum's halt reason, this
+        worker's msip/mtimecmp values, the pages the hart wrote, its UART
+        output and tohost value; None asks for the hart's final state.
+        """
+        clint = self.clint
+        memory = self.memory
+        uart = self.uart
+        core = hart.core
+        clint.active_hart = hart.hart_id
+        uart.capture = True
+        memory.clear_dirty()  # Report only this hart's stores
+        try:
+            while True:
+                message = connection.recv()
+                if message is None:
+                    connection.send(('ok', hart.get_state()))
+                    return
+                start, window, registers, pages = message
+                self._apply_clint_registers(*registers)
+                for page_number in pages:
+                    address = page_number << PAGE_SHIFT
+                    self.decode_cache.invalidate(address, PAGE_SIZE)
+                    memory.break_reservations(address, PAGE_SIZE)
+                clint.rewind(start)
+                reason = core.run(max_instructions=window, tohost=tohost)
+                clint.rewind(start)
+                clint.tick(window)  # End of the quantum: this hart's timer compare is checked
+                written = sorted(memory.dirty_pages)
+                memory.clear_dirty()
+                output = bytes(uart.captured)
+                uart.captured.clear()
+                msips, mtimecmps = self._clint_registers()
+                connection.send(('ok', (reason, msips, mtimecmps, written, output, core.tohost_value)))
+        except Exception:
+            connection.send(('error', traceback.format_exc()))
+        finally:
+            connection.close()
+
+    @staticmethod
+    def _receive(connection):
+        """Get a worker's reply, raising its error if it failed"""
+        try:
+            status, payload = connection.recv()
+        except EOFError:
+            raise RuntimeError("Hart worker process exited unexpectedly") from None
+        if status == 'error':
+            raise RuntimeError(f"Hart worker process failed:\n{payload}")
+        return payload
+
+    def _clint_registers(self):
+        """Get (msips, mtimecmps) for every hart"""
+        clint = self.clint
+        return list(clint.msips), [clint.get_mtimecmp(hart) for hart in range(clint.num_harts)]
+
+    def _apply_clint_registers(self, msips, mtimecmps):
+        """Write the msip/mtimecmp values that differ, as a store from a hart would"""
+        clint = self.clint
+        for hart, value in enumerate(msips):
+            if clint.msips[hart] != value:
+                clint.write_register(clint.MSIP_BASE + 4 * hart, value)
+        for hart, value in enumerate(mtimecmps):
+            if clint.get_mtimecmp(hart) != value:
+                address = clint.MTIMECMP_BASE + 8 * hart
+                clint.write_register(address, value & 0xFFFFFFFF)
+                clint.write_register(address + 4, value >> 32)
+
+    def close(self):
+        """Free the shared memory of a parallel system (its RAM stays readable)"""
+        if self.shared_ram is not None:
+            self.shared_ram.close()
+            self.shared_ram = None
+
+    def get_stats(self):
+        """Get run statistics
+
+        Returns:
+            Dictionary with cycles and quanta simulated and each hart's
+            FunctionalCore statistics (under 'harts', by hart number)
+        """
+        return {
+            'cycles': self.cycles,
+            'quanta': self.quanta,
+            'quantum': self.quantum,
+            'parallel': self.parallel,
+            'harts': [self._hart_stats(hart) for hart in self.harts],
+        }
+
+    @staticmethod
+    def _hart_stats(hart):
+        stats = dict(hart.core.get_stats(), halt_reason=hart.halt_reason)
+        if hart.translation_stats is not None:
+            stats['translation'] = hart.translation_stats  # Counted in the worker
+        return stats
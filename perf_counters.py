@@ -0,0 +1,147 @@
+"""Hardware performance monitor (HPM) counters for RISC-V pipeline simulator
+
+PerfCounters holds the pipeline's event counts as plain integers, or as
+small lists indexed by register number, instruction class or flush cause,
+so the pipeline hot paths only ever do `counters.x += 1`. Cycles and UART
+bytes are not counted at all: they are read from the SimPy clock and the
+UART when a value is needed.
+
+Guest code reads the counters through the standard counter CSRs:
+- mcycle/cycle and minstret/instret
+- mhpmcounterN/hpmcounterN (N = 3 + index in HPM_EVENTS)
+The CSRs are brought up to date on demand (sync_csrs), right before a CSR
+instruction touches one, and advance by deltas so a guest write (e.g.
+zeroing mcycle) counts on from the written value.
+
+Python code takes snapshot()s: flat {name: count} dictionaries that
+subtract to the counts for the interval between them.
+
+Event counters other than cycles/instret count pipeline execution only;
+the functional core keeps its own cycle/instret totals.
+"""
+
+from instruction import (Opcode, ALU_OPCODES, LOAD_OPCODES, STORE_OPCODES, BRANCH_OPCODES,
+                         CSR_OPCODES)
+
+MASK_32 = 0xFFFFFFFF
+
+# Instruction classes counted at retirement
+INSTRUCTION_CLASSES = ('alu', 'load', 'store', 'branch', 'jump', 'csr', 'system', 'other')
+CLASS_ALU, CLASS_LOAD, CLASS_STORE, CLASS_BRANCH, CLASS_JUMP, CLASS_CSR, CLASS_SYSTEM, CLASS_OTHER = range(8)
+
+
+def _instruction_class(op):
+    if op in ALU_OPCODES or op in (Opcode.LUI, Opcode.AUIPC):
+        return CLASS_ALU
+    if op in LOAD_OPCODES:
+        return CLASS_LOAD
+    if op in STORE_OPCODES:
+        return CLASS_STORE
+    if op in BRANCH_OPCODES:
+        return CLASS_BRANCH
+    if op in (Opcode.JAL, Opcode.JALR):
+        return CLASS_JUMP
+    if op in CSR_OPCODES:
+        return CLASS_CSR
+    if op in (Opcode.ECALL, Opcode.EBREAK, Opcode.MRET, Opcode.WFI, Opcode.FENCE, Opcode.FENCE_I):
+        return CLASS_SYSTEM
+    return CLASS_OTHER
+
+
+# Instruction class by opcode id
+CLASS_BY_OPCODE = tuple(_instruction_class(op) for op in Opcode)
+
+# Pipeline flush causes (MRET counts as a trap return)
+FLUSH_CAUSES = ('branch', 'jump', 'trap', 'interrupt')
+FLUSH_BRANCH, FLUSH_JUMP, FLUSH_TRAP, FLUSH_INTERRUPT = range(4)
+
+# Events on mhpmcounter3, mhpmcounter4, ... (snapshot() names)
+HPM_EVENTS = (
+    'load_use_stalls',
+    'raw_stalls',
+    *(f'flush_{cause}' for cause in FLUSH_CAUSES),
+    'interrupts',
+    'interrupt_latency',
+    'uart_bytes',
+    *(f'class_{name}' for name in INSTRUCTION_CLASSES),
+)
+
+# Counter CSR address -> snapshot() name
+COUNTER_CSRS = {0xB00: 'cycles', 0xC00: 'cycles', 0xB02: 'instret', 0xC02: 'instret'}
+for _index, _name in enumerate(HPM_EVENTS):
+    COUNTER_CSRS[0xB03 + _index] = _name   # mhpmcounterN
+    COUNTER_CSRS[0xC03 + _index] = _name   # hpmcounterN
+
+
+def is_counter_csr(csr_addr):
+    """Check whether a CSR address is a cycle/instret/hpm counter"""
+    return csr_addr in COUNTER_CSRS
+
+
+class CounterSnapshot(dict):
+    """Counter values at one point; a - b gives the counts between b and a"""
+
+    def __sub__(self, other):
+        return CounterSnapshot({name: value - other.get(name, 0) for name, value in self.items()})
+
+
+class PerfCounters:
+    """Event counters updated by the pipeline stages"""
+
+    def __init__(self, env=None, uart=None):
+        """
+        Args:
+            env: SimPy environment supplying the cycle count
+            uart: UART supplying the transmitted byte count
+        """
+        self.env = env
+        self.uart = uart
+        self.instret = 0
+        self.class_counts = [0] * len(INSTRUCTION_CLASSES)
+        self.load_use_stalls = 0
+        self.raw_stalls = [0] * 32        # Stall cycles by source register number
+        self.flushes = [0] * len(FLUSH_CAUSES)
+        self.interrupts = 0
+        self.interrupt_latency = 0        # Total cycles from interrupt seen to handler fetch
+        self._csr_synced = {}             # snapshot() at the last sync_csrs()
+
+    @property
+    def cycles(self):
+        # env.now is a float once env.run(until=...) has returned
+        return int(self.env.now) if self.env is not None else 0
+
+    def snapshot(self):
+        """Get the current counter values
+
+        Returns:
+            CounterSnapshot with cycles, instret, every HPM_EVENTS name and
+            raw_stalls_xN for each register that caused a stall
+        """
+        values = {
+            'cycles': self.cycles,
+            'instret': self.instret,
+            'load_use_stalls': self.load_use_stalls,
+            'raw_stalls': sum(self.raw_stalls),
+            'interrupts': self.interrupts,
+            'interrupt_latency': self.interrupt_latency,
+            'uart_bytes': self.uart.char_count if self.uart is not None else 0,
+        }
+        for cause, count in zip(FLUSH_CAUSES, self.flushes):
+            values[f'flush_{cause}'] = count
+        for name, count in zip(INSTRUCTION_CLASSES, self.class_counts):
+            values[f'class_{name}'] = count
+        for reg, count in enumerate(self.raw_stalls):
+            if count:
+                values[f'raw_stalls_x{reg}'] = count
+        return CounterSnapshot(values)
+
+    def sync_csrs(self, csr_bank):
+        """Advance the counter CSRs by the events since the last sync"""
+        values = self.snapshot()
+        synced = self._csr_synced
+        csrs = csr_bank.csrs
+        for addr, name in COUNTER_CSRS.items():
+            delta = values[name] - synced.get(name, 0)
+            if delta:
+                csrs[addr] = (csrs.get(addr, 0) + delta) & MASK_32
+        self._csr_synced = values
@@ -2,13 +2,35 @@
 import simpy
 from register_file import RegisterFile
 from memory import Memory
-from exe import EXE
-from instruction import Instruction
+from exe import EXE, memory_fault
+from instruction import (Instruction, DecodedInstruction, Opcode, BUBBLE_DECODED,
+                         BRANCH_OPCODES, CSR_OPCODES, LOAD_OPCODES, STORE_OPCODES, REDIRECT_OPCODES,
+                         parse_instruction_text, decode_instruction_word)
+from decode_cache import DecodeCache
 from csr import CSRBank
 from trap import TrapController
 from interrupt import InterruptController
 from clint import CLINT
 from uart import UART
+from tracing import Tracer
+from cache import CacheHierarchy
+from perf_counters import (PerfCounters, CLASS_BY_OPCODE, FLUSH_BRANCH, FLUSH_JUMP, FLUSH_TRAP,
+                           FLUSH_INTERRUPT, is_counter_csr)
+
+# Second RAM window where riscv-tests images are linked (ELFTestLoader.ENTRY_POINT);
+# memory is sparse, so it costs nothing for programs based at 0
+DRAM_BASE = 0x80000000
+DRAM_SIZE = 1 * 1024 * 1024
+
+# CSR read-modify-write by opcode id (immediate forms take a zimm source value)
+CSR_HANDLERS = {
+    Opcode.CSRRW: EXE.execute_csr_read_write,
+    Opcode.CSRRS: EXE.execute_csr_read_set,
+    Opcode.CSRRC: EXE.execute_csr_read_clear,
+    Opcode.CSRRWI: EXE.execute_csr_read_write,
+    Opcode.CSRRSI: EXE.execute_csr_read_set,
+    Opcode.CSRRCI: EXE.execute_csr_read_clear,
+}
 
 
 class PipelineStage:
@@ -18,26 +40,87 @@ class PipelineStage:
         self.latency = latency  # number of cycles this stage takes
         self.current_instruction = None
         self.pipe = simpy.Store(env)  # buffer to hold instruction between stages
+        self.trace = Tracer()  # Replaced by the owning Pipeline's tracer
+        self.caches = None  # Owning Pipeline's cache.CacheHierarchy (a miss holds every stage)
+        self.run_id = 0     # Owning Pipeline's run: work left from an earlier run is dropped
         
     def process(self, instruction):
-        """Process instruction for this stage's latency"""
-        self.current_instruction = instruction
-        if not instruction.is_bubble:
-            print(f"[Cycle {self.env.now}] {self.name} stage processing: {instruction}")
+        """Process instruction for this stage's latency (plus any cache stall)"""
+        run = self.run_id
+        self.start(instruction)
         yield self.env.timeout(self.latency)
-        if not instruction.is_bubble:
-            print(f"[Cycle {self.env.now}] {self.name} stage completed: {instruction}")
+        if self.caches is not None:
+            stall = self.caches.wait()
+            if stall:
+                yield self.env.timeout(stall)
+        if self.run_id != run:
+            return instruction  # The run ended while the instruction was in the stage
+        self.finish(instruction)
         return instruction
+    
+    def start(self, instruction):
+        """Instruction enters the stage"""
+        self.current_instruction = instruction
+        if self.trace.stage and not instruction.is_bubble:
+            self.trace.event('stage', self.env.now, "{} stage processing: {}", self.name, instruction.text)
+    
+    def finish(self, instruction):
+        """Instruction leaves the stage: the stage's work happens now, at the end of its cycle"""
+        if self.trace.stage and not instruction.is_bubble:
+            self.trace.event('stage', self.env.now, "{} stage completed: {}", self.name, instruction.text)
+        self.work(instruction)
+    
+    def work(self, instruction):
+        """Perform this stage's operation on instruction (none by default)"""
 
 
 # Define the 5 stages of the pipeline
 class FetchStage(PipelineStage):
-    def __init__(self, env):
+    def __init__(self, env, decode_cache=None, memory=None):
         super().__init__(env, "Fetch", latency=1)
+        self.decode_cache = decode_cache if decode_cache is not None else DecodeCache()
+        self.memory = memory
     
-    def process(self, instruction):
-        """Simulate fetching instruction from memory"""
-        yield from super().process(instruction)
+    def fetch_instruction(self, pc, item):
+        """Build a dynamic instruction for pc, decoding it only on a cache miss
+        
+        Args:
+            pc: Address of the instruction
+            item: 32-bit instruction word, assembly text, or DecodedInstruction
+        """
+        if isinstance(item, DecodedInstruction):
+            return Instruction.from_decoded(item)
+        decoder = decode_instruction_word if isinstance(item, int) else parse_instruction_text
+        return Instruction.from_decoded(self.decode_cache.lookup(pc, item, decoder))
+    
+    def fetch_from_memory(self, pc):
+        """Fetch the instruction word at pc from memory and decode it
+        
+        Fetch faults are not raised here: the instruction may be on a wrong
+        path, so the fault travels with it and is only taken at Execute.
+        
+        Args:
+            pc: Address to fetch from
+            
+        Returns:
+            Instruction with pc set (and fault set for bad fetches)
+        """
+        if pc & 0x3:
+            instruction = Instruction("FETCH_FAULT")
+            instruction.fault = (TrapController.EXCEPTION_INSTRUCTION_MISALIGNED, pc)
+        else:
+            try:
+                word = self.memory.read_word(pc)
+            except ValueError:
+                instruction = Instruction("FETCH_FAULT")
+                instruction.fault = (TrapController.EXCEPTION_INSTRUCTION_ACCESS_FAULT, pc)
+            else:
+                instruction = self.fetch_instruction(pc, word)
+                instruction.word = word
+                if instruction.opcode == Opcode.UNKNOWN:
+                    instruction.fault = (TrapController.EXCEPTION_ILLEGAL_INSTRUCTION, word)
+        
+        instruction.pc = pc
         return instruction
 
 
@@ -46,43 +129,74 @@ class DecodeStage(PipelineStage):
         super().__init__(env, "Decode", latency=1)
         self.register_file = register_file
     
-    def process(self, instruction):
+    def work(self, instruction):
         """Simulate decoding instruction and reading registers"""
-        yield from super().process(instruction)
-        
         # Read source register values
         if not instruction.is_bubble:
-            instruction.src_values = [self.register_file.read(reg) for reg in instruction.src_regs]
+            regs = self.register_file.regs
+            instruction.src_values = [regs[index] for index in instruction.decoded.src_indices]
             if instruction.src_values:
-                print(f"  -> Read registers: {dict(zip(instruction.src_regs, instruction.src_values))}")
+                if self.trace.stage:
+                    self.trace.detail('stage', self.env.now, "Read registers: {}", dict(zip(instruction.src_regs, instruction.src_values)))
         
         return instruction
 
 
 class ExecuteStage(PipelineStage):
-    def __init__(self, env, exe, register_file, trap_controller=None):
+    def __init__(self, env, exe, register_file, trap_controller=None, decode_cache=None, memory=None):
         super().__init__(env, "Execute", latency=1)
         self.exe = exe
         self.register_file = register_file
         self.trap_controller = trap_controller
+        self.decode_cache = decode_cache
+        self.memory = memory  # Checks load/store addresses (None: every access goes ahead)
     
-    def process(self, instruction):
+    def take_fault(self, instruction, pc):
+        """Trap for the exception in instruction.fault (the instruction does nothing else)"""
+        if self.trap_controller:
+            cause, trap_value = instruction.fault
+            trap_info = self.trap_controller.trigger_exception(cause, pc, trap_value)
+            instruction.trap_info = trap_info
+            if self.trace.trap:
+                self.trace.detail('trap', self.env.now, "EXCEPTION cause={}: Trap to handler at {:#x}", cause, trap_info['handler_pc'])
+    
+    def work(self, instruction):
         """Simulate executing instruction"""
-        yield from super().process(instruction)
-        
         # Delegate execution to EXE
         if not instruction.is_bubble:
-            op = instruction.operation
+            opcode = instruction.opcode
+            
+            # PC of this instruction: fetch address when fetched from memory,
+            # otherwise the register file PC (hand-written test programs)
+            current_pc = instruction.pc if instruction.pc is not None else self.register_file.read_pc()
+            
+            # Bypass: take operands from older instructions still in flight
+            if instruction.forwards:
+                for index, producer in instruction.forwards:
+                    if producer.result is not None and not isinstance(producer.result, dict):
+                        instruction.src_values[index] = producer.result
+                if self.trace.exec:
+                    self.trace.detail('exec', self.env.now, "Forwarded operands: {}", dict(zip(instruction.src_regs, instruction.src_values)))
+            
+            # Illegal or unfetchable instruction that reached Execute - take the trap
+            if instruction.fault is not None:
+                self.take_fault(instruction, current_pc)
+                return instruction
             
             # Execute instruction through EXE
-            # Get current PC for AUIPC instruction
-            current_pc = self.register_file.read_pc()
             result, mem_address = self.exe.execute_instruction(instruction, current_pc)
             
             # Store results in instruction
             if mem_address is not None:
+                # Misaligned or unmapped: trap here, in order, instead of accessing memory
+                if self.memory is not None:
+                    instruction.fault = memory_fault(self.memory, opcode, mem_address)
+                    if instruction.fault is not None:
+                        self.take_fault(instruction, current_pc)
+                        return instruction
                 instruction.mem_address = mem_address
-                print(f"  -> Calculated address: {instruction.mem_address}")
+                if self.trace.exec:
+                    self.trace.detail('exec', self.env.now, "Calculated address: {}", instruction.mem_address)
             
             if result is not None:
                 instruction.result = result
@@ -90,118 +204,131 @@ class ExecuteStage(PipelineStage):
                 # Handle special instruction types
                 if isinstance(result, dict):
                     # Special result type (ECALL, EBREAK, MRET, CSR)
-                    result_type = result.get('type')
-                    
-                    if result_type == 'ecall' and self.trap_controller:
+                    if opcode == Opcode.ECALL and self.trap_controller:
                         # Trigger ECALL exception
                         trap_info = self.trap_controller.ecall(current_pc)
                         instruction.trap_info = trap_info
-                        print(f"  -> ECALL: Trap to handler at {trap_info['handler_pc']:#x}")
+                        if self.trace.trap:
+                            self.trace.detail('trap', self.env.now, "ECALL: Trap to handler at {:#x}", trap_info['handler_pc'])
                     
-                    elif result_type == 'ebreak' and self.trap_controller:
+                    elif opcode == Opcode.EBREAK and self.trap_controller:
                         # Trigger EBREAK exception
                         trap_info = self.trap_controller.ebreak(current_pc)
                         instruction.trap_info = trap_info
-                        print(f"  -> EBREAK: Trap to handler at {trap_info['handler_pc']:#x}")
+                        if self.trace.trap:
+                            self.trace.detail('trap', self.env.now, "EBREAK: Trap to handler at {:#x}", trap_info['handler_pc'])
                     
-                    elif result_type == 'mret':
+                    elif opcode == Opcode.MRET:
                         # MRET returns new PC - execute it here with trap_controller
                         if self.trap_controller and self.trap_controller.csr_bank:
                             mret_result = EXE.execute_mret(self.trap_controller.csr_bank)
                             new_pc = mret_result.get('new_pc')
                             if new_pc is not None:
                                 instruction.jump_target = new_pc
-                                print(f"  -> MRET: Return to {new_pc:#x}")
+                                if self.trace.trap:
+                                    self.trace.detail('trap', self.env.now, "MRET: Return to {:#x}", new_pc)
                         else:
-                            print(f"  -> MRET: No CSR bank available")
+                            if self.trace.trap:
+                                self.trace.detail('trap', self.env.now, "MRET: No CSR bank available")
                     
-                    elif result_type == 'csr':
+                    elif opcode in CSR_OPCODES:
                         # CSR instruction - will be handled in WriteBack
-                        print(f"  -> CSR operation: {result['operation']}")
+                        if self.trace.csr:
+                            self.trace.detail('csr', self.env.now, "CSR operation: {}", result['operation'])
                 
                 # Print appropriate message based on operation type
-                elif op == 'LUI':
-                    print(f"  -> LUI result: {result:#010x}")
-                elif op == 'AUIPC':
-                    print(f"  -> AUIPC result: PC({current_pc:#010x}) + {instruction.immediate:#010x} = {result:#010x}")
-                elif op in ['BEQ', 'BNE', 'BLT', 'BGE', 'BLTU', 'BGEU']:
+                elif opcode == Opcode.LUI:
+                    if self.trace.exec:
+                        self.trace.detail('exec', self.env.now, "LUI result: {:#010x}", result)
+                elif opcode == Opcode.AUIPC:
+                    if self.trace.exec:
+                        self.trace.detail('exec', self.env.now, "AUIPC result: PC({:#010x}) + {:#010x} = {:#010x}", current_pc, instruction.immediate, result)
+                elif opcode in BRANCH_OPCODES:
                     branch_taken = (result == 1)
                     if branch_taken:
                         # Calculate branch target (PC + offset)
-                        branch_target = (current_pc + instruction.offset) & 0xFFFFFFFF
+                        branch_target = (current_pc + instruction.decoded.offset) & 0xFFFFFFFF
                         instruction.jump_target = branch_target
-                        print(f"  -> Branch {op}: TAKEN, target = {branch_target:#010x} - FLUSHING PIPELINE")
+                        if self.trace.exec:
+                            self.trace.detail('exec', self.env.now, "Branch {}: TAKEN, target = {:#010x} - FLUSHING PIPELINE", instruction.operation, branch_target)
                         # Signal pipeline flush
                         # Note: Flush will occur after this instruction completes Execute stage
                     else:
-                        print(f"  -> Branch {op}: NOT TAKEN")
-                elif op in ['JAL', 'JALR']:
-                    print(f"  -> {op}: Return address = {result:#010x}, Jump target = {instruction.jump_target:#010x} - FLUSHING PIPELINE")
+                        if self.trace.exec:
+                            self.trace.detail('exec', self.env.now, "Branch {}: NOT TAKEN", instruction.operation)
+                elif opcode == Opcode.JAL or opcode == Opcode.JALR:
+                    if self.trace.exec:
+                        self.trace.detail('exec', self.env.now, "{}: Return address = {:#010x}, Jump target = {:#010x} - FLUSHING PIPELINE", instruction.operation, result, instruction.jump_target)
                     # Signal pipeline flush for unconditional jumps
                     # Note: Flush will occur after this instruction completes Execute stage
                 else:
-                    print(f"  -> EXE result: {result}")
+                    if self.trace.exec:
+                        self.trace.detail('exec', self.env.now, "EXE result: {}", result)
+            
+            elif opcode == Opcode.FENCE_I and self.decode_cache is not None:
+                # Instruction stream may have been modified - drop all decoded instructions
+                self.decode_cache.invalidate_all()
+                if self.trace.mem:
+                    self.trace.detail('mem', self.env.now, "FENCE.I: Decode cache invalidated")
         
         return instruction
 
 
 class MemoryStage(PipelineStage):
-    def __init__(self, env, memory):
+    def __init__(self, env, memory, decode_cache=None):
         super().__init__(env, "Memory", latency=1)
         self.memory = memory
+        self.decode_cache = decode_cache
+        
+        # Opcode -> (memory access, trace label); built once per stage
+        self.load_handlers = {
+            Opcode.LOAD: (memory.read_word, "LW: Loaded word"),
+            Opcode.LW: (memory.read_word, "LW: Loaded word"),
+            Opcode.LH: (lambda address: memory.read_halfword(address, signed=True), "LH: Loaded halfword"),
+            Opcode.LHU: (lambda address: memory.read_halfword(address, signed=False), "LHU: Loaded halfword unsigned"),
+            Opcode.LB: (lambda address: memory.read_byte(address, signed=True), "LB: Loaded byte"),
+            Opcode.LBU: (lambda address: memory.read_byte(address, signed=False), "LBU: Loaded byte unsigned"),
+        }
+        # Opcode -> (memory access, value mask, size in bytes, trace label)
+        self.store_handlers = {
+            Opcode.STORE: (memory.write_word, 0xFFFFFFFF, 4, "SW: Stored word"),
+            Opcode.SW: (memory.write_word, 0xFFFFFFFF, 4, "SW: Stored word"),
+            Opcode.SH: (memory.write_halfword, 0xFFFF, 2, "SH: Stored halfword"),
+            Opcode.SB: (memory.write_byte, 0xFF, 1, "SB: Stored byte"),
+        }
     
-    def process(self, instruction):
+    def work(self, instruction):
         """Simulate memory access"""
-        yield from super().process(instruction)
-        
         # Perform memory operation
         if not instruction.is_bubble and instruction.mem_address is not None:
-            op = instruction.operation
+            opcode = instruction.opcode
+            address = instruction.mem_address
             
-            # LOAD operations
-            if op == 'LW' or op == 'LOAD':
-                # Load Word (32-bit)
-                instruction.result = self.memory.read_word(instruction.mem_address)
-                print(f"  -> LW: Loaded word {instruction.result:#010x} from address {instruction.mem_address:#x}")
-                
-            elif op == 'LH':
-                # Load Halfword (16-bit, sign-extended)
-                instruction.result = self.memory.read_halfword(instruction.mem_address, signed=True)
-                print(f"  -> LH: Loaded halfword {instruction.result:#010x} from address {instruction.mem_address:#x}")
-                
-            elif op == 'LHU':
-                # Load Halfword Unsigned (16-bit, zero-extended)
-                instruction.result = self.memory.read_halfword(instruction.mem_address, signed=False)
-                print(f"  -> LHU: Loaded halfword unsigned {instruction.result:#010x} from address {instruction.mem_address:#x}")
-                
-            elif op == 'LB':
-                # Load Byte (8-bit, sign-extended)
-                instruction.result = self.memory.read_byte(instruction.mem_address, signed=True)
-                print(f"  -> LB: Loaded byte {instruction.result:#010x} from address {instruction.mem_address:#x}")
-                
-            elif op == 'LBU':
-                # Load Byte Unsigned (8-bit, zero-extended)
-                instruction.result = self.memory.read_byte(instruction.mem_address, signed=False)
-                print(f"  -> LBU: Loaded byte unsigned {instruction.result:#010x} from address {instruction.mem_address:#x}")
+            # LOAD operations (sign/zero extension handled by the memory access)
+            load = self.load_handlers.get(opcode)
+            if load is not None:
+                if self.caches is not None:
+                    self.caches.data(address, False)
+                read, label = load
+                instruction.result = read(address)
+                if self.trace.mem:
+                    self.trace.detail('mem', self.env.now, "{} {:#010x} from address {:#x}", label, instruction.result, address)
             
             # STORE operations
-            elif op == 'SW' or op == 'STORE':
-                # Store Word (32-bit)
-                store_value = instruction.src_values[0] if instruction.src_values else 0
-                self.memory.write_word(instruction.mem_address, store_value)
-                print(f"  -> SW: Stored word {store_value:#010x} to address {instruction.mem_address:#x}")
-                
-            elif op == 'SH':
-                # Store Halfword (16-bit)
-                store_value = instruction.src_values[0] if instruction.src_values else 0
-                self.memory.write_halfword(instruction.mem_address, store_value & 0xFFFF)
-                print(f"  -> SH: Stored halfword {store_value & 0xFFFF:#06x} to address {instruction.mem_address:#x}")
-                
-            elif op == 'SB':
-                # Store Byte (8-bit)
-                store_value = instruction.src_values[0] if instruction.src_values else 0
-                self.memory.write_byte(instruction.mem_address, store_value & 0xFF)
-                print(f"  -> SB: Stored byte {store_value & 0xFF:#04x} to address {instruction.mem_address:#x}")
+            else:
+                store = self.store_handlers.get(opcode)
+                if store is not None:
+                    if self.caches is not None:
+                        self.caches.data(address, True)
+                    write, mask, size, label = store
+                    store_value = (instruction.src_values[0] if instruction.src_values else 0) & mask
+                    write(address, store_value)
+                    if self.trace.mem:
+                        self.trace.detail('mem', self.env.now, "{} {:#0{}x} to address {:#x}", label, store_value, size * 2 + 2, address)
+                    
+                    # Stores into code pages invalidate the affected decoded instructions
+                    if self.decode_cache is not None:
+                        self.decode_cache.invalidate(address, size)
         
         return instruction
 
@@ -211,62 +338,61 @@ class WriteBackStage(PipelineStage):
         super().__init__(env, "WriteBack", latency=1)
         self.register_file = register_file
         self.csr_bank = csr_bank
+        self.counter_sync = None  # Brings counter CSRs up to date before they are accessed
     
-    def process(self, instruction):
+    def work(self, instruction):
         """Simulate writing back to register"""
-        yield from super().process(instruction)
-        
         # Write result to register file
-        if not instruction.is_bubble and instruction.dest_reg and instruction.result is not None:
+        # (rd x0 still performs CSR side effects; write_index discards the value)
+        rd = instruction.decoded.rd
+        if rd is not None and instruction.result is not None:
             # Check if result is a special type (dict)
             if isinstance(instruction.result, dict):
-                result_type = instruction.result.get('type')
-                
-                if result_type == 'csr' and self.csr_bank:
+                if instruction.opcode in CSR_OPCODES and self.csr_bank:
                     # Handle CSR operations
                     csr_operation = instruction.result['operation']
                     csr_addr = instruction.result['csr_addr']
                     
                     # Get source value (register or immediate)
-                    if instruction.has_immediate:
-                        src_value = instruction.immediate
+                    decoded = instruction.decoded
+                    if decoded.has_immediate:
+                        src_value = decoded.immediate
                     else:
                         src_value = instruction.src_values[0] if instruction.src_values else 0
                     
                     # Execute CSR operation
-                    if csr_operation == 'CSRRW':
-                        old_value = EXE.execute_csr_read_write(self.csr_bank, csr_addr, src_value)
-                    elif csr_operation == 'CSRRS':
-                        old_value = EXE.execute_csr_read_set(self.csr_bank, csr_addr, src_value)
-                    elif csr_operation == 'CSRRC':
-                        old_value = EXE.execute_csr_read_clear(self.csr_bank, csr_addr, src_value)
-                    elif csr_operation == 'CSRRWI':
-                        old_value = EXE.execute_csr_read_write(self.csr_bank, csr_addr, src_value)
-                    elif csr_operation == 'CSRRSI':
-                        old_value = EXE.execute_csr_read_set(self.csr_bank, csr_addr, src_value)
-                    elif csr_operation == 'CSRRCI':
-                        old_value = EXE.execute_csr_read_clear(self.csr_bank, csr_addr, src_value)
-                    else:
-                        old_value = 0
+                    if self.counter_sync is not None and is_counter_csr(csr_addr):
+                        self.counter_sync()
+                    csr_handler = CSR_HANDLERS.get(instruction.opcode)
+                    old_value = csr_handler(self.csr_bank, csr_addr, src_value) if csr_handler else 0
                     
                     # Write old CSR value to destination register
-                    self.register_file.write(instruction.dest_reg, old_value)
-                    print(f"  -> CSR {csr_operation}: Wrote old value {old_value:#x} to {instruction.dest_reg}")
+                    self.register_file.write_index(rd, old_value)
+                    if self.trace.csr:
+                        self.trace.detail('csr', self.env.now, "CSR {}: Wrote old value {:#x} to {}", csr_operation, old_value, instruction.dest_reg)
                 
                 # Other special types (ECALL, EBREAK, MRET) don't write to registers
             else:
                 # Normal register write
-                self.register_file.write(instruction.dest_reg, instruction.result)
-                print(f"  -> Wrote {instruction.result} to {instruction.dest_reg}")
+                self.register_file.write_index(rd, instruction.result)
+                if self.trace.exec:
+                    self.trace.detail('exec', self.env.now, "Wrote {} to {}", instruction.result, instruction.dest_reg)
         
         return instruction
 
 
 class Pipeline:
-    def __init__(self, env, enable_forwarding=False):
+    def __init__(self, env, enable_forwarding=False, trace=None, predictor=None, icache=None, dcache=None):
         self.env = env
         self.enable_forwarding = enable_forwarding
         
+        # Branch prediction unit consulted by the memory fetch engine (None:
+        # fall through and flush on every taken branch/jump)
+        self.predictor = predictor
+        
+        # Trace output (level/category filtered; see tracing.py)
+        self.trace = trace if trace is not None else Tracer()
+        
         # Create hardware components
         self.register_file = RegisterFile()
         
@@ -274,40 +400,102 @@ class Pipeline:
         self.uart = UART()
         
         # Create CLINT (Core Local Interruptor) for timer interrupts
-        # time_scale=1 means increment mtime every cycle (can be adjusted for realistic timing)
+        # time_scale=1 means increment mtime every cycle (can be adjusted for realistic timing);
+        # it is attached to the SimPy clock when the stages start
         self.csr_bank = CSRBank()
         self.trap_controller = TrapController(self.csr_bank)
         self.interrupt_controller = self.trap_controller.interrupt_controller
         self.clint = CLINT(self.interrupt_controller, time_scale=1)
+        self.uart.connect(self.clint)  # TX FIFO timing and its interrupt
         
         # Create memory with UART and CLINT integration
         self.memory = Memory(uart=self.uart, clint=self.clint)
+        self.memory.map_ram(DRAM_BASE, DRAM_SIZE, name='dram')
         self.exe = EXE()
         
+        # Decoded-instruction cache shared by fetch (lookup) and execute/memory (invalidation)
+        self.decode_cache = DecodeCache()
+        
         # Create pipeline stages with hardware components
-        self.fetch = FetchStage(env)
+        self.fetch = FetchStage(env, self.decode_cache, self.memory)
         self.decode = DecodeStage(env, self.register_file)
-        self.execute = ExecuteStage(env, self.exe, self.register_file, self.trap_controller)
-        self.memory_stage = MemoryStage(env, self.memory)
+        self.execute = ExecuteStage(env, self.exe, self.register_file, self.trap_controller,
+                                    self.decode_cache, self.memory)
+        self.memory_stage = MemoryStage(env, self.memory, self.decode_cache)
         self.write_back = WriteBackStage(env, self.register_file, self.csr_bank)
+        self.write_back.counter_sync = self.sync_counters
+        for stage in (self.fetch, self.decode, self.execute, self.memory_stage, self.write_back):
+            stage.trace = self.trace
         
-        # Create buffers between stages
+        # L1 caches (cache.Cache) in front of fetch and data accesses; None when
+        # neither is configured (every access takes its stage's single cycle)
+        self.caches = CacheHierarchy(env, self.memory, icache, dcache) \
+            if icache is not None or dcache is not None else None
+        for stage in (self.fetch, self.decode, self.execute, self.memory_stage, self.write_back):
+            stage.caches = self.caches
+        
+        # Buffers between stages (replaced for every run by start_stages())
         self.fetch_to_decode = simpy.Store(env)
         self.decode_to_execute = simpy.Store(env)
         self.execute_to_memory = simpy.Store(env)
         self.memory_to_writeback = simpy.Store(env)
         self.writeback_output = simpy.Store(env)  # Optional: for tracking completed instructions
+        self.run_id = 0            # Bumped for every run; processes of older runs exit
         
         self.completed_instructions = []
+        self.keep_retired = True   # False: completed_instructions stays empty (counts only)
+        self.retired_count = 0
+        self.retire_trace = None   # retire_trace.RetireTrace streaming retired instructions
+        self.stage_trace = None    # stage_trace.StageTrace following instructions through the stages
         self.stall_count = 0
         self.bubble_count = 0
         self.completion_time = 0  # Track when last instruction completes
         self.flush_count = 0  # Track number of pipeline flushes
         
+        # HPM event counters (also readable by the guest through the counter CSRs)
+        self.counters = PerfCounters(env, self.uart)
+        self.profiler = None  # profiler.Profiler charged at retirement (see Profiler.attach)
+        
+        # Bypass network counters (enable_forwarding)
+        self.forward_ex_count = 0   # Operands forwarded from the instruction in EX
+        self.forward_mem_count = 0  # Operands forwarded from the instruction in MEM
+        self.load_use_stalls = 0    # Stall cycles waiting on a load in EX
+        self.load_use_producer = None  # Load that Decode last stalled on
+        
         # Pipeline flush control
         self.flush_signal = False  # Flag to trigger flush
         self.flush_target_pc = None  # New PC value after jump/branch
         
+        # Memory fetch engine state (run_from_memory)
+        self.fetch_from_memory = False
+        self.flush_epoch = 0       # Bumped on every flush; older instructions are wrong-path
+        self.redirect_pc = None    # Fetch PC requested by the last flush
+        self.in_flight = 0         # Instructions fetched but not yet retired or squashed
+        self.halt_reason = None
+        self.stop_event = None
+        self.fetch_pc = None       # Next PC to fetch (start_fetch/fetch_next)
+        self.fetch_epoch = 0       # Epoch given to fetched instructions
+        self.fetch_entry_pc = None # Entry PC, whose breakpoint is ignored until it is fetched
+        self.interrupt_seen = None
+        self.deadline = None       # Cycle the run ends at (max_cycles)
+        
+        # Idle fast-forward (see sleep())
+        self.fast_forward_idle = True  # False: idle loops spin, WFI waits cycle by cycle
+        self.idle = None           # 'wfi' or 'loop' while the core idles
+        self.idle_epoch = 0        # Flush epoch the idle state belongs to
+        self.idle_until = 0        # Cycle the fetch engine sleeps until
+        self.idle_loop = None      # The idle loop's branch/jump, and the cycles one iteration takes
+        self.idle_period = None
+        self.loop_seen = None      # (pc, cycle) a branch/jump to itself last left Execute
+        self._idle_cycles = 0
+        
+        # Run termination conditions (see run_from_memory)
+        self.max_instret = None      # Retired instruction limit
+        self.breakpoints = frozenset()  # PCs to stop before
+        self.halt_on = frozenset()   # 'ecall'/'ebreak': stop instead of trapping
+        self.tohost_address = None   # Stop once a store writes this address
+        self.tohost_value = None     # Word written to tohost
+        
         # Track instructions currently in pipeline stages (for hazard detection)
         self.pipeline_state = {
             'execute': None,
@@ -315,33 +503,241 @@ class Pipeline:
             'writeback': None
         }
 
-    def trigger_flush(self, target_pc):
-        """Trigger a pipeline flush and set new PC target"""
+    def trigger_flush(self, target_pc, cause=FLUSH_BRANCH):
+        """Trigger a pipeline flush and set new PC target
+        
+        Args:
+            target_pc: PC to fetch next
+            cause: FLUSH_BRANCH, FLUSH_JUMP or FLUSH_TRAP (counted by cause)
+        """
         self.flush_signal = True
         self.flush_target_pc = target_pc
         self.flush_count += 1
-        print(f"[Cycle {self.env.now}] Pipeline flush triggered, target PC = {target_pc:#010x}")
+        self.counters.flushes[cause] += 1
+        self.flush_epoch += 1
+        self.redirect_pc = target_pc
+        if self.trace.flush:
+            self.trace.event('flush', self.env.now, "Pipeline flush triggered, target PC = {:#010x}", target_pc)
+    
+    def resolve_prediction(self, instruction):
+        """Check a control instruction's fetch-time prediction after Execute
+        
+        Trains the predictor and redirects fetch through the normal flush
+        when the predicted next PC was wrong.
+        """
+        if instruction.opcode in BRANCH_OPCODES:
+            taken = instruction.result == 1
+        else:
+            taken = instruction.jump_target is not None
+        actual_pc = instruction.jump_target if taken else (instruction.pc + 4) & 0xFFFFFFFF
+        
+        if self.predictor.resolve(instruction.pc, instruction.decoded, instruction.prediction, taken, actual_pc):
+            if self.trace.flush:
+                self.trace.event('flush', self.env.now, "PREDICTED: {} -> {:#010x}", instruction.text, actual_pc)
+        else:
+            if self.trace.flush:
+                self.trace.event('flush', self.env.now, "MISPREDICT: {} predicted {:#010x}, actual {:#010x}", instruction.text, instruction.prediction.next_pc, actual_pc)
+            self.trigger_flush(actual_pc, FLUSH_BRANCH if instruction.opcode in BRANCH_OPCODES else FLUSH_JUMP)
+    
+    def sync_counters(self):
+        """Bring the cycle/instret/hpm counter CSRs and the time CSR up to date"""
+        self.counters.sync_csrs(self.csr_bank)
+        self.csr_bank.csrs[0xC01] = self.clint.mtime & 0xFFFFFFFF
+    
+    def leave_pipeline(self):
+        """Account for an instruction retiring or being squashed"""
+        self.in_flight -= 1
+        if self.halt_reason is not None and self.in_flight == 0:
+            self._stop(self.halt_reason)
+    
+    def halt(self, reason):
+        """Stop fetching; the run ends once older instructions have drained"""
+        if self.halt_reason is None:
+            self.halt_reason = reason
+            if self.trace.trap:
+                self.trace.event('trap', self.env.now, "HALT: {}", reason)
+        if self.in_flight == 0:
+            self._stop(reason)
+    
+    def fetch_stop_reason(self, instruction, skip_breakpoint=None):
+        """Check whether the run should end before a fetched instruction
+        
+        Args:
+            instruction: Freshly fetched instruction
+            skip_breakpoint: PC whose breakpoint is ignored (the run's entry PC)
+        
+        Returns:
+            Halt reason ('breakpoint', 'max_instret', 'ecall', 'ebreak') or None
+        """
+        if instruction.pc in self.breakpoints and instruction.pc != skip_breakpoint:
+            return 'breakpoint'
+        if self.max_instret is not None and \
+                self.retired_count + self.in_flight >= self.max_instret:
+            return 'max_instret'
+        if self.halt_on:
+            opcode = instruction.opcode
+            if opcode == Opcode.ECALL and 'ecall' in self.halt_on:
+                return 'ecall'
+            if opcode == Opcode.EBREAK and 'ebreak' in self.halt_on:
+                return 'ebreak'
+        return None
+    
+    def _stop(self, reason):
+        if self.stop_event is not None and not self.stop_event.triggered:
+            self.stop_event.succeed(reason)
+    
+    def reset_run_state(self):
+        """Start a new run afresh from where the last one stopped
+        
+        Clears the last run's halt reason, tohost value and idle sleep, and
+        drops whatever it left in flight (a run cut off by max_cycles); the
+        last run's processes exit at their next step (run_id).
+        """
+        self.run_id += 1
+        self.halt_reason = None
+        self.tohost_value = None
+        self.in_flight = 0
+        self.flush_signal = False
+        self.flush_target_pc = None
+        self.load_use_producer = None
+        for stage_name in self.pipeline_state:
+            self.pipeline_state[stage_name] = None
+        self.idle = None
+        self.loop_seen = None
+        now = int(self.env.now)
+        if self.idle_until > now:
+            self._idle_cycles -= self.idle_until - now  # The part of the sleep not taken
+            self.idle_until = now
+    
+    @property
+    def idle_cycles(self):
+        """Cycles skipped so far while the fetch engine slept (see sleep())"""
+        return self._idle_cycles - max(0, self.idle_until - int(self.env.now))
+    
+    def sleep(self, pc):
+        """Idle the fetch engine until an interrupt can wake the core
+        
+        Called while the core idles after fetching a WFI, or after an idle
+        loop (a branch/jump to itself) left Execute. Once older instructions
+        have drained nothing happens until the CLINT timer raises its
+        interrupt, so fetch sleeps until then (idle_until) instead of
+        stepping through the cycles; those are counted in idle_cycles.
+        The loop is not fetched again meanwhile, but the iterations it
+        would have run are retired: the skipped cycles over the loop's
+        measured period (see after_execute()), added to instret, the
+        retired count and its class count, up to max_instret, and handed to
+        the profiler and the retire and stage traces as one idle record.
+        A WFI wakes once an
+        enabled interrupt is pending, whether or not mstatus.MIE lets it be
+        taken.
+        
+        With no timer event to wait for, a loop sleeps out the run (to
+        max_cycles); a WFI, or a loop no interrupt can ever leave, halts
+        it ('self_loop').
+        
+        Args:
+            pc: Next PC to fetch
+        
+        Returns:
+            True if fetch waits this cycle, False once the core is awake
+        """
+        if self.in_flight:
+            return True
+        csr_bank = self.csr_bank
+        if self.idle == 'wfi':
+            awake = csr_bank.read(0x344) & csr_bank.read(0x304)
+        else:
+            # Stop at a breakpoint or the instret limit rather than sleep through it
+            awake = pc in self.breakpoints or \
+                self.max_instret is not None and self.retired_count >= self.max_instret
+        if awake:
+            self.idle = None
+            return False
+        
+        cycles = self.clint.cycles_until_timer()
+        if cycles is None and self.idle == 'loop':
+            cycles = self.deadline - int(self.env.now)
+        if cycles is None or self.idle == 'loop' and not self._interrupts_possible():
+            self.register_file.write_pc(pc)
+            self.halt('self_loop')
+        elif self.fast_forward_idle:
+            now = int(self.env.now)
+            if self.idle == 'loop':
+                # The run ends at the deadline even if the timer is due later
+                skipped = min(cycles, self.deadline - now)
+                iterations = skipped // self.idle_period
+                if self.max_instret is not None and iterations > self.max_instret - self.retired_count:
+                    iterations = self.max_instret - self.retired_count
+                    cycles = skipped = iterations * self.idle_period
+                self.credit_idle_loop(iterations, skipped)
+            self.idle_until = now + cycles
+            self._idle_cycles += cycles
+            if self.trace.trap:
+                self.trace.event('trap', self.env.now, "IDLE: sleeping {} cycles", cycles)
+        return True
+    
+    def credit_idle_loop(self, iterations, cycles):
+        """Retire the iterations of the idle loop fetch sleeps through for cycles (see sleep())"""
+        loop = self.idle_loop
+        self.retired_count += iterations
+        counters = self.counters
+        counters.instret += iterations
+        counters.class_counts[CLASS_BY_OPCODE[loop.opcode]] += iterations
+        now = self.env.now
+        if self.retire_trace is not None:
+            self.retire_trace.idle(loop, now, iterations, cycles)
+        if self.stage_trace is not None:
+            self.stage_trace.idle(loop, now, cycles)
+        if self.profiler is not None:
+            self.profiler.idle(loop, iterations, cycles)
+        if self.trace.trap:
+            self.trace.event('trap', now, "IDLE: crediting {} iterations of {:#010x} ({} cycles each)",
+                             iterations, loop.pc, self.idle_period)
+    
+    def _interrupts_possible(self):
+        """Check whether any interrupt could ever be taken (mstatus.MIE and mie)"""
+        csr_bank = self.csr_bank
+        return bool((csr_bank.read(0x300) >> 3) & 0x1) and csr_bank.read(0x304) != 0
+    
+    def count_stall(self, instruction, src, producer):
+        """Count one RAW stall cycle of instruction on register src waiting for producer"""
+        if self.profiler is not None:
+            self.profiler.stall(instruction.pc)
+        counters = self.counters
+        counters.raw_stalls[src] += 1
+        if producer.opcode in LOAD_OPCODES:
+            counters.load_use_stalls += 1
     
     def check_hazard(self, instruction):
         """Check for RAW, WAR, WAW hazards"""
         if instruction.is_bubble:
             return False
         
+        if self.enable_forwarding:
+            return self.check_hazard_forwarding(instruction)
+        
         # RAW (Read After Write) - True dependency
         # Check if any source register is being written by instructions in EX or MEM stages
         # We DON'T check WriteBack stage because by then the value is available
-        for src_reg in instruction.src_regs:
-            # Check Execute stage
-            if self.pipeline_state['execute'] and not self.pipeline_state['execute'].is_bubble:
-                if self.pipeline_state['execute'].dest_reg == src_reg:
-                    print(f"[Cycle {self.env.now}] RAW Hazard detected: {instruction.text} needs {src_reg} from {self.pipeline_state['execute'].text}")
-                    return True
+        # x0 is never a dependency: it always reads 0
+        execute = self.pipeline_state['execute']
+        memory = self.pipeline_state['memory']
+        for src in instruction.decoded.src_indices:
+            if not src:
+                continue
+            # Check Execute stage (bubbles have rd None)
+            if execute and execute.decoded.rd == src:
+                if self.trace.hazard:
+                    self.trace.event('hazard', self.env.now, "RAW Hazard detected: {} needs {} from {}", instruction.text, execute.dest_reg, execute.text)
+                self.count_stall(instruction, src, execute)
+                return True
             
             # Check Memory stage
-            if self.pipeline_state['memory'] and not self.pipeline_state['memory'].is_bubble:
-                if self.pipeline_state['memory'].dest_reg == src_reg:
-                    print(f"[Cycle {self.env.now}] RAW Hazard detected: {instruction.text} needs {src_reg} from {self.pipeline_state['memory'].text}")
-                    return True
+            if memory and memory.decoded.rd == src:
+                if self.trace.hazard:
+                    self.trace.event('hazard', self.env.now, "RAW Hazard detected: {} needs {} from {}", instruction.text, memory.dest_reg, memory.text)
+                self.count_stall(instruction, src, memory)
+                return True
             
             # WriteBack stage: No stall needed - value is being written back and available
         
@@ -355,18 +751,161 @@ class Pipeline:
         
         return False
 
+    def check_hazard_forwarding(self, instruction):
+        """Check for RAW hazards with EX->EX and MEM->EX bypass paths
+        
+        ALU results are forwarded from EX (available at the end of this cycle)
+        and loads from MEM. Only a load still in EX (load-use) or a CSR read,
+        whose value is produced at WriteBack, stalls. Forwarding sources are
+        recorded on the instruction and applied when it enters Execute.
+        
+        A load-use hazard costs exactly one bubble: once Decode has stalled on
+        a load, that load is treated as being in MEM on the re-check (the stage
+        state may not have advanced yet within the same simulated cycle).
+        
+        Returns:
+            True if the instruction must stall this cycle
+        """
+        forwards = []
+        forwarded_ex = forwarded_mem = 0
+        for index, src in enumerate(instruction.decoded.src_indices):
+            if not src:
+                continue  # x0 always reads 0
+            for stage_name in ('execute', 'memory'):
+                producer = self.pipeline_state[stage_name]
+                if producer is None or producer.decoded.rd != src:
+                    continue
+                opcode = producer.opcode
+                if stage_name == 'execute' and producer is self.load_use_producer:
+                    stage_name = 'memory'  # Already waited the load-use bubble
+                elif opcode in CSR_OPCODES or (stage_name == 'execute' and opcode in LOAD_OPCODES):
+                    if self.trace.hazard:
+                        kind = "Load-use" if opcode in LOAD_OPCODES else "RAW"
+                        self.trace.event('hazard', self.env.now, "{} Hazard detected: {} needs {} from {}", kind, instruction.text, producer.dest_reg, producer.text)
+                    if opcode in LOAD_OPCODES:
+                        self.load_use_stalls += 1
+                        self.load_use_producer = producer
+                    self.count_stall(instruction, src, producer)
+                    return True
+                
+                forwards.append((index, producer))
+                if stage_name == 'execute':
+                    forwarded_ex += 1
+                else:
+                    forwarded_mem += 1
+                if self.trace.hazard:
+                    self.trace.event('hazard', self.env.now, "FORWARD: {} gets {} from {} in {}", instruction.text, producer.dest_reg, producer.text, stage_name)
+                break  # Youngest producer wins
+        
+        instruction.forwards = forwards or None
+        self.load_use_producer = None
+        self.forward_ex_count += forwarded_ex
+        self.forward_mem_count += forwarded_mem
+        return False
+
+    def squash(self, instruction, stage_name):
+        """Drop a wrong-path instruction, leaving a bubble in its place"""
+        if self.trace.flush:
+            self.trace.event('flush', self.env.now, "FLUSH: Squashing {} in {} stage", instruction.text, stage_name)
+        if self.stage_trace is not None:
+            self.stage_trace.squash(instruction, self.env.now)
+        self.leave_pipeline()
+        return Instruction.from_decoded(BUBBLE_DECODED)
+    
+    def after_execute(self, instruction):
+        """Redirect fetch for an instruction that just left Execute (trap, jump, taken branch)"""
+        opcode = instruction.opcode
+        
+        # Check for trap (ECALL, EBREAK)
+        if hasattr(instruction, 'trap_info') and instruction.trap_info:
+            trap_pc = instruction.trap_info['handler_pc']
+            self.trigger_flush(trap_pc, FLUSH_TRAP)
+            if self.trace.trap:
+                self.trace.event('trap', self.env.now, "TRAP: Flushing pipeline for trap handler")
+        
+        # Predicted control transfer: flush only on a mispredict
+        elif instruction.prediction is not None:
+            self.resolve_prediction(instruction)
+        
+        # Trigger flush for jumps and taken branches
+        elif opcode in REDIRECT_OPCODES and instruction.jump_target is not None:
+            self.trigger_flush(instruction.jump_target, FLUSH_TRAP if opcode == Opcode.MRET else FLUSH_JUMP)
+        elif opcode in BRANCH_OPCODES:
+            if instruction.result == 1 and instruction.jump_target is not None:
+                self.trigger_flush(instruction.jump_target)
+        
+        # A branch/jump to itself changes nothing: only an interrupt can leave it.
+        # Fetch sleeps once it has left Execute twice in a row, which measures
+        # how many cycles an iteration takes
+        if self.fetch_from_memory and instruction.jump_target == instruction.pc \
+                and (opcode == Opcode.JAL or opcode in BRANCH_OPCODES and instruction.result == 1):
+            now = int(self.env.now)
+            seen = self.loop_seen
+            self.loop_seen = (instruction.pc, now)
+            if opcode == Opcode.JAL and not self._interrupts_possible():
+                self.halt('self_loop')
+            elif self.fast_forward_idle and seen is not None and seen[0] == instruction.pc:
+                self.idle = 'loop'
+                self.idle_epoch = self.flush_epoch
+                self.idle_loop = instruction
+                self.idle_period = max(1, now - seen[1])
+        else:
+            self.loop_seen = None
+    
+    def after_memory(self, instruction):
+        """Halt on a store to tohost (riscv-tests pass/fail reporting)"""
+        if self.tohost_address is not None and instruction.mem_address == self.tohost_address \
+                and instruction.opcode in STORE_OPCODES:
+            self.tohost_value = self.memory.read_word(self.tohost_address & ~0x3)
+            self.halt('tohost')
+    
+    def retire(self, instruction):
+        """Account for an instruction completing WriteBack"""
+        if self.keep_retired:
+            self.completed_instructions.append(instruction)
+        self.retired_count += 1
+        if self.retire_trace is not None:
+            self.retire_trace.record(instruction, self.env.now)
+        if self.stage_trace is not None:
+            self.stage_trace.retire(instruction, self.env.now)
+        counters = self.counters
+        counters.instret += 1
+        counters.class_counts[CLASS_BY_OPCODE[instruction.opcode]] += 1
+        if self.profiler is not None:
+            self.profiler.retire(instruction)
+        self.completion_time = self.env.now  # Track actual completion time
+        self.leave_pipeline()
+    
     def stage_runner(self, stage, input_buffer, output_buffer, stage_name=None):
         """Run a stage continuously, processing instructions from input buffer"""
+        run = self.run_id
         while True:
             instruction = yield input_buffer.get()
+            if self.run_id != run:
+                return
+            
+            if self.fetch_from_memory:
+                # Instructions fetched before the last redirect are wrong-path:
+                # squash them before they can read operands or execute
+                if stage_name in ['decode', 'execute'] and not instruction.is_bubble \
+                        and instruction.epoch != self.flush_epoch:
+                    instruction = self.squash(instruction, stage_name)
             
             # Check if this instruction should be flushed (for Fetch and Decode stages)
-            if self.flush_signal and stage_name in ['decode']:
+            elif self.flush_signal and stage_name in ['decode']:
                 # Convert to bubble if in early stages during flush
-                print(f"[Cycle {self.env.now}] FLUSH: Converting {instruction} to bubble in {stage_name} stage")
+                if self.trace.flush:
+                    self.trace.event('flush', self.env.now, "FLUSH: Converting {} to bubble in {} stage", instruction.text, stage_name)
+                if not instruction.is_bubble:
+                    if self.stage_trace is not None:
+                        self.stage_trace.squash(instruction, self.env.now)
+                    self.leave_pipeline()
                 instruction = Instruction("BUBBLE")
                 # Don't clear flush signal yet - let it propagate
             
+            if self.stage_trace is not None and not instruction.is_bubble:
+                self.stage_trace.enter(stage.name, instruction, self.env.now)
+            
             # Update pipeline state IMMEDIATELY when entering stage
             if stage_name and stage_name != 'decode':
                 self.pipeline_state[stage_name] = instruction
@@ -376,12 +915,15 @@ class Pipeline:
                 # Small delay to ensure other stages have updated their pipeline state
                 # This handles SimPy concurrent execution within the same cycle
                 yield self.env.timeout(0)
+                if self.run_id != run:
+                    return
                 
                 # Check for hazards before decoding (skip if being flushed)
                 if not instruction.is_bubble:
                     while self.check_hazard(instruction):
                         # Insert bubble and stall
-                        print(f"[Cycle {self.env.now}] STALL: Inserting bubble into Execute stage")
+                        if self.trace.hazard:
+                            self.trace.event('hazard', self.env.now, "STALL: Inserting bubble into Execute stage")
                         bubble = Instruction("BUBBLE")
                         self.stall_count += 1
                         self.bubble_count += 1
@@ -389,41 +931,35 @@ class Pipeline:
                         # Send bubble to next stage
                         yield output_buffer.put(bubble)
                         yield self.env.timeout(1)
+                        if self.caches is not None and self.caches.wait():
+                            yield self.env.timeout(self.caches.wait())
+                        if self.run_id != run:
+                            return
                         
                         # Keep checking hazard on same instruction
             
             # Now process the instruction
             processed = yield self.env.process(stage.process(instruction))
-            
-            # Tick CLINT after each stage completes (increment timer)
-            if stage_name:
-                self.clint.tick(1)
+            if self.run_id != run:
+                return
             
             # After Execute stage, check if we need to trigger flush
             if stage_name == 'execute' and not instruction.is_bubble:
-                op = instruction.operation
-                
-                # Check for trap (ECALL, EBREAK)
-                if hasattr(instruction, 'trap_info') and instruction.trap_info:
-                    trap_pc = instruction.trap_info['handler_pc']
-                    self.trigger_flush(trap_pc)
-                    print(f"[Cycle {self.env.now}] TRAP: Flushing pipeline for trap handler")
-                
-                # Trigger flush for jumps and taken branches
-                elif op in ['JAL', 'JALR', 'MRET'] and instruction.jump_target is not None:
-                    self.trigger_flush(instruction.jump_target)
-                elif op in ['BEQ', 'BNE', 'BLT', 'BGE', 'BLTU', 'BGEU']:
-                    if instruction.result == 1 and instruction.jump_target is not None:
-                        self.trigger_flush(instruction.jump_target)
+                self.after_execute(instruction)
+            
+            # A store to tohost ends the run (riscv-tests pass/fail reporting)
+            elif stage_name == 'memory':
+                self.after_memory(instruction)
             
             # Send to output buffer
             if output_buffer is not None:
                 yield output_buffer.put(processed)
+                if self.run_id != run:
+                    return
             else:
                 # Last stage - store completed instruction
                 if not instruction.is_bubble:
-                    self.completed_instructions.append(processed)
-                    self.completion_time = self.env.now  # Track actual completion time
+                    self.retire(processed)
             
             # Clear pipeline state after instruction exits this stage
             if stage_name and stage_name != 'decode':
@@ -431,16 +967,22 @@ class Pipeline:
             
             # Clear flush signal after Memory stage (gives time for early stages to flush)
             if stage_name == 'memory' and self.flush_signal:
-                print(f"[Cycle {self.env.now}] FLUSH: Clearing flush signal")
+                if self.trace.flush:
+                    self.trace.event('flush', self.env.now, "FLUSH: Clearing flush signal")
                 self.flush_signal = False
                 self.flush_target_pc = None
 
     def instruction_feeder(self, instructions):
         """Feed instructions into the pipeline"""
-        instruction_queue = [Instruction(instr) for instr in instructions]
         pc = 0  # Track current PC
+        run = self.run_id
         
-        for idx, instruction in enumerate(instruction_queue):
+        for idx, item in enumerate(instructions):
+            if self.run_id != run:
+                return
+            # Program slot idx is cached at address idx * 4
+            instruction = self.fetch.fetch_instruction(idx * 4, item)
+            
             # Check for pending interrupts before fetching
             next_pc = (pc + 4) & 0xFFFFFFFF
             interrupt_info = self.trap_controller.check_pending_interrupts(next_pc)
@@ -449,11 +991,15 @@ class Pipeline:
                 # Interrupt delivered - redirect to handler
                 handler_pc = interrupt_info['handler_pc']
                 cause = interrupt_info['cause']
-                print(f"\n[Cycle {self.env.now}] INTERRUPT DELIVERED: cause={cause:#x}, handler={handler_pc:#x}")
-                print(f"[Cycle {self.env.now}] FLUSH: Redirecting to interrupt handler")
+                if self.trace.trap:
+                    self.trace.banner('trap', self.env.now, "INTERRUPT DELIVERED: cause={:#x}, handler={:#x}", cause, handler_pc)
+                if self.trace.flush:
+                    self.trace.event('flush', self.env.now, "FLUSH: Redirecting to interrupt handler")
                 
                 # Update PC to handler
                 pc = handler_pc
+                self.counters.interrupts += 1
+                self.counters.flushes[FLUSH_INTERRUPT] += 1
                 
                 # Flush pipeline by inserting bubbles
                 for _ in range(3):  # Flush fetch, decode, execute stages
@@ -466,14 +1012,157 @@ class Pipeline:
                 yield self.env.timeout(1)
                 continue
             
-            print(f"\n[Cycle {self.env.now}] Fetching instruction: {instruction}")
+            if self.trace.fetch:
+                self.trace.banner('fetch', self.env.now, "Fetching instruction: {}", instruction.text)
+            if not instruction.is_bubble:
+                self.in_flight += 1
             yield self.fetch_to_decode.put(instruction)
             pc = next_pc
             yield self.env.timeout(1)
+        
+        # Program exhausted: the run ends once the pipeline has drained
+        self.halt('drained')
 
-    def run(self, instructions):
-        """Run the pipeline with a list of instructions"""
-        # Start all pipeline stages with stage names for tracking
+    def memory_fetcher(self):
+        """Fetch instructions from memory at the architectural PC
+        
+        Follows taken branches, jumps, MRET and trap handlers through the
+        redirect PC set by trigger_flush(); instructions fetched before a
+        redirect carry an older epoch and are squashed. With a branch
+        predictor, fetch continues at the predicted PC of each branch/jump and
+        only a mispredict redirects it. Interrupts are taken
+        on an instruction boundary: fetch pauses until older instructions
+        have drained, then mepc is the next PC to fetch.
+        
+        Stop conditions at an instruction (fetch_stop_reason) are handled the
+        same way: fetch waits for the older instructions, and the run halts
+        there only if none of them redirected fetch, so a wrong-path fetch can
+        never end the run. The PC is left at the stopping instruction.
+        """
+        self.start_fetch()
+        run = self.run_id
+        while self.halt_reason is None and self.run_id == run:
+            instruction = self.fetch_next()
+            if instruction is None:
+                if self.halt_reason is None:
+                    # Next cycle, or the end of an idle sleep
+                    yield self.env.timeout(max(1, self.idle_until - self.env.now))
+                    if self.caches is not None and self.caches.wait():
+                        yield self.env.timeout(self.caches.wait())
+                continue
+            yield self.fetch_to_decode.put(instruction)
+            yield self.env.timeout(1)
+            if self.caches is not None and self.caches.wait():
+                yield self.env.timeout(self.caches.wait())
+    
+    def start_fetch(self):
+        """Point the memory fetch engine at the architectural PC"""
+        self.fetch_pc = self.register_file.read_pc()
+        self.fetch_epoch = self.flush_epoch
+        self.fetch_entry_pc = self.fetch_pc
+        self.interrupt_seen = None  # Cycle fetch first saw a deliverable interrupt
+        self.idle = None
+    
+    def fetch_next(self):
+        """Make one fetch attempt at the fetch PC
+        
+        Returns:
+            The fetched instruction (counted in flight), or None if fetch
+            waits this cycle or has just halted the run
+        """
+        pc = self.fetch_pc
+        
+        # Follow the most recent redirect
+        if self.fetch_epoch != self.flush_epoch:
+            self.fetch_epoch = self.flush_epoch
+            pc = self.redirect_pc
+            self.redirect_pc = None
+        
+        # Deliverable-interrupt mask, kept current by mstatus/mie/mip writes
+        if self.csr_bank.deliverable:
+            if self.interrupt_seen is None:
+                self.interrupt_seen = self.env.now
+            if self.in_flight:
+                # Drain older instructions before taking the interrupt
+                self.fetch_pc = pc
+                return None
+            
+            interrupt_info = self.trap_controller.check_pending_interrupts(pc)
+            if interrupt_info:
+                pc = interrupt_info['handler_pc']
+                self.idle = None
+                counters = self.counters
+                counters.interrupts += 1
+                counters.flushes[FLUSH_INTERRUPT] += 1
+                counters.interrupt_latency += int(self.env.now - self.interrupt_seen)
+                if self.trace.trap:
+                    self.trace.banner('trap', self.env.now, "INTERRUPT DELIVERED: cause={:#x}, handler={:#x}", interrupt_info['cause'], pc)
+        
+        if self.idle is not None and self.idle_epoch == self.flush_epoch and self.sleep(pc):
+            self.fetch_pc = pc
+            return None
+        
+        instruction = self.fetch.fetch_from_memory(pc)
+        reason = self.fetch_stop_reason(instruction, self.fetch_entry_pc)
+        if reason is not None:
+            self.fetch_pc = pc
+            if not self.in_flight:
+                self.register_file.write_pc(pc)
+                self.halt(reason)
+            return None
+        self.fetch_entry_pc = None
+        self.interrupt_seen = None
+        if self.caches is not None and instruction.fault is None:
+            self.caches.fetch(pc)  # A miss holds the pipeline from the next cycle
+        instruction.epoch = self.fetch_epoch
+        prediction = None
+        if self.predictor is not None and instruction.fault is None:
+            prediction = self.predictor.predict(pc, instruction.decoded)
+        if prediction is not None:
+            instruction.prediction = prediction
+            pc = prediction.next_pc
+        else:
+            pc = (pc + 4) & 0xFFFFFFFF
+        self.fetch_pc = pc
+        self.register_file.write_pc(pc)
+        
+        if self.trace.fetch:
+            self.trace.banner('fetch', self.env.now, "Fetching instruction: {} @ {:#010x}", instruction.text, instruction.pc)
+        if instruction.opcode == Opcode.WFI:
+            # Nothing after it is fetched until an interrupt wakes the core
+            self.idle = 'wfi'
+            self.idle_epoch = self.fetch_epoch
+        self.in_flight += 1
+        return instruction
+
+    def cycle_watchdog(self, max_cycles):
+        """End the run after max_cycles regardless of pipeline state"""
+        run = self.run_id
+        yield self.env.timeout(max_cycles)
+        if self.run_id != run:
+            return  # That run already ended
+        if self.halt_reason is None:
+            self.halt_reason = 'max_cycles'
+        self._stop(self.halt_reason)
+
+    def start_stages(self, front_end_capacity=float('inf')):
+        """Start the five stage processes, on empty buffers
+        
+        Args:
+            front_end_capacity: Entries of the Fetch -> Decode -> Execute buffers
+        """
+        # mtime follows the simulation clock; the timer interrupt is a scheduled event
+        self.clint.attach(self.env)
+        
+        env = self.env
+        self.fetch_to_decode = simpy.Store(env, capacity=front_end_capacity)
+        self.decode_to_execute = simpy.Store(env, capacity=front_end_capacity)
+        self.execute_to_memory = simpy.Store(env)
+        self.memory_to_writeback = simpy.Store(env)
+        self.writeback_output = simpy.Store(env)
+        for stage in (self.fetch, self.decode, self.execute, self.memory_stage, self.write_back):
+            stage.run_id = self.run_id
+        
         # Format: stage_runner(stage, input_buffer, output_buffer, stage_name)
         # Pipeline flow: Fetch -> Decode -> Execute -> Memory -> WriteBack
         self.env.process(self.stage_runner(self.fetch, self.fetch_to_decode, self.decode_to_execute))
@@ -481,15 +1170,82 @@ class Pipeline:
         self.env.process(self.stage_runner(self.execute, self.execute_to_memory, self.memory_to_writeback, 'execute'))
         self.env.process(self.stage_runner(self.memory_stage, self.memory_to_writeback, self.writeback_output, 'memory'))
         self.env.process(self.stage_runner(self.write_back, self.writeback_output, None, 'writeback'))
+
+    def run(self, instructions, max_cycles=None):
+        """Run the pipeline with a list of instructions
+        
+        Runs until the last instruction has left the pipeline ('drained') or
+        max_cycles elapse; the reason is left in halt_reason.
+        
+        Args:
+            instructions: List of 32-bit instruction words, DecodedInstruction
+                records, or assembly strings (hand-written test programs)
+            max_cycles: Cycle limit for the run (None: no limit)
+        """
+        # Start all pipeline stages with stage names for tracking
+        self.reset_run_state()
+        self.start_stages()
+        self.stop_event = self.env.event()
         
         # Feed instructions
         self.env.process(self.instruction_feeder(instructions))
+        if max_cycles is not None:
+            self.env.process(self.cycle_watchdog(max_cycles))
+        self.env.run(until=self.stop_event)
+        self.uart.flush()
+        
+        return self.completed_instructions
+
+    def configure_memory_run(self, entry_pc, max_instret, breakpoints, halt_on, tohost):
+        """Set the termination conditions and entry PC of a run_from_memory() run"""
+        unknown = set(halt_on) - {'ecall', 'ebreak'}
+        if unknown:
+            raise ValueError(f"Unknown halt_on conditions: {sorted(unknown)}")
+        self.reset_run_state()
+        self.max_instret = max_instret
+        self.breakpoints = frozenset(breakpoints)
+        self.halt_on = frozenset(halt_on)
+        self.tohost_address = tohost
         
-        # Run simulation for enough time to complete all instructions
-        # Account for stalls - give extra cycles
-        # Use more cycles to ensure deeply dependent instructions complete
-        total_cycles = len(instructions) * 10 + 20
-        self.env.run(until=total_cycles)
+        self.fetch_from_memory = True
+        if entry_pc is not None:
+            self.register_file.write_pc(entry_pc)
+    
+    def run_from_memory(self, entry_pc=None, max_cycles=100000, max_instret=None,
+                        breakpoints=(), halt_on=(), tohost=None):
+        """Run the program loaded in memory, fetching at the real PC
+        
+        Runs until one of these ends it; the reason is left in halt_reason:
+        - 'self_loop': a branch/jump to itself, or a WFI, that no interrupt
+          can ever end (with interrupts possible, the core sleeps through
+          such idle time instead: see sleep())
+        - 'tohost': a store to the tohost address (value in tohost_value)
+        - 'breakpoint': the PC reaches a breakpoint (not executed)
+        - 'ecall'/'ebreak': that instruction is reached and listed in halt_on
+          (not executed); otherwise it traps as usual
+        - 'max_instret': max_instret instructions have retired
+        - 'max_cycles': max_cycles elapse
+        
+        Args:
+            entry_pc: Address of the first instruction (default: current PC)
+            max_cycles: Cycle limit for the run
+            max_instret: Retired instruction limit (None: no limit)
+            breakpoints: PCs to stop before; one at the entry PC is ignored
+                         so a stopped run can be resumed
+            halt_on: Subset of ('ecall', 'ebreak') that stop the run
+            tohost: Address whose store ends the run (None: disabled)
+        """
+        self.configure_memory_run(entry_pc, max_instret, breakpoints, halt_on, tohost)
+
+        # Fetch must stall along with decode: single-entry front-end buffers give
+        # back-pressure so fetched instructions cannot pile up behind a hazard stall
+        self.start_stages(front_end_capacity=1)
+        self.stop_event = self.env.event()
+        self.deadline = int(self.env.now) + max_cycles
+        self.env.process(self.memory_fetcher())
+        self.env.process(self.cycle_watchdog(max_cycles))
+        self.env.run(until=self.stop_event)
+        self.uart.flush()
         
         return self.completed_instructions
 
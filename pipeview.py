@@ -0,0 +1,260 @@
+#!/usr/bin/env python3
+"""Pipeline diagrams and trace viewer exports from a stage trace
+
+Works on StageRecords (stage_trace.py) -- read back from a trace file or
+an in-memory StageTrace -- rather than re-running the pipeline, so a window
+of a long run can be drawn at any time after it was simulated:
+
+- render_diagram(): the classic ASCII diagram, one row per instruction,
+  written a row at a time
+- write_konata(): Kanata 0004 log for the Konata pipeline viewer
+- write_chrome_trace(): Trace Event Format JSON for chrome://tracing and
+  Perfetto, one track per stage
+
+All three stream: none holds more than the instructions in flight at once.
+
+Command line:
+    python pipeview.py run.rvst --start 5000000 --end 5000200
+    python pipeview.py run.rvst --pc 0x80000124 --konata run.kanata --chrome run.json
+"""
+
+import sys
+import json
+import heapq
+
+from stage_trace import STAGES, FLAG_SQUASHED, FLAG_IDLE, read_stage_trace
+from instruction import decode_instruction_word
+
+
+def stage_spans(record):
+    """Get the cycles an instruction spent in each stage
+
+    Returns:
+        List of (stage index, first cycle, cycle after the last) for the
+        stages it reached; the last span ends when it left the pipeline
+        (it is open-ended, None, for an instruction still in flight)
+    """
+    cycles = record.stage_cycles()
+    end = record.end_cycle
+    reached = [(index, cycle) for index, cycle in enumerate(cycles) if cycle is not None]
+    spans = []
+    for position, (index, cycle) in enumerate(reached):
+        if position + 1 < len(reached):
+            stop = reached[position + 1][1]
+        elif end is not None:
+            stop = max(end, cycle + 1)   # At least the cycle it entered the stage
+        else:
+            stop = None
+        spans.append((index, cycle, stop))
+    return spans
+
+
+_disassembly = {}
+
+
+def describe(record):
+    """Label for a record: address and disassembly, or None for list-fed programs"""
+    if not record.word and not record.pc:
+        return None
+    text = _disassembly.get(record.word)
+    if text is None:
+        text = _disassembly[record.word] = decode_instruction_word(record.word).text
+    return f"{record.pc:08x}: {text}"
+
+
+def _labeller(label):
+    """Label function for the renderers; list-fed instructions are numbered"""
+    if label is not None:
+        return label
+    counter = [0]
+
+    def default(record):
+        counter[0] += 1
+        return describe(record) or f"Inst {counter[0]}"
+    return default
+
+
+def render_diagram(records, start_cycle=None, end_cycle=None, stream=None, label=None, width=32):
+    """Draw records as an ASCII pipeline diagram
+
+    Each cell shows the stage an instruction entered that cycle, '-' while
+    it stays in the same stage (a stall) and 'X' where it was squashed.
+
+    Args:
+        records: StageRecords in fetch order (read_stage_trace())
+        start_cycle: First cycle drawn (None: the first record's fetch)
+        end_cycle: Cycle after the last drawn (None: when the last record
+                   left the pipeline); with both bounds given the records
+                   are drawn as they are read
+        stream: Text stream to write to (default: sys.stdout)
+        label: Function giving a record's row label (default: address and
+               disassembly, "Inst n" for list-fed programs)
+        width: Width of the label column
+
+    Returns:
+        Number of rows drawn
+    """
+    stream = stream or sys.stdout
+    label = _labeller(label)
+    if start_cycle is None or end_cycle is None:
+        records = list(records)
+        if start_cycle is None:
+            start_cycle = records[0].fetch if records else 0
+        if end_cycle is None:
+            ends = [stop for record in records for _, _, stop in stage_spans(record)[-1:] if stop is not None]
+            end_cycle = max(ends + [start_cycle + 1])
+    cycles = range(start_cycle, end_cycle)
+    cell = max(3, len(str(end_cycle - 1)) + 1)
+
+    rule = "=" * (width + 1 + len(cycles) * (cell + 3) + 1)
+    stream.write("\nPipeline Execution Diagram:\n" + rule + "\n")
+    stream.write(" " * width + " " + "".join(f"| {'t' + str(cycle):<{cell}} " for cycle in cycles) + "|\n")
+    stream.write("-" * len(rule) + "\n")
+
+    rows = 0
+    for record in records:
+        spans = stage_spans(record)
+        if not spans or (spans[-1][2] is not None and spans[-1][2] <= start_cycle):
+            continue
+        if record.fetch >= end_cycle:
+            break
+        marks = {}
+        for index, first, stop in spans:
+            stop = end_cycle if stop is None else min(stop, end_cycle)
+            for cycle in range(max(first, start_cycle), stop):
+                marks[cycle] = STAGES[index] if cycle == first else '-'
+        if record.flags & FLAG_SQUASHED:
+            marks[record.end_cycle] = 'X'
+        name = label(record)[:width]
+        stream.write(f"{name:<{width}} " + "".join(f"| {marks.get(cycle, ''):<{cell}} " for cycle in cycles)
+                     + "|\n")
+        rows += 1
+
+    stream.write(rule + "\n")
+    stream.write("Legend: IF=Fetch, ID=Decode, EX=Execute, MEM=Memory, WB=WriteBack, "
+                 "-=stalled, X=squashed\n")
+    return rows
+
+
+def _record_events(record, sequence, text, retire_id):
+    """Konata events of one record as (cycle, order, line) tuples"""
+    events = [(record.fetch, 0, f"I\t{sequence}\t{sequence}\t0"),
+              (record.fetch, 1, f"L\t{sequence}\t0\t{text}")]
+    for index, first, stop in stage_spans(record):
+        events.append((first, 3, f"S\t{sequence}\t0\t{STAGES[index]}"))
+        if stop is not None:
+            events.append((stop, 2, f"E\t{sequence}\t0\t{STAGES[index]}"))
+    if record.end_cycle is not None:
+        squashed = 1 if record.flags & FLAG_SQUASHED else 0
+        events.append((record.end_cycle, 4, f"R\t{sequence}\t{retire_id}\t{squashed}"))
+    return events
+
+
+def write_konata(records, stream, label=None):
+    """Write records as a Kanata 0004 log (Konata pipeline viewer)
+
+    Args:
+        records: StageRecords in fetch order
+        stream: Text stream to write to
+        label: Function giving a record's label (see render_diagram())
+
+    Returns:
+        Number of instructions written
+    """
+    label = _labeller(label)
+    pending = []          # Heap of (cycle, order, sequence, line)
+    now = None
+    count = retired = 0
+
+    def emit_before(limit):
+        nonlocal now
+        while pending and (limit is None or pending[0][0] < limit):
+            cycle, _, _, line = heapq.heappop(pending)
+            if now is None:
+                stream.write(f"C=\t{cycle}\n")
+            elif cycle > now:
+                stream.write(f"C\t{cycle - now}\n")
+            now = cycle
+            stream.write(line + "\n")
+
+    stream.write("Kanata\t0004\n")
+    for record in records:
+        emit_before(record.fetch)
+        if record.end_cycle is not None and not record.flags & (FLAG_SQUASHED | FLAG_IDLE):
+            retired += 1
+        for cycle, order, line in _record_events(record, count, label(record), retired):
+            heapq.heappush(pending, (cycle, order, count, line))
+        count += 1
+    emit_before(None)
+    return count
+
+
+def write_chrome_trace(records, stream, label=None):
+    """Write records as Trace Event Format JSON (chrome://tracing, Perfetto)
+
+    Each stage is a thread whose spans are the instructions occupying it;
+    squashes are instant events. One cycle is shown as one microsecond.
+
+    Args:
+        records: StageRecords in fetch order
+        stream: Text stream to write to
+        label: Function giving a record's span name (see render_diagram())
+
+    Returns:
+        Number of instructions written
+    """
+    label = _labeller(label)
+    stream.write('{"traceEvents":[\n')
+    events = [{"name": "thread_name", "ph": "M", "pid": 0, "tid": index, "args": {"name": name}}
+              for index, name in enumerate(STAGES)]
+    stream.write(",\n".join(json.dumps(event) for event in events))
+    count = 0
+    for record in records:
+        name = label(record)
+        args = {"pc": f"0x{record.pc:08x}", "fetch": record.fetch}
+        for index, first, stop in stage_spans(record):
+            if stop is None:
+                continue
+            stream.write(",\n" + json.dumps({"name": name, "cat": STAGES[index], "ph": "X", "ts": first,
+                                             "dur": stop - first, "pid": 0, "tid": index, "args": args}))
+        if record.flags & FLAG_SQUASHED:
+            index = stage_spans(record)[-1][0]
+            stream.write(",\n" + json.dumps({"name": "squash", "cat": STAGES[index], "ph": "i", "s": "t",
+                                             "ts": record.end_cycle, "pid": 0, "tid": index, "args": args}))
+        count += 1
+    stream.write('\n],"displayTimeUnit":"ns"}\n')
+    return count
+
+
+def main(argv=None):
+    import argparse
+
+    parser = argparse.ArgumentParser(description='Draw or export a window of a stage trace')
+    parser.add_argument('trace', help='Stage trace file (RISCVProcessor.enable_stage_trace())')
+    parser.add_argument('--start', type=int, default=None, metavar='CYCLE',
+                        help='Skip instructions that left the pipeline before CYCLE')
+    parser.add_argument('--end', type=int, default=None, metavar='CYCLE',
+                        help='Stop at instructions fetched at or after CYCLE')
+    parser.add_argument('--pc', dest='pcs', type=lambda text: int(text, 0), action='append', default=None,
+                        metavar='PC', help='Only instructions at PC (repeatable)')
+    parser.add_argument('--konata', metavar='FILE', default=None, help='Write a Kanata log to FILE')
+    parser.add_argument('--chrome', metavar='FILE', default=None, help='Write Chrome trace JSON to FILE')
+    parser.add_argument('--diagram', action='store_true',
+                        help='Draw the ASCII diagram as well as the exports')
+    args = parser.parse_args(argv)
+
+    def window():
+        return read_stage_trace(args.trace, args.start, args.end, args.pcs)
+
+    if args.konata:
+        with open(args.konata, 'w') as stream:
+            print(f"{write_konata(window(), stream)} instructions written to {args.konata}")
+    if args.chrome:
+        with open(args.chrome, 'w') as stream:
+            print(f"{write_chrome_trace(window(), stream)} instructions written to {args.chrome}")
+    if args.diagram or not (args.konata or args.chrome):
+        render_diagram(window(), args.start, args.end)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,249 @@
+"""Guest-code profiler for RISC-V pipeline simulator
+
+An exact (not sampled) PC profiler driven by the pipeline's retire path.
+Each retiring instruction is charged the cycles since the previous
+retirement, so the per-PC cycle counts add up to the run's cycles; stall
+cycles are charged to the instruction Decode held back, and an idle loop
+the pipeline sleeps through (Pipeline.sleep()) to the loop's branch/jump. Only runs from
+memory are profiled: instruction-list runs have no PCs.
+
+PCs are symbolized with the ELF function symbols (ELFTestLoader.functions)
+and a shadow call stack is kept from the retired control flow:
+- JAL/JALR linking ra or t0 push the callee
+- JALR x0 through ra/t0 and MRET pop back to the matching caller
+- a function change after a non-control instruction is a trap or
+  interrupt entry and pushes the handler
+- any other change (jump, tail call, branch) replaces the top frame
+
+Reports:
+- flat_report(): self/inclusive cycles, stalls and CPI per function, plus
+  the hottest PCs
+- call_graph_report(): callers and callees of each function
+- collapsed_stacks(): "main;vTaskDelay;prvAddCurrentTaskToList 1234" lines,
+  the input format of flamegraph.pl and speedscope
+
+Usage:
+    profiler = processor.enable_profiler(loader.functions)
+    processor.execute_from_memory(entry, verbose=False)
+    print(profiler.flat_report())
+"""
+
+import bisect
+
+from instruction import Opcode, BRANCH_OPCODES
+
+UNKNOWN_FUNCTION = '[unknown]'
+MAX_STACK_DEPTH = 64
+
+# Control transfer performed by the previously retired instruction
+SEQUENTIAL, CALL, RETURN, JUMP = range(4)
+LINK_REGISTERS = (1, 5)  # ra, t0 (RISC-V calling convention)
+
+
+class SymbolTable:
+    """Address -> function name lookup over sorted function symbols"""
+
+    def __init__(self, functions=()):
+        """
+        Args:
+            functions: Iterable of (address, size, name); size 0 extends
+                       to the next function
+        """
+        self.functions = sorted(functions)
+        self.starts = [address for address, _, _ in self.functions]
+
+    def lookup(self, pc):
+        """Get (name, offset) of the function holding pc (UNKNOWN_FUNCTION if none)"""
+        index = bisect.bisect_right(self.starts, pc) - 1
+        if index >= 0:
+            address, size, name = self.functions[index]
+            if size == 0 or pc < address + size:
+                return name, pc - address
+        return UNKNOWN_FUNCTION, pc
+
+
+class Profiler:
+    """Per-PC and per-function cycle profile with a shadow call stack"""
+
+    def __init__(self, functions=()):
+        """
+        Args:
+            functions: Function symbols as (address, size, name) tuples
+        """
+        self.symbols = SymbolTable(functions)
+        self.pc_cycles = {}     # pc -> cycles charged at retirement
+        self.pc_stalls = {}     # pc -> stall cycles in Decode
+        self.pc_retired = {}    # pc -> retirement count
+        self.stacks = {}        # call stack tuple -> cycles
+        self.env = None
+        self._function_of = {}  # pc -> function name (memoized lookups)
+        self._stack = ()
+        self._transfer = SEQUENTIAL
+        self._last_time = 0
+
+    def attach(self, pipeline):
+        """Start profiling a pipeline's retired instructions"""
+        pipeline.profiler = self
+        self.env = pipeline.env
+        self._last_time = pipeline.env.now
+
+    def function_of(self, pc):
+        name = self._function_of.get(pc)
+        if name is None:
+            name = self._function_of[pc] = self.symbols.lookup(pc)[0]
+        return name
+
+    def stall(self, pc):
+        """Charge one stall cycle to the instruction at pc"""
+        if pc is None:
+            return
+        self.pc_stalls[pc] = self.pc_stalls.get(pc, 0) + 1
+
+    def retire(self, instruction):
+        """Account for a retired (non-bubble) instruction"""
+        pc = instruction.pc
+        if pc is None:
+            return
+        now = self.env.now
+        cycles = int(now - self._last_time)
+        self._last_time = now
+        self.pc_cycles[pc] = self.pc_cycles.get(pc, 0) + cycles
+        self.pc_retired[pc] = self.pc_retired.get(pc, 0) + 1
+
+        function = self.function_of(pc)
+        stack = self._stack
+        if not stack:
+            stack = (function,)
+        elif stack[-1] != function:
+            transfer = self._transfer
+            if transfer == RETURN:
+                # Unwind to the caller (a context switch may return elsewhere)
+                depth = len(stack) - 1
+                while depth > 0 and stack[depth - 1] != function:
+                    depth -= 1
+                stack = stack[:depth] if depth else stack[:-1] + (function,)
+            elif transfer == JUMP or len(stack) >= MAX_STACK_DEPTH:
+                stack = stack[:-1] + (function,)
+            else:
+                stack = stack + (function,)
+        self._stack = stack
+        self.stacks[stack] = self.stacks.get(stack, 0) + cycles
+
+        decoded = instruction.decoded
+        opcode = decoded.opcode
+        if opcode == Opcode.JAL or opcode == Opcode.JALR:
+            if decoded.rd in LINK_REGISTERS:
+                self._transfer = CALL
+            elif opcode == Opcode.JALR and decoded.src_indices[0] in LINK_REGISTERS:
+                self._transfer = RETURN
+            else:
+                self._transfer = JUMP
+        elif opcode == Opcode.MRET:
+            self._transfer = RETURN
+        elif opcode in BRANCH_OPCODES:
+            self._transfer = JUMP
+        else:
+            self._transfer = SEQUENTIAL
+
+    def idle(self, instruction, iterations, cycles):
+        """Charge an idle loop fetch is about to sleep through (see Pipeline.sleep())
+
+        The loop's branch/jump is charged the cycles since the previous
+        retirement and the cycles skipped, and counted once per skipped
+        iteration, as if it had spun through them.
+        """
+        pc = instruction.pc
+        end = self.env.now + cycles
+        charged = int(end - self._last_time)
+        self._last_time = end
+        self.pc_cycles[pc] = self.pc_cycles.get(pc, 0) + charged
+        self.pc_retired[pc] = self.pc_retired.get(pc, 0) + iterations
+        stack = self._stack or (self.function_of(pc),)
+        self._stack = stack
+        self.stacks[stack] = self.stacks.get(stack, 0) + charged
+
+    # ------------------------------------------------------------------
+    # Aggregation and reports
+    # ------------------------------------------------------------------
+
+    @property
+    def total_cycles(self):
+        return sum(self.pc_cycles.values())
+
+    def function_profile(self):
+        """Aggregate the per-PC counts by function
+
+        Returns:
+            List of dicts (name, self_cycles, inclusive_cycles, stalls,
+            instructions), hottest self_cycles first
+        """
+        rows = {}
+
+        def row(name):
+            if name not in rows:
+                rows[name] = {'name': name, 'self_cycles': 0, 'inclusive_cycles': 0,
+                              'stalls': 0, 'instructions': 0}
+            return rows[name]
+
+        for pc, cycles in self.pc_cycles.items():
+            entry = row(self.function_of(pc))
+            entry['self_cycles'] += cycles
+            entry['instructions'] += self.pc_retired[pc]
+        for pc, stalls in self.pc_stalls.items():
+            row(self.function_of(pc))['stalls'] += stalls
+        for stack, cycles in self.stacks.items():
+            for name in set(stack):
+                row(name)['inclusive_cycles'] += cycles
+        return sorted(rows.values(), key=lambda r: (-r['self_cycles'], r['name']))
+
+    def call_edges(self):
+        """Get {(caller, callee): inclusive cycles of callee under caller}"""
+        edges = {}
+        for stack, cycles in self.stacks.items():
+            for edge in set(zip(stack, stack[1:])):
+                edges[edge] = edges.get(edge, 0) + cycles
+        return edges
+
+    def flat_report(self, top=20):
+        """Format the per-function profile and the hottest PCs"""
+        total = self.total_cycles or 1
+        lines = [f"Flat profile: {self.total_cycles} cycles, {sum(self.pc_retired.values())} instructions",
+                 f"{'%self':>6s} {'self':>10s} {'incl':>10s} {'stalls':>8s} {'instr':>9s} {'CPI':>5s}  function"]
+        for r in self.function_profile()[:top]:
+            cpi = r['self_cycles'] / r['instructions'] if r['instructions'] else 0
+            lines.append(f"{r['self_cycles'] * 100 / total:6.2f} {r['self_cycles']:10d} {r['inclusive_cycles']:10d} "
+                         f"{r['stalls']:8d} {r['instructions']:9d} {cpi:5.2f}  {r['name']}")
+
+        lines += ["", "Hot PCs:", f"{'%cyc':>6s} {'cycles':>10s} {'stalls':>8s} {'count':>9s}  pc          location"]
+        hottest = sorted(self.pc_cycles.items(), key=lambda item: (-item[1], item[0]))[:top]
+        for pc, cycles in hottest:
+            name, offset = self.symbols.lookup(pc)
+            location = f"{name}+{offset:#x}" if name != UNKNOWN_FUNCTION else name
+            lines.append(f"{cycles * 100 / total:6.2f} {cycles:10d} {self.pc_stalls.get(pc, 0):8d} "
+                         f"{self.pc_retired[pc]:9d}  0x{pc:08x}  {location}")
+        return "\n".join(lines)
+
+    def call_graph_report(self):
+        """Format each function with its callers and callees (inclusive cycles)"""
+        edges = self.call_edges()
+        total = self.total_cycles or 1
+        lines = ["Call graph (inclusive cycles):"]
+        for r in sorted(self.function_profile(), key=lambda r: (-r['inclusive_cycles'], r['name'])):
+            name = r['name']
+            lines.append(f"{r['inclusive_cycles'] * 100 / total:6.2f}% {r['inclusive_cycles']:10d}  {name} "
+                         f"(self {r['self_cycles']})")
+            callers = sorted(((c, caller) for (caller, callee), c in edges.items() if callee == name), reverse=True)
+            callees = sorted(((c, callee) for (caller, callee), c in edges.items() if caller == name), reverse=True)
+            lines += [f"{'':19s}<- {caller} ({c})" for c, caller in callers]
+            lines += [f"{'':19s}-> {callee} ({c})" for c, callee in callees]
+        return "\n".join(lines)
+
+    def collapsed_stacks(self):
+        """Format the call stacks in collapsed ("folded") flamegraph format"""
+        lines = [f"{';'.join(stack)} {cycles}" for stack, cycles in self.stacks.items() if cycles]
+        return "\n".join(sorted(lines)) + ("\n" if lines else "")
+
+    def write_collapsed(self, path):
+        """Write collapsed stacks to a file (flamegraph.pl, speedscope, inferno)"""
+        with open(path, 'w') as f:
+            f.write(self.collapsed_stacks())
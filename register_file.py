@@ -1,26 +1,46 @@
 """Register file for RISC-V pipeline simulator"""
+from instruction import register_index
 
 
 class RegisterFile:
-    """Register file with read/write operations and special registers"""
+    """Register file with read/write operations and special registers
+    
+    The 32 GPRs live in a list indexed by register number (regs). The
+    pipeline and functional core use the index accessors; read()/write()
+    take register names ('R5', 'x5', 'a0', ...) for tests and tools.
+    """
     def __init__(self):
-        self.registers = {}
-        # Initialize 32 general-purpose registers with default values
-        for i in range(32):
-            self.registers[f'R{i}'] = 0
+        # 32 general-purpose registers, indexed by number (x0 stays 0)
+        self.regs = [0] * 32
         
         # Special registers (not part of the 32 GPRs)
         self.pc = 0           # Program Counter
         self.next_pc = 4      # Next PC (for branches/jumps)
     
+    @property
+    def registers(self):
+        """Snapshot of all GPRs as {'R0': value, ..., 'R31': value}"""
+        return {f'R{i}': value for i, value in enumerate(self.regs)}
+    
     def read(self, reg_name):
-        """Read value from register"""
-        return self.registers.get(reg_name, 0)
+        """Read value from register (0 for names that are not a GPR)"""
+        index = register_index(reg_name) if isinstance(reg_name, str) else reg_name
+        return self.regs[index] if index is not None else 0
     
     def write(self, reg_name, value):
         """Write value to register (masked to 32-bit)"""
-        if reg_name and reg_name != 'R0':  # R0 is always 0 in RISC-V
-            self.registers[reg_name] = value & 0xFFFFFFFF
+        index = register_index(reg_name) if isinstance(reg_name, str) else reg_name
+        if index:  # R0 is always 0 in RISC-V
+            self.regs[index] = value & 0xFFFFFFFF
+    
+    def read_index(self, index):
+        """Read register by number"""
+        return self.regs[index]
+    
+    def write_index(self, index, value):
+        """Write register by number (masked to 32-bit; writes to x0 are discarded)"""
+        if index:
+            self.regs[index] = value & 0xFFFFFFFF
     
     def read_pc(self):
         """Read program counter"""
@@ -61,17 +81,17 @@ class RegisterFile:
             # Show all registers
             for i in range(32):
                 reg_name = f'R{i}'
-                value = self.registers[reg_name]
+                value = self.regs[i]
                 # Add common RISC-V register aliases
                 alias = self._get_register_alias(i)
                 alias_str = f" ({alias})" if alias else ""
                 print(f"{reg_name:4s}{alias_str:8s}: {value:10d} (0x{value:08x})")
         else:
             # Only show non-zero registers
-            non_zero = {k: v for k, v in self.registers.items() if v != 0}
+            non_zero = [(i, v) for i, v in enumerate(self.regs) if v != 0]
             if non_zero:
-                for reg_name, value in sorted(non_zero.items(), key=lambda x: int(x[0][1:])):
-                    reg_num = int(reg_name[1:])
+                for reg_num, value in non_zero:
+                    reg_name = f'R{reg_num}'
                     alias = self._get_register_alias(reg_num)
                     alias_str = f" ({alias})" if alias else ""
                     print(f"{reg_name:4s}{alias_str:8s}: {value:10d} (0x{value:08x})")
@@ -119,5 +139,5 @@ class RegisterFile:
     
     def __str__(self):
         # Only show non-zero registers
-        non_zero = {k: v for k, v in self.registers.items() if v != 0}
+        non_zero = {f'R{i}': v for i, v in enumerate(self.regs) if v != 0}
         return str(non_zero)
@@ -0,0 +1,279 @@
+"""Streaming retire trace: one fixed-width binary record per retired instruction
+
+By default the pipeline keeps every retired Instruction object in
+completed_instructions. For long runs that list grows without bound, so a
+RetireTrace can take over: attached to a pipeline (with keep_retired off),
+it packs each retired instruction into a 32-byte record and streams the
+records out in chunks, keeping nothing else per instruction. With neither
+(keep_retired off, no trace) retirement only updates counters.
+
+Record layout (little-endian, RECORD_FORMAT):
+    cycle       u64  Cycle the instruction left WriteBack
+    pc          u32  Address it was fetched from
+    word        u32  Instruction word
+    value       u32  Value written to rd (FLAG_RD)
+    mem_address u32  Load/store address (FLAG_LOAD/FLAG_STORE)
+    mem_data    u32  Value loaded, or stored (low bytes for SB/SH)
+    rd          u8   Destination register (0: none)
+    flags       u8   FLAG_* bits
+    cause       u16  Exception cause of a trapping instruction (FLAG_TRAP)
+A FLAG_IDLE record is not one retirement but the iterations of an idle
+loop credited while fetch slept through it (Pipeline.sleep()): cycle is
+when the sleep began, pc and word the loop's branch/jump, value the
+iteration count and mem_data the cycles skipped.
+
+Stream layout: a header (HEADER_FORMAT: magic, version, record size,
+stream flags), then frames of a u32 payload length and the payload: a
+chunk of records, zlib-compressed when the stream flag STREAM_COMPRESSED
+is set. Traces go to a file (host memory stays flat however long the run)
+or, without a target, to an in-memory list of compressed chunks. The
+stream handling lives in ChunkedTrace, shared with the stage-occupancy
+trace (stage_trace.py), which uses the same layout with its own magic
+and record format.
+
+Example:
+    trace = processor.enable_retire_trace('run.rvrt')
+    processor.execute_from_memory(entry, max_cycles=10**7, verbose=False)
+    trace.close()
+    for record in read_retire_trace('run.rvrt'):
+        ...
+"""
+
+import struct
+import zlib
+from collections import namedtuple
+
+from instruction import Opcode, LOAD_OPCODES, STORE_OPCODES
+
+MAGIC = b'RVRT'
+VERSION = 1
+HEADER_FORMAT = '<4sHHI'
+RECORD_FORMAT = '<QIIIIIBBH'
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+STREAM_COMPRESSED = 0x1
+
+# Record flags
+FLAG_RD = 0x1      # value was written to rd (x1-x31)
+FLAG_LOAD = 0x2
+FLAG_STORE = 0x4
+FLAG_TRAP = 0x8    # The instruction raised an exception (cause)
+FLAG_IDLE = 0x10   # Skipped idle-loop iterations (value) over mem_data cycles
+
+# Store opcode -> mask of the bytes it writes
+STORE_MASKS = {Opcode.SB: 0xFF, Opcode.SH: 0xFFFF}
+
+RetireRecord = namedtuple('RetireRecord', ['cycle', 'pc', 'word', 'value', 'mem_address', 'mem_data',
+                                           'rd', 'flags', 'cause'])
+
+
+class ChunkedTrace:
+    """Sink packing fixed-width records and writing them out in chunks
+
+    Subclasses set MAGIC, VERSION, RECORD_FORMAT and RECORD_TYPE (the
+    namedtuple records read back as) and pack records from their own hooks
+    with _append(). The stream layout is the one described above.
+    """
+
+    MAGIC = MAGIC
+    VERSION = VERSION
+    RECORD_FORMAT = RECORD_FORMAT
+    RECORD_TYPE = None
+
+    def __init__(self, target=None, compress=True, chunk_records=8192):
+        """
+        Args:
+            target: Path or binary file object to stream to (None: keep the
+                    compressed chunks in memory, see chunks)
+            compress: zlib-compress each chunk
+            chunk_records: Records packed before a chunk is written out
+        """
+        self.compress = compress
+        self.chunk_records = chunk_records
+        self.chunks = []      # Chunk payloads (in-memory traces only)
+        self.count = 0        # Records written so far
+        self._pending = bytearray()
+        self._pending_count = 0
+        self._pack = struct.Struct(self.RECORD_FORMAT).pack
+
+        self.path = None
+        self.stream = None
+        self._owns_stream = False
+        if isinstance(target, str):
+            self.path = target
+            self.stream = open(target, 'wb')
+            self._owns_stream = True
+        elif target is not None:
+            self.stream = target
+        if self.stream is not None:
+            self.stream.write(struct.pack(HEADER_FORMAT, self.MAGIC, self.VERSION,
+                                          struct.calcsize(self.RECORD_FORMAT),
+                                          STREAM_COMPRESSED if compress else 0))
+
+    def _append(self, *fields):
+        """Pack one record"""
+        self._pending += self._pack(*fields)
+        self.count += 1
+        self._pending_count += 1
+        if self._pending_count >= self.chunk_records:
+            self.flush()
+
+    def flush(self):
+        """Write out the records packed so far as a chunk"""
+        if not self._pending_count:
+            return
+        payload = zlib.compress(bytes(self._pending)) if self.compress else bytes(self._pending)
+        if self.stream is not None:
+            self.stream.write(struct.pack('<I', len(payload)))
+            self.stream.write(payload)
+        else:
+            self.chunks.append(payload)
+        self._pending.clear()
+        self._pending_count = 0
+
+    def close(self):
+        """Flush, and close the file if the trace opened it"""
+        self.flush()
+        if self._owns_stream:
+            self.stream.close()
+        elif self.stream is not None:
+            self.stream.flush()
+
+    def __iter__(self):
+        """Iterate over the records of an in-memory trace, or of the file it wrote"""
+        self.flush()
+        if self.stream is None:
+            return _iter_chunks(self.chunks, self.compress, type(self))
+        if self.path is None:
+            raise ValueError("Trace streamed to a file object: read it back with its reader function")
+        if not self.stream.closed:
+            self.stream.flush()
+        return read_trace(self.path, type(self))
+
+    def __len__(self):
+        return self.count
+
+
+class RetireTrace(ChunkedTrace):
+    """Retired-instruction sink writing RECORD_SIZE-byte records in chunks"""
+
+    RECORD_TYPE = RetireRecord
+
+    def __init__(self, target=None, compress=True, chunk_records=8192):
+        """
+        Args:
+            target: Path or binary file object to stream to (None: keep the
+                    compressed chunks in memory, see chunks)
+            compress: zlib-compress each chunk
+            chunk_records: Records packed before a chunk is written out
+        """
+        super().__init__(target, compress, chunk_records)
+        self.registers = None
+
+    def attach(self, pipeline):
+        """Receive a pipeline's retired instructions (see Pipeline.retire)"""
+        pipeline.retire_trace = self
+        self.registers = pipeline.register_file.regs
+
+    def record(self, instruction, cycle):
+        """Append the record of an instruction that has just left WriteBack"""
+        decoded = instruction.decoded
+        opcode = decoded.opcode
+        flags = 0
+        rd = decoded.rd or 0
+        value = mem_address = mem_data = cause = 0
+        if rd:
+            flags = FLAG_RD
+            value = self.registers[rd]
+        if instruction.mem_address is not None:
+            mem_address = instruction.mem_address
+            if opcode in LOAD_OPCODES:
+                flags |= FLAG_LOAD
+                mem_data = instruction.result or 0
+            elif opcode in STORE_OPCODES:
+                flags |= FLAG_STORE
+                mem_data = (instruction.src_values[0] if instruction.src_values else 0) \
+                    & STORE_MASKS.get(opcode, 0xFFFFFFFF)
+        if instruction.trap_info is not None:
+            flags |= FLAG_TRAP
+            cause = instruction.trap_info['cause'] & 0xFFFF
+        self._append(int(cycle), instruction.pc or 0, instruction.word or 0, value,
+                     mem_address, mem_data, rd, flags, cause)
+
+    def idle(self, instruction, cycle, iterations, cycles):
+        """Append the FLAG_IDLE record of the idle loop iterations skipped from cycle"""
+        self._append(int(cycle), instruction.pc or 0, instruction.word or 0, iterations,
+                     0, cycles, 0, FLAG_IDLE, 0)
+
+
+def _iter_chunks(chunks, compressed, trace_class):
+    unpack = struct.Struct(trace_class.RECORD_FORMAT).iter_unpack
+    make = trace_class.RECORD_TYPE._make
+    for payload in chunks:
+        for fields in unpack(zlib.decompress(payload) if compressed else payload):
+            yield make(fields)
+
+
+def iter_payloads(stream, trace_class):
+    """Iterate over the (decompressed) chunk payloads of a trace stream
+
+    Yields:
+        bytes holding whole records in trace_class.RECORD_FORMAT
+
+    Raises:
+        ValueError: If the stream is not a trace_class trace
+    """
+    magic, version, record_size, stream_flags = struct.unpack(
+        HEADER_FORMAT, stream.read(struct.calcsize(HEADER_FORMAT)))
+    if magic != trace_class.MAGIC or version != trace_class.VERSION \
+            or record_size != struct.calcsize(trace_class.RECORD_FORMAT):
+        raise ValueError(f"Not a version {trace_class.VERSION} {trace_class.MAGIC.decode()} trace "
+                         f"(magic {magic!r}, version {version})")
+    compressed = bool(stream_flags & STREAM_COMPRESSED)
+    while True:
+        length = stream.read(4)
+        if not length:
+            return
+        if len(length) < 4:
+            raise ValueError("Truncated trace frame header")
+        payload = stream.read(struct.unpack('<I', length)[0])
+        yield zlib.decompress(payload) if compressed else payload
+
+
+def _iter_frames(stream, trace_class):
+    unpack = struct.Struct(trace_class.RECORD_FORMAT).iter_unpack
+    make = trace_class.RECORD_TYPE._make
+    for payload in iter_payloads(stream, trace_class):
+        for fields in unpack(payload):
+            yield make(fields)
+
+
+def read_trace(source, trace_class):
+    """Iterate over the records of a trace written by a ChunkedTrace subclass
+
+    Args:
+        source: Path, binary file object, or an in-memory trace
+        trace_class: The ChunkedTrace subclass that wrote it
+    """
+    if isinstance(source, ChunkedTrace):
+        yield from source
+    elif isinstance(source, str):
+        with open(source, 'rb') as stream:
+            yield from _iter_frames(stream, trace_class)
+    else:
+        yield from _iter_frames(source, trace_class)
+
+
+def read_retire_trace(source):
+    """Iterate over the records of a retire trace
+
+    Args:
+        source: Path or binary file object holding a trace written by
+                RetireTrace, or an in-memory RetireTrace
+
+    Yields:
+        RetireRecord per retired instruction, in retirement order
+
+    Raises:
+        ValueError: If the stream is not a retire trace
+    """
+    yield from read_trace(source, RetireTrace)
@@ -1,29 +1,73 @@
 """RISC-V Processor - Assembles all components into a complete processor"""
+import struct
 import simpy
 from register_file import RegisterFile
 from memory import Memory
 from exe import EXE
 from pipeline import Pipeline
+from clocked_pipeline import ClockedPipeline
+from functional import FunctionalCore
+from branch_predictor import make_branch_predictor
+from cache import make_cache
+from tracing import TRACE_OFF
+from checkpoint import save_checkpoint, load_checkpoint
+from profiler import Profiler
+from retire_trace import RetireTrace
+from stage_trace import StageTrace
 
 
 class RISCVProcessor:
     """Complete RISC-V processor with pipeline, register file, memory, and ALU"""
     
-    def __init__(self, enable_forwarding=False):
+    MODES = ('pipeline', 'clocked', 'functional')
+    
+    def __init__(self, enable_forwarding=False, mode="pipeline", branch_predictor=None, icache=None,
+                 dcache=None):
         """
         Initialize the RISC-V processor
         
         Args:
-            enable_forwarding: Enable data forwarding (not yet implemented)
+            enable_forwarding: Enable EX->EX and MEM->EX operand bypassing
+                               (only load-use and CSR-read hazards stall)
+            mode: "pipeline" for the cycle-level SimPy model, "clocked" for
+                  the same model advanced by explicit per-cycle ticks (faster,
+                  identical results; execute_from_memory only, execute() runs
+                  on SimPy), "functional" for the fast non-timing interpreter
+                  (execute_from_memory only)
+            branch_predictor: None (flush on every taken branch/jump), a
+                              predictor name ('static', 'btfn', 'bimodal',
+                              'gshare') or a dict of BranchPredictionUnit
+                              arguments; used by execute_from_memory
+            icache: None (no instruction cache), True (default geometry) or
+                    a dict of cache.Cache arguments; fetch misses stall the
+                    pipeline (execute_from_memory in the pipeline modes)
+            dcache: Same for a data cache in front of loads and stores
         """
+        if mode not in self.MODES:
+            raise ValueError(f"Unknown processor mode: {mode!r} (expected one of {self.MODES})")
+        self.mode = mode
+        self.branch_predictor = branch_predictor
+        self.icache = icache
+        self.dcache = dcache
+        
         self.env = simpy.Environment()
-        self.pipeline = Pipeline(self.env, enable_forwarding)
+        self.pipeline = self._make_pipeline(enable_forwarding)
+        
+        # Functional core shares the pipeline's architectural state
+        self.functional = FunctionalCore.from_pipeline(self.pipeline)
         
         # Direct access to hardware components
         self.register_file = self.pipeline.register_file
         self.memory = self.pipeline.memory
         self.exe = self.pipeline.exe
     
+    def _make_pipeline(self, enable_forwarding):
+        pipeline_class = ClockedPipeline if self.mode == 'clocked' else Pipeline
+        return pipeline_class(self.env, enable_forwarding,
+                              predictor=make_branch_predictor(self.branch_predictor),
+                              icache=make_cache('icache', self.icache),
+                              dcache=make_cache('dcache', self.dcache))
+    
     def initialize_registers(self, register_values):
         """
         Initialize registers with specific values
@@ -44,40 +88,181 @@ class RISCVProcessor:
         for addr, value in memory_data.items():
             self.memory.write(addr, value)
     
-    def execute(self, instructions, verbose=True):
+    def execute(self, instructions, verbose=True, max_cycles=None):
         """
         Execute a program (list of instructions)
         
+        The run ends as soon as the last instruction has left the pipeline.
+        
+        Args:
+            instructions: List of instruction words, DecodedInstruction records
+                or assembly strings
+            verbose: Print execution trace (False switches tracing off;
+                     program output such as UART writes is still shown)
+            max_cycles: Cycle limit (None: run until the pipeline drains)
+            
+        Returns:
+            Dictionary with execution results (including 'halt_reason':
+            'drained' or 'max_cycles')
+        """
+        # Quiet runs switch tracing off, so no trace message is ever formatted
+        trace = self.pipeline.trace
+        saved_level = trace.level
+        if not verbose:
+            trace.configure(level=TRACE_OFF)
+        
+        try:
+            results = self.pipeline.run(instructions, max_cycles)
+            cycles = int(self.env.now)
+            retired = self.pipeline.retired_count
+            
+            execution_info = {
+                'completed_instructions': results,
+                'total_cycles': cycles,
+                'stall_count': self.pipeline.stall_count,
+                'bubble_count': self.pipeline.bubble_count,
+                **self._forwarding_info(),
+                'perf_counters': self.pipeline.counters.snapshot(),
+                'halt_reason': self.pipeline.halt_reason,
+                'cpi': cycles / retired if retired else 0,
+                'ipc': retired / cycles if cycles > 0 else 0,
+            }
+            
+            return execution_info
+        finally:
+            trace.configure(level=saved_level)
+    
+    def execute_from_memory(self, entry_pc=None, max_cycles=100000, verbose=True, max_instret=None,
+                            breakpoints=(), halt_on=(), tohost=None):
+        """
+        Execute the program loaded in memory, fetching at the real PC
+        
         Args:
-            instructions: List of instruction strings
+            entry_pc: Address of the first instruction (default: current PC)
+            max_cycles: Cycle limit for the run (instructions in functional mode)
             verbose: Print execution trace
+            max_instret: Retired instruction limit (None: no limit)
+            breakpoints: PCs to stop before (one at the entry PC is ignored)
+            halt_on: Subset of ('ecall', 'ebreak') that stop instead of trapping
+            tohost: Address whose store ends the run (None: disabled)
             
         Returns:
-            Dictionary with execution results
+            Dictionary with execution results, including 'halt_reason'
+            (see Pipeline.run_from_memory), 'tohost_value', 'idle_cycles'
+            (part of total_cycles skipped while the core idled) and 'caches'
+            (per-cache hits, misses and MPKI; None without caches)
         """
+        # Quiet runs switch tracing off, so no trace message is ever formatted
+        trace = self.pipeline.trace
+        saved_level = trace.level
         if not verbose:
-            # Suppress output by temporarily redirecting
-            import sys
-            from io import StringIO
-            old_stdout = sys.stdout
-            sys.stdout = StringIO()
+            trace.configure(level=TRACE_OFF)
         
         try:
-            results = self.pipeline.run(instructions)
+            if self.mode == 'functional':
+                return self._execute_functional(entry_pc, max_cycles, max_instret, breakpoints, halt_on, tohost)
+            
+            idle_start = self.pipeline.idle_cycles
+            results = self.pipeline.run_from_memory(entry_pc, max_cycles, max_instret,
+                                                    breakpoints, halt_on, tohost)
+            retired = self.pipeline.retired_count
             
             execution_info = {
                 'completed_instructions': results,
+                'instructions_retired': retired,
                 'total_cycles': self.env.now,
                 'stall_count': self.pipeline.stall_count,
                 'bubble_count': self.pipeline.bubble_count,
-                'cpi': self.env.now / len(results) if results else 0,
-                'ipc': len(results) / self.env.now if self.env.now > 0 else 0,
+                'flush_count': self.pipeline.flush_count,
+                **self._forwarding_info(),
+                'branch_prediction': self.pipeline.predictor.get_stats() if self.pipeline.predictor else None,
+                'caches': self.pipeline.caches.get_stats(retired) if self.pipeline.caches else None,
+                'perf_counters': self.pipeline.counters.snapshot(),
+                'halt_reason': self.pipeline.halt_reason,
+                'tohost_value': self.pipeline.tohost_value,
+                'idle_cycles': self.pipeline.idle_cycles - idle_start,
+                'cpi': self.env.now / retired if retired else 0,
+                'ipc': retired / self.env.now if self.env.now > 0 else 0,
             }
             
             return execution_info
         finally:
-            if not verbose:
-                sys.stdout = old_stdout
+            trace.configure(level=saved_level)
+    
+    def _forwarding_info(self):
+        """Bypass network counters (zero unless forwarding is enabled)"""
+        return {
+            'forward_ex_count': self.pipeline.forward_ex_count,
+            'forward_mem_count': self.pipeline.forward_mem_count,
+            'load_use_stalls': self.pipeline.load_use_stalls,
+        }
+    
+    def _execute_functional(self, entry_pc, max_cycles, max_instret=None, breakpoints=(), halt_on=(),
+                            tohost=None):
+        """Run the functional core (one cycle per instruction)"""
+        if entry_pc is not None:
+            self.register_file.write_pc(entry_pc)
+        core = self.functional
+        start_cycles, start_instret, start_idle = core.cycles, core.instret, core.idle_cycles
+        
+        halt_reason = core.run(max_instructions=max_cycles,
+                               stop_instret=None if max_instret is None else start_instret + max_instret,
+                               breakpoints=breakpoints, halt_on=halt_on, tohost=tohost)
+        halt_reason = {'max_instructions': 'max_cycles', 'stop_instret': 'max_instret'}.get(halt_reason, halt_reason)
+        
+        cycles = core.cycles - start_cycles
+        retired = core.instret - start_instret
+        return {
+            'completed_instructions': [],  # No per-instruction records in functional mode
+            'instructions_retired': retired,
+            'total_cycles': cycles,
+            'stall_count': 0,
+            'bubble_count': 0,
+            'flush_count': 0,
+            'forward_ex_count': 0,
+            'forward_mem_count': 0,
+            'load_use_stalls': 0,
+            'branch_prediction': None,
+            'caches': None,  # Timing only: no cache model without the pipeline
+            'perf_counters': None,  # Pipeline events only; cycles/instret are above
+            'halt_reason': halt_reason,
+            'tohost_value': core.tohost_value,
+            'idle_cycles': core.idle_cycles - start_idle,
+            'cpi': cycles / retired if retired else 0,
+            'ipc': retired / cycles if cycles else 0,
+        }
+    
+    def fast_forward(self, stop_pc=None, stop_instret=None, max_instructions=None):
+        """
+        Run the functional core to a point of interest, leaving the state there
+        
+        Whatever the processor mode, a following pipelined
+        execute_from_memory() (with entry_pc=None) continues from the stop
+        point with the same registers, memory, CSRs and CLINT time.
+        
+        Args:
+            stop_pc: Stop before executing the instruction at this PC
+            stop_instret: Stop once this many instructions have retired
+            max_instructions: Instruction budget
+            
+        Returns:
+            Halt reason ('stop_pc', 'stop_instret', 'max_instructions', 'self_loop')
+        """
+        return self.functional.run(max_instructions=max_instructions, stop_pc=stop_pc,
+                                   stop_instret=stop_instret)
+    
+    def save_checkpoint(self, path):
+        """Save the architectural machine state to a checkpoint file (see checkpoint.py)"""
+        save_checkpoint(self, path)
+    
+    def load_checkpoint(self, path):
+        """
+        Restore the machine state saved by save_checkpoint()
+        
+        execute_from_memory() (with entry_pc=None) or fast_forward() then
+        continues from the checkpointed PC.
+        """
+        load_checkpoint(self, path)
     
     def get_register(self, reg_name):
         """Get value of a specific register"""
@@ -93,26 +278,89 @@ class RISCVProcessor:
     
     def get_memory_state(self):
         """Get all memory contents (word-addressed for compatibility)"""
-        # For backward compatibility, return word-addressed memory like before
+        # For backward compatibility, return word-addressed memory like before.
+        # Only allocated pages can hold non-zero data.
         mem_dict = {}
-        # Scan through memory and extract non-zero words
-        for word_addr in range(0, self.memory.size // 4):
-            byte_addr = word_addr * 4
-            try:
-                value = self.memory.read_word(byte_addr)
+        for page_address, page in self.memory.iter_pages():
+            for index, (value,) in enumerate(struct.iter_unpack('<I', page)):
                 if value != 0:
-                    mem_dict[word_addr] = value
-            except:
-                pass
+                    mem_dict[page_address // 4 + index] = value
         return mem_dict
     
+    def enable_profiler(self, functions=()):
+        """
+        Profile the pipeline's retired instructions by PC and function
+        
+        Args:
+            functions: Function symbols as (address, size, name), e.g.
+                       ELFTestLoader.functions after load_into()
+            
+        Returns:
+            The attached profiler.Profiler (reports: flat_report(),
+            call_graph_report(), collapsed_stacks())
+        """
+        profiler = Profiler(functions)
+        profiler.attach(self.pipeline)
+        return profiler
+    
+    def enable_retire_trace(self, target=None, compress=True, keep_instructions=False):
+        """
+        Stream the pipeline's retired instructions as fixed-width binary records
+        
+        Args:
+            target: Path or binary file object (None: compressed chunks kept
+                    in memory)
+            compress: zlib-compress the record chunks
+            keep_instructions: Also keep the Instruction objects in
+                               'completed_instructions' (off, so that host
+                               memory stays flat however long the run)
+            
+        Returns:
+            The attached retire_trace.RetireTrace (iterate it, or read the
+            file back with retire_trace.read_retire_trace(); close() it to
+            flush the last records)
+        
+        Without a trace, setting pipeline.keep_retired = False keeps counts
+        only ('instructions_retired' and the perf counters).
+        """
+        trace = RetireTrace(target, compress)
+        trace.attach(self.pipeline)
+        self.pipeline.keep_retired = keep_instructions
+        return trace
+    
+    def enable_stage_trace(self, target=None, compress=True):
+        """
+        Record when every instruction entered each pipeline stage (pipeline modes)
+        
+        Args:
+            target: Path or binary file object (None: compressed chunks kept
+                    in memory)
+            compress: zlib-compress the record chunks
+            
+        Returns:
+            The attached stage_trace.StageTrace (read a window of it back with
+            stage_trace.read_stage_trace(), draw or export it with
+            pipeview.py; close() it to write the last records)
+        """
+        trace = StageTrace(target, compress)
+        trace.attach(self.pipeline)
+        return trace
+    
+    def get_perf_counters(self):
+        """Get a snapshot of the pipeline's HPM event counters
+        
+        Snapshots subtract: after - before gives the events in between.
+        """
+        return self.pipeline.counters.snapshot()
+    
     def reset(self):
         """Reset the processor to initial state"""
         self.env = simpy.Environment()
-        self.pipeline = Pipeline(self.env)
+        self.pipeline = self._make_pipeline(self.pipeline.enable_forwarding)
+        self.functional = FunctionalCore.from_pipeline(self.pipeline)
         self.register_file = self.pipeline.register_file
         self.memory = self.pipeline.memory
-        self.alu = self.pipeline.alu
+        self.exe = self.pipeline.exe
 
 
 def run_program(instructions, initial_registers=None, initial_memory=None, verbose=True):
@@ -17,6 +17,8 @@ sys.path.insert(0, str(Path(__file__).parent / 'utils'))
 
 from elf_loader import ELFTestLoader, RISCVDecoder
 from riscv import RISCVProcessor
+from branch_predictor import DIRECTION_PREDICTORS
+from instruction import Opcode, decode_instruction_word
 import simpy
 
 
@@ -29,27 +31,27 @@ def load_elf_to_memory(elf_path, processor):
         processor: RISCVProcessor instance
         
     Returns:
-        entry_point: Entry point address from ELF
+        Tuple of (entry_point, loader); loader.symbols is the ELF symbol table
     """
     print(f"Loading ELF file: {elf_path}")
     loader = ELFTestLoader(elf_path)
     
-    # Load ELF into memory dictionary
-    memory_dict, entry_point = loader.load()
+    # Copy each PT_LOAD segment straight into the simulator's memory pages
+    entry_point, symbols = loader.load_into(processor.memory)
     
     print(f"  Entry point: 0x{entry_point:08x}")
-    print(f"  Loaded {len(memory_dict)} bytes into memory")
-    
-    # Copy memory into simulator's byte-addressed memory
-    for addr, value in memory_dict.items():
-        processor.memory.data[addr] = value
+    print(f"  Loaded {processor.memory.get_stats()['pages_dirty']} pages, {len(symbols)} symbols")
     
     return entry_point, loader
 
 
 def decode_instructions_from_memory(processor, start_pc, max_instructions=50000):
     """
-    Decode instructions from memory starting at PC
+    Decode instructions from memory starting at PC (listing only)
+    
+    The simulator fetches from memory as it runs, so this is only used to
+    show the straight-line code at the entry point. Words are decoded straight into DecodedInstruction records with bit
+    masks; no assembly text is generated and re-parsed.
     
     Args:
         processor: RISCVProcessor with loaded memory
@@ -57,7 +59,7 @@ def decode_instructions_from_memory(processor, start_pc, max_instructions=50000)
         max_instructions: Maximum number of instructions to decode
         
     Returns:
-        List of decoded instruction strings
+        List of DecodedInstruction records
     """
     instructions = []
     pc = start_pc
@@ -70,13 +72,13 @@ def decode_instructions_from_memory(processor, start_pc, max_instructions=50000)
             word = processor.memory.read_word(pc)
             
             # Decode instruction
-            instr_str = RISCVDecoder.decode(word)
+            decoded = decode_instruction_word(word)
             
-            if instr_str is None:
+            if decoded.opcode == Opcode.UNKNOWN:
                 print(f"  WARNING: Failed to decode instruction at 0x{pc:08x}: 0x{word:08x}")
                 break
             
-            instructions.append(instr_str)
+            instructions.append(decoded)
             pc += 4
             
             # Stop at ECALL or infinite loop (common end patterns)
@@ -101,7 +103,7 @@ def print_first_instructions(instructions, count=20):
     """Print first N instructions"""
     print(f"\nFirst {min(count, len(instructions))} instructions:")
     for i, instr in enumerate(instructions[:count]):
-        print(f"  [{i:4d}] {instr}")
+        print(f"  [{i:4d}] {instr.text}")
     if len(instructions) > count:
         print(f"  ... ({len(instructions) - count} more instructions)")
 
@@ -127,8 +129,9 @@ def dump_memory_to_file(processor, filename="memory_dump.txt", max_addr=0x20000)
         in_region = False
         region_start = 0
         
+        contents = processor.memory.read_bytes(0, max_addr)
         for addr in range(0, max_addr):
-            byte_val = processor.memory.data[addr]
+            byte_val = contents[addr]
             if byte_val != 0:
                 if not in_region:
                     region_start = addr
@@ -175,7 +178,7 @@ def dump_memory_to_file(processor, filename="memory_dump.txt", max_addr=0x20000)
                         hex_bytes.append("  ")
                         ascii_chars.append(" ")
                     else:
-                        byte_val = processor.memory.data[byte_addr]
+                        byte_val = contents[byte_addr]
                         hex_bytes.append(f"{byte_val:02x}")
                         # ASCII representation
                         if 32 <= byte_val <= 126:
@@ -218,7 +221,9 @@ def dump_memory_to_file(processor, filename="memory_dump.txt", max_addr=0x20000)
         print(f"  Total data size: {total_bytes} bytes")
 
 
-def run_freertos(elf_path, max_cycles=100000, verbose=True):
+def run_freertos(elf_path, max_cycles=100000, verbose=True, mode="pipeline", fast_forward=0,
+                 branch_predictor=None, max_instret=None, breakpoints=(), halt_on=(),
+                 profile=False, profile_folded=None, retire_trace=None, stage_trace=None):
     """
     Run FreeRTOS ELF on simulator
     
@@ -226,20 +231,38 @@ def run_freertos(elf_path, max_cycles=100000, verbose=True):
         elf_path: Path to FreeRTOS ELF file
         max_cycles: Maximum simulation cycles
         verbose: Print detailed execution trace
+        mode: "pipeline" (cycle-level), "clocked" (cycle-level, faster) or
+              "functional" (fast, no timing)
+        fast_forward: Instructions to run on the functional core before
+                      handing the state to the selected mode
+        branch_predictor: Branch predictor name (None: no prediction)
+        max_instret: Retired instruction limit (None: no limit)
+        breakpoints: PCs to stop before
+        halt_on: Subset of ('ecall', 'ebreak') that end the run instead of trapping
+        profile: Print flat and call-graph profiles by ELF function (pipeline mode)
+        profile_folded: Write collapsed call stacks for flamegraph.pl to this path
+        retire_trace: Stream retired instructions to this path as binary
+                      records (see retire_trace.py); pipeline modes
+        stage_trace: Stream each instruction's stage entry cycles to this
+                     path (see stage_trace.py, pipeview.py); pipeline modes
+    
+    A store to the ELF's tohost symbol, if it has one, also ends the run.
     """
     print("=" * 70)
     print("FreeRTOS RISC-V Simulator")
     print("=" * 70)
     
     # Create processor
-    processor = RISCVProcessor(enable_forwarding=False)
+    processor = RISCVProcessor(enable_forwarding=False, mode=mode, branch_predictor=branch_predictor)
     
     # Load ELF file
     entry_point, loader = load_elf_to_memory(elf_path, processor)
     
-    # Initialize stack pointer (from linker script: top of RAM)
-    # FreeRTOS uses _stack_start symbol, which should be at RAM_BASE + RAM_SIZE
-    stack_pointer = 0x100000  # 1MB (end of RAM defined in linker.ld)
+    # Initialize stack pointer from the linker script's _stack_start symbol
+    # (RAM_BASE + RAM_SIZE), falling back to the top of the RAM holding the entry point
+    stack_pointer = loader.symbols.get('_stack_start')
+    if stack_pointer is None:
+        stack_pointer = processor.memory.find_region(entry_point).end
     processor.register_file.write('R2', stack_pointer)  # R2 = sp
     print(f"\nInitialized stack pointer: 0x{stack_pointer:08x}")
     
@@ -247,8 +270,8 @@ def run_freertos(elf_path, max_cycles=100000, verbose=True):
     processor.register_file.write_pc(entry_point)
     print(f"Set PC to entry point: 0x{entry_point:08x}")
     
-    # Decode instructions from memory
-    instructions = decode_instructions_from_memory(processor, entry_point, max_instructions=50000)
+    # Decode the first few instructions for the listing (execution fetches from memory)
+    instructions = decode_instructions_from_memory(processor, entry_point, max_instructions=30)
     
     if not instructions:
         print("\nERROR: No instructions decoded!")
@@ -275,19 +298,64 @@ def run_freertos(elf_path, max_cycles=100000, verbose=True):
     print("-" * 70)
     
     try:
-        # Execute with verbose output
-        results = processor.execute(instructions, verbose=verbose)
+        # Skip boot code on the functional core, then continue from where it stopped
+        entry_pc = entry_point
+        if fast_forward:
+            reason = processor.fast_forward(max_instructions=fast_forward)
+            entry_pc = None
+            print(f"Fast-forwarded {processor.functional.instret} instructions ({reason}), "
+                  f"PC = 0x{processor.register_file.read_pc():08x}")
+        
+        profiler = None
+        if profile or profile_folded:
+            profiler = processor.enable_profiler(loader.functions)
+        
+        # Long runs: keep counts (and the optional trace file), not every retired instruction
+        processor.pipeline.keep_retired = False
+        trace = processor.enable_retire_trace(retire_trace) if retire_trace else None
+        stages = processor.enable_stage_trace(stage_trace) if stage_trace else None
+        
+        # Execute from memory, following branches, jumps and trap handlers
+        results = processor.execute_from_memory(entry_pc, max_cycles=max_cycles, verbose=verbose,
+                                                max_instret=max_instret, breakpoints=breakpoints,
+                                                halt_on=halt_on, tohost=loader.symbols.get('tohost'))
+        if trace is not None:
+            trace.close()
+        if stages is not None:
+            stages.close()
         
         print("-" * 70)
         print("\n" + "=" * 70)
         print("Simulation Complete")
         print("=" * 70)
         print(f"Total cycles:              {results['total_cycles']}")
-        print(f"Instructions completed:    {results['completed_instructions']}")
+        print(f"Halt reason:               {results['halt_reason']}")
+        if results['tohost_value'] is not None:
+            print(f"tohost value:              0x{results['tohost_value']:08x}")
+        print(f"Instructions completed:    {results['instructions_retired']}")
+        print(f"Idle cycles skipped:       {results['idle_cycles']}")
+        if trace is not None:
+            print(f"Retire trace:              {trace.count} records written to {retire_trace}")
+        if stages is not None:
+            print(f"Stage trace:               {stages.count} records written to {stage_trace}")
         print(f"Stalls:                    {results['stall_count']}")
         print(f"Bubbles:                   {results['bubble_count']}")
         print(f"CPI (Cycles per Instr):    {results['cpi']:.2f}")
         print(f"IPC (Instr per Cycle):     {results['ipc']:.2f}")
+        prediction = results['branch_prediction']
+        if prediction:
+            print(f"Branch predictor:          {prediction['predictor']} "
+                  f"({prediction['accuracy']:.1%} correct, BTB hit rate {prediction['btb_hit_rate']:.1%})")
+            print(f"Flush cycles saved (est.): {prediction['flush_cycles_saved_estimate']}")
+        
+        if profiler is not None:
+            if profile:
+                print("\n" + "=" * 70)
+                print(profiler.flat_report())
+                print("\n" + profiler.call_graph_report())
+            if profile_folded:
+                profiler.write_collapsed(profile_folded)
+                print(f"\nCollapsed stacks written to {profile_folded} (flamegraph.pl input)")
         
         # Show final register state
         print("\n" + "=" * 70)
@@ -314,8 +382,28 @@ if __name__ == "__main__":
                        help='Path to FreeRTOS ELF file')
     parser.add_argument('--max-cycles', type=int, default=100000,
                        help='Maximum simulation cycles (default: 100000)')
+    parser.add_argument('--max-instret', type=int, default=None, metavar='N',
+                       help='Stop after N retired instructions')
+    parser.add_argument('--break', dest='breakpoints', type=lambda text: int(text, 0), action='append',
+                       default=[], metavar='PC', help='Stop before the instruction at PC (repeatable)')
+    parser.add_argument('--halt-on', choices=('ecall', 'ebreak'), action='append', default=[],
+                       help='End the run at ECALL/EBREAK instead of trapping (repeatable)')
+    parser.add_argument('--profile', action='store_true',
+                       help='Print flat and call-graph profiles by ELF function')
+    parser.add_argument('--profile-folded', metavar='FILE', default=None,
+                       help='Write collapsed call stacks (flamegraph.pl input) to FILE')
+    parser.add_argument('--retire-trace', metavar='FILE', default=None,
+                       help='Stream retired instructions to FILE as binary records')
+    parser.add_argument('--stage-trace', metavar='FILE', default=None,
+                       help='Stream per-stage timing to FILE (draw or export it with pipeview.py)')
     parser.add_argument('--quiet', action='store_true',
                        help='Suppress detailed execution trace')
+    parser.add_argument('--mode', choices=RISCVProcessor.MODES, default='pipeline',
+                       help='Simulation engine (default: pipeline)')
+    parser.add_argument('--fast-forward', type=int, default=0, metavar='N',
+                       help='Run the first N instructions on the functional core')
+    parser.add_argument('--predictor', choices=tuple(DIRECTION_PREDICTORS), default=None,
+                       help='Branch predictor for the pipeline fetch engine (default: none)')
     
     args = parser.parse_args()
     
@@ -329,4 +417,8 @@ if __name__ == "__main__":
                 print(f"  {f}")
         sys.exit(1)
     
-    run_freertos(args.elf_file, max_cycles=args.max_cycles, verbose=not args.quiet)
+    run_freertos(args.elf_file, max_cycles=args.max_cycles, verbose=not args.quiet,
+                 mode=args.mode, fast_forward=args.fast_forward, branch_predictor=args.predictor,
+                 max_instret=args.max_instret, breakpoints=args.breakpoints, halt_on=args.halt_on,
+                 profile=args.profile, profile_folded=args.profile_folded,
+                 retire_trace=args.retire_trace, stage_trace=args.stage_trace)
@@ -0,0 +1,26 @@
+#!/bin/bash
+# Run the functional test modules and riscv-tests over a process pool
+#
+# Usage:
+#   ./scripts/run_parallel_tests.sh              # Everything, one worker per core
+#   ./scripts/run_parallel_tests.sh -j 16        # Sixteen workers
+#   ./scripts/run_parallel_tests.sh --unit-only  # Only tests/functional_tests modules
+
+set -e  # Exit on error
+
+# Get the directory where this script is located
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_DIR="$(dirname "$SCRIPT_DIR")"
+
+cd "$PROJECT_DIR"
+
+# Activate virtual environment
+if [ -f "pysim-venv/bin/activate" ]; then
+    source pysim-venv/bin/activate
+else
+    echo "Error: Virtual environment not found at pysim-venv/"
+    echo "Please run: python3 -m venv pysim-venv && source pysim-venv/bin/activate && pip install -r requirements.txt"
+    exit 1
+fi
+
+python tests/parallel_runner.py "$@"
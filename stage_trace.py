@@ -0,0 +1,222 @@
+"""Stage-occupancy trace: the cycle every instruction entered each pipeline stage
+
+A StageTrace attached to a pipeline (either engine, memory or list-fed
+runs) follows each dynamic instruction from Fetch to WriteBack and packs
+one fixed-width record for it once it leaves the pipeline, retired or
+squashed. Records are written in fetch order, in chunks, in the same
+stream layout as the retire trace (retire_trace.ChunkedTrace) with magic
+b'RVST', so a long run can be traced to a file and a window of it read
+back and drawn later (pipeview.py) without simulating it again.
+
+Record layout (little-endian, RECORD_FORMAT):
+    fetch     u64  Cycle the instruction entered Fetch
+    pc        u32  Address it was fetched from (0 for list-fed programs)
+    word      u32  Instruction word (0 for list-fed programs)
+    decode    u32  Cycles after fetch it reached Decode
+    execute   u32  ... Execute (a hazard stall is spent in Decode before it)
+    memory    u32  ... Memory
+    writeback u32  ... WriteBack
+    end       u32  ... it left the pipeline (retired, or squashed by a flush)
+    flags     u8   FLAG_* bits
+Stages an instruction never reached are NOT_REACHED; so is the end of an
+instruction still in the pipeline when the trace is closed. A FLAG_IDLE
+record stands for an idle loop fetch slept through (Pipeline.sleep()):
+the loop's branch/jump, held in Fetch from the cycle the sleep began for
+end cycles.
+
+Example:
+    trace = processor.enable_stage_trace('run.rvst')
+    processor.execute_from_memory(entry, max_cycles=10**7, verbose=False)
+    trace.close()
+    for record in read_stage_trace('run.rvst', start_cycle=5000000, end_cycle=5000200):
+        ...
+"""
+
+import struct
+import zlib
+from collections import namedtuple, deque
+
+from retire_trace import ChunkedTrace, iter_payloads
+
+MAGIC = b'RVST'
+VERSION = 1
+RECORD_FORMAT = '<QIIIIIIIB3x'
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+NOT_REACHED = 0xFFFFFFFF
+
+# Record flags
+FLAG_RETIRED = 0x1
+FLAG_SQUASHED = 0x2
+FLAG_TRAP = 0x4    # Retired after raising an exception
+FLAG_IDLE = 0x8    # Not an instruction: the iterations of an idle loop skipped
+
+# Short stage names, in pipeline order, and the index of each PipelineStage.name
+STAGES = ('IF', 'ID', 'EX', 'MEM', 'WB')
+STAGE_INDEX = {'Fetch': 0, 'Decode': 1, 'Execute': 2, 'Memory': 3, 'WriteBack': 4}
+
+# Instructions waiting behind an older one that has not left the pipeline;
+# past this the oldest is given up on (left in flight by an earlier run)
+MAX_WAITING = 64
+
+
+class StageRecord(namedtuple('StageRecord', ['fetch', 'pc', 'word', 'decode', 'execute', 'memory',
+                                             'writeback', 'end', 'flags'])):
+    """One instruction's trip through the pipeline (offsets relative to fetch)"""
+
+    __slots__ = ()
+
+    def stage_cycles(self):
+        """Get the cycle each stage was entered, in STAGES order (None: never reached)"""
+        fetch = self.fetch
+        return (fetch,) + tuple(None if offset == NOT_REACHED else fetch + offset
+                                for offset in (self.decode, self.execute, self.memory, self.writeback))
+
+    @property
+    def end_cycle(self):
+        """Cycle the instruction left the pipeline (None: still in it)"""
+        return None if self.end == NOT_REACHED else self.fetch + self.end
+
+    @property
+    def stall_cycles(self):
+        """Cycles Decode held the instruction for a hazard"""
+        if self.decode == NOT_REACHED or self.execute == NOT_REACHED:
+            return 0
+        return self.execute - self.decode - 1
+
+
+class StageTrace(ChunkedTrace):
+    """Stage-occupancy sink writing RECORD_SIZE-byte records in fetch order"""
+
+    MAGIC = MAGIC
+    VERSION = VERSION
+    RECORD_FORMAT = RECORD_FORMAT
+    RECORD_TYPE = StageRecord
+
+    def __init__(self, target=None, compress=True, chunk_records=8192):
+        """
+        Args:
+            target: Path or binary file object to stream to (None: keep the
+                    compressed chunks in memory, see chunks)
+            compress: zlib-compress each chunk
+            chunk_records: Records packed before a chunk is written out
+        """
+        super().__init__(target, compress, chunk_records)
+        # Instructions in the pipeline: id -> [fetch, pc, word, decode, execute,
+        # memory, writeback, end, flags] (absolute cycles), and entries in fetch order
+        self._entries = {}
+        self._order = deque()
+
+    def attach(self, pipeline):
+        """Follow a pipeline's instructions (see Pipeline.stage_runner and ClockedPipeline.tick)"""
+        pipeline.stage_trace = self
+
+    def enter(self, stage_name, instruction, cycle):
+        """Note an instruction arriving in a stage (PipelineStage.name)"""
+        index = STAGE_INDEX[stage_name]
+        if index == 0:
+            entry = [int(cycle), instruction.pc or 0, instruction.word or 0, None, None, None, None, None, 0]
+            self._entries[id(instruction)] = entry
+            self._order.append(entry)
+            if len(self._order) > MAX_WAITING:
+                self._write(self._order.popleft())
+                self._drain()
+        else:
+            entry = self._entries.get(id(instruction))
+            if entry is not None:
+                entry[2 + index] = int(cycle)
+
+    def retire(self, instruction, cycle):
+        """Note an instruction leaving WriteBack"""
+        self._leave(instruction, cycle, FLAG_RETIRED | (FLAG_TRAP if instruction.trap_info is not None else 0))
+
+    def squash(self, instruction, cycle):
+        """Note a wrong-path instruction being dropped"""
+        self._leave(instruction, cycle, FLAG_SQUASHED)
+
+    def idle(self, instruction, cycle, cycles):
+        """Note fetch sleeping through an idle loop for cycles from cycle"""
+        cycle = int(cycle)
+        self._order.append([cycle, instruction.pc or 0, instruction.word or 0, None, None, None, None,
+                            cycle + cycles, FLAG_IDLE])
+        self._drain()
+
+    def _leave(self, instruction, cycle, flags):
+        entry = self._entries.pop(id(instruction), None)
+        if entry is None:
+            return
+        entry[7] = int(cycle)
+        entry[8] = flags
+        self._drain()
+
+    def _drain(self):
+        """Write out the oldest instructions once they have left the pipeline"""
+        order = self._order
+        while order and order[0][7] is not None:
+            self._write(order.popleft())
+
+    def _write(self, entry):
+        fetch = entry[0]
+        self._append(fetch, entry[1], entry[2],
+                     *[NOT_REACHED if cycle is None else cycle - fetch for cycle in entry[3:8]], entry[8])
+
+    def close(self):
+        """Write out the instructions still in the pipeline, then flush and close"""
+        while self._order:
+            self._write(self._order.popleft())
+        self._entries.clear()
+        super().close()
+
+
+def _raw_records(source):
+    """Iterate over a stage trace's records as plain tuples"""
+    unpack = struct.Struct(RECORD_FORMAT).iter_unpack
+    if isinstance(source, StageTrace):
+        source.flush()
+        if source.stream is None:
+            for payload in source.chunks:
+                yield from unpack(zlib.decompress(payload) if source.compress else payload)
+            return
+        if source.path is None:
+            raise ValueError("Stage trace streamed to a file object: read that back instead")
+        if not source.stream.closed:
+            source.stream.flush()
+        source = source.path
+    if isinstance(source, str):
+        with open(source, 'rb') as stream:
+            for payload in iter_payloads(stream, StageTrace):
+                yield from unpack(payload)
+    else:
+        for payload in iter_payloads(source, StageTrace):
+            yield from unpack(payload)
+
+
+def read_stage_trace(source, start_cycle=None, end_cycle=None, pcs=None):
+    """Iterate over the records of a stage trace, optionally a window of it
+
+    Records are in fetch order, so reading stops at the first instruction
+    fetched at or after end_cycle.
+
+    Args:
+        source: Path or binary file object holding a trace written by
+                StageTrace, or an in-memory StageTrace
+        start_cycle: Skip instructions that left the pipeline before this cycle
+        end_cycle: Stop at instructions fetched at or after this cycle
+        pcs: Only instructions fetched from these addresses
+
+    Yields:
+        StageRecord per instruction in the window
+
+    Raises:
+        ValueError: If the stream is not a stage trace
+    """
+    pcs = frozenset(pcs) if pcs is not None else None
+    make = StageRecord._make
+    for fields in _raw_records(source):
+        fetch = fields[0]
+        if end_cycle is not None and fetch >= end_cycle:
+            return
+        if start_cycle is not None and fields[7] != NOT_REACHED and fetch + fields[7] < start_cycle:
+            continue
+        if pcs is not None and fields[1] not in pcs:
+            continue
+        yield make(fields)
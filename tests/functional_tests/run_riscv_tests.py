@@ -1,6 +1,7 @@
 """Run official RISC-V tests on our simulator using extracted patterns"""
 import sys
 import os
+import pickle
 
 # Add parent directory to path for imports
 sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
@@ -9,6 +10,18 @@ from utils.riscv_test_utils import extract_test_patterns, convert_to_simulator_f
 from tests.functional_tests.riscv_test_adapter import run_extracted_tests
 from riscv import RISCVProcessor
 
+TEST_SOURCE_DIR = "3rd_party/riscv-tests/isa/rv64ui"
+
+BASIC_TESTS = [
+    'add', 'addi', 'sub',
+    'and', 'andi', 'or', 'ori', 'xor', 'xori',
+    'sll', 'slli', 'srl', 'srli', 'sra', 'srai',
+    'slt', 'slti', 'sltu', 'sltiu',
+]
+
+# Converted test cases already parsed by this process, by (path, mtime, size)
+_parsed_tests = {}
+
 def sign_extend_32bit(value):
     """Sign extend to 32-bit value"""
     value = value & 0xFFFFFFFF
@@ -16,9 +29,55 @@ def sign_extend_32bit(value):
         return value | 0xFFFFFFFF00000000
     return value
 
-def run_test_file(test_name):
-    """Run a specific test file"""
-    test_source = f"3rd_party/riscv-tests/isa/rv64ui/{test_name}.S"
+def load_test_cases(test_source, cache_dir=None):
+    """Extract and convert the test patterns of one source file
+    
+    Parsed files are reused within a process, and across runs when
+    cache_dir is given (one pickle per source, keyed on its mtime and size).
+    
+    Args:
+        test_source: Path to the .S test source
+        cache_dir: Directory for the on-disk cache (None: no disk cache)
+        
+    Returns:
+        List of test cases from convert_to_simulator_format
+    """
+    stat = os.stat(test_source)
+    key = (os.path.abspath(test_source), stat.st_mtime_ns, stat.st_size)
+    if key in _parsed_tests:
+        return _parsed_tests[key]
+    
+    cache_path = None
+    if cache_dir:
+        name = os.path.splitext(os.path.basename(test_source))[0]
+        cache_path = os.path.join(cache_dir, f"{name}-{stat.st_mtime_ns}-{stat.st_size}.pickle")
+        try:
+            with open(cache_path, 'rb') as f:
+                _parsed_tests[key] = pickle.load(f)
+                return _parsed_tests[key]
+        except (OSError, EOFError, pickle.UnpicklingError):
+            pass
+    
+    sim_tests = convert_to_simulator_format(extract_test_patterns(test_source))
+    _parsed_tests[key] = sim_tests
+    if cache_path:
+        # Write then rename, so parallel workers never read a partial file
+        os.makedirs(cache_dir, exist_ok=True)
+        temp_path = f"{cache_path}.{os.getpid()}.tmp"
+        with open(temp_path, 'wb') as f:
+            pickle.dump(sim_tests, f)
+        os.replace(temp_path, cache_path)
+    return sim_tests
+
+def run_test_file(test_name, cache_dir=None, source_dir=TEST_SOURCE_DIR):
+    """Run a specific test file
+    
+    Args:
+        test_name: Test source name without extension (e.g. 'add')
+        cache_dir: Directory caching parsed test sources (see load_test_cases)
+        source_dir: Directory holding the riscv-tests sources
+    """
+    test_source = os.path.join(source_dir, f"{test_name}.S")
     
     if not os.path.exists(test_source):
         print(f"Test source not found: {test_source}")
@@ -29,8 +88,7 @@ def run_test_file(test_name):
     print('='*60)
     
     # Extract and convert tests
-    tests = extract_test_patterns(test_source)
-    sim_tests = convert_to_simulator_format(tests)
+    sim_tests = load_test_cases(test_source, cache_dir)
     
     if not sim_tests:
         print(f"No compatible tests found in {test_name}")
@@ -45,12 +103,7 @@ def run_test_file(test_name):
 
 def run_all_basic_tests():
     """Run all basic RV32I instruction tests"""
-    test_files = [
-        'add', 'addi', 'sub',
-        'and', 'andi', 'or', 'ori', 'xor', 'xori',
-        'sll', 'slli', 'srl', 'srli', 'sra', 'srai',
-        'slt', 'slti', 'sltu', 'sltiu',
-    ]
+    test_files = BASIC_TESTS
     
     total_passed = 0
     total_failed = 0
@@ -0,0 +1,98 @@
+"""Tests for the batch/parameter-sweep simulation API"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from batch import run_batch, decode_program, MemoryProgram, ResultTable, METRIC_COLUMNS
+from riscv import RISCVProcessor
+from utils.rv32_encoder import addi, add, branch, load_program, HALT
+
+
+DEPENDENT = [
+    "ADD R1, R2, R3",
+    "SUB R4, R1, R5",
+    "AND R6, R4, R8",
+]
+
+LOOP = [
+    addi(1, 0, 20),              # 0x00: x1 = 20
+    add(2, 2, 1),                # 0x04: loop: x2 += x1
+    addi(1, 1, -1),              # 0x08
+    branch(0x1, 1, 0, -8),       # 0x0c: bne x1, x0, loop
+    HALT,                        # 0x10
+]
+
+
+class TestRunBatch(unittest.TestCase):
+    """Test sweeps return one row per point with the single-run metrics"""
+
+    def test_matches_individual_runs(self):
+        """Test each row equals a fresh RISCVProcessor run of the same point"""
+        states = {'small': {'registers': {'R2': 1, 'R3': 2}}, 'big': {'registers': {'R2': 100}}}
+        configs = [{'name': 'stall'}, {'name': 'fwd', 'enable_forwarding': True}]
+        table = run_batch({'dep': DEPENDENT}, configs, initial_states=states)
+
+        self.assertEqual(len(table), 4)
+        self.assertEqual(table['state'], ['small', 'small', 'big', 'big'])
+        self.assertEqual(table['config'], ['stall', 'fwd', 'stall', 'fwd'])
+        for row in table.rows():
+            processor = RISCVProcessor(enable_forwarding=row['config'] == 'fwd')
+            processor.initialize_registers(states[row['state']]['registers'])
+            info = processor.execute(DEPENDENT, verbose=False)
+            self.assertEqual(row['cycles'], info['total_cycles'])
+            self.assertEqual(row['stall_count'], info['stall_count'])
+            self.assertEqual(row['instructions'], 3)
+        self.assertLess(table.where(config='fwd')['stall_count'][0],
+                        table.where(config='stall')['stall_count'][0])
+
+    def test_memory_program_predictor_sweep(self):
+        """Test MemoryProgram points run from memory with each predictor"""
+        configs = {'none': {}, 'bimodal': {'branch_predictor': 'bimodal'}}
+        table = run_batch([MemoryProgram(LOOP, max_cycles=2000)], configs)
+
+        reference = RISCVProcessor()
+        load_program(reference.memory, LOOP)
+        info = reference.execute_from_memory(0, max_cycles=2000, verbose=False)
+        none = next(table.where(config='none').rows())
+        self.assertEqual(none['cycles'], info['total_cycles'])
+        self.assertEqual(none['flush_count'], info['flush_count'])
+        self.assertEqual(none['instructions'], info['instructions_retired'])
+        self.assertLess(table.where(config='bimodal')['cycles'][0], none['cycles'])
+
+    def test_memory_program_cache_sweep(self):
+        """Test MemoryProgram points pass their cache configuration on"""
+        configs = {'none': {}, 'slow': {'icache': {'size': 16, 'ways': 1, 'line_size': 16, 'miss_latency': 20}}}
+        table = run_batch([MemoryProgram(LOOP, max_cycles=2000)], configs)
+        none, slow = table.where(config='none')['cycles'][0], table.where(config='slow')['cycles'][0]
+        self.assertGreater(slow, none)
+
+    def test_parallel_matches_serial(self):
+        """Test worker processes produce the same table as an in-process run"""
+        programs = {'dep': DEPENDENT, 'loop': MemoryProgram(LOOP, max_cycles=2000)}
+        configs = [{'name': 'base'}, {'name': 'fwd', 'enable_forwarding': True},
+                   {'name': 'slow_timer', 'time_scale': 100}]
+        serial = run_batch(programs, configs)
+        parallel = run_batch(programs, configs, jobs=2)
+        self.assertEqual(parallel.columns, serial.columns)
+        self.assertEqual(serial.column_names[3:], METRIC_COLUMNS)
+
+    def test_unknown_config_key(self):
+        """Test a misspelled configuration key is rejected"""
+        with self.assertRaisesRegex(ValueError, 'forwarding'):
+            run_batch([DEPENDENT], [{'forwarding': True}])
+
+    def test_decode_program_shares_records(self):
+        """Test programs are decoded once into shared records"""
+        decoded = decode_program(["ADDI R1, R0, 5", addi(2, 0, 1)])
+        self.assertEqual(decoded[0].rd, 1)
+        self.assertEqual(decode_program(decoded), decoded)
+        table = ResultTable({'a': [1, 2], 'b': [0.5, 0.25]})
+        self.assertEqual(list(table.rows()), [{'a': 1, 'b': 0.5}, {'a': 2, 'b': 0.25}])
+        self.assertIn('0.250', str(table))
+
+
+if __name__ == '__main__':
+    unittest.main()
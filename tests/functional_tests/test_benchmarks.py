@@ -0,0 +1,99 @@
+"""Tests for the host-side benchmark kernels and baseline comparison"""
+import sys
+import os
+import unittest
+
+# Add parent directory (and benchmarks/) to path for imports
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+sys.path.insert(0, REPO_ROOT)
+sys.path.insert(0, os.path.join(REPO_ROOT, 'benchmarks'))
+
+from kernels import KERNELS, ELF_KERNELS, parse_bench_lines
+from run_benchmarks import run_benchmark, make_report, compare
+from riscv import RISCVProcessor
+
+
+# Small scales keep every kernel to a few hundred instructions
+TEST_SCALES = {'alu_straight': 2, 'dependent_chain': 2, 'branchy_loop': 9, 'memcpy': 10,
+               'clint_interrupts': 3}
+
+
+class TestKernels(unittest.TestCase):
+    """Test every kernel computes its expected result on both engines"""
+
+    def test_kernels_check_out(self):
+        """Test each kernel halts and passes its own result check"""
+        for name, scale in TEST_SCALES.items():
+            for mode in RISCVProcessor.MODES:
+                with self.subTest(kernel=name, mode=mode):
+                    result = run_benchmark(name, mode, scale)
+                    self.assertEqual(result['halt_reason'], 'self_loop')
+                    self.assertGreater(result['instructions'], 0)
+                    self.assertGreaterEqual(result['cycles'], result['instructions'])
+                    self.assertGreater(result['peak_rss_kb'], 0)
+
+    def test_check_detects_wrong_result(self):
+        """Test a kernel check fails when the state is wrong"""
+        kernel = KERNELS['memcpy'](4)
+        processor = RISCVProcessor(mode='functional')
+        entry = kernel.setup(processor)
+        processor.execute_from_memory(entry, verbose=False)
+        processor.memory.write_word(0x10000 + 4 * 4, 0xDEAD)  # Corrupt the copy
+        with self.assertRaises(AssertionError):
+            kernel.check(processor)
+
+    def test_every_kernel_is_tested(self):
+        """Test the table above covers all self-contained kernels"""
+        self.assertEqual(set(TEST_SCALES), set(KERNELS) - {kernel.name for kernel in ELF_KERNELS})
+
+
+class TestGuestBenchmarks(unittest.TestCase):
+    """Test the BENCH lines printed by the freertos_demo benchmark images are parsed and checked"""
+
+    OUTPUT = ("pingpong benchmark: starting scheduler\n"
+              "BENCH name=pingpong_queue iterations=0x000000c8 mcycle_start=0xfffff000 mcycle_end=0x00001000 "
+              "minstret_start=0x00000100 minstret_end=0x00000900 checksum=0x00004e84\n")
+
+    def test_parse(self):
+        """Test fields are parsed as numbers and counter deltas wrap at 32 bits"""
+        reports = parse_bench_lines(self.OUTPUT)
+        self.assertEqual(len(reports), 1)
+        report = reports[0]
+        self.assertEqual((report['name'], report['iterations'], report['checksum']), ('pingpong_queue', 200, 20100))
+        self.assertEqual((report['cycles'], report['instret']), (0x2000, 0x800))
+
+    def guest(self, output, code):
+        processor = RISCVProcessor(mode='functional')
+        kernel = KERNELS['guest_pingpong'](1)
+        kernel.uart = processor.pipeline.uart
+        kernel.uart.capture = True
+        kernel.uart.captured.extend(output.encode())
+        kernel.tohost = 0x400
+        processor.memory.write_word(kernel.tohost, code)
+        kernel.check(processor)
+        return kernel
+
+    def test_check(self):
+        """Test a guest passes only with a report, no self-check failure and the pass exit code"""
+        self.assertEqual(self.guest(self.OUTPUT, 1).reports[0]['name'], 'pingpong_queue')
+        for output, code in ((self.OUTPUT, 3), ("no report\n", 1),
+                             (self.OUTPUT + "BENCH_FAIL name=pingpong_queue code=0x00000001\n", 1)):
+            with self.subTest(output=output, code=code):
+                with self.assertRaises(AssertionError):
+                    self.guest(output, code)
+
+
+class TestBaselineComparison(unittest.TestCase):
+    """Test reports compare point by point on instructions/s"""
+
+    def test_compare(self):
+        def result(kernel, mode, ips):
+            return {'kernel': kernel, 'mode': mode, 'instructions_per_sec': ips}
+        baseline = make_report([result('memcpy', 'functional', 1000.0), result('alu', 'pipeline', 50.0)])
+        current = make_report([result('memcpy', 'functional', 800.0), result('new', 'pipeline', 10.0)])
+        rows = compare(baseline, current)
+        self.assertEqual(rows, [('memcpy/functional', 1000.0, 800.0, 0.8)])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,151 @@
+"""Tests for direct binary decode of RV32I instruction words"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+import simpy
+from pipeline import Pipeline
+from instruction import Instruction, Opcode, decode_instruction_word, parse_instruction_text
+
+
+# Minimal RV32I encoders for building test words
+def r_type(funct7, rs2, rs1, funct3, rd, opcode=0x33):
+    return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode
+
+
+def i_type(imm, rs1, funct3, rd, opcode=0x13):
+    return ((imm & 0xFFF) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode
+
+
+def s_type(imm, rs2, rs1, funct3):
+    imm &= 0xFFF
+    return ((imm >> 5) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((imm & 0x1F) << 7) | 0x23
+
+
+def b_type(imm, rs2, rs1, funct3):
+    imm &= 0x1FFF
+    return (((imm >> 12) & 1) << 31) | (((imm >> 5) & 0x3F) << 25) | (rs2 << 20) | (rs1 << 15) | \
+           (funct3 << 12) | (((imm >> 1) & 0xF) << 8) | (((imm >> 11) & 1) << 7) | 0x63
+
+
+def j_type(imm, rd):
+    imm &= 0x1FFFFF
+    return (((imm >> 20) & 1) << 31) | (((imm >> 1) & 0x3FF) << 21) | (((imm >> 11) & 1) << 20) | \
+           (((imm >> 12) & 0xFF) << 12) | (rd << 7) | 0x6F
+
+
+STATIC_FIELDS = ('opcode', 'operation', 'dest_reg', 'src_regs', 'rd', 'rs1', 'rs2',
+                 'offset', 'immediate', 'has_immediate', 'csr_addr', 'is_jump')
+
+
+class TestBinaryDecode(unittest.TestCase):
+    """Test field extraction from instruction words"""
+
+    def test_r_type(self):
+        """Test ADD/SUB/SRA decode"""
+        add = decode_instruction_word(0x003100B3)  # add x1, x2, x3
+        self.assertEqual((add.opcode, add.rd, add.rs1, add.rs2), (Opcode.ADD, 1, 2, 3))
+        self.assertEqual(decode_instruction_word(0x403100B3).opcode, Opcode.SUB)
+        self.assertEqual(decode_instruction_word(r_type(0x20, 3, 2, 0x5, 1)).opcode, Opcode.SRA)
+
+    def test_negative_immediate(self):
+        """Test I-type immediates are sign-extended"""
+        decoded = decode_instruction_word(i_type(-5, 2, 0x0, 1))
+        self.assertEqual((decoded.opcode, decoded.immediate), (Opcode.ADDI, -5))
+
+    def test_shift_immediates(self):
+        """Test SLLI/SRLI/SRAI carry the shift amount"""
+        self.assertEqual(decode_instruction_word(i_type(7, 2, 0x1, 1)).immediate, 7)
+        srai = decode_instruction_word(i_type(0x400 | 9, 2, 0x5, 1))
+        self.assertEqual((srai.opcode, srai.immediate), (Opcode.SRAI, 9))
+
+    def test_loads_and_stores(self):
+        """Test every load/store width and the store operand order"""
+        for funct3, opcode in [(0, Opcode.LB), (1, Opcode.LH), (2, Opcode.LW), (4, Opcode.LBU), (5, Opcode.LHU)]:
+            decoded = decode_instruction_word(i_type(-4, 2, funct3, 5, opcode=0x03))
+            self.assertEqual((decoded.opcode, decoded.rd, decoded.offset), (opcode, 5, -4))
+
+        store = decode_instruction_word(s_type(-12, 6, 2, 0x2))  # sw x6, -12(x2)
+        self.assertEqual(store.opcode, Opcode.SW)
+        self.assertEqual(store.src_regs, ('R6', 'R2'))  # value, base
+        self.assertEqual(store.offset, -12)
+
+    def test_branch_and_jump_offsets(self):
+        """Test B/J immediate reassembly"""
+        beq = decode_instruction_word(b_type(-8, 2, 1, 0x0))
+        self.assertEqual((beq.opcode, beq.offset), (Opcode.BEQ, -8))
+        jal = decode_instruction_word(j_type(2048, 1))
+        self.assertEqual((jal.opcode, jal.rd, jal.offset), (Opcode.JAL, 1, 2048))
+        self.assertEqual(decode_instruction_word(0xffdff06f).offset, -4)  # j .-4
+
+    def test_upper_immediate(self):
+        """Test LUI/AUIPC keep the 20-bit immediate"""
+        lui = decode_instruction_word(0x12345037)  # lui x0, 0x12345
+        self.assertEqual((lui.opcode, lui.immediate), (Opcode.LUI, 0x12345))
+
+    def test_system_and_csr(self):
+        """Test ECALL/EBREAK/MRET/FENCE and CSR forms"""
+        self.assertEqual(decode_instruction_word(0x00000073).opcode, Opcode.ECALL)
+        self.assertEqual(decode_instruction_word(0x00100073).opcode, Opcode.EBREAK)
+        self.assertEqual(decode_instruction_word(0x30200073).opcode, Opcode.MRET)
+        self.assertEqual(decode_instruction_word(0x0000100F).opcode, Opcode.FENCE_I)
+
+        csrrw = decode_instruction_word(i_type(0x305, 5, 0x1, 0, opcode=0x73))  # csrw mtvec, t0
+        self.assertEqual((csrrw.opcode, csrrw.csr_addr, csrrw.src_regs), (Opcode.CSRRW, 0x305, ('R5',)))
+        csrrsi = decode_instruction_word(i_type(0x300, 8, 0x6, 0, opcode=0x73))  # csrsi mstatus, 8
+        self.assertEqual((csrrsi.opcode, csrrsi.immediate, csrrsi.src_regs), (Opcode.CSRRSI, 8, ()))
+
+    def test_unsupported_words(self):
+        """Test zero, M-extension and compressed-looking words are UNKNOWN"""
+        self.assertEqual(decode_instruction_word(0).opcode, Opcode.UNKNOWN)
+        self.assertEqual(decode_instruction_word(r_type(0x01, 3, 2, 0, 1)).opcode, Opcode.UNKNOWN)  # mul
+
+    def test_disassembly_round_trips_through_text_parser(self):
+        """Test binary records match what the text parser builds from their disassembly"""
+        words = [
+            0x003100B3, i_type(-5, 2, 0x0, 1), i_type(0x400 | 3, 4, 0x5, 7),
+            i_type(16, 2, 0x2, 5, opcode=0x03), s_type(-12, 6, 2, 0x0),
+            b_type(64, 4, 3, 0x6), j_type(-2048, 0), i_type(8, 1, 0x0, 0, opcode=0x67),
+            0x000FF2B7, 0x00000073, 0x30200073,
+            i_type(0x341, 6, 0x2, 5, opcode=0x73), i_type(0x300, 3, 0x7, 0, opcode=0x73),
+        ]
+        for word in words:
+            with self.subTest(word=f"{word:#010x}"):
+                binary = decode_instruction_word(word)
+                text = parse_instruction_text(binary.text)
+                for field in STATIC_FIELDS:
+                    self.assertEqual(getattr(binary, field), getattr(text, field), field)
+
+
+class TestPipelineFromWords(unittest.TestCase):
+    """Test running programs given as instruction words"""
+
+    def test_instruction_from_word(self):
+        """Test Instruction.from_word builds a runnable instance"""
+        instr = Instruction.from_word(0x003100B3)
+        self.assertEqual(instr.operation, 'ADD')
+        self.assertEqual(instr.src_regs, ('R2', 'R3'))
+
+    def test_run_word_program(self):
+        """Test a word program produces the same state as its text form"""
+        words = [
+            i_type(10, 0, 0x0, 1),          # addi x1, x0, 10
+            i_type(20, 0, 0x0, 2),          # addi x2, x0, 20
+            r_type(0, 2, 1, 0x0, 3),        # add x3, x1, x2
+            s_type(100, 3, 0, 0x2),         # sw x3, 100(x0)
+            i_type(100, 0, 0x2, 4, opcode=0x03),  # lw x4, 100(x0)
+        ]
+        env = simpy.Environment()
+        pipeline = Pipeline(env)
+        results = pipeline.run(words)
+
+        self.assertEqual(len(results), 5)
+        self.assertEqual(pipeline.register_file.read('R3'), 30)
+        self.assertEqual(pipeline.register_file.read('R4'), 30)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,188 @@
+"""Tests for basic-block translation in the functional core"""
+import sys
+import os
+import unittest
+
+# Add parent directory (and benchmarks/) to path for imports
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+sys.path.insert(0, REPO_ROOT)
+sys.path.insert(0, os.path.join(REPO_ROOT, 'benchmarks'))
+
+from riscv import RISCVProcessor
+from functional import FunctionalCore
+from block_cache import HOT_THRESHOLD
+from kernels import KERNELS, load_immediate
+from utils.rv32_encoder import addi, lui, lw, sw, branch, jal, load_program, HALT
+
+
+FENCE_I = 0x0000100F
+LOOP = [
+    addi(1, 0, 20),              # 0x00: x1 = 20
+    addi(2, 2, 3),               # 0x04: loop: x2 += 3
+    addi(1, 1, -1),              # 0x08
+    branch(0x1, 1, 0, -8),       # 0x0c: bne x1, x0, loop
+    HALT,                        # 0x10
+]
+
+
+def make_processor(words, translate=True):
+    processor = RISCVProcessor(mode='functional')
+    processor.functional = FunctionalCore.from_pipeline(processor.pipeline, translate)
+    load_program(processor.memory, words)
+    return processor
+
+
+def architectural_state(processor):
+    core = processor.functional
+    csrs = processor.pipeline.csr_bank
+    return {
+        'regs': list(processor.register_file.regs),
+        'pc': processor.register_file.pc,
+        'counts': (core.cycles, core.instret, core.traps_taken, core.interrupts_taken),
+        'halt_reason': core.halt_reason,
+        'csrs': [csrs.read(addr) for addr in (0x300, 0x341, 0x342, 0xB00, 0xB02)],
+        'mtime': processor.pipeline.clint.mtime,
+        'memory': processor.memory.read_bytes(0x10000, 0x100),
+    }
+
+
+class TestTranslation(unittest.TestCase):
+    """Test translated runs match the interpreter exactly"""
+
+    def test_matches_interpreter(self):
+        """Test kernels (loads/stores, branches, timer interrupts) end in identical state"""
+        for name, scale in (('memcpy', 40), ('branchy_loop', 40), ('clint_interrupts', 6)):
+            states = []
+            for translate in (False, True):
+                kernel = KERNELS[name](scale)
+                processor = make_processor([], translate)
+                processor.functional.run(max_instructions=0)  # Fresh counters
+                entry = kernel.setup(processor)
+                processor.register_file.write_pc(entry)
+                processor.functional.run(max_instructions=100000)
+                kernel.check(processor)
+                if translate and name != 'clint_interrupts':  # Its hot spin loop is idle time
+                    self.assertGreater(processor.functional.block_cache.translated, 0)
+                states.append(architectural_state(processor))
+            with self.subTest(kernel=name):
+                self.assertEqual(states[0], states[1])
+
+    def test_hot_loop_is_translated(self):
+        """Test the loop body becomes one block ending in its branch"""
+        processor = make_processor(LOOP)
+        processor.functional.run()
+        blocks = processor.functional.block_cache.blocks
+        self.assertEqual(set(blocks), {0x04})
+        self.assertEqual(blocks[0x04].length, 3)
+        self.assertEqual(processor.register_file.read_index(2), 60)
+        self.assertEqual(processor.functional.instret, 1 + 3 * 20 + 1)
+
+    def test_budgets_stop_inside_blocks(self):
+        """Test instruction budgets, stop PCs and breakpoints stop exactly where interpreting would"""
+        for kwargs in ({'max_instructions': 40}, {'stop_instret': 40}):
+            processor = make_processor(LOOP)
+            processor.functional.run(**kwargs)
+            self.assertEqual(processor.functional.instret, 40)
+            self.assertEqual(processor.register_file.pc, 0x04)  # 1 + 13 iterations
+            self.assertEqual(processor.register_file.read_index(2), 39)
+
+        processor = make_processor(LOOP)
+        core = processor.functional
+        core.run(max_instructions=1 + 3 * HOT_THRESHOLD)  # Warm the block up
+        self.assertIn(0x04, core.block_cache.blocks)
+        self.assertEqual(core.run(breakpoints={0x08}), 'breakpoint')
+        self.assertEqual(processor.register_file.pc, 0x08)
+        self.assertEqual(core.run(stop_pc=0x0c), 'stop_pc')
+        self.assertEqual(processor.register_file.pc, 0x0c)
+
+    def test_disabled(self):
+        """Test translate=False interprets everything"""
+        processor = make_processor(LOOP, translate=False)
+        processor.functional.run()
+        self.assertIsNone(processor.functional.block_cache)
+        self.assertIsNone(processor.functional.get_stats()['translation'])
+        self.assertEqual(processor.register_file.read_index(2), 60)
+
+
+class TestInvalidation(unittest.TestCase):
+    """Test stale translations are never run"""
+
+    def test_store_into_translated_code(self):
+        """Test a guest store rewriting a hot block's instruction takes effect on the next pass"""
+        patched = addi(2, 2, 100)
+        processor = make_processor([
+            addi(1, 0, 20),              # 0x00
+            *load_immediate(5, patched), # 0x04: x5 = patched
+            addi(0, 0, 0),               # 0x0c
+            addi(0, 0, 0),               # 0x10
+            addi(2, 2, 3),               # 0x14: loop: x2 += 3
+            addi(1, 1, -1),              # 0x18
+            addi(6, 0, 10),              # 0x1c
+            branch(0x1, 1, 6, 8),        # 0x20: skip the patch unless x1 == 10
+            sw(5, 0, 0x14),              # 0x24: patch the loop head
+            branch(0x1, 1, 0, -20),      # 0x28: bne x1, x0, loop
+            HALT,                        # 0x2c
+        ])
+        processor.functional.run()
+        # 10 iterations add 3, the patched 10 add 100
+        self.assertEqual(processor.register_file.read_index(2), 10 * 3 + 10 * 100)
+        self.assertGreater(processor.functional.block_cache.flushes, 0)
+
+    def test_fence_i_drops_translations(self):
+        """Test FENCE.I makes code written behind the caches' back visible"""
+        processor = make_processor(LOOP)
+        core = processor.functional
+        core.run()
+        self.assertIn(0x04, core.block_cache.blocks)
+
+        processor.memory.write_word(0x04, addi(2, 2, 5))  # Not seen by the caches
+        load_program(processor.memory, [FENCE_I, jal(0, -0x100)], base=0x100)
+        processor.register_file.write_index(1, 20)
+        processor.register_file.write_index(2, 0)
+        processor.register_file.write_pc(0x100)
+        core.run()
+        self.assertEqual(processor.register_file.read_index(2), 100)
+        self.assertEqual(core.block_cache.flushes, 1)
+
+    def test_checkpoint_restore_drops_translations(self):
+        """Test restoring memory (DecodeCache.invalidate_all) starts translation over"""
+        processor = make_processor(LOOP)
+        core = processor.functional
+        core.run()
+        generation = processor.pipeline.decode_cache.generation
+        processor.pipeline.decode_cache.invalidate_all()
+        self.assertNotEqual(processor.pipeline.decode_cache.generation, generation)
+        processor.register_file.write_pc(0)
+        core.run()
+        self.assertEqual(core.block_cache.flushes, 1)
+        self.assertIn(0x04, core.block_cache.blocks)
+
+
+class TestBlockBoundaries(unittest.TestCase):
+    """Test what ends a block"""
+
+    def test_clint_access_leaves_to_interpreter(self):
+        """Test a mtime load inside a block sees time brought up to date"""
+        program = [
+            lui(20, 0x0200C),                # 0x00
+            addi(20, 20, -8),                # 0x04: x20 = &mtime (0x0200BFF8)
+            addi(1, 0, -12),                 # 0x08
+            addi(3, 3, 1),                   # 0x0c: loop
+            lw(4, 20, 0),                    # 0x10: x4 = mtime
+            sw(4, 0, 0x400),                 # 0x14
+            addi(1, 1, 1),                   # 0x18
+            branch(0x1, 1, 0, -16),          # 0x1c: bne x1, x0, loop
+            HALT,
+        ]
+        processor = make_processor(program)
+        reference = make_processor(program, translate=False)
+        for p in (processor, reference):
+            p.pipeline.clint.time_scale = 1
+            p.functional.run()
+        self.assertEqual(processor.memory.read_word(0x400), reference.memory.read_word(0x400))
+        self.assertEqual(processor.register_file.read_index(4), reference.register_file.read_index(4))
+        self.assertGreater(processor.register_file.read_index(4), 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
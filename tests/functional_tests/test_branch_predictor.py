@@ -0,0 +1,167 @@
+"""Tests for the branch prediction unit and predicted fetch"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from riscv import RISCVProcessor
+from branch_predictor import (BranchPredictionUnit, BimodalPredictor, GSharePredictor,
+                              ReturnAddressStack, make_branch_predictor, ras_hints, MISPREDICT_PENALTY)
+from instruction import decode_instruction_word
+from utils.rv32_encoder import add, addi, branch, jal, jalr, load_program, HALT
+
+
+# Nested loops with a call: 10 outer iterations, each calling a 5-iteration inner loop
+LOOP_PROGRAM = [
+    addi(1, 0, 10),              # 0x00: x1 = outer count
+    jal(5, 0x18),                # 0x04: outer: call inner (0x1c)
+    addi(1, 1, -1),              # 0x08
+    branch(0x1, 1, 0, -8),       # 0x0c: bne x1, x0, outer
+    HALT,                        # 0x10
+    HALT,                        # 0x14
+    HALT,                        # 0x18
+    addi(2, 0, 5),               # 0x1c: inner: x2 = 5
+    add(3, 3, 2),                # 0x20: x3 += x2
+    addi(2, 2, -1),              # 0x24
+    branch(0x1, 2, 0, -8),       # 0x28: bne x2, x0, 0x20
+    jalr(0, 5, 0),               # 0x2c: ret
+]
+
+
+def run(program, branch_predictor):
+    processor = RISCVProcessor(branch_predictor=branch_predictor)
+    load_program(processor.memory, program)
+    info = processor.execute_from_memory(0, max_cycles=20000, verbose=False)
+    return processor, info
+
+
+class TestPredictorComponents(unittest.TestCase):
+    """Test direction tables, BTB and RAS"""
+
+    def test_bimodal_saturates(self):
+        """Test 2-bit counters need two outcomes to flip"""
+        predictor = BimodalPredictor(entries=16)
+        taken, index = predictor.predict(0x40, 0x20)
+        self.assertFalse(taken)
+        predictor.update(index, True)
+        self.assertTrue(predictor.predict(0x40, 0x20)[0])
+        predictor.update(index, True)
+        predictor.update(index, False)
+        self.assertTrue(predictor.predict(0x40, 0x20)[0])
+
+    def test_gshare_learns_alternating_pattern(self):
+        """Test global history separates an alternating branch"""
+        predictor = GSharePredictor(entries=64, history_bits=4)
+        outcomes = [i % 2 == 0 for i in range(200)]
+        correct = 0
+        for outcome in outcomes:
+            taken, index = predictor.predict(0x80, 0x40)
+            correct += taken == outcome
+            predictor.update(index, outcome)
+        self.assertGreater(correct, 180)
+
+    def test_ras_overflow_drops_oldest(self):
+        """Test the RAS keeps the most recent return addresses"""
+        ras = ReturnAddressStack(depth=2)
+        for address in (0x10, 0x20, 0x30):
+            ras.push(address)
+        self.assertEqual(ras.pop(), 0x30)
+        self.assertEqual(ras.pop(), 0x20)
+        self.assertIsNone(ras.pop())
+
+    def test_call_return_prediction(self):
+        """Test a call pushes and its return pops the RAS"""
+        unit = BranchPredictionUnit('static')
+        call = decode_instruction_word(jal(1, 0x100))
+        ret = decode_instruction_word(jalr(0, 1, 0))
+        unit.predict(0x40, call)
+        self.assertEqual(unit.predict(0x140, ret).next_pc, 0x44)
+        self.assertIsNone(unit.predict(0x48, decode_instruction_word(addi(1, 0, 1))))
+
+    def test_ras_hint_table(self):
+        """Test JAL/JALR push and pop the RAS by the rd/rs1 link-register table"""
+        cases = [
+            (jal(0, 0x10), (False, False)),
+            (jal(5, 0x10), (False, True)),
+            (jalr(0, 6, 0), (False, False)),
+            (jalr(0, 1, 0), (True, False)),      # Return
+            (jalr(2, 5, 0), (True, False)),      # Return writing a non-link register
+            (jalr(1, 6, 0), (False, True)),      # Indirect call
+            (jalr(1, 1, 0), (False, True)),      # Call through the link register
+            (jalr(5, 1, 0), (True, True)),       # Coroutine swap
+            (jalr(1, 5, 0), (True, True)),
+        ]
+        for word, expected in cases:
+            with self.subTest(text=decode_instruction_word(word).text):
+                self.assertEqual(ras_hints(decode_instruction_word(word)), expected)
+
+    def test_coroutine_swap(self):
+        """Test a swap returns to the top entry and leaves its own return address there"""
+        unit = BranchPredictionUnit('static')
+        unit.predict(0x40, decode_instruction_word(jal(1, 0x100)))
+        swap = unit.predict(0x140, decode_instruction_word(jalr(5, 1, 0)))
+        self.assertEqual(swap.next_pc, 0x44)
+        self.assertTrue(swap.used_ras)
+        self.assertEqual(unit.predict(0x44, decode_instruction_word(jalr(0, 5, 0))).next_pc, 0x144)
+
+    def test_unknown_predictor(self):
+        """Test an unknown direction predictor name raises"""
+        with self.assertRaises(ValueError):
+            make_branch_predictor('perceptron')
+        self.assertIsNone(make_branch_predictor(None))
+
+
+class TestPredictedFetch(unittest.TestCase):
+    """Test the fetch engine with a predictor attached"""
+
+    def test_same_state_fewer_cycles(self):
+        """Test every predictor gets the baseline's result, bimodal fastest"""
+        baseline, baseline_info = run(LOOP_PROGRAM, None)
+        self.assertEqual(baseline.get_register('R3'), 150)
+        self.assertIsNone(baseline_info['branch_prediction'])
+
+        cycles = {}
+        for name in ('static', 'btfn', 'bimodal', 'gshare'):
+            processor, info = run(LOOP_PROGRAM, name)
+            with self.subTest(predictor=name):
+                self.assertEqual(info['halt_reason'], 'self_loop')
+                self.assertEqual(processor.get_register_state(), baseline.get_register_state())
+                self.assertEqual(info['instructions_retired'], baseline_info['instructions_retired'])
+                self.assertLess(info['flush_count'], baseline_info['flush_count'])
+            cycles[name] = info['total_cycles']
+
+        self.assertLess(cycles['bimodal'], cycles['static'])
+        self.assertLess(cycles['static'], baseline_info['total_cycles'])
+
+    def test_flush_cycles_saved_estimate_matches_run(self):
+        """Test the estimated savings match the measured cycle difference when no flush overlaps a stall"""
+        _, baseline_info = run(LOOP_PROGRAM, None)
+        _, info = run(LOOP_PROGRAM, 'bimodal')
+        saved = baseline_info['total_cycles'] - info['total_cycles']
+        self.assertEqual(info['branch_prediction']['flush_cycles_saved_estimate'], saved)
+
+    def test_statistics(self):
+        """Test branch, jump and RAS statistics are reported"""
+        _, info = run(LOOP_PROGRAM, {'direction': 'bimodal', 'btb_entries': 64, 'ras_depth': 4})
+        stats = info['branch_prediction']
+
+        self.assertEqual(stats['predictor'], 'bimodal')
+        self.assertEqual(stats['branches'], 60)
+        self.assertGreater(stats['branch_accuracy'], 0.7)
+        self.assertEqual(stats['ras_returns'], 10)
+        self.assertEqual(stats['ras_accuracy'], 1.0)
+        self.assertGreater(stats['btb_hit_rate'], 0.5)
+        self.assertEqual(stats['predictions'], stats['branches'] + stats['jumps'])
+        self.assertEqual(stats['flush_cycles_saved_estimate'],
+                         MISPREDICT_PENALTY * (stats['flushes_avoided'] - stats['flushes_added']))
+
+    def test_no_btb_mispredicts_taken(self):
+        """Test without a BTB only fall-through predictions are possible"""
+        _, info = run(LOOP_PROGRAM, {'direction': 'bimodal', 'btb_entries': 0, 'ras_depth': 0})
+        self.assertEqual(info['branch_prediction']['flushes_avoided'], 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
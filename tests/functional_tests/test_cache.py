@@ -0,0 +1,178 @@
+"""Tests for the L1 cache model and the stalls its misses cause"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from riscv import RISCVProcessor
+from cache import Cache, make_cache
+from utils.rv32_encoder import add, addi, lui, lw, sw, branch, load_program, HALT
+
+
+DATA = 0x1000
+
+# Sums 8 words at DATA, 20 times over (x3 = 20 * 36)
+LOOP_PROGRAM = [
+    addi(1, 0, 20),              # 0x00: x1 = outer count
+    lui(10, DATA >> 12),         # 0x04: outer: x10 = DATA
+    addi(2, 0, 8),               # 0x08: x2 = words left
+    lw(4, 10, 0),                # 0x0c: inner
+    addi(10, 10, 4),             # 0x10
+    addi(2, 2, -1),              # 0x14
+    add(3, 3, 4),                # 0x18: x3 += word
+    branch(0x1, 2, 0, -16),      # 0x1c: bne x2, x0, inner
+    addi(1, 1, -1),              # 0x20
+    branch(0x1, 1, 0, -32),      # 0x24: bne x1, x0, outer
+    HALT,                        # 0x28
+]
+
+ICACHE = {'size': 256, 'ways': 2, 'line_size': 16, 'miss_latency': 8}
+DCACHE = {'size': 256, 'ways': 2, 'line_size': 16, 'miss_latency': 8}
+
+
+def run(program, mode='pipeline', icache=None, dcache=None):
+    processor = RISCVProcessor(mode=mode, icache=icache, dcache=dcache)
+    load_program(processor.memory, program)
+    for index in range(8):
+        processor.memory.write_word(DATA + 4 * index, index + 1)
+    info = processor.execute_from_memory(0, max_cycles=20000, verbose=False)
+    return processor, info
+
+
+class TestCache(unittest.TestCase):
+    """Test the cache on its own"""
+
+    def test_geometry(self):
+        """Test sets follow size, ways and line size, and bad geometries are rejected"""
+        cache = Cache(size=1024, ways=4, line_size=32)
+        self.assertEqual(cache.num_sets, 8)
+        for kwargs in ({'size': 1000}, {'line_size': 24}, {'ways': 3}, {'ways': 0},
+                       {'replacement': 'plru'}, {'write_policy': 'write-around'}):
+            with self.subTest(**kwargs), self.assertRaises(ValueError):
+                Cache(**kwargs)
+
+    def test_hits_and_misses(self):
+        """Test a miss fills the whole line and costs miss_latency"""
+        cache = Cache(size=64, ways=1, line_size=16, miss_latency=5)
+        self.assertEqual(cache.access(0x100), 5)
+        self.assertEqual(cache.access(0x10c), 0)
+        self.assertEqual(cache.access(0x110), 5)
+        self.assertEqual((cache.hits, cache.misses), (1, 2))
+        self.assertEqual(cache.get_stats(instructions=500)['mpki'], 4.0)
+
+    def test_replacement(self):
+        """Test LRU keeps a line that is in use, FIFO evicts the oldest fill"""
+        for replacement, survivor in (('lru', 0x000), ('fifo', 0x040)):
+            with self.subTest(replacement=replacement):
+                cache = Cache(size=32, ways=2, line_size=16, replacement=replacement)
+                cache.access(0x000)
+                cache.access(0x040)
+                cache.access(0x000)  # Use the first line again
+                cache.access(0x080)  # Same set: one of the two goes
+                self.assertTrue(cache.contains(survivor))
+                self.assertEqual(cache.contains(0x000), replacement == 'lru')
+
+    def test_random_replacement_repeats(self):
+        """Test seeded random replacement makes the same choices every run"""
+        def misses():
+            cache = Cache(size=64, ways=4, line_size=16, replacement='random', seed=3)
+            for address in [0x40 * (i % 7) for i in range(100)]:
+                cache.access(address)
+            return cache.misses
+        self.assertEqual(misses(), misses())
+
+    def test_write_back(self):
+        """Test stores dirty the line and cost nothing until it is evicted"""
+        cache = Cache(size=16, ways=1, line_size=16, miss_latency=5, write_latency=3)
+        self.assertEqual(cache.access(0x00, write=True), 5)   # Write-allocate fill
+        self.assertEqual(cache.access(0x04, write=True), 0)
+        self.assertEqual(cache.access(0x10), 5 + 3)          # Dirty eviction
+        self.assertEqual(cache.access(0x20), 5)              # Clean eviction
+        self.assertEqual(cache.writebacks, 1)
+
+    def test_write_through(self):
+        """Test every store goes to memory and a store miss does not allocate"""
+        cache = Cache(size=16, ways=1, line_size=16, write_policy='write-through', miss_latency=5,
+                      write_latency=2)
+        self.assertEqual(cache.access(0x00, write=True), 2)
+        self.assertFalse(cache.contains(0x00))
+        cache.access(0x00)
+        self.assertEqual(cache.access(0x04, write=True), 2)
+        self.assertEqual((cache.memory_writes, cache.writebacks), (2, 0))
+
+    def test_make_cache(self):
+        """Test None, True and keyword configurations"""
+        self.assertIsNone(make_cache('icache', None))
+        self.assertEqual(make_cache('icache', True).name, 'icache')
+        self.assertEqual(make_cache('dcache', {'ways': 4}).ways, 4)
+
+
+class TestPipelineCaches(unittest.TestCase):
+    """Test cache misses stall the pipeline"""
+
+    def test_no_caches_by_default(self):
+        """Test runs without caches report none and keep their timing"""
+        processor, info = run(LOOP_PROGRAM)
+        self.assertIsNone(processor.pipeline.caches)
+        self.assertIsNone(info['caches'])
+        self.assertEqual(processor.register_file.read_index(3), 20 * 36)
+
+    def test_stall_adds_exactly_its_cycles(self):
+        """Test every cycle a miss adds shows up in total_cycles, nothing else changes"""
+        _, base = run(LOOP_PROGRAM)
+        for icache, dcache in ((ICACHE, None), (None, DCACHE), (ICACHE, DCACHE)):
+            with self.subTest(icache=icache is not None, dcache=dcache is not None):
+                _, info = run(LOOP_PROGRAM, icache=icache, dcache=dcache)
+                stats = info['caches']
+                self.assertGreater(stats['stall_cycles'], 0)
+                self.assertEqual(info['total_cycles'], base['total_cycles'] + stats['stall_cycles'])
+                self.assertEqual(info['instructions_retired'], base['instructions_retired'])
+
+    def test_compulsory_misses_only(self):
+        """Test a loop that fits misses once per line of code and data"""
+        _, info = run(LOOP_PROGRAM, icache=ICACHE, dcache=DCACHE)
+        icache, dcache = info['caches']['icache'], info['caches']['dcache']
+        self.assertEqual(icache['misses'], 3)  # Code 0x00-0x2b: three 16-byte lines
+        self.assertEqual(dcache['misses'], 2)  # 8 words in two 16-byte lines
+        self.assertEqual(dcache['hits'], 20 * 8 - 2)
+        self.assertAlmostEqual(dcache['mpki'], 1000 * 2 / info['instructions_retired'])
+
+    def test_conflict_misses(self):
+        """Test a direct-mapped cache too small for the data misses every pass"""
+        tiny = {'size': 16, 'ways': 1, 'line_size': 16, 'miss_latency': 8}
+        _, info = run(LOOP_PROGRAM, dcache=tiny)
+        self.assertEqual(info['caches']['dcache']['misses'], 20 * 2)
+
+    def test_devices_are_uncached(self):
+        """Test UART and CLINT accesses bypass the D-cache"""
+        program = [
+            lui(11, 0x10000), addi(12, 0, 0x41), sw(12, 11, 0),   # UART TX
+            lui(13, 0x0200C), lw(14, 13, -8),                     # mtime
+            HALT,
+        ]
+        processor, info = run(program, dcache=DCACHE)
+        stats = info['caches']['dcache']
+        self.assertEqual(stats['uncached'], 2)
+        self.assertEqual(stats['accesses'], 0)
+        self.assertEqual(info['caches']['stall_cycles'], 0)
+
+    def test_engines_agree(self):
+        """Test the clocked engine stalls on misses exactly like the SimPy engine"""
+        configs = (dict(icache=ICACHE, dcache=DCACHE),
+                   dict(icache={'size': 32, 'ways': 1, 'line_size': 16, 'miss_latency': 3},
+                        dcache={'size': 32, 'line_size': 8, 'write_policy': 'write-through',
+                                'replacement': 'fifo'}))
+        for config in configs:
+            with self.subTest(config=config):
+                results = []
+                for mode in ('pipeline', 'clocked'):
+                    processor, info = run(LOOP_PROGRAM, mode, **config)
+                    results.append((info['total_cycles'], info['stall_count'], info['caches'],
+                                    list(processor.register_file.regs)))
+                self.assertEqual(results[1], results[0])
+
+
+if __name__ == '__main__':
+    unittest.main()
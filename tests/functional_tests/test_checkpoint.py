@@ -0,0 +1,105 @@
+"""Tests for checkpoint/restore of machine state"""
+import sys
+import os
+import tempfile
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from riscv import RISCVProcessor
+from pipeline import DRAM_BASE
+from utils.rv32_encoder import add, addi, sw, lw, branch, jal, jalr, load_program, HALT
+
+
+# Sum 1..10 into x3 through a call, store it, reload it into x4
+SUM_PROGRAM = [
+    addi(1, 0, 10),              # 0x00: x1 = 10
+    jal(5, 0x14),                # 0x04: call sum (0x18)
+    sw(3, 0, 0x400),             # 0x08
+    lw(4, 0, 0x400),             # 0x0c
+    HALT,                        # 0x10
+    HALT,                        # 0x14
+    add(3, 3, 1),                # 0x18: sum: x3 += x1
+    addi(1, 1, -1),              # 0x1c
+    branch(0x1, 1, 0, -8),       # 0x20: bne x1, x0, sum
+    jalr(0, 5, 0),               # 0x24: ret
+]
+
+
+class TestCheckpoint(unittest.TestCase):
+    """Test a restored processor continues exactly like the original"""
+
+    def setUp(self):
+        handle, self.path = tempfile.mkstemp(suffix='.ckpt')
+        os.close(handle)
+
+    def tearDown(self):
+        os.remove(self.path)
+
+    def _booted(self, mode='functional'):
+        processor = RISCVProcessor(mode=mode)
+        load_program(processor.memory, SUM_PROGRAM)
+        processor.memory.write_word(DRAM_BASE + 0x20, 0xCAFEF00D)
+        processor.pipeline.clint.set_timer_interrupt(5000)
+        processor.pipeline.csr_bank.write(0x340, 0x1234)  # mscratch
+        processor.pipeline.uart.captured.extend(b'boot')
+        processor.fast_forward(stop_instret=12)
+        return processor
+
+    def test_round_trip_state(self):
+        """Test registers, CSRs, CLINT, UART and memory survive a round trip"""
+        original = self._booted()
+        original.save_checkpoint(self.path)
+
+        restored = RISCVProcessor(mode='functional')
+        restored.load_checkpoint(self.path)
+
+        self.assertEqual(restored.register_file.regs, original.register_file.regs)
+        self.assertEqual(restored.register_file.read_pc(), original.register_file.read_pc())
+        self.assertEqual(restored.pipeline.csr_bank.csrs, original.pipeline.csr_bank.csrs)
+        self.assertEqual(restored.pipeline.clint.mtime, original.pipeline.clint.mtime)
+        self.assertEqual(restored.pipeline.clint.mtimecmp, original.pipeline.clint.mtimecmp)
+        self.assertEqual(restored.pipeline.uart.captured, b'boot')
+        self.assertEqual(restored.functional.instret, 12)
+        self.assertEqual(restored.memory.read_word(DRAM_BASE + 0x20), 0xCAFEF00D)
+        self.assertEqual(restored.get_memory_state(), original.get_memory_state())
+        self.assertEqual(restored.memory.dirty_pages, set())
+
+    def test_restored_run_matches(self):
+        """Test functional and pipelined runs from a checkpoint finish like the original"""
+        original = self._booted()
+        original.save_checkpoint(self.path)
+        original.execute_from_memory(None, max_cycles=1000, verbose=False)
+
+        for mode in ('functional', 'pipeline'):
+            with self.subTest(mode=mode):
+                restored = RISCVProcessor(mode=mode)
+                restored.load_checkpoint(self.path)
+                info = restored.execute_from_memory(None, max_cycles=2000, verbose=False)
+                self.assertEqual(info['halt_reason'], 'self_loop')
+                self.assertEqual(restored.get_register_state(), original.get_register_state())
+                self.assertEqual(restored.get_register('R4'), 55)
+                self.assertEqual(restored.memory.dirty_pages, {0})
+
+    def test_restore_replaces_existing_state(self):
+        """Test restoring drops memory and registers written after the checkpoint"""
+        processor = self._booted()
+        processor.save_checkpoint(self.path)
+        processor.memory.write_word(0x8000, 0xFFFFFFFF)
+        processor.register_file.write('R7', 99)
+
+        processor.load_checkpoint(self.path)
+        self.assertEqual(processor.memory.read_word(0x8000), 0)
+        self.assertEqual(processor.get_register('R7'), 0)
+
+    def test_rejects_foreign_file(self):
+        """Test a file without the checkpoint header is refused"""
+        with open(self.path, 'wb') as f:
+            f.write(b'not a checkpoint at all')
+        with self.assertRaisesRegex(ValueError, 'Not a checkpoint'):
+            RISCVProcessor().load_checkpoint(self.path)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,120 @@
+"""Tests for the event-driven (SimPy clock) CLINT timer"""
+import sys
+import os
+import unittest
+import simpy
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from clint import CLINT
+from interrupt import InterruptController
+from csr import CSRBank
+from riscv import RISCVProcessor
+from utils.rv32_encoder import addi, load_program, HALT
+
+
+class TestAttachedCLINT(unittest.TestCase):
+    """Test mtime follows env.now and the compare fires as an event"""
+
+    def setUp(self):
+        self.env = simpy.Environment()
+        self.int_ctrl = InterruptController(CSRBank())
+        self.clint = CLINT(self.int_ctrl)
+        self.clint.attach(self.env)
+
+    def timer_pending(self):
+        return self.int_ctrl.is_pending(self.int_ctrl.INT_TIMER)
+
+    def test_mtime_follows_clock(self):
+        """Test mtime equals elapsed cycles divided by time_scale"""
+        self.env.run(until=37)
+        self.assertEqual(self.clint.mtime, 37)
+
+        scaled = CLINT(self.int_ctrl, time_scale=10)
+        scaled.attach(self.env)
+        self.env.run(until=100)
+        self.assertEqual(scaled.mtime, 6)
+        self.assertEqual(scaled.cycle_count, 3)
+
+    def test_timer_fires_on_cycle(self):
+        """Test the interrupt is raised at exactly mtime == mtimecmp"""
+        self.clint.mtimecmp = 100
+        self.env.run(until=100)
+        self.assertFalse(self.timer_pending())
+        self.env.run(until=101)
+        self.assertTrue(self.timer_pending())
+
+    def test_mtimecmp_write_reschedules(self):
+        """Test moving mtimecmp through MMIO cancels the earlier event"""
+        self.clint.mtimecmp = 20
+        self.env.run(until=10)
+        self.clint.write_register(CLINT.MTIMECMP_BASE, 50)
+        self.clint.write_register(CLINT.MTIMECMP_BASE + 4, 0)
+        self.env.run(until=49)
+        self.assertFalse(self.timer_pending())
+        self.env.run(until=51)
+        self.assertTrue(self.timer_pending())
+
+    def test_mtimecmp_in_past_fires_after_write(self):
+        """Test a compare value already reached raises the interrupt, not the write"""
+        self.env.run(until=30)
+        self.clint.write_register(CLINT.MTIMECMP_BASE, 10)
+        self.clint.write_register(CLINT.MTIMECMP_BASE + 4, 0)
+        self.assertFalse(self.timer_pending())
+        self.env.run(until=31)
+        self.assertTrue(self.timer_pending())
+
+    def test_mtime_write_rebases(self):
+        """Test writing mtime moves both the counter and the due cycle"""
+        self.clint.mtimecmp = 1000
+        self.env.run(until=5)
+        self.clint.write_mtime_64(990)
+        self.env.run(until=14)
+        self.assertEqual(self.clint.mtime, 999)
+        self.assertFalse(self.timer_pending())
+        self.env.run(until=16)
+        self.assertTrue(self.timer_pending())
+
+    def test_ticks_then_reattach(self):
+        """Test cycles advanced by tick() count, and attach() re-syncs the event"""
+        self.clint.mtimecmp = 100
+        self.clint.tick(90)
+        self.assertEqual(self.clint.mtime, 90)
+        self.clint.attach(self.env)
+        self.env.run(until=10)
+        self.assertFalse(self.timer_pending())
+        self.env.run(until=11)
+        self.assertTrue(self.timer_pending())
+
+
+class TestPipelineTimer(unittest.TestCase):
+    """Test the fetch engine against the event-driven timer"""
+
+    def test_mtime_matches_cycles(self):
+        """Test mtime no longer advances once per stage"""
+        processor = RISCVProcessor()
+        load_program(processor.memory, [addi(1, 0, 1), addi(2, 0, 2), HALT])
+        info = processor.execute_from_memory(0, max_cycles=1000, verbose=False)
+        self.assertEqual(processor.pipeline.clint.mtime, info['total_cycles'])
+
+    def test_interrupt_delivered_near_compare(self):
+        """Test the timer interrupt is taken shortly after mtimecmp"""
+        processor = RISCVProcessor()
+        load_program(processor.memory, [HALT])
+        load_program(processor.memory, [addi(8, 0, 1), HALT], base=0x100)
+        csr_bank = processor.pipeline.csr_bank
+        csr_bank.write(0x305, 0x100)
+        csr_bank.write(0x304, 1 << 7)
+        csr_bank.write(0x300, 1 << 3)
+        processor.pipeline.clint.write_mtimecmp_64(200)
+        info = processor.execute_from_memory(0, max_cycles=1000, verbose=False)
+
+        self.assertEqual(info['halt_reason'], 'self_loop')
+        self.assertEqual(processor.get_register('R8'), 1)
+        self.assertEqual(csr_bank.read(0x342), 0x80000007)
+        self.assertLess(info['total_cycles'], 220)
+
+
+if __name__ == '__main__':
+    unittest.main()
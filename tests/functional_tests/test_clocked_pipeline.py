@@ -0,0 +1,149 @@
+"""Tests for the clocked (latch-based) pipeline engine"""
+import sys
+import os
+import unittest
+
+# Add parent directory (and benchmarks/) to path for imports
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+sys.path.insert(0, REPO_ROOT)
+sys.path.insert(0, os.path.join(REPO_ROOT, 'benchmarks'))
+
+from riscv import RISCVProcessor
+from clocked_pipeline import ClockedPipeline
+from kernels import KERNELS
+from utils.rv32_encoder import addi, add, lui, lw, sw, branch, jal, csr, load_program, ECALL, MRET, HALT
+
+
+HAZARDS = [
+    addi(1, 0, 5),          # 0x00
+    addi(2, 1, 1),          # 0x04: RAW on x1 (distance 1)
+    addi(3, 0, 7),          # 0x08
+    lw(4, 0, 0x100),        # 0x0c
+    add(5, 4, 2),           # 0x10: load-use
+    branch(0x0, 0, 0, 8),   # 0x14: taken, skips 0x18
+    addi(6, 0, 1),          # 0x18
+    sw(5, 0, 0x104),        # 0x1c
+    HALT,                   # 0x20
+]
+
+# ECALL traps to a handler that skips it: mepc += 4 (MRET reads mepc in EX,
+# so the write must have reached WriteBack)
+TRAPS = [
+    addi(1, 0, 0x40), csr(0x1, 0, 0x305, 1),   # mtvec = 0x40
+    addi(2, 0, 3),
+    ECALL,
+    addi(2, 2, 1),
+    HALT,
+]
+TRAP_HANDLER = [csr(0x2, 3, 0x341, 0), addi(3, 3, 4), csr(0x1, 0, 0x341, 3), addi(0, 0, 0), MRET]
+
+
+def run(mode, program, handler=None, enable_forwarding=False, branch_predictor=None, **kwargs):
+    processor = RISCVProcessor(mode=mode, enable_forwarding=enable_forwarding,
+                               branch_predictor=branch_predictor)
+    load_program(processor.memory, program)
+    if handler:
+        load_program(processor.memory, handler, base=0x40)
+    processor.memory.write_word(0x100, 9)
+    info = processor.execute_from_memory(0, verbose=False, **kwargs)
+    return processor, info
+
+
+def outcome(processor, info):
+    """Everything the two engines must agree on"""
+    keys = ('instructions_retired', 'total_cycles', 'stall_count', 'bubble_count', 'flush_count',
+            'forward_ex_count', 'forward_mem_count', 'load_use_stalls', 'branch_prediction',
+            'halt_reason', 'tohost_value')
+    return {
+        'info': {key: info[key] for key in keys},
+        'perf': dict(info['perf_counters']),
+        'retired': [instruction.pc for instruction in info['completed_instructions']],
+        'regs': list(processor.register_file.regs),
+        'pc': processor.register_file.pc,
+        'csrs': dict(processor.pipeline.csr_bank.csrs),
+        'memory': processor.memory.read_bytes(0, 0x200),
+        'mtime': processor.pipeline.clint.mtime,
+    }
+
+
+class TestSameResults(unittest.TestCase):
+    """Test the clocked engine reproduces the SimPy engine cycle for cycle"""
+
+    def assert_same(self, program, **kwargs):
+        simpy_run = outcome(*run('pipeline', program, **kwargs))
+        clocked_run = outcome(*run('clocked', program, **kwargs))
+        self.assertEqual(clocked_run, simpy_run)
+        return clocked_run
+
+    def test_hazards_and_flushes(self):
+        """Test RAW/load-use stalls and taken-branch flushes, with and without bypassing"""
+        for forwarding in (False, True):
+            for predictor in (None, 'gshare'):
+                with self.subTest(forwarding=forwarding, predictor=predictor):
+                    result = self.assert_same(HAZARDS, enable_forwarding=forwarding,
+                                              branch_predictor=predictor)
+                    self.assertEqual(result['info']['halt_reason'], 'self_loop')
+                    self.assertEqual(result['regs'][5], 15)
+
+    def test_traps(self):
+        """Test an ECALL trap and MRET return"""
+        result = self.assert_same(TRAPS, handler=TRAP_HANDLER)
+        self.assertEqual(result['regs'][2], 4)
+        self.assertEqual(result['perf']['flush_trap'], 2)
+
+    def test_stop_conditions(self):
+        """Test each termination condition stops both engines in the same state"""
+        for kwargs in ({'max_cycles': 13}, {'max_instret': 4}, {'breakpoints': {0x1c}},
+                       {'tohost': 0x104}, {'halt_on': ('ecall',)}):
+            with self.subTest(**{key: str(value) for key, value in kwargs.items()}):
+                program = TRAPS if 'halt_on' in kwargs else HAZARDS
+                self.assert_same(program, handler=TRAP_HANDLER, **kwargs)
+
+    def test_kernels(self):
+        """Test the benchmark kernels, timer interrupts included"""
+        for name, scale in (('dependent_chain', 1), ('branchy_loop', 8), ('memcpy', 6),
+                            ('clint_interrupts', 3)):
+            results = []
+            for mode in ('pipeline', 'clocked'):
+                kernel = KERNELS[name](scale)
+                processor = RISCVProcessor(mode=mode, branch_predictor='bimodal')
+                entry = kernel.setup(processor)
+                info = processor.execute_from_memory(entry, verbose=False)
+                kernel.check(processor)
+                results.append(outcome(processor, info))
+            with self.subTest(kernel=name):
+                self.assertEqual(results[1], results[0])
+
+
+class TestClockedEngine(unittest.TestCase):
+    """Test the clocked processor mode itself"""
+
+    def test_mode_selects_engine(self):
+        """Test mode='clocked' builds a ClockedPipeline, also after reset()"""
+        processor = RISCVProcessor(mode='clocked')
+        self.assertIsInstance(processor.pipeline, ClockedPipeline)
+        processor.reset()
+        self.assertIsInstance(processor.pipeline, ClockedPipeline)
+        self.assertNotIsInstance(RISCVProcessor().pipeline, ClockedPipeline)
+
+    def test_latches_drain(self):
+        """Test a finished run leaves only bubbles behind"""
+        processor, info = run('clocked', HAZARDS)
+        pipeline = processor.pipeline
+        self.assertEqual(pipeline.in_flight, 0)
+        for latch in (pipeline.decode_latch, pipeline.execute_latch, pipeline.memory_latch,
+                      pipeline.writeback_latch):
+            self.assertTrue(latch is None or latch.is_bubble)
+        self.assertIsNone(pipeline.decode_stalled)
+
+    def test_instruction_lists_run_on_simpy(self):
+        """Test execute() on an instruction list still works in clocked mode"""
+        processor = RISCVProcessor(mode='clocked')
+        processor.initialize_registers({'R2': 10, 'R3': 20})
+        info = processor.execute(["ADD R1, R2, R3", "SUB R4, R1, R3"], verbose=False)
+        self.assertEqual(processor.get_register('R4'), 10)
+        self.assertEqual(info['halt_reason'], 'drained')
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -23,7 +23,7 @@ class TestCSRInstructions(unittest.TestCase):
         self.assertEqual(instr.operation, "CSRRW")
         self.assertEqual(instr.dest_reg, "R1")
         self.assertEqual(instr.csr_addr, 0x300)
-        self.assertEqual(instr.src_regs, ["R2"])
+        self.assertEqual(instr.src_regs, ("R2",))
         self.assertFalse(instr.has_immediate)
     
     def test_csrrw_execution(self):
@@ -47,7 +47,7 @@ class TestCSRInstructions(unittest.TestCase):
         self.assertEqual(instr.operation, "CSRRS")
         self.assertEqual(instr.dest_reg, "R3")
         self.assertEqual(instr.csr_addr, 0x304)
-        self.assertEqual(instr.src_regs, ["R4"])
+        self.assertEqual(instr.src_regs, ("R4",))
     
     def test_csrrs_set_bits(self):
         """Test CSRRS set bits operation"""
@@ -70,7 +70,7 @@ class TestCSRInstructions(unittest.TestCase):
         self.assertEqual(instr.operation, "CSRRC")
         self.assertEqual(instr.dest_reg, "R5")
         self.assertEqual(instr.csr_addr, 0x340)
-        self.assertEqual(instr.src_regs, ["R6"])
+        self.assertEqual(instr.src_regs, ("R6",))
     
     def test_csrrc_clear_bits(self):
         """Test CSRRC clear bits operation"""
@@ -95,7 +95,7 @@ class TestCSRInstructions(unittest.TestCase):
         self.assertEqual(instr.csr_addr, 0x300)
         self.assertEqual(instr.immediate, 15)
         self.assertTrue(instr.has_immediate)
-        self.assertEqual(instr.src_regs, [])
+        self.assertEqual(instr.src_regs, ())
     
     def test_csrrwi_execution(self):
         """Test CSRRWI with immediate value"""
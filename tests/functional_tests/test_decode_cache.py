@@ -0,0 +1,161 @@
+"""Tests for the decoded-instruction cache"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+import simpy
+from pipeline import Pipeline
+from instruction import Instruction, Opcode, BUBBLE_DECODED, parse_instruction_text, decode_instruction_word
+from decode_cache import DecodeCache
+from riscv import RISCVProcessor
+from utils.rv32_encoder import addi, load_program, HALT
+
+
+class TestDecodedInstruction(unittest.TestCase):
+    """Test the immutable decoded record"""
+
+    def test_opcode_and_register_indices(self):
+        """Test decode resolves opcode id and register numbers"""
+        decoded = parse_instruction_text("ADD R1, R2, R3")
+        self.assertEqual(decoded.opcode, Opcode.ADD)
+        self.assertEqual((decoded.rd, decoded.rs1, decoded.rs2), (1, 2, 3))
+
+    def test_load_store_indices(self):
+        """Test load/store rs1/rs2 follow the encoding (a store's rs1 is its base)"""
+        load = parse_instruction_text("LW R6, 100(R1)")
+        self.assertEqual((load.opcode, load.rd, load.rs1, load.offset), (Opcode.LW, 6, 1, 100))
+
+        store = parse_instruction_text("SW R6, -8(R7)")
+        self.assertEqual((store.opcode, store.rd, store.rs1, store.rs2), (Opcode.SW, None, 7, 6))
+        self.assertEqual(store.src_indices, (6, 7))  # value, base
+        self.assertEqual(store.offset, -8)
+        self.assertEqual(decode_instruction_word(0xFE63AC23), store)  # sw x6, -8(x7)
+
+    def test_fence_i_opcode(self):
+        """Test FENCE.I maps to its own opcode id"""
+        self.assertEqual(parse_instruction_text("fence.i").opcode, Opcode.FENCE_I)
+
+    def test_record_is_immutable(self):
+        """Test decoded record fields cannot be reassigned"""
+        decoded = parse_instruction_text("ADDI R1, R0, 5")
+        with self.assertRaises(AttributeError):
+            decoded.immediate = 6
+
+    def test_source_registers_are_immutable(self):
+        """Test src_regs is a tuple in records from either decoder and in bubbles"""
+        for decoded in (parse_instruction_text("ADD R1, R2, R3"), decode_instruction_word(0x003100B3),
+                        BUBBLE_DECODED):
+            self.assertIsInstance(decoded.src_regs, tuple)
+        self.assertEqual(parse_instruction_text("ADD R1, R2, R3").src_regs, ('R2', 'R3'))
+        self.assertEqual(BUBBLE_DECODED.src_regs, ())
+
+    def test_instances_share_record(self):
+        """Test dynamic instances share the record but not mutable state"""
+        decoded = parse_instruction_text("ADD R1, R2, R3")
+        first = Instruction.from_decoded(decoded)
+        second = Instruction.from_decoded(decoded)
+        first.result = 42
+        first.src_values = [1, 2]
+
+        self.assertIs(first.decoded, second.decoded)
+        self.assertIsNone(second.result)
+        self.assertEqual(second.src_values, [])
+
+
+class TestDecodeCache(unittest.TestCase):
+    """Test cache lookup and invalidation"""
+
+    def setUp(self):
+        self.cache = DecodeCache()
+
+    def test_hit_after_miss(self):
+        """Test second lookup at the same PC is a hit"""
+        first = self.cache.lookup(0x100, "ADD R1, R2, R3", parse_instruction_text)
+        second = self.cache.lookup(0x100, "ADD R1, R2, R3", parse_instruction_text)
+        self.assertIs(first, second)
+        self.assertEqual(self.cache.misses, 1)
+        self.assertEqual(self.cache.hits, 1)
+
+    def test_key_mismatch_redecodes(self):
+        """Test a different instruction at a cached PC is decoded fresh"""
+        self.cache.lookup(0x100, "ADD R1, R2, R3", parse_instruction_text)
+        decoded = self.cache.lookup(0x100, "SUB R1, R2, R3", parse_instruction_text)
+        self.assertEqual(decoded.opcode, Opcode.SUB)
+        self.assertEqual(self.cache.misses, 2)
+
+    def test_store_into_code_invalidates(self):
+        """Test a store overlapping a cached PC drops only that entry"""
+        self.cache.lookup(0x100, "ADD R1, R2, R3", parse_instruction_text)
+        self.cache.lookup(0x104, "SUB R1, R2, R3", parse_instruction_text)
+
+        self.cache.invalidate(0x102, 1)  # Byte store into the first instruction
+
+        self.assertIsNone(self.cache.get(0x100))
+        self.assertIsNotNone(self.cache.get(0x104))
+        self.assertEqual(self.cache.invalidations, 1)
+
+    def test_store_to_data_page_keeps_code(self):
+        """Test stores to pages without code leave the cache intact"""
+        self.cache.lookup(0x100, "ADD R1, R2, R3", parse_instruction_text)
+        self.cache.invalidate(0x8000, 4)
+        self.assertEqual(self.cache.get_stats()['entries'], 1)
+
+    def test_invalidate_all(self):
+        """Test FENCE.I-style full invalidation"""
+        self.cache.lookup(0x100, "ADD R1, R2, R3", parse_instruction_text)
+        self.cache.lookup(0x2000, "SUB R1, R2, R3", parse_instruction_text)
+        self.cache.invalidate_all()
+        self.assertEqual(self.cache.get_stats()['entries'], 0)
+
+
+class TestPipelineDecodeCache(unittest.TestCase):
+    """Test pipeline integration"""
+
+    def test_pipeline_populates_cache(self):
+        """Test each fetched slot is decoded once"""
+        env = simpy.Environment()
+        pipeline = Pipeline(env)
+        pipeline.run(["ADDI R1, R0, 1", "ADDI R2, R0, 2"])
+        self.assertEqual(pipeline.decode_cache.misses, 2)
+        self.assertEqual(pipeline.register_file.read('R2'), 2)
+
+    def test_fence_i_clears_cache(self):
+        """Test FENCE.I in the pipeline invalidates the cache"""
+        env = simpy.Environment()
+        pipeline = Pipeline(env)
+        pipeline.run(["ADDI R1, R0, 1", "FENCE.I"])
+        self.assertEqual(pipeline.decode_cache.get_stats()['entries'], 0)
+
+    def test_store_into_code_slot_invalidates(self):
+        """Test a store to a cached program slot invalidates it"""
+        env = simpy.Environment()
+        pipeline = Pipeline(env)
+        pipeline.run(["ADDI R1, R0, 7", "SW R1, 0(R0)"])
+        self.assertIsNone(pipeline.decode_cache.get(0))
+        self.assertIsNotNone(pipeline.decode_cache.get(4))
+
+
+class TestHostWrites(unittest.TestCase):
+    """Test code rewritten by the host between runs is decoded afresh"""
+
+    def test_rewritten_code_runs(self):
+        """Test write_word() and write_bytes() into run code replace the cached decode"""
+        for mode in RISCVProcessor.MODES:
+            for write in ('write_word', 'write_bytes'):
+                with self.subTest(mode=mode, write=write):
+                    processor = RISCVProcessor(mode=mode)
+                    load_program(processor.memory, [addi(1, 0, 5), HALT])
+                    processor.execute_from_memory(0, max_cycles=100, verbose=False)
+                    if write == 'write_word':
+                        processor.memory.write_word(0, addi(2, 0, 7))
+                    else:
+                        processor.memory.write_bytes(0, addi(2, 0, 7).to_bytes(4, 'little'))
+                    processor.execute_from_memory(0, max_cycles=100, verbose=False)
+                    self.assertEqual(processor.register_file.read_index(2), 7)
+
+
+if __name__ == '__main__':
+    unittest.main()
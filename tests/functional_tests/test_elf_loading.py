@@ -0,0 +1,130 @@
+"""Tests for loading ELF PT_LOAD segments straight into memory"""
+import sys
+import os
+import tempfile
+import unittest
+from unittest import mock
+
+# Add parent directory (and utils/) to path for imports
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+sys.path.insert(0, REPO_ROOT)
+sys.path.insert(0, os.path.join(REPO_ROOT, 'utils'))
+
+import elf_loader
+from elf_loader import ELFTestLoader
+from memory import Memory
+
+
+class FakeSymbol:
+    def __init__(self, name, value, size=0, kind='STT_NOTYPE'):
+        self.name = name
+        self.entry = {'st_value': value, 'st_size': size, 'st_info': {'type': kind}}
+
+    def __getitem__(self, key):
+        return self.entry[key]
+
+
+class FakeSymtab:
+    def __init__(self, symbols):
+        self.symbols = [FakeSymbol(name, *value) if isinstance(value, tuple) else FakeSymbol(name, value)
+                        for name, value in symbols.items()]
+
+    def iter_symbols(self):
+        return iter(self.symbols)
+
+
+class FakeELFFile:
+    """Stand-in for elftools ELFFile describing a fixed segment layout"""
+
+    segments = []
+    symbols = None
+    entry = 0
+
+    def __init__(self, stream):
+        self.header = {'e_entry': self.entry}
+
+    def iter_segments(self):
+        return iter(self.segments)
+
+    def get_section_by_name(self, name):
+        if name == '.symtab' and self.symbols is not None:
+            return FakeSymtab(self.symbols)
+        return None
+
+
+class TestLoadInto(unittest.TestCase):
+    """Test segments are sliced from the file image and .bss is zero-filled"""
+
+    def setUp(self):
+        self.image = bytes(range(256)) * 40  # 10 KiB file
+        handle, self.path = tempfile.mkstemp(suffix='.elf')
+        with os.fdopen(handle, 'wb') as f:
+            f.write(self.image)
+        self.memory = Memory()
+        self.memory.map_ram(0x80000000, 1024 * 1024, name='dram')
+
+    def tearDown(self):
+        os.remove(self.path)
+
+    def _fake(self, segments, symbols=None, entry=0):
+        attrs = {'segments': segments, 'symbols': symbols, 'entry': entry}
+        return mock.patch.object(elf_loader, 'ELFFile', type('ELF', (FakeELFFile,), attrs))
+
+    def test_segments_copied_and_bss_zeroed(self):
+        """Test file bytes land at p_vaddr and p_memsz beyond p_filesz is zero"""
+        self.memory.write_bytes(0x5000, b'\xff' * 0x80)  # Stale data under .bss
+        segments = [
+            {'p_type': 'PT_LOAD', 'p_vaddr': 0x0, 'p_offset': 0x100, 'p_filesz': 0x1800, 'p_memsz': 0x1800},
+            {'p_type': 'PT_NOTE', 'p_vaddr': 0x9000, 'p_offset': 0, 'p_filesz': 16, 'p_memsz': 16},
+            {'p_type': 'PT_LOAD', 'p_vaddr': 0x4FF0, 'p_offset': 0x2000, 'p_filesz': 0x10, 'p_memsz': 0x50},
+        ]
+        with self._fake(segments, entry=0x40):
+            entry, symbols = ELFTestLoader(self.path).load_into(self.memory)
+
+        self.assertEqual(entry, 0x40)
+        self.assertEqual(symbols, {})
+        self.assertEqual(self.memory.read_bytes(0, 0x1800), self.image[0x100:0x1900])
+        self.assertEqual(self.memory.read_bytes(0x4FF0, 0x10), self.image[0x2000:0x2010])
+        self.assertEqual(self.memory.read_bytes(0x5000, 0x40), bytes(0x40))
+        self.assertEqual(self.memory.read_word(0x5040), 0xFFFFFFFF)
+        self.assertEqual(self.memory.read_bytes(0x9000, 16), bytes(16))
+
+    def test_symbol_table(self):
+        """Test named symbols are returned and tohost comes from the table"""
+        segments = [{'p_type': 'PT_LOAD', 'p_vaddr': 0x80000000, 'p_offset': 0,
+                     'p_filesz': 8, 'p_memsz': 8}]
+        symbols = {'tohost': 0x80002000, '_stack_start': 0x80100000, '': 0}
+        with self._fake(segments, symbols, entry=0x80000000):
+            loader = ELFTestLoader(self.path)
+            entry, table = loader.load_into(self.memory)
+
+        self.assertEqual(table, {'tohost': 0x80002000, '_stack_start': 0x80100000})
+        self.assertEqual(loader.tohost_address, 0x80002000)
+        self.assertEqual(self.memory.read_word(0x80000004), 0x07060504)
+
+    def test_function_symbols(self):
+        """Test STT_FUNC symbols are collected sorted by address for symbolization"""
+        segments = [{'p_type': 'PT_LOAD', 'p_vaddr': 0x80000000, 'p_offset': 0,
+                     'p_filesz': 8, 'p_memsz': 8}]
+        symbols = {'vTaskSwitchContext': (0x80000200, 0x80, 'STT_FUNC'),
+                   'main': (0x80000100, 0x40, 'STT_FUNC'),
+                   'xTickCount': (0x80003000, 4, 'STT_OBJECT')}
+        with self._fake(segments, symbols, entry=0x80000000):
+            loader = ELFTestLoader(self.path)
+            loader.load_into(self.memory)
+
+        self.assertEqual(loader.functions, [(0x80000100, 0x40, 'main'),
+                                            (0x80000200, 0x80, 'vTaskSwitchContext')])
+        self.assertEqual(loader.symbols['xTickCount'], 0x80003000)
+
+    def test_segment_outside_ram_rejected(self):
+        """Test a segment with no RAM behind it raises instead of being dropped"""
+        segments = [{'p_type': 'PT_LOAD', 'p_vaddr': 0x40000000, 'p_offset': 0,
+                     'p_filesz': 4, 'p_memsz': 4}]
+        with self._fake(segments):
+            with self.assertRaises(ValueError):
+                ELFTestLoader(self.path).load_into(self.memory)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,80 @@
+"""Tests for opcode-indexed execute dispatch"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from exe import EXE, ALU_FUNCTIONS, BRANCH_CONDITIONS
+from instruction import Instruction, Opcode, ALU_OPCODES, BRANCH_OPCODES
+from riscv import RISCVProcessor
+from utils.rv32_encoder import addi, lw, load_program, HALT
+
+
+OPERANDS = [0, 1, 5, 31, 32, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF, -1, -2048]
+
+
+class TestExeDispatch(unittest.TestCase):
+    """Test the handler tables agree with the named-operation API"""
+
+    def test_every_alu_opcode_has_a_function(self):
+        """Test the ALU table covers exactly the ALU opcode class"""
+        self.assertEqual(set(ALU_FUNCTIONS), set(ALU_OPCODES))
+        self.assertEqual(set(BRANCH_CONDITIONS), set(BRANCH_OPCODES))
+
+    def test_execute_alu_matches_execute(self):
+        """Test EXE.execute_alu(opcode) equals EXE.execute(name) on edge operands"""
+        for opcode in ALU_OPCODES:
+            for a in OPERANDS:
+                for b in OPERANDS:
+                    with self.subTest(op=opcode.name, a=a, b=b):
+                        self.assertEqual(EXE.execute_alu(opcode, a, b), EXE.execute(opcode.name, a, b))
+
+    def test_sra_sign_fill(self):
+        """Test arithmetic shifts fill with the sign bit"""
+        self.assertEqual(EXE.execute('SRA', 0x80000000, 4), 0xF8000000)
+        self.assertEqual(EXE.execute('sra', 0x80000000, 0), 0x80000000)
+        self.assertEqual(EXE.execute_alu(Opcode.SRAI, 0x40000000, 30), 1)
+
+    def test_execute_instruction_by_class(self):
+        """Test execute_instruction dispatches each instruction class"""
+        store = Instruction("SW R1, 8(R2)")
+        store.src_values = [7, 100]
+        self.assertEqual(EXE.execute_instruction(store), (None, 108))
+
+        branch = Instruction("BLT R1, R2, 16")
+        branch.src_values = [0xFFFFFFFF, 1]  # -1 < 1
+        self.assertEqual(EXE.execute_instruction(branch), (1, None))
+
+        jalr = Instruction("JALR R1, R5, 4")
+        jalr.src_values = [0x101]
+        self.assertEqual(EXE.execute_instruction(jalr, pc=0x40), (0x44, None))
+        self.assertEqual(jalr.jump_target, 0x104)
+
+    def test_address_wraps_to_32_bits(self):
+        """Test load/store addresses wrap around the 32-bit address space"""
+        load = Instruction("LW R2, 12(R1)")
+        load.src_values = [0xFFFFFFFC]
+        self.assertEqual(EXE.execute_instruction(load), (None, 0x8))
+        store = Instruction("SW R1, -4(R2)")
+        store.src_values = [7, 0]
+        self.assertEqual(EXE.execute_instruction(store), (None, 0xFFFFFFFC))
+
+        # x1 = -4: lw x2, 12(x1) reads the word at 0x8 on every engine
+        program = [addi(1, 0, -4), lw(2, 1, 12), HALT]
+        for mode in RISCVProcessor.MODES:
+            with self.subTest(mode=mode):
+                processor = RISCVProcessor(mode=mode)
+                load_program(processor.memory, program)
+                processor.execute_from_memory(0, max_cycles=100, verbose=False)
+                self.assertEqual(processor.register_file.read_index(2), HALT)
+
+    def test_unknown_names(self):
+        """Test unrecognized operation names keep their old results"""
+        self.assertEqual(EXE.execute('MUL', 3, 4), 0)
+        self.assertFalse(EXE.evaluate_branch('BXX', 1, 1))
+
+
+if __name__ == '__main__':
+    unittest.main()
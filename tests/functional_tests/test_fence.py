@@ -17,7 +17,7 @@ class TestFenceInstructions(unittest.TestCase):
         instr = Instruction("FENCE")
         self.assertEqual(instr.operation, "FENCE")
         self.assertIsNone(instr.dest_reg)
-        self.assertEqual(instr.src_regs, [])
+        self.assertEqual(instr.src_regs, ())
         self.assertFalse(instr.is_bubble)
     
     def test_fence_i_parsing(self):
@@ -25,7 +25,7 @@ class TestFenceInstructions(unittest.TestCase):
         instr = Instruction("FENCE.I")
         self.assertEqual(instr.operation, "FENCE.I")
         self.assertIsNone(instr.dest_reg)
-        self.assertEqual(instr.src_regs, [])
+        self.assertEqual(instr.src_regs, ())
         self.assertFalse(instr.is_bubble)
     
     def test_fence_lowercase(self):
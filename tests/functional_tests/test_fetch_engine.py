@@ -0,0 +1,137 @@
+"""Tests for the execute-from-memory fetch engine"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+import simpy
+from pipeline import Pipeline
+from riscv import RISCVProcessor
+from utils.rv32_encoder import (addi, sw, branch, jal, jalr, csr, load_program,
+                                ECALL, MRET, NOP, HALT)
+
+
+class TestFetchEngine(unittest.TestCase):
+    """Test fetch follows the real PC"""
+
+    def setUp(self):
+        self.env = simpy.Environment()
+        self.pipeline = Pipeline(self.env)
+
+    def test_backward_branch_loop(self):
+        """Test a counted loop runs every iteration"""
+        load_program(self.pipeline.memory, [
+            addi(1, 0, 5),               # 0x00: x1 = 5
+            addi(2, 2, 1),               # 0x04: loop: x2 += 1
+            addi(1, 1, -1),              # 0x08: x1 -= 1
+            branch(0x1, 1, 0, -8),       # 0x0c: bne x1, x0, loop
+            HALT,                        # 0x10
+        ])
+        self.pipeline.run_from_memory(0, max_cycles=2000)
+
+        self.assertEqual(self.pipeline.register_file.read('R2'), 5)
+        self.assertEqual(self.pipeline.register_file.read('R1'), 0)
+        self.assertEqual(self.pipeline.halt_reason, 'self_loop')
+
+    def test_call_and_return(self):
+        """Test JAL/JALR redirect fetch and the wrong path never executes"""
+        load_program(self.pipeline.memory, [
+            jal(1, 12),                  # 0x00: call func
+            addi(3, 0, 1),               # 0x04: after return
+            HALT,                        # 0x08
+            addi(4, 0, 7),               # 0x0c: func
+            jalr(0, 1, 0),               # 0x10: ret
+            addi(5, 0, 99),              # 0x14: wrong path
+        ])
+        results = self.pipeline.run_from_memory(0, max_cycles=500)
+
+        self.assertEqual(self.pipeline.register_file.read('R1'), 4)
+        self.assertEqual(self.pipeline.register_file.read('R3'), 1)
+        self.assertEqual(self.pipeline.register_file.read('R4'), 7)
+        self.assertEqual(self.pipeline.register_file.read('R5'), 0)
+        self.assertEqual([instr.pc for instr in results], [0x00, 0x0c, 0x10, 0x04, 0x08])
+
+    def test_taken_branch_squashes_store(self):
+        """Test a store on the fall-through of a taken branch has no effect"""
+        load_program(self.pipeline.memory, [
+            addi(1, 0, 1),               # 0x00
+            branch(0x0, 0, 0, 8),        # 0x04: beq x0, x0, +8
+            sw(1, 0, 0x200),             # 0x08: wrong path
+            HALT,                        # 0x0c
+        ])
+        self.pipeline.run_from_memory(0, max_cycles=500)
+        self.assertEqual(self.pipeline.memory.read_word(0x200), 0)
+
+    def test_ecall_handler_and_mret(self):
+        """Test ECALL traps to mtvec and MRET resumes after it"""
+        self.pipeline.csr_bank.write(0x305, 0x100)  # mtvec
+        load_program(self.pipeline.memory, [
+            ECALL,                       # 0x00
+            addi(6, 0, 1),               # 0x04
+            HALT,                        # 0x08
+        ])
+        load_program(self.pipeline.memory, [
+            csr(0x2, 7, 0x341, 0),       # csrr x7, mepc
+            addi(7, 7, 4),
+            csr(0x1, 0, 0x341, 7),       # csrw mepc, x7
+            NOP, NOP,
+            MRET,
+        ], base=0x100)
+        self.pipeline.run_from_memory(0, max_cycles=500)
+
+        self.assertEqual(self.pipeline.csr_bank.read(0x342), 11)  # ECALL from M
+        self.assertEqual(self.pipeline.register_file.read('R6'), 1)
+        self.assertEqual(self.pipeline.halt_reason, 'self_loop')
+
+    def test_illegal_instruction_traps(self):
+        """Test an undecodable word raises illegal-instruction at Execute"""
+        self.pipeline.csr_bank.write(0x305, 0x100)
+        load_program(self.pipeline.memory, [addi(1, 0, 1), 0xFFFFFFFF])
+        load_program(self.pipeline.memory, [HALT], base=0x100)
+        self.pipeline.run_from_memory(0, max_cycles=500)
+
+        self.assertEqual(self.pipeline.csr_bank.read(0x342), 2)
+        self.assertEqual(self.pipeline.csr_bank.read(0x341), 0x04)
+        self.assertEqual(self.pipeline.csr_bank.read(0x343), 0xFFFFFFFF)
+
+    def test_timer_interrupt_redirects_fetch(self):
+        """Test a timer interrupt vectors fetch and saves the resume PC"""
+        self.pipeline.csr_bank.write(0x305, 0x100)
+        self.pipeline.csr_bank.write(0x304, 1 << 7)   # mie.MTIE
+        self.pipeline.csr_bank.write(0x300, 1 << 3)   # mstatus.MIE
+        self.pipeline.clint.write_mtimecmp_64(100)
+        load_program(self.pipeline.memory, [HALT])
+        load_program(self.pipeline.memory, [addi(8, 0, 1), HALT], base=0x100)
+        self.pipeline.run_from_memory(0, max_cycles=2000)
+
+        self.assertEqual(self.pipeline.register_file.read('R8'), 1)
+        self.assertEqual(self.pipeline.csr_bank.read(0x342), 0x80000007)
+        self.assertEqual(self.pipeline.csr_bank.read(0x341), 0)
+        self.assertEqual(self.pipeline.halt_reason, 'self_loop')
+
+    def test_max_cycles(self):
+        """Test a loop that can still be interrupted runs to the cycle limit"""
+        self.pipeline.csr_bank.write(0x304, 1 << 7)
+        self.pipeline.csr_bank.write(0x300, 1 << 3)
+        load_program(self.pipeline.memory, [HALT])
+        self.pipeline.run_from_memory(0, max_cycles=300)
+
+        self.assertEqual(self.pipeline.halt_reason, 'max_cycles')
+        self.assertEqual(self.env.now, 300)
+
+    def test_processor_execute_from_memory(self):
+        """Test RISCVProcessor reports the halt reason"""
+        processor = RISCVProcessor()
+        for i, word in enumerate([addi(1, 0, 3), HALT]):
+            processor.memory.write_word(0x1000 + i * 4, word)
+        info = processor.execute_from_memory(0x1000, max_cycles=500, verbose=False)
+
+        self.assertEqual(info['halt_reason'], 'self_loop')
+        self.assertEqual(processor.get_register('R1'), 3)
+        self.assertEqual(len(info['completed_instructions']), 2)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,111 @@
+"""Tests for the EX/MEM operand bypass network"""
+import sys
+import os
+import unittest
+import simpy
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from pipeline import Pipeline
+from riscv import RISCVProcessor
+from tracing import Tracer, TRACE_OFF
+from utils.rv32_encoder import add, addi, sw, lw, branch, jal, csr, load_program, HALT
+
+
+def run_text(instructions, enable_forwarding, registers=None):
+    pipeline = Pipeline(simpy.Environment(), enable_forwarding, trace=Tracer(level=TRACE_OFF))
+    for reg, value in (registers or {}).items():
+        pipeline.register_file.write(reg, value)
+    pipeline.run(instructions)
+    return pipeline
+
+
+# Loop with back-to-back ALU, load-use and branch-operand dependencies
+LOOP_PROGRAM = [
+    addi(1, 0, 8),               # 0x00: x1 = 8 (counter)
+    addi(2, 0, 0x300),           # 0x04: x2 = buffer
+    add(3, 3, 1),                # 0x08: loop: x3 += x1
+    sw(3, 2, 0),                 # 0x0c
+    lw(4, 2, 0),                 # 0x10
+    add(5, 5, 4),                # 0x14: load-use
+    addi(1, 1, -1),              # 0x18
+    branch(0x1, 1, 0, -20),      # 0x1c: bne x1, x0, loop
+    HALT,                        # 0x20
+]
+
+
+def run_memory(program, enable_forwarding):
+    processor = RISCVProcessor(enable_forwarding=enable_forwarding)
+    load_program(processor.memory, program)
+    info = processor.execute_from_memory(0, max_cycles=5000, verbose=False)
+    return processor, info
+
+
+class TestForwarding(unittest.TestCase):
+    """Test bypassing removes ALU stalls and keeps results unchanged"""
+
+    def test_alu_chain_no_stalls(self):
+        """Test dependent ALU instructions forward from EX and MEM"""
+        program = ["ADDI R1, R0, 5", "ADD R2, R1, R1", "SUB R3, R2, R1", "OR R4, R3, R2"]
+        pipeline = run_text(program, True)
+
+        self.assertEqual(pipeline.stall_count, 0)
+        self.assertEqual(pipeline.register_file.read('R2'), 10)
+        self.assertEqual(pipeline.register_file.read('R3'), 5)
+        self.assertEqual(pipeline.register_file.read('R4'), 15)
+        self.assertEqual(pipeline.forward_ex_count, 4)
+        self.assertEqual(pipeline.forward_mem_count, 2)
+
+    def test_load_use_single_stall(self):
+        """Test a load-use hazard costs exactly one bubble"""
+        pipeline = run_text(["LW R1, 0(R2)", "ADD R3, R1, R1"], True, {'R2': 0x100})
+        self.assertEqual(pipeline.stall_count, 1)
+        self.assertEqual(pipeline.load_use_stalls, 1)
+        self.assertEqual(pipeline.forward_mem_count, 2)
+
+        legacy = run_text(["LW R1, 0(R2)", "ADD R3, R1, R1"], False, {'R2': 0x100})
+        self.assertGreater(legacy.stall_count, pipeline.stall_count)
+
+    def test_store_data_forwarded(self):
+        """Test store data written by the previous instruction reaches memory"""
+        pipeline = run_text(["ADDI R1, R0, 42", "SW R1, 64(R0)"], True)
+        self.assertEqual(pipeline.stall_count, 0)
+        self.assertEqual(pipeline.memory.read_word(0x40), 42)
+
+    def test_x0_never_forwarded(self):
+        """Test a discarded write to x0 is not bypassed to consumers"""
+        pipeline = run_text(["ADDI R0, R0, 7", "ADD R1, R0, R0"], True)
+        self.assertEqual(pipeline.register_file.read('R1'), 0)
+        self.assertEqual(pipeline.forward_ex_count, 0)
+
+    def test_csr_read_still_stalls(self):
+        """Test a CSR read (written back at WB) is not forwarded"""
+        pipeline = run_text(["CSRRS R1, 0x300, R0", "ADD R2, R1, R1"], True)
+        self.assertGreater(pipeline.stall_count, 0)
+        self.assertEqual(pipeline.load_use_stalls, 0)
+
+    def test_memory_mode_matches_legacy(self):
+        """Test the fetch engine gets the same state with fewer cycles"""
+        fast, fast_info = run_memory(LOOP_PROGRAM, True)
+        slow, slow_info = run_memory(LOOP_PROGRAM, False)
+
+        self.assertEqual(fast_info['halt_reason'], 'self_loop')
+        self.assertEqual(fast.get_register_state(), slow.get_register_state())
+        self.assertEqual(fast.get_register('R5'), 8 + 15 + 21 + 26 + 30 + 33 + 35 + 36)
+        self.assertEqual(fast_info['instructions_retired'], slow_info['instructions_retired'])
+        self.assertLess(fast_info['total_cycles'], slow_info['total_cycles'])
+        self.assertEqual(fast_info['load_use_stalls'], 8)
+        self.assertGreater(fast_info['forward_ex_count'], 0)
+        self.assertEqual(slow_info['forward_ex_count'], 0)
+
+    def test_reset_keeps_forwarding(self):
+        """Test reset() rebuilds the pipeline with the same configuration"""
+        processor = RISCVProcessor(enable_forwarding=True)
+        processor.reset()
+        self.assertTrue(processor.pipeline.enable_forwarding)
+        self.assertIs(processor.exe, processor.pipeline.exe)
+
+
+if __name__ == '__main__':
+    unittest.main()
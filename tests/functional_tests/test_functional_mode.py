@@ -0,0 +1,142 @@
+"""Tests for the functional (non-timing) simulation mode"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from riscv import RISCVProcessor
+from utils.rv32_encoder import (add, addi, sw, lw, branch, jal, jalr, csr, load_program,
+                                ECALL, MRET, HALT)
+
+
+# Sum 1..10 into x3 through a call, store it, reload it into x4
+SUM_PROGRAM = [
+    addi(1, 0, 10),              # 0x00: x1 = 10
+    jal(5, 0x14),                # 0x04: call sum (0x18)
+    sw(3, 0, 0x400),             # 0x08
+    lw(4, 0, 0x400),             # 0x0c
+    HALT,                        # 0x10
+    HALT,                        # 0x14
+    add(3, 3, 1),                # 0x18: sum: x3 += x1
+    addi(1, 1, -1),              # 0x1c
+    branch(0x1, 1, 0, -8),       # 0x20: bne x1, x0, sum
+    jalr(0, 5, 0),               # 0x24: ret
+]
+
+
+def make_processor(mode, program=SUM_PROGRAM):
+    processor = RISCVProcessor(mode=mode)
+    load_program(processor.memory, program)
+    return processor
+
+
+class TestFunctionalMode(unittest.TestCase):
+    """Test the functional core against the pipeline"""
+
+    def test_matches_pipeline_state(self):
+        """Test both engines end with the same architectural state"""
+        functional = make_processor('functional')
+        info = functional.execute_from_memory(0, max_cycles=1000, verbose=False)
+        pipelined = make_processor('pipeline')
+        pipelined.execute_from_memory(0, max_cycles=2000, verbose=False)
+
+        self.assertEqual(info['halt_reason'], 'self_loop')
+        self.assertEqual(functional.get_register('R3'), 55)
+        self.assertEqual(functional.get_register('R4'), 55)
+        self.assertEqual(functional.get_register_state(), pipelined.get_register_state())
+        self.assertEqual(functional.register_file.read_pc(), 0x10)
+
+    def test_counters_updated_in_bulk(self):
+        """Test instret/cycle CSRs are current when read and at the end of the run"""
+        processor = make_processor('functional', [
+            addi(1, 0, 1), addi(1, 1, 1), addi(1, 1, 1),
+            csr(0x2, 5, 0xC02, 0),       # csrr x5, instret
+            HALT,
+        ])
+        info = processor.execute_from_memory(0, max_cycles=100, verbose=False)
+
+        self.assertEqual(processor.get_register('R5'), 3)
+        self.assertEqual(info['instructions_retired'], 5)
+        self.assertEqual(processor.pipeline.csr_bank.read(0xB02), 5)
+        self.assertEqual(processor.pipeline.clint.mtime, info['total_cycles'])
+
+    def test_ecall_and_mret(self):
+        """Test traps vector to mtvec and MRET resumes"""
+        processor = make_processor('functional', [ECALL, addi(6, 0, 1), HALT])
+        load_program(processor.memory, [
+            csr(0x2, 7, 0x341, 0),       # csrr x7, mepc
+            addi(7, 7, 4),
+            csr(0x1, 0, 0x341, 7),       # csrw mepc, x7
+            MRET,
+        ], base=0x100)
+        processor.pipeline.csr_bank.write(0x305, 0x100)
+        processor.execute_from_memory(0, max_cycles=100, verbose=False)
+
+        self.assertEqual(processor.pipeline.csr_bank.read(0x342), 11)
+        self.assertEqual(processor.get_register('R6'), 1)
+        self.assertEqual(processor.functional.traps_taken, 1)
+
+    def test_timer_interrupt(self):
+        """Test the lazily-ticked CLINT still interrupts on time"""
+        processor = make_processor('functional', [HALT])
+        load_program(processor.memory, [addi(8, 0, 1), HALT], base=0x100)
+        csr_bank = processor.pipeline.csr_bank
+        csr_bank.write(0x305, 0x100)
+        csr_bank.write(0x304, 1 << 7)
+        csr_bank.write(0x300, 1 << 3)
+        processor.pipeline.clint.write_mtimecmp_64(250)
+        info = processor.execute_from_memory(0, max_cycles=10000, verbose=False)
+
+        self.assertEqual(info['halt_reason'], 'self_loop')
+        self.assertEqual(processor.get_register('R8'), 1)
+        self.assertEqual(csr_bank.read(0x342), 0x80000007)
+        self.assertEqual(csr_bank.read(0x341), 0)
+        self.assertEqual(processor.functional.interrupts_taken, 1)
+        self.assertLess(info['total_cycles'], 260)
+
+    def test_max_cycles(self):
+        """Test the cycle budget ends an interruptible spin loop"""
+        processor = make_processor('functional', [HALT])
+        processor.pipeline.csr_bank.write(0x304, 1 << 7)
+        processor.pipeline.csr_bank.write(0x300, 1 << 3)
+        info = processor.execute_from_memory(0, max_cycles=500, verbose=False)
+
+        self.assertEqual(info['halt_reason'], 'max_cycles')
+        self.assertEqual(info['total_cycles'], 500)
+
+    def test_unknown_mode_rejected(self):
+        """Test an invalid mode name raises"""
+        with self.assertRaises(ValueError):
+            RISCVProcessor(mode='turbo')
+
+
+class TestFastForward(unittest.TestCase):
+    """Test handing functional state to the pipeline"""
+
+    def test_stop_at_pc(self):
+        """Test fast_forward stops before the requested PC"""
+        processor = make_processor('pipeline')
+        self.assertEqual(processor.fast_forward(stop_pc=0x08), 'stop_pc')
+        self.assertEqual(processor.register_file.read_pc(), 0x08)
+        self.assertEqual(processor.get_register('R3'), 55)
+        self.assertEqual(processor.memory.read_word(0x400), 0)
+
+    def test_handoff_to_pipeline(self):
+        """Test the pipeline continues from a functional stop point"""
+        processor = make_processor('pipeline')
+        self.assertEqual(processor.fast_forward(stop_instret=12), 'stop_instret')
+        self.assertEqual(processor.functional.instret, 12)
+
+        info = processor.execute_from_memory(max_cycles=2000, verbose=False)
+        reference = make_processor('pipeline')
+        reference.execute_from_memory(0, max_cycles=2000, verbose=False)
+
+        self.assertEqual(info['halt_reason'], 'self_loop')
+        self.assertEqual(processor.get_register_state(), reference.get_register_state())
+        self.assertLess(info['instructions_retired'], len(reference.pipeline.completed_instructions))
+
+
+if __name__ == '__main__':
+    unittest.main()
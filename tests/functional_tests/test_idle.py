@@ -0,0 +1,207 @@
+"""Tests for WFI and idle fast-forward (sleeping through idle loops to the next timer event)"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from riscv import RISCVProcessor
+from instruction import Opcode, decode_instruction_word, parse_instruction_text
+from retire_trace import FLAG_IDLE, read_retire_trace
+from stage_trace import FLAG_IDLE as STAGE_FLAG_IDLE, read_stage_trace
+from utils.rv32_encoder import addi, lui, sw, branch, csr, load_program, MRET, WFI, HALT
+
+
+HANDLER = 0x200
+TIMER_DUE = 600
+
+
+def timer_setup(enable_interrupts):
+    """mtvec = HANDLER, mtimecmp = TIMER_DUE, mie.MTIE (and mstatus.MIE)"""
+    words = [
+        addi(14, 0, HANDLER), csr(0x1, 0, 0x305, 14),    # mtvec
+        lui(12, 0x02004),                                # x12 = &mtimecmp
+        sw(0, 12, 4),
+        addi(14, 0, TIMER_DUE), sw(14, 12, 0),
+        addi(14, 0, 0x80), csr(0x2, 0, 0x304, 14),       # mie.MTIE
+    ]
+    if enable_interrupts:
+        words += [addi(14, 0, 0x8), csr(0x2, 0, 0x300, 14)]  # mstatus.MIE
+    return words
+
+
+# Counts the interrupt in x6 and masks further ones, so the final HALT halts
+TIMER_HANDLER = [addi(6, 6, 1), csr(0x1, 0, 0x304, 0), MRET]
+
+
+def run(mode, program, fast_forward_idle=True, setup=None):
+    processor = RISCVProcessor(mode=mode)
+    processor.pipeline.fast_forward_idle = fast_forward_idle
+    if setup is not None:
+        setup(processor)
+    load_program(processor.memory, program)
+    load_program(processor.memory, TIMER_HANDLER, base=HANDLER)
+    info = processor.execute_from_memory(0, max_cycles=5000, verbose=False)
+    return processor, info
+
+
+class TestWFI(unittest.TestCase):
+    """Test WFI sleeps until an enabled interrupt is pending"""
+
+    def test_decode(self):
+        """Test WFI decodes from its word and from assembly text"""
+        self.assertEqual(decode_instruction_word(WFI).opcode, Opcode.WFI)
+        self.assertEqual(decode_instruction_word(WFI).text, 'WFI')
+        self.assertEqual(parse_instruction_text('WFI').opcode, Opcode.WFI)
+
+    def test_wakes_without_trap(self):
+        """Test a masked (mstatus.MIE off) timer interrupt wakes WFI, which falls through"""
+        program = [*timer_setup(enable_interrupts=False), WFI, addi(5, 5, 1), HALT]
+        for mode in RISCVProcessor.MODES:
+            with self.subTest(mode=mode):
+                processor, info = run(mode, program)
+                self.assertEqual(info['halt_reason'], 'self_loop')
+                self.assertEqual(processor.register_file.read_index(5), 1)
+                self.assertEqual(processor.register_file.read_index(6), 0)
+                self.assertGreaterEqual(info['total_cycles'], TIMER_DUE)
+                self.assertGreater(info['idle_cycles'], TIMER_DUE - 50)
+
+    def test_interrupt_taken_after_wfi(self):
+        """Test an enabled interrupt ends the sleep with mepc at the instruction after WFI"""
+        setup = timer_setup(enable_interrupts=True)
+        program = [*setup, WFI, addi(5, 5, 1), HALT]
+        for mode in RISCVProcessor.MODES:
+            with self.subTest(mode=mode):
+                processor, info = run(mode, program)
+                self.assertEqual(info['halt_reason'], 'self_loop')
+                self.assertEqual(processor.register_file.read_index(6), 1)
+                self.assertEqual(processor.register_file.read_index(5), 1)
+                self.assertEqual(processor.pipeline.csr_bank.read(0x341), 4 * (len(setup) + 1))
+
+    def test_nothing_can_wake(self):
+        """Test a WFI with no enabled interrupt source ends the run right after it"""
+        for mode in RISCVProcessor.MODES:
+            with self.subTest(mode=mode):
+                processor, info = run(mode, [addi(1, 0, 1), WFI, addi(5, 5, 1), HALT])
+                self.assertEqual(info['halt_reason'], 'self_loop')
+                self.assertEqual(processor.register_file.read_pc(), 0x08)
+                self.assertEqual(processor.register_file.read_index(5), 0)
+                self.assertLess(info['total_cycles'], 20)
+
+    def test_fast_forward_is_exact(self):
+        """Test sleeping through WFI takes exactly as long as waiting cycle by cycle"""
+        program = [*timer_setup(enable_interrupts=False), WFI, addi(5, 5, 1), HALT]
+        for mode in ('pipeline', 'clocked'):
+            with self.subTest(mode=mode):
+                _, fast = run(mode, program)
+                _, slow = run(mode, program, fast_forward_idle=False)
+                self.assertEqual(fast['total_cycles'], slow['total_cycles'])
+                self.assertEqual(fast['instructions_retired'], slow['instructions_retired'])
+                self.assertEqual(slow['idle_cycles'], 0)
+
+
+class TestIdleLoops(unittest.TestCase):
+    """Test branches/jumps to themselves are skipped up to the next timer event"""
+
+    # Spins until the handler has counted the interrupt
+    PROGRAM = [*timer_setup(enable_interrupts=True), branch(0x0, 6, 0, 0), addi(5, 5, 1), HALT]
+
+    def test_sleeps_to_timer(self):
+        """Test the spin is left through the timer interrupt, with the idle time skipped"""
+        for mode in RISCVProcessor.MODES:
+            with self.subTest(mode=mode):
+                processor, info = run(mode, self.PROGRAM)
+                self.assertEqual(info['halt_reason'], 'self_loop')
+                self.assertEqual(processor.register_file.read_index(6), 1)
+                self.assertEqual(processor.register_file.read_index(5), 1)
+                self.assertGreaterEqual(info['total_cycles'], TIMER_DUE)
+                self.assertGreater(info['idle_cycles'], TIMER_DUE - 50)
+
+    def test_functional_counts_skipped_iterations(self):
+        """Test the functional core retires the skipped iterations (one per cycle)"""
+        processor, info = run('functional', self.PROGRAM)
+        self.assertEqual(info['instructions_retired'], info['total_cycles'])
+        self.assertGreater(info['total_cycles'], TIMER_DUE)
+
+    def test_pipelines_count_skipped_iterations(self):
+        """Test the pipelines retire as many iterations sleeping through a loop as spinning in it"""
+        for mode in ('pipeline', 'clocked'):
+            with self.subTest(mode=mode):
+                _, fast = run(mode, self.PROGRAM)
+                _, slow = run(mode, self.PROGRAM, fast_forward_idle=False)
+                self.assertGreater(fast['idle_cycles'], TIMER_DUE - 50)
+                # Within the iteration measuring the loop and the part of one cut off
+                self.assertAlmostEqual(fast['instructions_retired'], slow['instructions_retired'], delta=3)
+
+    def test_profiler_charges_loop(self):
+        """Test the profiler charges the skipped cycles and iterations to the loop's branch"""
+        loop_pc = 4 * len(timer_setup(enable_interrupts=True))
+        for mode in ('pipeline', 'clocked'):
+            with self.subTest(mode=mode):
+                profilers = []
+                _, info = run(mode, self.PROGRAM, setup=lambda processor: profilers.append(processor.enable_profiler()))
+                profiler = profilers[0]
+                self.assertEqual(profiler.total_cycles, info['total_cycles'])
+                self.assertGreater(profiler.pc_cycles[loop_pc], info['idle_cycles'])
+                self.assertEqual(sum(profiler.pc_retired.values()), info['instructions_retired'])
+                self.assertGreater(profiler.pc_retired[loop_pc], info['instructions_retired'] // 2)
+
+    def test_traces_note_skipped_iterations(self):
+        """Test the retire and stage traces hold one idle record for the sleep"""
+        loop_pc = 4 * len(timer_setup(enable_interrupts=True))
+        for mode in ('pipeline', 'clocked'):
+            with self.subTest(mode=mode):
+                traces = []
+                _, info = run(mode, self.PROGRAM, setup=lambda processor: traces.extend(
+                    (processor.enable_retire_trace(), processor.enable_stage_trace())))
+                retire_trace, stage_trace = traces
+                records = list(read_retire_trace(retire_trace))
+                idle = [record for record in records if record.flags & FLAG_IDLE]
+                self.assertEqual(len(idle), 1)
+                self.assertEqual(idle[0].pc, loop_pc)
+                self.assertEqual(idle[0].mem_data, info['idle_cycles'])
+                self.assertEqual(len(records) - 1 + idle[0].value, info['instructions_retired'])
+                stage_trace.close()
+                idle = [record for record in read_stage_trace(stage_trace) if record.flags & STAGE_FLAG_IDLE]
+                self.assertEqual([(record.pc, record.end) for record in idle], [(loop_pc, info['idle_cycles'])])
+
+    def test_max_instret_ends_sleep(self):
+        """Test the retired iteration count stops at max_instret mid-sleep"""
+        for mode in RISCVProcessor.MODES:
+            with self.subTest(mode=mode):
+                processor = RISCVProcessor(mode=mode)
+                load_program(processor.memory, self.PROGRAM)
+                load_program(processor.memory, TIMER_HANDLER, base=HANDLER)
+                info = processor.execute_from_memory(0, max_cycles=5000, verbose=False, max_instret=60)
+                self.assertEqual(info['halt_reason'], 'max_instret')
+                self.assertEqual(info['instructions_retired'], 60)
+                self.assertEqual(processor.register_file.read_index(6), 0)
+
+    def test_pipelines_agree(self):
+        """Test both pipeline engines sleep identically"""
+        (_, simpy_info), (_, clocked_info) = (run(mode, self.PROGRAM) for mode in ('pipeline', 'clocked'))
+        for key in ('total_cycles', 'instructions_retired', 'idle_cycles', 'flush_count'):
+            self.assertEqual(clocked_info[key], simpy_info[key], key)
+
+    def test_disabled(self):
+        """Test fast_forward_idle=False spins through the loop instead"""
+        processor, info = run('pipeline', self.PROGRAM, fast_forward_idle=False)
+        self.assertEqual(processor.register_file.read_index(6), 1)
+        self.assertEqual(info['idle_cycles'], 0)
+        self.assertGreater(info['instructions_retired'], 100)
+
+    def test_interruptible_loop_without_timer(self):
+        """Test a loop no event is scheduled for sleeps out the run to max_cycles"""
+        program = [addi(14, 0, 0x8), csr(0x2, 0, 0x300, 14), addi(14, 0, 0x8), csr(0x2, 0, 0x304, 14),
+                   branch(0x0, 0, 0, 0)]
+        for mode in ('pipeline', 'clocked'):
+            with self.subTest(mode=mode):
+                processor, info = run(mode, program)
+                self.assertEqual(info['halt_reason'], 'max_cycles')
+                self.assertEqual(info['total_cycles'], 5000)
+                self.assertGreater(info['idle_cycles'], 4900)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -7,6 +7,7 @@ edge/level triggering, and deliverability.
 import unittest
 from interrupt import InterruptController, InterruptSource
 from csr import CSRBank
+from trap import TrapController
 
 
 class TestInterruptController(unittest.TestCase):
@@ -392,5 +393,67 @@ class TestInterruptSource(unittest.TestCase):
         self.assertTrue(self.ic.is_pending(InterruptController.INT_TIMER))
 
 
+class TestDeliverableMask(unittest.TestCase):
+    """Test the cached deliverable-interrupt mask follows mstatus/mie/mip"""
+    
+    def setUp(self):
+        """Set up test fixtures"""
+        self.csr = CSRBank()
+        self.trap = TrapController(self.csr)
+        self.ic = self.trap.interrupt_controller
+    
+    def test_mask_follows_csr_writes(self):
+        """Test every way of changing mstatus, mie and mip updates the mask"""
+        self.ic.set_pending(InterruptController.INT_TIMER)
+        self.assertEqual(self.csr.deliverable, 0)
+        self.csr.set_bits(0x304, 1 << 7)          # CSRRS mie
+        self.assertEqual(self.csr.deliverable, 0)
+        self.csr.write(0x300, 1 << 3)             # CSRRW mstatus
+        self.assertEqual(self.csr.deliverable, 1 << 7)
+        self.csr.clear_bits(0x344, 1 << 7)        # CSRRC mip
+        self.assertEqual(self.csr.deliverable, 0)
+        self.ic.set_pending(InterruptController.INT_TIMER)
+        self.ic.disable_global_interrupts()
+        self.assertFalse(self.trap.has_deliverable_interrupt())
+    
+    def test_mask_matches_csr_state(self):
+        """Test the mask equals the value recomputed from the CSRs for every state"""
+        for mstatus in (0, 1 << 3):
+            for mie in range(0, 1 << 12, 0x88):
+                for mip in (0, 1 << 3, 1 << 7, 1 << 11, 0x888, 0xFFF):
+                    self.csr.write(0x300, mstatus)
+                    self.csr.write(0x304, mie)
+                    self.csr.write(0x344, mip)
+                    expected = mip & mie & 0x888 if mstatus else 0
+                    self.assertEqual(self.csr.deliverable, expected)
+    
+    def test_legacy_and_mip_share_priority(self):
+        """Test legacy pending interrupts and mip bits are taken highest priority first"""
+        self.csr.write(0x304, 0x888)
+        self.trap.trigger_interrupt(TrapController.INTERRUPT_EXTERNAL)  # MIE clear: held
+        self.assertEqual(self.csr.read(0x344), 0)
+        self.assertFalse(self.trap.has_deliverable_interrupt())
+        self.ic.set_pending(InterruptController.INT_TIMER)
+        self.ic.enable_global_interrupts()
+        self.assertEqual(self.ic.get_highest_priority_interrupt(), InterruptController.INT_EXTERNAL)
+        
+        causes = []
+        while self.trap.has_deliverable_interrupt():
+            causes.append(self.trap.check_pending_interrupts(0x1000)['cause'])
+            self.ic.enable_global_interrupts()  # As MRET would
+        self.assertEqual(causes, [TrapController.INTERRUPT_EXTERNAL, TrapController.INTERRUPT_TIMER])
+        self.assertEqual(self.trap.pending_interrupts, set())
+        self.assertIsNone(self.trap.check_pending_interrupts(0x1000))
+    
+    def test_pending_set_assignment(self):
+        """Test assigning the legacy pending set (checkpoint restore) updates the mask"""
+        self.csr.write(0x304, 1 << 3)
+        self.ic.enable_global_interrupts()
+        self.trap.pending_interrupts = {TrapController.INTERRUPT_SOFTWARE}
+        self.assertEqual(self.csr.deliverable, 1 << 3)
+        self.trap.pending_interrupts = set()
+        self.assertEqual(self.csr.deliverable, 0)
+
+
 if __name__ == '__main__':
     unittest.main()
@@ -8,6 +8,19 @@ sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspa
 
 import simpy
 from pipeline import Pipeline
+from riscv import RISCVProcessor
+from utils.rv32_encoder import i_type, s_type, addi, lui, lw, sw, branch, jal, csr, load_program, HALT
+
+
+HANDLER = 0x100
+
+
+def lh(rd, rs1, imm):
+    return i_type(imm, rs1, 0x1, rd, opcode=0x03)
+
+
+def sh(rs2, rs1, imm):
+    return s_type(imm, rs2, rs1, 0x1)
 
 
 class TestLoadStoreInstructions(unittest.TestCase):
@@ -291,6 +304,62 @@ class TestLoadStoreInstructions(unittest.TestCase):
         self.assertEqual(self.pipeline.register_file.read('R22'), 0x22222222)
 
 
+class TestMemoryFaults(unittest.TestCase):
+    """Test misaligned and unmapped loads/stores trap instead of stopping the simulator"""
+    
+    def run_fault(self, mode, setup, access):
+        """Run setup then the faulting access (at 0xc) with mtvec = HANDLER"""
+        program = [addi(14, 0, HANDLER), csr(0x1, 0, 0x305, 14), setup, access, addi(3, 0, 1), HALT]
+        processor = RISCVProcessor(mode=mode)
+        load_program(processor.memory, program)
+        load_program(processor.memory, [HALT], base=HANDLER)
+        info = processor.execute_from_memory(0, max_cycles=200, verbose=False)
+        return processor, info
+    
+    def test_faults_trap_in_every_mode(self):
+        """Test each access takes its exception with mepc at the access and mtval = address"""
+        cases = [
+            ('unmapped load', lui(1, 0x40000), lw(2, 1, 0), 5, 0x40000000),
+            ('misaligned load', addi(1, 0, 2), lw(2, 1, 0), 4, 0x2),
+            ('misaligned halfword load', addi(1, 0, 1), lh(2, 1, 0), 4, 0x1),
+            ('unmapped store', lui(1, 0x40000), sw(0, 1, 8), 7, 0x40000008),
+            ('misaligned store', addi(1, 0, 6), sw(0, 1, 0), 6, 0x6),
+            ('misaligned halfword store', addi(1, 0, 3), sh(0, 1, 0), 6, 0x3),
+        ]
+        for mode in RISCVProcessor.MODES:
+            for name, setup, access, cause, address in cases:
+                with self.subTest(mode=mode, access=name):
+                    processor, info = self.run_fault(mode, setup, access)
+                    csr_bank = processor.pipeline.csr_bank
+                    self.assertEqual(info['halt_reason'], 'self_loop')
+                    self.assertEqual(csr_bank.read(0x342), cause)
+                    self.assertEqual(csr_bank.read(0x341), 0xc)
+                    self.assertEqual(csr_bank.read(0x343), address)
+                    self.assertEqual(processor.register_file.read_index(2), 0)
+                    self.assertEqual(processor.register_file.read_index(3), 0)
+    
+    def test_translated_block_fault(self):
+        """Test a load in a translated block that turns misaligned traps precisely"""
+        program = [
+            addi(14, 0, HANDLER), csr(0x1, 0, 0x305, 14),
+            addi(5, 0, 12),              # 0x08
+            lw(2, 1, 0),                 # 0x0c: loop (x1 = 0 at first)
+            addi(5, 5, -1),              # 0x10
+            branch(0x1, 5, 0, -8),       # 0x14: bne x5, x0, loop
+            addi(1, 1, 2),               # 0x18: x1 = 2: misaligned from now on
+            addi(5, 0, 1),               # 0x1c
+            jal(0, -20),                 # 0x20: j loop
+        ]
+        processor = RISCVProcessor(mode='functional')
+        load_program(processor.memory, program)
+        load_program(processor.memory, [HALT], base=HANDLER)
+        processor.execute_from_memory(0, max_cycles=500, verbose=False)
+        csr_bank = processor.pipeline.csr_bank
+        self.assertGreater(processor.functional.block_cache.translated, 0)
+        self.assertEqual((csr_bank.read(0x342), csr_bank.read(0x341), csr_bank.read(0x343)), (4, 0x0c, 2))
+        self.assertEqual(processor.register_file.read_index(5), 1)
+
+
 def run_tests():
     """Run all tests in this module"""
     loader = unittest.TestLoader()
@@ -0,0 +1,107 @@
+"""Tests for the address-decoded memory bus (RAM fast path and device regions)"""
+import sys
+import os
+import io
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from memory import Memory
+from uart import UART
+from clint import CLINT
+from interrupt import InterruptController
+from csr import CSRBank
+
+
+class ScratchDevice:
+    """Word-register device recording every access"""
+
+    def __init__(self):
+        self.registers = {}
+        self.writes = []
+
+    def read_register(self, address):
+        return self.registers.get(address)
+
+    def write_register(self, address, value):
+        self.writes.append((address, value))
+        self.registers[address] = value
+
+
+class TestMemoryBus(unittest.TestCase):
+    """Test MMIO decode at every access width"""
+
+    def setUp(self):
+        self.output = io.StringIO()
+        self.uart = UART(output_stream=self.output)
+        self.clint = CLINT(InterruptController(CSRBank()))
+        self.memory = Memory(size=4096, uart=self.uart, clint=self.clint)
+
+    def test_regions_sorted(self):
+        """Test RAM, CLINT and UART are mapped in address order"""
+        self.assertEqual([r.name for r in self.memory.regions], ['ram', 'clint', 'uart'])
+        self.assertIs(self.memory.find_region(UART.TX_DATA_REG).device, self.uart)
+        self.assertIs(self.memory.find_region(CLINT.MTIME_BASE + 4).device, self.clint)
+        self.assertTrue(self.memory.find_region(0x100).is_ram)
+        self.assertIsNone(self.memory.find_region(0x2000))
+
+    def test_uart_byte_store_transmits(self):
+        """Test SB/SH/SW to UART TX all transmit instead of landing in RAM"""
+        self.memory.write_byte(UART.TX_DATA_REG, ord('a'))
+        self.memory.write_halfword(UART.TX_DATA_REG, ord('b'))
+        self.memory.write_word(UART.TX_DATA_REG, 0x1234_5600 | ord('c'))
+        self.uart.flush()
+        self.assertEqual(self.output.getvalue(), 'abc')
+        ready = UART.STATUS_TX_READY | UART.STATUS_TX_EMPTY
+        self.assertEqual(self.memory.read_byte(UART.STATUS_REG), ready)
+        self.assertEqual(self.memory.read_word(UART.STATUS_REG), ready)
+
+    def test_clint_sub_word_access(self):
+        """Test byte/halfword stores read-modify-write CLINT word registers"""
+        self.clint.mtimecmp = 0
+        self.memory.write_byte(CLINT.MTIMECMP_BASE + 1, 0x12)
+        self.memory.write_halfword(CLINT.MTIMECMP_BASE + 6, 0xABCD)
+        self.assertEqual(self.clint.mtimecmp, 0xABCD_0000_0000_1200)
+        self.assertEqual(self.memory.read_byte(CLINT.MTIMECMP_BASE + 1), 0x12)
+        self.assertEqual(self.memory.read_halfword(CLINT.MTIMECMP_BASE + 6, signed=True), 0xFFFFABCD)
+
+        self.memory.write_byte(CLINT.MSIP_BASE, 1)
+        self.assertEqual(self.clint.msip, 1)
+
+    def test_ram_bounds_and_alignment(self):
+        """Test RAM keeps its bounds and alignment errors"""
+        self.memory.write_word(4092, 0xDEADBEEF)
+        self.assertEqual(self.memory.read_byte(4095), 0xDE)
+        with self.assertRaisesRegex(ValueError, 'out of bounds'):
+            self.memory.read_word(4096)
+        with self.assertRaisesRegex(ValueError, 'out of bounds'):
+            self.memory.write_halfword(4095, 0)
+        with self.assertRaisesRegex(ValueError, 'Misaligned word'):
+            self.memory.read_word(2)
+        with self.assertRaisesRegex(ValueError, 'Misaligned halfword'):
+            self.memory.write_halfword(CLINT.MTIMECMP_BASE + 1, 0)
+
+    def test_map_device(self):
+        """Test a custom device receives accesses inside its window only"""
+        device = ScratchDevice()
+        region = self.memory.map_device(0x4000_0000, 0x100, device, name='scratch')
+        self.assertEqual(self.memory.find_region(0x4000_00FF), region)
+        self.memory.write_word(0x4000_0010, 0x11223344)
+        self.memory.write_byte(0x4000_0013, 0xAA)
+        self.assertEqual(device.writes[-1], (0x4000_0010, 0xAA223344))
+        self.assertEqual(self.memory.read_halfword(0x4000_0012), 0xAA22)
+        with self.assertRaisesRegex(ValueError, 'out of bounds'):
+            self.memory.read_word(0x4000_0100)
+
+    def test_overlapping_regions_rejected(self):
+        """Test map_device refuses windows overlapping RAM or other devices"""
+        with self.assertRaisesRegex(ValueError, 'overlaps ram'):
+            self.memory.map_device(4092, 8, ScratchDevice())
+        with self.assertRaisesRegex(ValueError, 'overlaps uart'):
+            self.memory.map_device(UART.TX_DATA_REG - 4, 8, ScratchDevice())
+        self.memory.map_device(UART.TX_DATA_REG + UART.WINDOW_SIZE, 4, ScratchDevice())
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -22,7 +22,7 @@ class TestMRETInstruction(unittest.TestCase):
         instr = Instruction("MRET")
         self.assertEqual(instr.operation, "MRET")
         self.assertIsNone(instr.dest_reg)
-        self.assertEqual(instr.src_regs, [])
+        self.assertEqual(instr.src_regs, ())
     
     def test_mret_case_insensitive(self):
         """Test MRET parsing is case insensitive"""
@@ -0,0 +1,266 @@
+"""Tests for multi-hart simulation: per-hart CLINT state, LR/SC/AMO hooks and quantum scheduling"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from multihart import MultiHartSystem
+from clint import CLINT
+from csr import CSRBank
+from memory import Memory
+from interrupt import InterruptController
+from utils.rv32_encoder import addi, lui, sw, branch, csr, load_program, WFI, HALT
+
+
+MSIP_HART1 = CLINT.MSIP_BASE + 4
+
+
+def slli(rd, rs1, shamt):
+    return (shamt << 20) | (rs1 << 15) | (0x1 << 12) | (rd << 7) | 0x13
+
+
+# Every hart stores mhartid + 1 to 0x400 + 4 * mhartid
+HART_ID_PROGRAM = [
+    csr(0x2, 5, 0xF14, 0),         # 0x00: x5 = mhartid
+    addi(6, 5, 1),                 # 0x04: x6 = mhartid + 1
+    slli(7, 5, 2),                 # 0x08: x7 = 4 * mhartid
+    addi(8, 7, 0x400),             # 0x0c
+    sw(6, 8, 0),                   # 0x10
+    HALT,                          # 0x14
+]
+
+# Hart 1 sleeps until hart 0 raises its software interrupt, then stores its
+# loop count; hart 0 counts down 50 iterations first
+IPI_PROGRAM = [
+    csr(0x2, 5, 0xF14, 0),         # 0x00: x5 = mhartid
+    branch(0x1, 5, 0, 32),         # 0x04: bne x5, x0, hart1
+    addi(1, 0, 50),                # 0x08: hart 0
+    addi(1, 1, -1),                # 0x0c: spin
+    branch(0x1, 1, 0, -4),         # 0x10: bne x1, x0, spin
+    lui(2, 0x2000), addi(3, 0, 1), # 0x14: x2 = CLINT
+    sw(3, 2, 4),                   # 0x1c: hart 1's msip = 1
+    HALT,                          # 0x20
+    addi(1, 0, 8),                 # 0x24: hart1: x1 = MSIE
+    csr(0x1, 0, 0x304, 1),         # 0x28: mie = MSIE (mstatus.MIE clear: WFI just wakes)
+    WFI,                           # 0x2c
+    addi(4, 0, 0x500),             # 0x30
+    sw(1, 4, 0),                   # 0x34
+    HALT,                          # 0x38
+]
+
+
+class TestPerHartClint(unittest.TestCase):
+    """Test msip and mtimecmp at the standard per-hart offsets"""
+
+    def setUp(self):
+        self.csrs = [CSRBank(hartid) for hartid in range(2)]
+        self.controllers = [InterruptController(bank) for bank in self.csrs]
+        self.clint = CLINT(self.controllers[0])
+        self.assertEqual(self.clint.add_hart(self.controllers[1]), 1)
+
+    def mip(self, hart):
+        return self.csrs[hart].read(0x344)
+
+    def test_msip_per_hart(self):
+        """Test each hart's msip raises only its own software interrupt"""
+        self.clint.write_register(MSIP_HART1, 1)
+        self.assertEqual((self.mip(0), self.mip(1)), (0, 1 << 3))
+        self.assertEqual(self.clint.read_register(MSIP_HART1), 1)
+        self.assertEqual(self.clint.msip, 0)
+        self.clint.write_register(MSIP_HART1, 0)
+        self.assertEqual(self.mip(1), 0)
+
+    def test_mtimecmp_per_hart(self):
+        """Test each hart's compare fires its own timer interrupt against the shared mtime"""
+        self.clint.write_register(CLINT.MTIMECMP_BASE, 30)
+        self.clint.write_register(CLINT.MTIMECMP_BASE + 4, 0)
+        self.clint.write_register(CLINT.MTIMECMP_BASE + 8, 10)
+        self.clint.write_register(CLINT.MTIMECMP_BASE + 12, 0)
+        self.assertEqual(self.clint.get_mtimecmp(1), 10)
+        self.assertEqual(self.clint.cycles_until_timer(), 10)
+        self.clint.tick(10)
+        self.assertEqual((self.mip(0), self.mip(1)), (0, 1 << 7))
+        self.assertEqual(self.clint.cycles_until_timer(), 20)
+        self.clint.tick(20)
+        self.assertEqual(self.mip(0), 1 << 7)
+
+    def test_active_hart_and_rewind(self):
+        """Test only the active hart's compare fires, and rewind() returns the clock"""
+        self.clint.set_mtimecmp(0, 5)
+        self.clint.set_mtimecmp(1, 5)
+        self.clint.active_hart = 1
+        self.clint.tick(10)
+        self.assertEqual((self.mip(0), self.mip(1)), (0, 1 << 7))
+        self.clint.rewind(0)
+        self.assertEqual(self.clint.now, 0)
+        self.clint.active_hart = None
+        self.clint.tick(10)
+        self.assertEqual(self.mip(0), 1 << 7)
+
+    def test_mhartid(self):
+        """Test mhartid is the hart number and read-only"""
+        self.csrs[1].write(0xF14, 7)
+        self.assertEqual([bank.read(0xF14) for bank in self.csrs], [0, 1])
+
+
+class TestAtomicHooks(unittest.TestCase):
+    """Test the LR/SC reservation and AMO hooks on Memory"""
+
+    def setUp(self):
+        self.memory = Memory(size=0x2000)
+        self.memory.write_word(0x100, 5)  # Page now in the fast write table
+
+    def test_sc_succeeds_on_reservation(self):
+        """Test SC stores once after LR and fails without a reservation"""
+        self.assertEqual(self.memory.load_reserved(0, 0x100), 5)
+        self.assertTrue(self.memory.store_conditional(0, 0x100, 6))
+        self.assertEqual(self.memory.read_word(0x100), 6)
+        self.assertFalse(self.memory.store_conditional(0, 0x100, 7))
+        self.assertEqual(self.memory.read_word(0x100), 6)
+
+    def test_store_breaks_reservation(self):
+        """Test an ordinary store to the word (fast path page) breaks every reservation on it"""
+        self.memory.load_reserved(0, 0x100)
+        self.memory.load_reserved(1, 0x100)
+        self.memory.write_byte(0x102, 1)
+        for hart in (0, 1):
+            self.assertFalse(self.memory.store_conditional(hart, 0x100, 9))
+        self.assertEqual(self.memory.read_word(0x100), 0x10005)
+
+    def test_other_words_keep_reservation(self):
+        """Test stores elsewhere on the page, and another hart's SC, leave a reservation alone"""
+        self.memory.load_reserved(0, 0x100)
+        self.memory.write_word(0x104, 1)
+        self.assertFalse(self.memory.store_conditional(1, 0x100, 8))
+        self.assertTrue(self.memory.store_conditional(0, 0x100, 9))
+        # Unreserved again: the page goes back to the fast write table
+        self.memory.write_word(0x108, 1)
+        self.assertIn(0, self.memory._write_pages)
+
+    def test_amo(self):
+        """Test an AMO returns the old word and breaks reservations"""
+        self.memory.load_reserved(1, 0x100)
+        self.assertEqual(self.memory.amo_word(0x100, lambda old: old + 3), 5)
+        self.assertEqual(self.memory.read_word(0x100), 8)
+        self.assertFalse(self.memory.store_conditional(1, 0x100, 0))
+
+
+class TestScheduler(unittest.TestCase):
+    """Test harts run in quanta on the shared bus"""
+
+    def test_harts_share_memory(self):
+        """Test every hart runs the same image with its own mhartid"""
+        for translate in (True, False):
+            with self.subTest(translate=translate):
+                system = MultiHartSystem(num_harts=4, quantum=3, translate=translate)
+                load_program(system.memory, HART_ID_PROGRAM)
+                reasons = system.run(max_cycles=1000, entry_pc=0)
+                self.assertEqual(reasons, ['self_loop'] * 4)
+                self.assertEqual([system.memory.read_word(0x400 + 4 * hart) for hart in range(4)], [1, 2, 3, 4])
+                self.assertLess(system.cycles, 1000)
+
+    def test_ipi_wakes_sleeping_hart(self):
+        """Test a msip write by one hart wakes another from WFI within a quantum"""
+        for quantum in (1, 16, 64):
+            with self.subTest(quantum=quantum):
+                system = MultiHartSystem(num_harts=2, quantum=quantum)
+                load_program(system.memory, IPI_PROGRAM)
+                self.assertEqual(system.run(max_cycles=2000, entry_pc=0), ['self_loop'] * 2)
+                self.assertEqual(system.memory.read_word(0x500), 8)
+                self.assertEqual(system.harts[1].csr_bank.read(0x344), 1 << 3)
+                # Hart 0 stores msip in cycle 106; hart 1 runs the same quantum's
+                # cycles before or after it, so it wakes up to a quantum apart
+                woke = system.harts[1].core.cycles - 3  # Then ADDI, SW, J .
+                self.assertLessEqual(abs(woke - 106), quantum)
+                self.assertEqual(system.harts[0].core.cycles, 107)
+
+    def test_sleeping_hart_stays_in_quantum(self):
+        """Test a hart in WFI with nothing to wake it sleeps out each quantum instead of halting"""
+        system = MultiHartSystem(num_harts=2, quantum=50)
+        program = [addi(1, 0, 8), csr(0x1, 0, 0x304, 1), WFI, HALT]
+        load_program(system.memory, program)
+        self.assertEqual(system.run(max_cycles=500, entry_pc=0), [None, None])
+        self.assertEqual((system.cycles, system.quanta), (500, 10))
+        for hart in system.harts:
+            self.assertEqual(hart.core.cycles, 500)
+            self.assertEqual(hart.register_file.pc, 8)  # Still at the WFI
+        self.assertEqual(system.clint.mtime, 500)
+
+    def test_invalid_configuration(self):
+        """Test a system needs a hart and a positive quantum"""
+        with self.assertRaises(ValueError):
+            MultiHartSystem(num_harts=0)
+        with self.assertRaises(ValueError):
+            MultiHartSystem(quantum=0)
+
+
+class TestParallel(unittest.TestCase):
+    """Test harts run in worker processes over shared-memory RAM"""
+
+    def run_system(self, program, num_harts=2, quantum=64, max_cycles=2000):
+        system = MultiHartSystem(num_harts=num_harts, quantum=quantum, parallel=True)
+        self.addCleanup(system.close)
+        system.uart.capture = True
+        load_program(system.memory, program)
+        return system, system.run(max_cycles=max_cycles, entry_pc=0)
+
+    def test_matches_serial_run(self):
+        """Test every hart's stores and final state come back as after a serial run"""
+        system, reasons = self.run_system(HART_ID_PROGRAM, num_harts=4, quantum=3)
+        serial = MultiHartSystem(num_harts=4, quantum=3)
+        load_program(serial.memory, HART_ID_PROGRAM)
+        self.assertEqual(reasons, serial.run(max_cycles=1000, entry_pc=0))
+        self.assertEqual([system.memory.read_word(0x400 + 4 * hart) for hart in range(4)], [1, 2, 3, 4])
+        self.assertEqual(system.cycles, serial.cycles)
+        for hart, expected in zip(system.harts, serial.harts):
+            self.assertEqual(hart.register_file.regs, expected.register_file.regs)
+            self.assertEqual(hart.register_file.pc, expected.register_file.pc)
+            self.assertEqual((hart.core.cycles, hart.core.instret), (expected.core.cycles, expected.core.instret))
+            self.assertEqual(hart.csr_bank.read(0xB02), hart.core.instret)  # minstret
+        self.assertTrue(system.get_stats()['parallel'])
+
+    def test_ipi_crosses_processes(self):
+        """Test a msip write in one worker wakes the hart in another at the next boundary"""
+        system, reasons = self.run_system(IPI_PROGRAM, quantum=16)
+        self.assertEqual(reasons, ['self_loop'] * 2)
+        self.assertEqual(system.memory.read_word(0x500), 8)
+        self.assertEqual(system.harts[1].csr_bank.read(0x344), 1 << 3)
+        woke = system.harts[1].core.cycles - 3
+        self.assertLessEqual(abs(woke - 106), 16)
+        self.assertEqual(system.clint.msips[1], 1)
+
+    def test_uart_output_in_hart_order(self):
+        """Test the workers' UART output is merged in hart order each quantum"""
+        program = [
+            csr(0x2, 5, 0xF14, 0),         # x5 = mhartid
+            addi(6, 5, ord('a')),          # x6 = 'a' + mhartid
+            lui(7, 0x10000),               # x7 = &TX
+            sw(6, 7, 0),
+            HALT,
+        ]
+        system, _ = self.run_system(program, num_harts=3)
+        self.assertEqual(system.uart.captured_text(), "abc")
+        self.assertEqual(system.uart.char_count, 3)
+
+    def test_sleeping_harts_keep_time(self):
+        """Test sleeping workers stay in step with the coordinator's clock"""
+        system, reasons = self.run_system([addi(1, 0, 8), csr(0x1, 0, 0x304, 1), WFI, HALT],
+                                          quantum=50, max_cycles=500)
+        self.assertEqual(reasons, [None, None])
+        self.assertEqual((system.cycles, system.quanta, system.clint.mtime), (500, 10, 500))
+        for hart in system.harts:
+            self.assertEqual((hart.core.cycles, hart.register_file.pc), (500, 8))
+
+    def test_close_keeps_memory(self):
+        """Test closing the shared memory leaves RAM contents readable"""
+        system, _ = self.run_system(HART_ID_PROGRAM)
+        system.close()
+        self.assertEqual(system.memory.read_word(0x404), 2)
+        system.memory.write_word(0x404, 7)
+        self.assertEqual(system.memory.read_word(0x404), 7)
+
+
+if __name__ == '__main__':
+    unittest.main()
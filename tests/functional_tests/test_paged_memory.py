@@ -0,0 +1,86 @@
+"""Tests for sparse, page-granular guest memory"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from memory import Memory, PAGE_SIZE
+from riscv import RISCVProcessor
+from pipeline import DRAM_BASE
+
+
+class TestPagedMemory(unittest.TestCase):
+    """Test pages are allocated on first touch and dirty pages are tracked"""
+
+    def setUp(self):
+        self.memory = Memory()
+        self.memory.map_ram(0x80000000, 64 * 1024 * 1024, name='dram')
+
+    def test_untouched_memory_is_unallocated(self):
+        """Test a fresh memory (even with a 64 MB window) holds no pages"""
+        self.assertEqual(self.memory.pages, {})
+        self.assertEqual(self.memory.read_bytes(0x80000000, 16), bytes(16))
+        self.assertEqual(self.memory.pages, {})
+        self.assertEqual(self.memory.get_stats()['size'], (1 + 64) * 1024 * 1024)
+
+    def test_both_layouts_mapped(self):
+        """Test RAM at 0 and at 0x80000000 are independent"""
+        self.memory.write_word(0x100, 0x11111111)
+        self.memory.write_word(0x80000100, 0x22222222)
+        self.assertEqual(self.memory.read_word(0x100), 0x11111111)
+        self.assertEqual(self.memory.read_word(0x80000100), 0x22222222)
+        self.assertEqual(sorted(self.memory.pages), [0, 0x80000])
+        with self.assertRaisesRegex(ValueError, 'out of bounds'):
+            self.memory.read_word(0x40000000)
+
+    def test_dirty_tracking(self):
+        """Test only pages written since clear_dirty() are dirty"""
+        self.memory.write_byte(0x10, 1)
+        self.memory.read_word(0x2000)
+        self.assertEqual(self.memory.dirty_pages, {0})
+        self.assertEqual(len(self.memory.pages), 2)
+
+        self.memory.clear_dirty()
+        self.memory.write_word(0x14, 5)  # Clean page: takes the slow path once
+        self.memory.write_halfword(0x80001000, 7)
+        self.assertEqual([address for address, _ in self.memory.iter_pages(dirty_only=True)],
+                         [0, 0x80001000])
+        self.assertEqual(self.memory.read_word(0x14), 5)
+        self.assertEqual(self.memory.read_byte(0x10), 1)
+
+    def test_bulk_copy_across_pages(self):
+        """Test write_bytes/read_bytes span page boundaries"""
+        data = bytes(range(256)) * 20
+        self.memory.load_program(data, start_address=PAGE_SIZE - 100)
+        self.assertEqual(self.memory.read_bytes(PAGE_SIZE - 100, len(data)), data)
+        self.assertEqual(self.memory.read_byte(PAGE_SIZE), data[100])
+        self.assertEqual(len(self.memory.dirty_pages), 3)
+        with self.assertRaises(ValueError):
+            self.memory.load_program(data, start_address=1024 * 1024 - 10)
+
+    def test_partial_page_bounds(self):
+        """Test a RAM window ending mid-page still enforces its end"""
+        memory = Memory(size=0x100)
+        memory.write_word(0xFC, 0xA5A5A5A5)
+        self.assertEqual(memory.read_word(0xFC), 0xA5A5A5A5)
+        with self.assertRaisesRegex(ValueError, 'out of bounds'):
+            memory.write_word(0x100, 0)
+        with self.assertRaisesRegex(ValueError, 'out of bounds'):
+            memory.read_byte(0x100)
+
+
+class TestProcessorMemoryState(unittest.TestCase):
+    """Test the processor's memory state covers every mapped layout"""
+
+    def test_memory_state_from_touched_pages(self):
+        """Test get_memory_state reports words in both RAM windows"""
+        processor = RISCVProcessor()
+        processor.memory.write_word(0x40, 3)
+        processor.memory.write_word(DRAM_BASE + 8, 9)
+        self.assertEqual(processor.get_memory_state(), {0x10: 3, (DRAM_BASE + 8) // 4: 9})
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,102 @@
+"""Tests for the parallel regression runner"""
+import sys
+import os
+import io
+import shutil
+import tempfile
+import unittest
+from unittest import mock
+
+# Add parent directories to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import parallel_runner
+import run_riscv_tests
+
+
+ADD_SOURCE = """
+  TEST_RR_OP( 2, add, 0x00000003, 0x00000001, 0x00000002 );
+  TEST_RR_OP( 3, add, 0x00000000, 0xffffffff, 0x00000001 );
+"""
+
+# Unit test module run as a job: three passes and a failure
+FIXTURE_MODULE = 'parallel_runner_fixture'
+FIXTURE_SOURCE = """
+import unittest
+
+
+class TestFixture(unittest.TestCase):
+    def test_one(self):
+        pass
+
+    def test_two(self):
+        pass
+
+    def test_three(self):
+        pass
+
+    def test_fails(self):
+        self.fail('expected')
+"""
+
+
+class TestParallelRunner(unittest.TestCase):
+    """Test jobs fan out over the pool and aggregate into one report"""
+
+    def setUp(self):
+        self.temp_dir = tempfile.mkdtemp()
+        self.source_dir = os.path.join(self.temp_dir, 'isa')
+        self.cache_dir = os.path.join(self.temp_dir, 'cache')
+        os.makedirs(self.source_dir)
+        with open(os.path.join(self.source_dir, 'add.S'), 'w') as f:
+            f.write(ADD_SOURCE)
+        with open(os.path.join(self.temp_dir, FIXTURE_MODULE + '.py'), 'w') as f:
+            f.write(FIXTURE_SOURCE)
+        sys.path.insert(0, self.temp_dir)
+
+    def tearDown(self):
+        sys.path.remove(self.temp_dir)
+        sys.modules.pop(FIXTURE_MODULE, None)
+        shutil.rmtree(self.temp_dir)
+
+    def test_discover_unit_modules(self):
+        """Test every functional test module becomes a job"""
+        jobs = parallel_runner.discover_jobs(riscv=False)
+        self.assertIn(('unit', 'test_exe_dispatch'), jobs)
+        self.assertNotIn(('unit', 'run_riscv_tests'), jobs)
+        self.assertIn(('riscv', 'add'), parallel_runner.discover_jobs(unit=False, source_dir=self.source_dir))
+
+    def test_run_parallel_aggregates(self):
+        """Test unit and riscv jobs report counts and wall time per job"""
+        jobs = [('unit', FIXTURE_MODULE), ('riscv', 'add'), ('unit', 'test_no_such_module')]
+        results, wall_time = parallel_runner.run_parallel(jobs, workers=2, cache_dir=self.cache_dir,
+                                                          source_dir=self.source_dir)
+
+        self.assertEqual([(r['kind'], r['name']) for r in results], jobs)
+        self.assertEqual((results[0]['passed'], results[0]['failed']), (3, 1))
+        self.assertEqual((results[1]['passed'], results[1]['failed']), (2, 0))
+        self.assertEqual(results[2]['failed'], 1)
+        self.assertTrue(all(r['wall_time'] >= 0 for r in results))
+
+        report = io.StringIO()
+        self.assertFalse(parallel_runner.print_report(results, wall_time, 2, stream=report))
+        self.assertIn('TOTAL: 5/7 tests passed', report.getvalue())
+        self.assertIn(f'{FIXTURE_MODULE} output', report.getvalue())
+        self.assertIn('test_no_such_module output', report.getvalue())
+
+    def test_parsed_sources_cached_on_disk(self):
+        """Test a parsed source is reused from the cache directory"""
+        source = os.path.join(self.source_dir, 'add.S')
+        cases = run_riscv_tests.load_test_cases(source, self.cache_dir)
+        self.assertEqual(len(cases), 2)
+        self.assertEqual(len(os.listdir(self.cache_dir)), 1)
+
+        run_riscv_tests._parsed_tests.clear()
+        with mock.patch.object(run_riscv_tests, 'extract_test_patterns') as extract:
+            self.assertEqual(run_riscv_tests.load_test_cases(source, self.cache_dir), cases)
+            extract.assert_not_called()
+
+
+if __name__ == '__main__':
+    unittest.main()
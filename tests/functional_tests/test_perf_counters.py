@@ -0,0 +1,164 @@
+"""Tests for the HPM performance counters (Python snapshots and guest CSR reads)"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from riscv import RISCVProcessor
+from perf_counters import HPM_EVENTS, CounterSnapshot
+from utils.rv32_encoder import addi, add, lw, sw, lui, branch, csr, load_program, HALT
+
+
+def hpm_csr(event):
+    """mhpmcounterN address counting an event"""
+    return 0xB03 + HPM_EVENTS.index(event)
+
+
+class TestPerfCounters(unittest.TestCase):
+    """Test event counts seen from Python"""
+
+    def test_instruction_classes_and_flushes(self):
+        """Test retired instructions are counted by class and flushes by cause"""
+        processor = RISCVProcessor()
+        load_program(processor.memory, [
+            addi(1, 0, 3),               # 0x00: x1 = 3
+            sw(1, 0, 0x100),             # 0x04
+            lw(2, 0, 0x100),             # 0x08
+            addi(1, 1, -1),              # 0x0c: loop: x1 -= 1
+            branch(0x1, 1, 0, -4),       # 0x10: bne x1, x0, loop
+            HALT,                        # 0x14
+        ])
+        info = processor.execute_from_memory(0, max_cycles=1000, verbose=False)
+        counters = info['perf_counters']
+
+        self.assertEqual(counters['instret'], info['instructions_retired'])
+        self.assertEqual(counters['cycles'], info['total_cycles'])
+        self.assertEqual(counters['class_alu'], 4)
+        self.assertEqual(counters['class_load'], 1)
+        self.assertEqual(counters['class_store'], 1)
+        self.assertEqual(counters['class_branch'], 3)
+        self.assertEqual(counters['class_jump'], 1)
+        self.assertEqual(counters['flush_branch'], 2)   # Two taken loop branches
+        self.assertEqual(counters['flush_jump'], 1)     # The final j .
+        self.assertEqual(counters['flush_trap'], 0)
+
+    def test_raw_stalls_by_register(self):
+        """Test stall cycles are attributed to the register waited on"""
+        processor = RISCVProcessor()
+        info = processor.execute(["ADDI R1, R0, 1", "ADD R2, R1, R1", "ADD R3, R2, R0"], verbose=False)
+        counters = info['perf_counters']
+
+        self.assertEqual(counters['raw_stalls'], info['stall_count'])
+        self.assertGreater(counters['raw_stalls_x1'], 0)
+        self.assertGreater(counters['raw_stalls_x2'], 0)
+        self.assertEqual(counters['raw_stalls'], counters['raw_stalls_x1'] + counters['raw_stalls_x2'])
+        self.assertEqual(counters['load_use_stalls'], 0)
+
+    def test_load_use_stalls(self):
+        """Test load-use stalls are counted with forwarding enabled"""
+        processor = RISCVProcessor(enable_forwarding=True)
+        load_program(processor.memory, [
+            lw(1, 0, 0x100),             # 0x00
+            add(2, 1, 1),                # 0x04: needs the load
+            HALT,
+        ])
+        info = processor.execute_from_memory(0, max_cycles=1000, verbose=False)
+        counters = info['perf_counters']
+        self.assertEqual(counters['load_use_stalls'], info['load_use_stalls'])
+        self.assertEqual(counters['load_use_stalls'], 1)
+        self.assertEqual(counters['raw_stalls_x1'], 1)
+
+    def test_interrupt_latency(self):
+        """Test taken interrupts count as interrupt flushes with their latency"""
+        processor = RISCVProcessor()
+        load_program(processor.memory, [
+            addi(1, 0, 0x40),            # 0x00: handler address
+            csr(0x1, 0, 0x305, 1),       # 0x04: csrw mtvec, x1
+            addi(2, 0, 8),               # 0x08: MSIE / MIE bit
+            csr(0x2, 0, 0x304, 2),       # 0x0c: csrs mie, x2
+            csr(0x2, 0, 0x300, 2),       # 0x10: csrs mstatus, x2
+            lui(3, 0x2000),              # 0x14: x3 = CLINT msip
+            addi(4, 0, 1),               # 0x18
+            sw(4, 3, 0),                 # 0x1c: msip = 1
+            branch(0x0, 0, 0, 0),        # 0x20: beq x0, x0, . (wait)
+        ])
+        load_program(processor.memory, [
+            sw(0, 3, 0),                 # 0x40: msip = 0
+            HALT,                        # 0x44
+        ], base=0x40)
+        info = processor.execute_from_memory(0, max_cycles=1000, verbose=False)
+        counters = info['perf_counters']
+
+        self.assertEqual(info['halt_reason'], 'self_loop')
+        self.assertEqual(counters['interrupts'], 1)
+        self.assertEqual(counters['flush_interrupt'], 1)
+        self.assertGreater(counters['interrupt_latency'], 0)
+        self.assertLess(counters['interrupt_latency'], 10)
+
+    def test_uart_bytes(self):
+        """Test UART bytes come from the UART's transmit count"""
+        processor = RISCVProcessor()
+        processor.pipeline.uart.output_stream = open(os.devnull, 'w')
+        self.addCleanup(processor.pipeline.uart.output_stream.close)
+        load_program(processor.memory, [
+            lui(1, 0x10000),             # 0x00: x1 = UART TX
+            addi(2, 0, ord('h')),        # 0x04
+            sw(2, 1, 0),                 # 0x08
+            sw(2, 1, 0),                 # 0x0c
+            HALT,
+        ])
+        info = processor.execute_from_memory(0, max_cycles=1000, verbose=False)
+        self.assertEqual(info['perf_counters']['uart_bytes'], 2)
+
+    def test_snapshot_difference(self):
+        """Test subtracting snapshots gives the counts in between"""
+        a = CounterSnapshot({'cycles': 10, 'instret': 4, 'raw_stalls_x5': 1})
+        b = CounterSnapshot({'cycles': 25, 'instret': 9, 'raw_stalls_x5': 3, 'raw_stalls_x6': 2})
+        self.assertEqual(b - a, {'cycles': 15, 'instret': 5, 'raw_stalls_x5': 2, 'raw_stalls_x6': 2})
+
+
+class TestCounterCSRs(unittest.TestCase):
+    """Test guest code reads the counters through CSRs"""
+
+    def test_guest_reads_counters(self):
+        """Test mcycle, minstret and mhpmcounters match the Python view"""
+        processor = RISCVProcessor()
+        load_program(processor.memory, [
+            addi(1, 0, 2),               # 0x00: x1 = 2
+            addi(1, 1, -1),              # 0x04: loop: x1 -= 1
+            branch(0x1, 1, 0, -4),       # 0x08: bne x1, x0, loop
+            csr(0x2, 10, 0xB02, 0),      # 0x0c: csrr a0, minstret
+            csr(0x2, 11, 0xC00, 0),      # 0x10: csrr a1, cycle
+            csr(0x2, 12, hpm_csr('flush_branch'), 0),   # 0x14
+            csr(0x2, 13, hpm_csr('class_alu'), 0),      # 0x18
+            HALT,
+        ])
+        processor.execute_from_memory(0, max_cycles=1000, verbose=False)
+        read = processor.register_file.read
+
+        self.assertEqual(read('R10'), 5)        # Instructions before the csrr
+        self.assertGreater(read('R11'), 5)
+        self.assertLess(read('R11'), processor.get_perf_counters()['cycles'])
+        self.assertEqual(read('R12'), 1)
+        self.assertEqual(read('R13'), 3)
+
+    def test_guest_write_counts_on(self):
+        """Test a guest write to minstret sets the count the next read continues from"""
+        processor = RISCVProcessor()
+        load_program(processor.memory, [
+            addi(1, 0, 100),             # 0x00
+            csr(0x1, 0, 0xB02, 1),       # 0x04: csrw minstret, x1
+            addi(0, 0, 0),               # 0x08
+            addi(0, 0, 0),               # 0x0c
+            csr(0x2, 10, 0xB02, 0),      # 0x10: csrr a0, minstret
+            HALT,
+        ])
+        processor.execute_from_memory(0, max_cycles=1000, verbose=False)
+        # The csrw itself and the two NOPs retire after the write
+        self.assertEqual(processor.register_file.read('R10'), 103)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -109,8 +109,8 @@ class TestPipelineCLINT(unittest.TestCase):
         pipeline.clint.set_timer_interrupt(tick_interval)
         pipeline.csr_bank.write(0x305, 0x80000000)
         
-        # Run some instructions
-        instructions = ["ADDI R1, R0, 1"] * 50
+        # Run enough instructions for mtime to tick (one tick per 100 cycles)
+        instructions = ["ADDI R1, R0, 1"] * 250
         pipeline.run(instructions)
         
         # Should have gotten at least one timer interrupt
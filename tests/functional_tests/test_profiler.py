@@ -0,0 +1,98 @@
+"""Tests for the guest-code PC profiler"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from riscv import RISCVProcessor
+from profiler import SymbolTable, UNKNOWN_FUNCTION
+from utils.rv32_encoder import addi, branch, jal, jalr, load_program, HALT
+
+
+FUNCTIONS = [(0x00, 0x10, 'main'), (0x40, 0x10, 'work')]
+
+
+def run_call_program():
+    """main calls work (a 3-iteration loop) twice"""
+    processor = RISCVProcessor()
+    load_program(processor.memory, [
+        addi(10, 0, 3),              # 0x00: main: a0 = 3
+        jal(1, 0x3c),                # 0x04: call work
+        jal(1, 0x38),                # 0x08: call work
+        HALT,                        # 0x0c
+    ])
+    load_program(processor.memory, [
+        addi(11, 10, 0),             # 0x40: work: a1 = a0
+        addi(11, 11, -1),            # 0x44: loop: a1 -= 1
+        branch(0x1, 11, 0, -4),      # 0x48: bne a1, x0, loop
+        jalr(0, 1, 0),               # 0x4c: ret
+    ], base=0x40)
+    profiler = processor.enable_profiler(FUNCTIONS)
+    info = processor.execute_from_memory(0, max_cycles=2000, verbose=False)
+    return processor, profiler, info
+
+
+class TestSymbolTable(unittest.TestCase):
+    """Test PC symbolization"""
+
+    def test_lookup(self):
+        """Test PCs resolve to the enclosing function and offset"""
+        table = SymbolTable([(0x100, 0x20, 'b'), (0x0, 0x10, 'a'), (0x200, 0, 'c')])
+        self.assertEqual(table.lookup(0x4), ('a', 0x4))
+        self.assertEqual(table.lookup(0x11c), ('b', 0x1c))
+        self.assertEqual(table.lookup(0x50), (UNKNOWN_FUNCTION, 0x50))   # Between a and b
+        self.assertEqual(table.lookup(0x1234), ('c', 0x1034))            # Unsized: to the next symbol
+
+
+class TestProfiler(unittest.TestCase):
+    """Test cycle attribution and the shadow call stack"""
+
+    def test_cycles_add_up(self):
+        """Test per-PC cycles sum to the cycle of the last retirement"""
+        processor, profiler, info = run_call_program()
+        self.assertEqual(info['halt_reason'], 'self_loop')
+        self.assertEqual(profiler.total_cycles, int(processor.pipeline.completion_time))
+        self.assertEqual(sum(profiler.pc_retired.values()), info['instructions_retired'])
+        self.assertEqual(profiler.pc_retired[0x44], 6)
+
+    def test_function_profile_and_call_graph(self):
+        """Test calls push the callee and returns pop back to the caller"""
+        _, profiler, _ = run_call_program()
+        self.assertEqual(set(profiler.stacks), {('main',), ('main', 'work')})
+
+        rows = {r['name']: r for r in profiler.function_profile()}
+        self.assertEqual(rows['work']['instructions'], 16)
+        self.assertEqual(rows['main']['instructions'], 4)
+        self.assertEqual(rows['main']['inclusive_cycles'], profiler.total_cycles)
+        self.assertEqual(rows['work']['inclusive_cycles'], rows['work']['self_cycles'])
+        self.assertEqual(profiler.call_edges(), {('main', 'work'): rows['work']['self_cycles']})
+
+        self.assertIn('work', profiler.flat_report())
+        self.assertIn('<- main', profiler.call_graph_report())
+
+    def test_collapsed_stacks(self):
+        """Test the folded output has one 'frame;frame count' line per stack"""
+        _, profiler, _ = run_call_program()
+        lines = profiler.collapsed_stacks().splitlines()
+        self.assertEqual([line.split()[0] for line in lines], ['main', 'main;work'])
+        self.assertEqual(sum(int(line.split()[1]) for line in lines), profiler.total_cycles)
+
+    def test_stalls_charged_to_waiting_instruction(self):
+        """Test RAW stall cycles land on the instruction held in Decode"""
+        processor = RISCVProcessor()
+        load_program(processor.memory, [
+            addi(1, 0, 1),               # 0x00
+            addi(2, 1, 1),               # 0x04: waits for x1
+            HALT,                        # 0x08
+        ])
+        profiler = processor.enable_profiler(FUNCTIONS)
+        info = processor.execute_from_memory(0, max_cycles=200, verbose=False)
+        self.assertGreater(info['stall_count'], 0)
+        self.assertEqual(profiler.pc_stalls, {0x4: info['stall_count']})
+        self.assertEqual(profiler.function_profile()[0]['stalls'], info['stall_count'])
+
+
+if __name__ == '__main__':
+    unittest.main()
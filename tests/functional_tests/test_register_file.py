@@ -0,0 +1,72 @@
+"""Tests for the integer-indexed register file"""
+import sys
+import os
+import unittest
+import simpy
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from register_file import RegisterFile
+from pipeline import Pipeline
+from instruction import Instruction, decode_instruction_word
+from tracing import Tracer, TRACE_OFF
+from utils.rv32_encoder import add, sw
+
+
+class TestRegisterFile(unittest.TestCase):
+    """Test index storage and the name accessors"""
+
+    def setUp(self):
+        self.register_file = RegisterFile()
+
+    def test_name_and_index_access_agree(self):
+        """Test 'Rn', 'xn' and ABI names address the same slot"""
+        self.register_file.write('R10', 0x1234)
+        self.assertEqual(self.register_file.read_index(10), 0x1234)
+        self.assertEqual(self.register_file.read('a0'), 0x1234)
+        self.assertEqual(self.register_file.read('x10'), 0x1234)
+        self.register_file.write_index(2, -4)
+        self.assertEqual(self.register_file.read('sp'), 0xFFFFFFFC)
+
+    def test_x0_hardwired(self):
+        """Test writes to x0 are discarded by every accessor"""
+        self.register_file.write('R0', 5)
+        self.register_file.write('zero', 5)
+        self.register_file.write_index(0, 5)
+        self.assertEqual(self.register_file.regs[0], 0)
+
+    def test_unknown_name_reads_zero(self):
+        """Test a name that is not a GPR reads 0 and is not stored"""
+        self.register_file.write('R40', 9)
+        self.assertEqual(self.register_file.read('R40'), 0)
+        self.assertEqual(len(self.register_file.regs), 32)
+
+    def test_registers_snapshot(self):
+        """Test the name-keyed snapshot covers all 32 registers"""
+        self.register_file.write('R31', 7)
+        snapshot = self.register_file.registers
+        self.assertEqual(len(snapshot), 32)
+        self.assertEqual(snapshot['R31'], 7)
+
+
+class TestRegisterIndices(unittest.TestCase):
+    """Test decoded instructions carry source register numbers"""
+
+    def test_text_and_word_decode_indices(self):
+        """Test both decoders fill src_indices in src_regs order"""
+        self.assertEqual(Instruction("SW R1, 8(R2)").src_indices, (1, 2))
+        self.assertEqual(decode_instruction_word(sw(1, 2, 8)).src_indices, (1, 2))
+        self.assertEqual(decode_instruction_word(add(3, 4, 5)).src_indices, (4, 5))
+        self.assertEqual(Instruction("ADD a0, sp, t0").src_indices, (2, 5))
+
+    def test_x0_is_not_a_hazard(self):
+        """Test a write to x0 does not stall a later reader of x0"""
+        pipeline = Pipeline(simpy.Environment(), trace=Tracer(level=TRACE_OFF))
+        pipeline.run(["ADDI R0, R0, 0", "ADDI R1, R0, 5"])
+        self.assertEqual(pipeline.stall_count, 0)
+        self.assertEqual(pipeline.register_file.read('R1'), 5)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,136 @@
+"""Tests for the streaming retire trace and counts-only retirement"""
+import sys
+import os
+import io
+import tempfile
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from riscv import RISCVProcessor
+from retire_trace import RetireTrace, read_retire_trace, FLAG_RD, FLAG_LOAD, FLAG_STORE, FLAG_TRAP
+from utils.rv32_encoder import addi, lw, sw, s_type, branch, csr, load_program, ECALL, MRET, HALT
+
+
+HANDLER = 0x100
+
+# Loop storing and reloading, an SB of a wide value, then an ECALL trap
+PROGRAM = [
+    addi(5, 0, HANDLER), csr(0x1, 0, 0x305, 5),   # 0x00: mtvec
+    addi(1, 0, 5),                       # 0x08
+    addi(2, 0, 0x300),                   # 0x0c
+    sw(1, 2, 0),                         # 0x10: loop
+    lw(3, 2, 0),                         # 0x14
+    addi(1, 1, -1),                      # 0x18
+    branch(0x1, 1, 0, -12),              # 0x1c: bne x1, x0, loop
+    addi(4, 0, 0x7AB),                   # 0x20
+    s_type(4, 4, 2, 0x0),                # 0x24: sb x4, 4(x2)
+    ECALL,                               # 0x28
+    HALT,                                # 0x2c
+]
+# Skips the ECALL (MRET reads mepc in EX, so the write must have reached WriteBack)
+TRAP_HANDLER = [csr(0x2, 6, 0x341, 0), addi(6, 6, 4), csr(0x1, 0, 0x341, 6), addi(0, 0, 0), MRET]
+
+
+def make_processor(mode='pipeline'):
+    processor = RISCVProcessor(mode=mode)
+    load_program(processor.memory, PROGRAM)
+    load_program(processor.memory, TRAP_HANDLER, base=HANDLER)
+    return processor
+
+
+def run(processor, **kwargs):
+    return processor.execute_from_memory(0, max_cycles=5000, verbose=False, **kwargs)
+
+
+class TestRetireTrace(unittest.TestCase):
+    """Test retired instructions stream out as binary records"""
+
+    def test_records_match_retired_instructions(self):
+        """Test each record carries the retired instruction's cycle, PC, word and results"""
+        processor = make_processor()
+        trace = processor.enable_retire_trace(keep_instructions=True)
+        info = run(processor)
+        records = list(trace)
+        retired = info['completed_instructions']
+        self.assertEqual(len(records), info['instructions_retired'])
+        self.assertEqual([record.pc for record in records], [instruction.pc for instruction in retired])
+        for record in records:
+            self.assertEqual(record.word, processor.memory.read_word(record.pc))
+        self.assertEqual(records[-1].cycle, processor.pipeline.completion_time)
+
+        loads = [record for record in records if record.flags & FLAG_LOAD]
+        self.assertEqual([record.mem_data for record in loads], [5, 4, 3, 2, 1])
+        self.assertTrue(all(record.mem_address == 0x300 and record.flags & FLAG_RD and record.rd == 3
+                            for record in loads))
+        stores = [record for record in records if record.flags & FLAG_STORE]
+        self.assertEqual(stores[-1].mem_address, 0x304)
+        self.assertEqual(stores[-1].mem_data, 0xAB)  # SB stores the low byte
+
+        traps = [record for record in records if record.flags & FLAG_TRAP]
+        self.assertEqual([(record.pc, record.cause) for record in traps], [(0x28, 11)])  # ECALL from M-mode
+
+    def test_file_round_trip(self):
+        """Test traces written to a path or a file object read back the same, compressed or not"""
+        reference = make_processor()
+        expected = reference.enable_retire_trace()
+        run(reference)
+        expected = list(expected)
+        with tempfile.TemporaryDirectory() as directory:
+            for compress in (True, False):
+                with self.subTest(compress=compress):
+                    path = os.path.join(directory, f'trace{compress}.rvrt')
+                    processor = make_processor('clocked')
+                    trace = processor.enable_retire_trace(path, compress=compress)
+                    trace.chunk_records = 7  # Several chunks
+                    run(processor)
+                    trace.close()
+                    self.assertEqual(list(read_retire_trace(path)), expected)
+                    self.assertEqual(list(trace), expected)
+        stream = io.BytesIO()
+        processor = make_processor()
+        trace = processor.enable_retire_trace(stream)
+        run(processor)
+        trace.close()
+        stream.seek(0)
+        self.assertEqual(list(read_retire_trace(stream)), expected)
+
+    def test_not_a_trace(self):
+        """Test reading something else fails clearly"""
+        with self.assertRaises(ValueError):
+            list(read_retire_trace(io.BytesIO(b'ELF\0' + bytes(20))))
+
+    def test_chunks_are_compressed(self):
+        """Test an in-memory trace keeps far less than a record's size per instruction"""
+        trace = RetireTrace(chunk_records=256)
+        processor = make_processor()
+        trace.attach(processor.pipeline)
+        processor.pipeline.keep_retired = False
+        program = [addi(1, 0, 500), addi(1, 1, -1), branch(0x1, 1, 0, -4), HALT]
+        load_program(processor.memory, program)
+        info = run(processor)
+        stored = sum(len(chunk) for chunk in trace.chunks)
+        self.assertEqual(len(trace), info['instructions_retired'])
+        self.assertLess(stored, len(trace) * 4)
+
+
+class TestCountsOnly(unittest.TestCase):
+    """Test retirement without keeping Instruction objects"""
+
+    def test_no_instruction_objects(self):
+        """Test counts and stop conditions are unchanged with keep_retired off"""
+        for kwargs in ({}, {'max_instret': 9}):
+            with self.subTest(**kwargs):
+                reference = run(make_processor(), **kwargs)
+                processor = make_processor()
+                processor.pipeline.keep_retired = False
+                info = run(processor, **kwargs)
+                self.assertEqual(info['completed_instructions'], [])
+                for key in ('instructions_retired', 'total_cycles', 'halt_reason', 'cpi'):
+                    self.assertEqual(info[key], reference[key], key)
+                self.assertEqual(info['perf_counters'], reference['perf_counters'])
+
+
+if __name__ == '__main__':
+    unittest.main()
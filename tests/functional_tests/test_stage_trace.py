@@ -0,0 +1,169 @@
+"""Tests for the stage-occupancy trace and the trace-driven pipeline viewer"""
+import sys
+import os
+import io
+import json
+import tempfile
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+import simpy
+from pipeline import Pipeline
+from tracing import TRACE_OFF
+from stage_trace import StageTrace, read_stage_trace, FLAG_RETIRED, FLAG_SQUASHED, FLAG_TRAP
+from pipeview import render_diagram, write_konata, write_chrome_trace, stage_spans
+from test_retire_trace import make_processor, run
+
+
+def traced_run(mode='pipeline', target=None):
+    processor = make_processor(mode)
+    trace = processor.enable_stage_trace(target)
+    info = run(processor)
+    trace.close()
+    return trace, info
+
+
+class TestStageTrace(unittest.TestCase):
+    """Test every fetched instruction gets a record of its stage entry cycles"""
+
+    def setUp(self):
+        self.trace, self.info = traced_run()
+        self.records = list(read_stage_trace(self.trace))
+
+    def test_engines_agree(self):
+        """Test the SimPy and clocked engines trace the same cycles"""
+        clocked, info = traced_run('clocked')
+        self.assertEqual(info['total_cycles'], self.info['total_cycles'])
+        self.assertEqual(list(read_stage_trace(clocked)), self.records)
+
+    def test_records(self):
+        """Test records are in fetch order and retired ones pass every stage in order"""
+        fetches = [record.fetch for record in self.records]
+        self.assertEqual(fetches, sorted(fetches))
+        retired = [record for record in self.records if record.flags & FLAG_RETIRED]
+        self.assertEqual(len(retired), self.info['instructions_retired'])
+        for record in retired:
+            cycles = record.stage_cycles()
+            self.assertEqual(list(cycles), sorted(set(cycles)))
+            self.assertGreater(record.end_cycle, cycles[-1])
+        self.assertLessEqual(max(record.end_cycle for record in retired), self.info['total_cycles'])
+        traps = [record.pc for record in retired if record.flags & FLAG_TRAP]
+        self.assertEqual(traps, [0x28])
+
+    def test_stalls_and_squashes(self):
+        """Test hazard stalls show between Decode and Execute and wrong-path fetches are squashed"""
+        # CSRRW mtvec waits in Decode for the ADDI writing x5
+        csrrw = self.records[1]
+        self.assertEqual(csrrw.pc, 0x04)
+        self.assertGreater(csrrw.stall_cycles, 0)
+        squashed = [record for record in self.records if record.flags & FLAG_SQUASHED]
+        self.assertTrue(squashed)
+        for record in squashed:
+            self.assertIsNone(record.stage_cycles()[4])
+        # The loop's fall-through is fetched and squashed on each of the four taken branches
+        self.assertEqual(sum(1 for record in squashed if record.pc == 0x20), 4)
+
+    def test_window_and_pc_filter(self):
+        """Test reads can be limited to a cycle window and a set of PCs"""
+        window = list(read_stage_trace(self.trace, start_cycle=30, end_cycle=50))
+        self.assertEqual(window, [record for record in self.records
+                                  if record.end_cycle >= 30 and record.fetch < 50])
+        loads = list(read_stage_trace(self.trace, pcs=[0x14]))
+        self.assertEqual(len(loads), 5)
+        self.assertTrue(all(record.pc == 0x14 for record in loads))
+
+    def test_file_round_trip(self):
+        """Test a trace streamed to a file reads back the same"""
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, 'run.rvst')
+            trace, _ = traced_run(target=path)
+            self.assertEqual(trace.count, len(self.records))
+            self.assertEqual(list(read_stage_trace(path)), self.records)
+            with open(path, 'rb') as stream:
+                self.assertEqual(list(read_stage_trace(stream, end_cycle=20)),
+                                 [record for record in self.records if record.fetch < 20])
+
+    def test_rejects_other_streams(self):
+        """Test a retire trace is not read as a stage trace"""
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, 'run.rvrt')
+            processor = make_processor()
+            processor.enable_retire_trace(path)
+            run(processor)
+            processor.pipeline.retire_trace.close()
+            with self.assertRaises(ValueError):
+                list(read_stage_trace(path))
+
+
+class TestPipeview(unittest.TestCase):
+    """Test the diagram and viewer exports drawn from stage records"""
+
+    def setUp(self):
+        trace, self.info = traced_run()
+        self.records = list(read_stage_trace(trace))
+
+    def test_diagram(self):
+        """Test the diagram marks stage entries, stalls and squashes"""
+        output = io.StringIO()
+        rows = render_diagram(self.records[:3], start_cycle=0, end_cycle=10, stream=output)
+        self.assertEqual(rows, 3)
+        lines = output.getvalue().splitlines()
+        csrrw = next(line for line in lines if line.startswith('00000004: CSRRW'))
+        self.assertEqual([cell.strip() for cell in csrrw.split('|')[1:-1]],
+                         ['', 'IF', 'ID', '-', '-', '-', 'EX', 'MEM', 'WB', ''])
+        output = io.StringIO()
+        render_diagram(iter(self.records), stream=output)
+        self.assertIn('| X ', output.getvalue())
+        self.assertIn(f"t{self.info['total_cycles'] - 1} ", output.getvalue())
+
+    def test_list_fed_diagram(self):
+        """Test programs run from instruction text are labelled by position"""
+        env = simpy.Environment()
+        pipeline = Pipeline(env)
+        pipeline.trace.configure(level=TRACE_OFF)
+        trace = StageTrace()
+        trace.attach(pipeline)
+        pipeline.run(["ADD R1, R2, R3", "SUB R4, R1, R5"])
+        trace.close()
+        output = io.StringIO()
+        render_diagram(read_stage_trace(trace), stream=output)
+        rows = [line for line in output.getvalue().splitlines() if line.startswith('Inst')]
+        self.assertEqual([row.split()[:2] for row in rows], [['Inst', '1'], ['Inst', '2']])
+        self.assertIn('-', rows[1])
+
+    def test_konata(self):
+        """Test the Kanata log starts, advances and retires every instruction in cycle order"""
+        output = io.StringIO()
+        self.assertEqual(write_konata(self.records, output), len(self.records))
+        lines = output.getvalue().splitlines()
+        self.assertEqual(lines[:2], ['Kanata\t0004', 'C=\t0'])
+        cycle = 0
+        retired = flushed = 0
+        for line in lines[2:]:
+            fields = line.split('\t')
+            if fields[0] == 'C':
+                self.assertGreater(int(fields[1]), 0)
+                cycle += int(fields[1])
+            elif fields[0] == 'R':
+                retired += fields[3] == '0'
+                flushed += fields[3] == '1'
+        self.assertEqual(cycle, self.info['total_cycles'])
+        self.assertEqual(retired, self.info['instructions_retired'])
+        self.assertEqual(flushed, sum(1 for record in self.records if record.flags & FLAG_SQUASHED))
+
+    def test_chrome_trace(self):
+        """Test the Chrome trace is valid JSON with one span per stage visited"""
+        output = io.StringIO()
+        write_chrome_trace(self.records, output)
+        events = json.loads(output.getvalue())['traceEvents']
+        spans = [event for event in events if event['ph'] == 'X']
+        self.assertEqual(len(spans), sum(len(stage_spans(record)) for record in self.records))
+        self.assertTrue(all(span['dur'] > 0 for span in spans))
+        self.assertEqual(sum(1 for event in events if event['ph'] == 'i'),
+                         sum(1 for record in self.records if record.flags & FLAG_SQUASHED))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -19,7 +19,7 @@ class TestSystemInstructions(unittest.TestCase):
         inst = Instruction("ECALL")
         self.assertEqual(inst.operation, "ECALL")
         self.assertIsNone(inst.dest_reg)
-        self.assertEqual(inst.src_regs, [])
+        self.assertEqual(inst.src_regs, ())
     
     def test_ecall_exit_syscall(self):
         """Test ECALL with exit syscall (93)"""
@@ -98,7 +98,7 @@ class TestSystemInstructions(unittest.TestCase):
         inst = Instruction("EBREAK")
         self.assertEqual(inst.operation, "EBREAK")
         self.assertIsNone(inst.dest_reg)
-        self.assertEqual(inst.src_regs, [])
+        self.assertEqual(inst.src_regs, ())
     
     def test_ebreak_execution(self):
         """Test EBREAK execution"""
@@ -0,0 +1,154 @@
+"""Tests for run termination conditions (drain, tohost, ECALL/EBREAK, breakpoints, limits)"""
+import sys
+import os
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from riscv import RISCVProcessor
+from utils.rv32_encoder import addi, sw, branch, load_program, ECALL, EBREAK, HALT
+
+
+# Counted loop that then reports through tohost at 0x100
+LOOP_PROGRAM = [
+    addi(1, 0, 5),               # 0x00: x1 = 5
+    addi(2, 2, 1),               # 0x04: loop: x2 += 1
+    addi(1, 1, -1),              # 0x08: x1 -= 1
+    branch(0x1, 1, 0, -8),       # 0x0c: bne x1, x0, loop
+    addi(3, 0, 1),               # 0x10: x3 = 1 (pass)
+    sw(3, 0, 0x100),             # 0x14: tohost = x3
+    addi(4, 0, 7),               # 0x18
+    HALT,                        # 0x1c
+]
+
+
+def make_processor(program, mode='pipeline'):
+    processor = RISCVProcessor(mode=mode)
+    load_program(processor.memory, program)
+    return processor
+
+
+class TestTextModeTermination(unittest.TestCase):
+    """Test instruction-list runs end when the pipeline drains"""
+
+    def test_stops_when_drained(self):
+        """Test the run ends at the last retirement, not a fixed budget"""
+        processor = RISCVProcessor()
+        program = ["ADDI R1, R0, 1", "ADDI R2, R1, 2", "ADD R3, R1, R2"]
+        info = processor.execute(program, verbose=False)
+
+        self.assertEqual(info['halt_reason'], 'drained')
+        self.assertEqual(len(info['completed_instructions']), 3)
+        self.assertEqual(info['total_cycles'], processor.pipeline.completion_time)
+        self.assertLess(info['total_cycles'], len(program) * 10 + 20)
+        self.assertEqual(processor.register_file.read('R3'), 4)
+
+    def test_empty_program(self):
+        """Test an empty program ends immediately"""
+        info = RISCVProcessor().execute([], verbose=False)
+        self.assertEqual(info['halt_reason'], 'drained')
+        self.assertEqual(info['total_cycles'], 0)
+
+    def test_max_cycles(self):
+        """Test the cycle limit cuts a run short and is reported"""
+        info = RISCVProcessor().execute(["ADDI R1, R0, 1"] * 20, verbose=False, max_cycles=8)
+        self.assertEqual(info['halt_reason'], 'max_cycles')
+        self.assertEqual(info['total_cycles'], 8)
+        self.assertLess(len(info['completed_instructions']), 20)
+
+
+class TestMemoryModeTermination(unittest.TestCase):
+    """Test execute_from_memory stop conditions in both processor modes"""
+
+    def for_each_mode(self, check, program=LOOP_PROGRAM, **kwargs):
+        for mode in RISCVProcessor.MODES:
+            with self.subTest(mode=mode):
+                processor = make_processor(program, mode)
+                info = processor.execute_from_memory(0, max_cycles=2000, verbose=False, **kwargs)
+                check(processor, info)
+
+    def test_tohost(self):
+        """Test a store to tohost ends the run and reports the value"""
+        def check(processor, info):
+            self.assertEqual(info['halt_reason'], 'tohost')
+            self.assertEqual(info['tohost_value'], 1)
+            self.assertEqual(processor.register_file.read('R2'), 5)
+        self.for_each_mode(check, tohost=0x100)
+
+    def test_breakpoint(self):
+        """Test the run stops before a breakpoint on the correct path only"""
+        def check(processor, info):
+            # 0x10 is fetched behind every taken loop branch; only the exit stops
+            self.assertEqual(info['halt_reason'], 'breakpoint')
+            self.assertEqual(processor.register_file.read_pc(), 0x10)
+            self.assertEqual(processor.register_file.read('R2'), 5)
+            self.assertEqual(processor.register_file.read('R3'), 0)
+        self.for_each_mode(check, breakpoints={0x10})
+
+    def test_breakpoint_at_entry_is_ignored(self):
+        """Test a breakpoint at the entry PC does not stop the run immediately"""
+        def check(processor, info):
+            self.assertEqual(info['halt_reason'], 'self_loop')
+            self.assertEqual(processor.register_file.read('R4'), 7)
+        self.for_each_mode(check, breakpoints={0x00})
+
+    def test_resume_after_stop(self):
+        """Test a stopped run carries on from the stopping PC when run again"""
+        for mode in RISCVProcessor.MODES:
+            with self.subTest(mode=mode):
+                processor = make_processor(LOOP_PROGRAM, mode)
+                registers = processor.register_file
+                info = processor.execute_from_memory(0, max_cycles=2000, verbose=False, breakpoints={0x10})
+                self.assertEqual((info['halt_reason'], registers.read('R3')), ('breakpoint', 0))
+
+                info = processor.execute_from_memory(None, max_cycles=2000, verbose=False,
+                                                     breakpoints={0x10}, tohost=0x100)
+                self.assertEqual((info['halt_reason'], info['tohost_value']), ('tohost', 1))
+                self.assertEqual((registers.read('R2'), registers.read('R3')), (5, 1))
+
+                info = processor.execute_from_memory(None, max_cycles=2000, verbose=False)
+                self.assertEqual((info['halt_reason'], info['tohost_value']), ('self_loop', None))
+                self.assertEqual(registers.read('R4'), 7)
+
+    def test_resume_after_max_instret(self):
+        """Test runs split by max_instret retire the program exactly once"""
+        for mode in RISCVProcessor.MODES:
+            with self.subTest(mode=mode):
+                processor = make_processor(LOOP_PROGRAM, mode)
+                reasons = [processor.execute_from_memory(0, max_cycles=2000, verbose=False, max_instret=6)['halt_reason']]
+                while reasons[-1] == 'max_instret' and len(reasons) < 10:
+                    info = processor.execute_from_memory(None, max_cycles=2000, verbose=False,
+                                                         max_instret=6 * (len(reasons) + 1))
+                    reasons.append(info['halt_reason'])
+                self.assertEqual(reasons[-1], 'self_loop')
+                self.assertEqual(processor.register_file.read('R2'), 5)
+                self.assertEqual(processor.register_file.read('R4'), 7)
+
+    def test_max_instret(self):
+        """Test exactly max_instret instructions retire"""
+        def check(processor, info):
+            self.assertEqual(info['halt_reason'], 'max_instret')
+            self.assertEqual(info['instructions_retired'], 6)
+            self.assertEqual(processor.register_file.read('R2'), 2)
+            self.assertEqual(processor.register_file.read_pc(), 0x0c)
+        self.for_each_mode(check, max_instret=6)
+
+    def test_halt_on_ecall_and_ebreak(self):
+        """Test ECALL/EBREAK stop the run without trapping when listed in halt_on"""
+        for word, reason in ((ECALL, 'ecall'), (EBREAK, 'ebreak')):
+            def check(processor, info):
+                self.assertEqual(info['halt_reason'], reason)
+                self.assertEqual(processor.register_file.read_pc(), 0x04)
+                self.assertEqual(processor.pipeline.csr_bank.read(0x342), 0)  # mcause untouched
+            self.for_each_mode(check, program=[addi(1, 0, 1), word, HALT], halt_on=(reason,))
+
+    def test_unknown_halt_on(self):
+        """Test an unknown halt_on condition is rejected"""
+        processor = make_processor(LOOP_PROGRAM)
+        with self.assertRaises(ValueError):
+            processor.execute_from_memory(0, verbose=False, halt_on=('wfi',))
+
+
+if __name__ == '__main__':
+    unittest.main()
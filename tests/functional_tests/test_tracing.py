@@ -0,0 +1,139 @@
+"""Tests for the trace filter and sinks"""
+import sys
+import os
+import io
+import unittest
+import simpy
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from pipeline import Pipeline
+from tracing import (Tracer, PrintSink, RingBufferSink, TRACE_OFF, TRACE_EVENTS, TRACE_ALL,
+                     KIND_EVENT, KIND_DETAIL)
+
+
+class CountingSink:
+    """Sink that only counts calls"""
+
+    def __init__(self):
+        self.calls = 0
+
+    def record(self, cycle, category, kind, fmt, args):
+        self.calls += 1
+
+
+class TestTracer(unittest.TestCase):
+    """Test level and category filtering"""
+
+    def test_levels(self):
+        """Test each level enables the expected categories"""
+        tracer = Tracer(CountingSink(), level=TRACE_EVENTS)
+        self.assertTrue(tracer.hazard)
+        self.assertTrue(tracer.trap)
+        self.assertFalse(tracer.fetch)
+        tracer.configure(level=TRACE_ALL)
+        self.assertTrue(tracer.fetch)
+        tracer.configure(level=TRACE_OFF)
+        self.assertFalse(tracer.hazard)
+
+    def test_category_filter(self):
+        """Test only the selected categories are enabled"""
+        tracer = Tracer(CountingSink(), categories=['mem'])
+        self.assertTrue(tracer.enabled('mem'))
+        self.assertFalse(tracer.enabled('stage'))
+        with self.assertRaises(ValueError):
+            tracer.configure(categories=['mem', 'bogus'])
+
+    def test_disabled_pipeline_never_calls_sink(self):
+        """Test a pipeline traced at TRACE_OFF records nothing"""
+        sink = CountingSink()
+        pipeline = Pipeline(simpy.Environment(), trace=Tracer(sink, level=TRACE_OFF))
+        pipeline.run(["ADD R1, R2, R3", "SUB R4, R1, R5", "BEQ R0, R0, 8", "ADDI R6, R0, 1"])
+        self.assertEqual(sink.calls, 0)
+
+
+class TestSinks(unittest.TestCase):
+    """Test the print and ring buffer sinks"""
+
+    def test_print_sink_format(self):
+        """Test PrintSink reproduces the classic stdout trace lines"""
+        stream = io.StringIO()
+        tracer = Tracer(PrintSink(stream))
+        tracer.banner('fetch', 3, "Fetch stage processing: {}", "ADD R1, R2, R3")
+        tracer.event('stage', 4, "Decode stage processing: {}", "ADD R1, R2, R3")
+        tracer.detail('exec', 5, "Result: {}", 7)
+        self.assertEqual(stream.getvalue(),
+                         "\n[Cycle 3] Fetch stage processing: ADD R1, R2, R3\n"
+                         "[Cycle 4] Decode stage processing: ADD R1, R2, R3\n"
+                         "  -> Result: 7\n")
+
+    def test_ring_buffer_wraparound(self):
+        """Test the ring keeps the newest records in order"""
+        sink = RingBufferSink(capacity=4)
+        tracer = Tracer(sink)
+        for cycle in range(6):
+            tracer.event('stage', cycle, "step {}", cycle)
+
+        self.assertEqual(sink.total, 6)
+        self.assertEqual([record[0] for record in sink.records()], [2, 3, 4, 5])
+        self.assertEqual(sink.records()[0], (2, 'stage', KIND_EVENT, "step {}", (2,)))
+
+        stream = io.StringIO()
+        sink.dump(stream)
+        lines = stream.getvalue().splitlines()
+        self.assertEqual(lines[0], "... 2 earlier trace records dropped")
+        self.assertEqual(lines[1:], [f"[Cycle {cycle}] step {cycle}" for cycle in range(2, 6)])
+
+        sink.clear()
+        self.assertEqual(sink.records(), [])
+
+    def test_ring_buffer_packs_records(self):
+        """Test the ring stores scalars and text, not references to the args"""
+        sink = RingBufferSink(capacity=2)
+        size = len(sink.buffer)
+
+        class Live:
+            def __str__(self):
+                return "ADD R1, R2, R3"
+
+        arg = Live()
+        sink.record(7, 'exec', KIND_DETAIL, "{} -> {:#x} ({})", (arg, 0xFFFFFFFF, -3))
+        del arg
+        self.assertEqual(sink.records(), [(7, 'exec', KIND_DETAIL, "{} -> {:#x} ({})",
+                                           ("ADD R1, R2, R3", 0xFFFFFFFF, -3))])
+        sink.record(8, 'hazard', KIND_EVENT, "{} {} {} {} {}", (1, 2, 3, 4, 5))
+        self.assertEqual(sink.records()[1][3:], ("{}", ("1 2 3 4 5",)))
+        sink.record(9, 'exec', KIND_EVENT, "{}", ("x" * 200,))
+        self.assertEqual(len(sink.records()[1][4][0]), 64)  # Truncated to the text field
+        self.assertEqual(len(sink.buffer), size)
+        self.assertEqual(sink.formats, ["{} -> {:#x} ({})", "{}"])
+
+    def test_ring_dump_matches_print(self):
+        """Test a dumped pipeline trace reads the same as the printed one"""
+        program = ["ADDI R1, R0, 5", "ADD R2, R1, R1", "SW R2, 0(R0)", "LW R3, 0(R0)", "BEQ R3, R2, 8"]
+        printed = io.StringIO()
+        Pipeline(simpy.Environment(), trace=Tracer(PrintSink(printed))).run(program)
+        sink = RingBufferSink()
+        Pipeline(simpy.Environment(), trace=Tracer(sink)).run(program)
+        dumped = io.StringIO()
+        sink.dump(dumped)
+        self.assertEqual(dumped.getvalue(), printed.getvalue())
+
+    def test_pipeline_hazard_capture(self):
+        """Test a pipeline can record only hazard events into a ring"""
+        sink = RingBufferSink()
+        tracer = Tracer(sink, level=TRACE_EVENTS, categories=['hazard'])
+        pipeline = Pipeline(simpy.Environment(), trace=tracer)
+        pipeline.run(["ADD R1, R2, R3", "SUB R4, R1, R5"])
+
+        records = sink.records()
+        self.assertGreater(len(records), 0)
+        self.assertTrue(all(record[1] == 'hazard' for record in records))
+        stream = io.StringIO()
+        sink.dump(stream)
+        self.assertIn("RAW Hazard", stream.getvalue())
+
+
+if __name__ == '__main__':
+    unittest.main()
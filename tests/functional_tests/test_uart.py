@@ -0,0 +1,199 @@
+"""Tests for UART output buffering, capture mode and the TX FIFO model"""
+import sys
+import os
+import io
+import unittest
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+
+from riscv import RISCVProcessor
+from uart import UART
+from clint import CLINT
+from csr import CSRBank
+from interrupt import InterruptController
+from utils.rv32_encoder import addi, lui, lw, sw, i_type, branch, csr, load_program, WFI, HALT
+
+
+def andi(rd, rs1, imm):
+    return i_type(imm, rs1, 0x7, rd)
+
+
+# Prints 'abcdefghijkl' four bytes at a time, sleeping (WFI, mstatus.MIE
+# clear) until the TX-empty interrupt says the FIFO has drained
+WFI_DRIVER = [
+    lui(11, 0x10000),              # 0x00: x11 = UART
+    lui(1, 1), addi(1, 1, -0x800), # 0x04: x1 = MEIE
+    csr(0x1, 0, 0x304, 1),         # 0x0c: mie = MEIE
+    addi(2, 0, 1), sw(2, 11, 8),   # 0x10: CTRL = TX-empty interrupt enable
+    addi(8, 0, ord('a')),          # 0x18: x8 = next character
+    addi(5, 0, 3),                 # 0x1c: x5 = batches
+    addi(6, 0, 4),                 # 0x20: outer: x6 = bytes per batch
+    WFI,                           # 0x24
+    sw(8, 11, 0),                  # 0x28: inner
+    addi(8, 8, 1),                 # 0x2c
+    addi(6, 6, -1),                # 0x30
+    branch(0x1, 6, 0, -12),        # 0x34: bne x6, x0, inner
+    addi(5, 5, -1),                # 0x38
+    branch(0x1, 5, 0, -28),        # 0x3c: bne x5, x0, outer
+    HALT,                          # 0x40
+]
+
+# Same output, polling STATUS.TX_READY before every byte
+POLLING_DRIVER = [
+    lui(11, 0x10000),              # 0x00: x11 = UART
+    addi(8, 0, ord('a')),          # 0x04: x8 = next character
+    addi(5, 0, 12),                # 0x08: x5 = bytes left
+    lw(9, 11, 4),                  # 0x0c: poll: x9 = STATUS
+    andi(9, 9, 1),                 # 0x10
+    branch(0x0, 9, 0, -8),         # 0x14: beq x9, x0, poll
+    sw(8, 11, 0),                  # 0x18
+    addi(8, 8, 1),                 # 0x1c
+    addi(5, 5, -1),                # 0x20
+    branch(0x1, 5, 0, -24),        # 0x24: bne x5, x0, poll
+    HALT,                          # 0x28
+]
+
+
+def run(program, mode='pipeline', depth=4, cycles_per_byte=20):
+    processor = RISCVProcessor(mode=mode)
+    uart = processor.pipeline.uart
+    uart.capture = True
+    uart.tx_fifo_depth = depth
+    uart.cycles_per_byte = cycles_per_byte
+    load_program(processor.memory, program)
+    info = processor.execute_from_memory(0, max_cycles=5000, verbose=False)
+    return uart, info
+
+
+class TestOutput(unittest.TestCase):
+    """Test host-side buffering and capture"""
+
+    def setUp(self):
+        self.output = io.StringIO()
+        self.uart = UART(output_stream=self.output, flush_threshold=8)
+
+    def write(self, text):
+        for char in text:
+            self.uart.write_register(UART.TX_DATA_REG, ord(char))
+
+    def test_line_buffered(self):
+        """Test output reaches the stream a line at a time"""
+        self.write('ab')
+        self.assertEqual(self.output.getvalue(), '')
+        self.write('c\nd')
+        self.assertEqual(self.output.getvalue(), 'abc\n')
+        self.uart.flush()
+        self.assertEqual(self.output.getvalue(), 'abc\nd')
+        self.assertEqual(self.uart.get_statistics()['flushes'], 2)
+
+    def test_threshold_bounds_buffer(self):
+        """Test a long line is written out every flush_threshold bytes"""
+        self.write('x' * 20)
+        self.assertEqual(self.output.getvalue(), 'x' * 16)
+        self.assertEqual(self.uart.char_count, 20)
+
+    def test_capture(self):
+        """Test capture mode keeps the bytes and writes nothing"""
+        self.uart.capture = True
+        self.write('hi\n\xe9')
+        self.uart.flush()
+        self.assertEqual(self.output.getvalue(), '')
+        self.assertEqual(self.uart.captured, b'hi\n\xe9')
+        self.assertEqual(self.uart.captured_text(), 'hi\n\xe9')
+
+    def test_flushed_at_end_of_run(self):
+        """Test a run's unterminated last line is written out when it stops"""
+        program = [lui(11, 0x10000), addi(1, 0, ord('!')), sw(1, 11, 0), HALT]
+        for mode in ('pipeline', 'clocked', 'functional'):
+            with self.subTest(mode=mode):
+                processor = RISCVProcessor(mode=mode)
+                output = processor.pipeline.uart.output_stream = io.StringIO()
+                load_program(processor.memory, program)
+                processor.execute_from_memory(0, max_cycles=500, verbose=False)
+                self.assertEqual(output.getvalue(), '!')
+
+
+class TestTxFifo(unittest.TestCase):
+    """Test the TX FIFO and its TX-empty interrupt on a ticked CLINT"""
+
+    def setUp(self):
+        self.csr = CSRBank()
+        self.clint = CLINT(InterruptController(self.csr))
+        self.uart = UART(capture=True, tx_fifo_depth=2, cycles_per_byte=10)
+        self.uart.connect(self.clint)
+
+    def status(self):
+        return self.uart.read_register(UART.STATUS_REG)
+
+    def test_no_fifo_always_ready(self):
+        """Test without a FIFO depth the UART is always ready and empty"""
+        uart = UART(capture=True)
+        uart.connect(self.clint)
+        for _ in range(100):
+            uart.write_register(UART.TX_DATA_REG, 0x41)
+        self.assertEqual(uart.read_register(UART.STATUS_REG), UART.STATUS_TX_READY | UART.STATUS_TX_EMPTY)
+        self.assertEqual(uart.overruns, 0)
+
+    def test_fill_and_drain(self):
+        """Test the FIFO fills, drops bytes while full and drains one byte per cycles_per_byte"""
+        self.assertEqual(self.status(), UART.STATUS_TX_READY | UART.STATUS_TX_EMPTY)
+        for char in b'abc':
+            self.uart.write_register(UART.TX_DATA_REG, char)
+        self.assertEqual(self.status(), 0)
+        self.assertEqual((self.uart.captured, self.uart.overruns), (b'ab', 1))
+        self.clint.tick(10)
+        self.assertEqual(self.uart.tx_level(), 1)
+        self.assertEqual(self.status(), UART.STATUS_TX_READY)
+        self.clint.tick(10)
+        self.assertEqual(self.status(), UART.STATUS_TX_READY | UART.STATUS_TX_EMPTY)
+
+    def test_tx_empty_interrupt(self):
+        """Test MEIP follows FIFO empty while the interrupt is enabled"""
+        meip = 1 << UART.INTERRUPT_BIT
+        self.uart.write_register(UART.CTRL_REG, UART.CTRL_TX_EMPTY_IE)
+        self.assertTrue(self.csr.read(0x344) & meip)
+        self.uart.write_register(UART.TX_DATA_REG, 0x41)
+        self.assertFalse(self.csr.read(0x344) & meip)
+        self.assertEqual(self.clint.cycles_until_timer(), 10)
+        self.clint.tick(9)
+        self.assertFalse(self.csr.read(0x344) & meip)
+        self.clint.tick(1)
+        self.assertTrue(self.csr.read(0x344) & meip)
+        self.uart.write_register(UART.CTRL_REG, 0)
+        self.assertFalse(self.csr.read(0x344) & meip)
+
+
+class TestGuestDrivers(unittest.TestCase):
+    """Test guest code batching through the FIFO on every engine"""
+
+    def test_wfi_driver(self):
+        """Test a driver sleeping on the TX-empty interrupt loses nothing"""
+        results = {}
+        for mode in ('pipeline', 'clocked', 'functional'):
+            with self.subTest(mode=mode):
+                uart, info = run(WFI_DRIVER, mode)
+                self.assertEqual(uart.captured, b'abcdefghijkl')
+                self.assertEqual(uart.overruns, 0)
+                self.assertEqual(info['halt_reason'], 'self_loop')
+                self.assertGreater(info['idle_cycles'], 0)
+                # Two full FIFOs drained before the second and third batches
+                self.assertGreaterEqual(info['total_cycles'], 2 * 4 * 20)
+                results[mode] = info['total_cycles']
+        self.assertEqual(results['clocked'], results['pipeline'])
+
+    def test_polling_driver(self):
+        """Test a driver polling TX ready loses nothing and waits for the FIFO"""
+        results = {}
+        for mode in ('pipeline', 'clocked', 'functional'):
+            with self.subTest(mode=mode):
+                uart, info = run(POLLING_DRIVER, mode)
+                self.assertEqual(uart.captured, b'abcdefghijkl')
+                self.assertEqual(uart.overruns, 0)
+                self.assertGreaterEqual(info['total_cycles'], (12 - 4) * 20)
+                results[mode] = info['total_cycles']
+        self.assertEqual(results['clocked'], results['pipeline'])
+
+
+if __name__ == '__main__':
+    unittest.main()
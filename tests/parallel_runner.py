@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""
+Parallel regression runner for the functional tests and riscv-tests.
+
+Each tests/functional_tests module and each riscv-tests source file is one
+job; jobs are fanned out over a process pool, so every worker builds its
+own simpy.Environment/RISCVProcessor instances. Parsed riscv-tests sources
+are cached on disk between runs (see run_riscv_tests.load_test_cases).
+Results are aggregated into one report with the wall time of each job.
+
+Usage:
+  python tests/parallel_runner.py                  # Everything, one worker per core
+  python tests/parallel_runner.py -j 8             # Eight workers
+  python tests/parallel_runner.py --unit-only      # Only tests/functional_tests modules
+  python tests/parallel_runner.py --riscv-only     # Only riscv-tests
+"""
+
+import argparse
+import contextlib
+import io
+import os
+import sys
+import time
+import unittest
+from concurrent.futures import ProcessPoolExecutor
+
+PROJECT_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), '..'))
+FUNCTIONAL_TESTS_DIR = os.path.join(PROJECT_DIR, 'tests', 'functional_tests')
+DEFAULT_CACHE_DIR = os.path.join(PROJECT_DIR, '.test_cache')
+
+sys.path.insert(0, PROJECT_DIR)
+sys.path.insert(0, FUNCTIONAL_TESTS_DIR)
+
+
+def discover_jobs(unit=True, riscv=True, source_dir=None):
+    """List the jobs to run
+
+    Args:
+        unit: Include every tests/functional_tests/test_*.py module
+        riscv: Include the riscv-tests sources that exist under source_dir
+        source_dir: riscv-tests source directory (default: run_riscv_tests.TEST_SOURCE_DIR)
+
+    Returns:
+        List of (kind, name) with kind 'unit' or 'riscv'
+    """
+    jobs = []
+    if unit:
+        for filename in sorted(os.listdir(FUNCTIONAL_TESTS_DIR)):
+            if filename.startswith('test_') and filename.endswith('.py'):
+                jobs.append(('unit', filename[:-3]))
+    if riscv:
+        from run_riscv_tests import BASIC_TESTS, TEST_SOURCE_DIR
+        source_dir = os.path.join(PROJECT_DIR, source_dir or TEST_SOURCE_DIR)
+        for name in BASIC_TESTS:
+            if os.path.exists(os.path.join(source_dir, f"{name}.S")):
+                jobs.append(('riscv', name))
+    return jobs
+
+
+def _run_unit_module(name):
+    suite = unittest.defaultTestLoader.loadTestsFromName(name)
+    stream = io.StringIO()
+    result = unittest.TextTestRunner(stream=stream, verbosity=1).run(suite)
+    problems = len(result.failures) + len(result.errors) + len(result.unexpectedSuccesses)
+    return result.testsRun - problems, problems, stream.getvalue()
+
+
+def _run_riscv_file(name, cache_dir, source_dir):
+    from run_riscv_tests import run_test_file, TEST_SOURCE_DIR
+    passed, failed = run_test_file(name, cache_dir=cache_dir,
+                                   source_dir=os.path.join(PROJECT_DIR, source_dir or TEST_SOURCE_DIR))
+    return passed or 0, failed or 0, ''
+
+
+def run_job(job, cache_dir=DEFAULT_CACHE_DIR, source_dir=None):
+    """Run one job in the current process (the pool worker entry point)
+
+    Returns:
+        Dictionary with kind, name, passed, failed, wall_time and output
+        (captured stdout and test report, kept only when something failed)
+    """
+    kind, name = job
+    captured = io.StringIO()
+    start = time.perf_counter()
+    try:
+        with contextlib.redirect_stdout(captured):
+            if kind == 'unit':
+                passed, failed, report = _run_unit_module(name)
+            else:
+                passed, failed, report = _run_riscv_file(name, cache_dir, source_dir)
+    except Exception as e:  # Import errors and the like fail the job, not the run
+        passed, failed, report = 0, 1, f"{type(e).__name__}: {e}\n"
+    wall_time = time.perf_counter() - start
+    return {
+        'kind': kind,
+        'name': name,
+        'passed': passed,
+        'failed': failed,
+        'wall_time': wall_time,
+        'output': (captured.getvalue() + report) if failed else '',
+    }
+
+
+def run_parallel(jobs, workers=None, cache_dir=DEFAULT_CACHE_DIR, source_dir=None):
+    """Run jobs over a process pool
+
+    Args:
+        jobs: List of (kind, name) from discover_jobs()
+        workers: Pool size (default: os.cpu_count())
+        cache_dir: Directory caching parsed riscv-tests sources (None: no disk cache)
+        source_dir: riscv-tests source directory
+
+    Returns:
+        Tuple of (results in job order, total wall time)
+    """
+    start = time.perf_counter()
+    with ProcessPoolExecutor(max_workers=workers or os.cpu_count()) as pool:
+        futures = [pool.submit(run_job, job, cache_dir, source_dir) for job in jobs]
+        results = [future.result() for future in futures]
+    return results, time.perf_counter() - start
+
+
+def print_report(results, wall_time, workers, stream=None):
+    """Print the aggregated report, slowest jobs first
+
+    Returns:
+        True if every job passed
+    """
+    stream = stream or sys.stdout
+    total_passed = sum(r['passed'] for r in results)
+    total_failed = sum(r['failed'] for r in results)
+    serial_time = sum(r['wall_time'] for r in results)
+
+    for r in results:
+        if r['failed']:
+            stream.write(f"\n{'=' * 70}\n{r['kind']}:{r['name']} output\n{'=' * 70}\n{r['output']}")
+
+    stream.write("\n" + "=" * 70 + "\n")
+    stream.write(f"PARALLEL TEST REPORT ({len(results)} jobs, {workers} workers)\n")
+    stream.write("=" * 70 + "\n")
+    for r in sorted(results, key=lambda r: r['wall_time'], reverse=True):
+        status = "✓ PASS" if r['failed'] == 0 else "✗ FAIL"
+        stream.write(f"{status} {r['kind']:5s} {r['name']:28s}: {r['passed']:4d} passed, "
+                     f"{r['failed']:3d} failed  {r['wall_time']:7.2f}s\n")
+
+    total = total_passed + total_failed
+    pass_rate = (total_passed / total * 100) if total > 0 else 0
+    speedup = serial_time / wall_time if wall_time else 0
+    stream.write("\n" + "-" * 70 + "\n")
+    stream.write(f"TOTAL: {total_passed}/{total} tests passed ({pass_rate:.1f}%)\n")
+    stream.write(f"Wall time: {wall_time:.2f}s (sum of job times {serial_time:.2f}s, {speedup:.1f}x)\n")
+    stream.write("=" * 70 + "\n")
+    return total_failed == 0
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Run the test suites over a process pool")
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count(),
+                        help="Number of worker processes (default: all cores)")
+    group = parser.add_mutually_exclusive_group()
+    group.add_argument('--unit-only', action='store_true', help="Only tests/functional_tests modules")
+    group.add_argument('--riscv-only', action='store_true', help="Only riscv-tests sources")
+    parser.add_argument('--cache-dir', default=DEFAULT_CACHE_DIR,
+                        help="Parsed riscv-tests cache directory ('' disables it)")
+    args = parser.parse_args(argv)
+
+    jobs = discover_jobs(unit=not args.riscv_only, riscv=not args.unit_only)
+    results, wall_time = run_parallel(jobs, args.jobs, args.cache_dir or None)
+    return 0 if print_report(results, wall_time, args.jobs) else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
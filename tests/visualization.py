@@ -6,96 +6,51 @@ Can be imported by test files or run standalone.
 
 import sys
 import os
-from io import StringIO
 
 sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), '..')))
 
 import simpy
 from pipeline import Pipeline
-import re
+from tracing import TRACE_OFF
+from stage_trace import StageTrace, read_stage_trace
+from pipeview import render_diagram
 
 
-def draw_pipeline_diagram(instructions):
+def draw_pipeline_diagram(instructions, stream=None):
     """
     Draw a pipeline execution diagram showing stage occupancy over time.
     
+    The pipeline's stage trace (stage_trace.py) records when each
+    instruction entered every stage; pipeview.render_diagram() draws it.
+    For long runs, trace to a file and draw a window of it with pipeview.py
+    instead of calling this.
+    
     Args:
         instructions: List of instruction strings
+        stream: Text stream to draw on (default: sys.stdout)
+        
+    Returns:
+        List of StageRecords, one per instruction fetched
         
     Example output:
-              | t0 | t1 | t2  | t3  | t4  | t5  | t6 |
-        Inst1 | IF | ID | EXE | MEM | WB  |     |    |
-        Inst2 |    | IF | ID  | EXE | MEM | WB  |    |
+                                         | t0  | t1  | t2  | t3  | t4  | t5  |
+        Inst 1                           | IF  | ID  | EX  | MEM | WB  |     |
+        Inst 2                           |     | IF  | ID  | EX  | MEM | WB  |
     """
-    # Capture pipeline output
-    import sys
-    from io import StringIO
-    
-    old_stdout = sys.stdout
-    sys.stdout = StringIO()
-    
     env = simpy.Environment()
     pipeline = Pipeline(env)
-    results = pipeline.run(instructions)
-    
-    output = sys.stdout.getvalue()
-    sys.stdout = old_stdout
-    
-    # Parse the output to track stage occupancy
-    stage_map = {
-        'Fetch': 'IF',
-        'Decode': 'ID',
-        'Execute': 'EXE',
-        'Memory': 'MEM',
-        'WriteBack': 'WB'
-    }
-    
-    # Build timeline: timeline[cycle][instruction_text] = stage
-    timeline = {}
-    
-    for line in output.split('\n'):
-        if 'processing:' in line:
-            # Parse: [Cycle X] Stage processing: instruction
-            match = re.match(r'\[Cycle (\d+)\] (\w+) stage processing: (.+)', line)
-            if match:
-                cycle = int(match.group(1))
-                stage = match.group(2)
-                inst_text = match.group(3)
-                
-                if inst_text != 'BUBBLE':
-                    if cycle not in timeline:
-                        timeline[cycle] = {}
-                    timeline[cycle][inst_text] = stage_map.get(stage, stage)
-    
-    # Build the diagram
-    max_cycle = max(timeline.keys()) if timeline else 0
-    
-    # Print header
-    print("\nPipeline Execution Diagram:")
-    print("=" * (11 + (max_cycle + 1) * 6))
-    
-    header = "          "
-    for t in range(max_cycle + 1):
-        header += f"| t{t:<2} "
-    print(header + "|")
-    print("-" * (11 + (max_cycle + 1) * 6))
-    
-    # Print each instruction's timeline
-    for idx, inst in enumerate(instructions, 1):
-        row = f"Inst {idx:<4} "
-        for cycle in range(max_cycle + 1):
-            if cycle in timeline and inst in timeline[cycle]:
-                stage = timeline[cycle][inst]
-                row += f"| {stage:<3} "
-            else:
-                row += "|     "
-        print(row + "|")
-    
-    print("=" * (11 + (max_cycle + 1) * 6))
-    print(f"\nLegend: IF=Fetch, ID=Decode, EXE=Execute, MEM=Memory, WB=WriteBack")
-    print(f"Total cycles: {max_cycle + 1}, Stalls: {pipeline.stall_count}")
-    
-    return timeline
+    pipeline.trace.configure(level=TRACE_OFF)
+    trace = StageTrace()
+    trace.attach(pipeline)
+    pipeline.run(instructions)
+    trace.close()
+    
+    records = list(read_stage_trace(trace))
+    stream = stream or sys.stdout
+    render_diagram(records, stream=stream)
+    stream.write(f"Total cycles: {env.now}, Stalls: {pipeline.stall_count}\n")
+    
+    return records
 
 
 def visualize_pipeline_execution(instructions, show_details=True):
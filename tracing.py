@@ -0,0 +1,228 @@
+"""Structured trace output for the RISC-V pipeline simulator
+
+Trace calls go through a Tracer that holds one boolean per category, so a
+disabled category costs a single attribute test at the call site and no
+message formatting:
+
+    if trace.hazard:
+        trace.event('hazard', env.now, "RAW Hazard detected: {} needs {}", text, reg)
+
+Categories and the level at which they are enabled:
+    TRACE_EVENTS: hazard, flush, trap      (a few lines per redirect/stall)
+    TRACE_ALL:    fetch, stage, exec, mem, csr  (several lines per instruction)
+
+The tracer hands unformatted records to a sink:
+- PrintSink formats and prints them (the simulator's classic stdout trace)
+- RingBufferSink packs the last N records into a fixed-size binary ring
+  for post-mortem dumps
+"""
+
+import struct
+import sys
+
+
+# Trace levels
+TRACE_OFF = 0
+TRACE_EVENTS = 1
+TRACE_ALL = 2
+
+# Category -> minimum level at which it is enabled
+CATEGORY_LEVELS = {
+    'hazard': TRACE_EVENTS,
+    'flush': TRACE_EVENTS,
+    'trap': TRACE_EVENTS,
+    'fetch': TRACE_ALL,
+    'stage': TRACE_ALL,
+    'exec': TRACE_ALL,
+    'mem': TRACE_ALL,
+    'csr': TRACE_ALL,
+}
+CATEGORIES = tuple(CATEGORY_LEVELS)
+CATEGORY_IDS = {category: index for index, category in enumerate(CATEGORIES)}
+
+# Record kinds (how PrintSink lays out a line)
+KIND_EVENT = 0    # "[Cycle N] message"
+KIND_DETAIL = 1   # "  -> message" (continuation of the previous event)
+KIND_BANNER = 2   # blank line, then "[Cycle N] message"
+
+# RingBufferSink record layout (see RingBufferSink)
+RING_MAX_ARGS = 4
+RING_RECORD_FORMAT = '<QHBBBB2x4q64s'
+RING_RECORD_SIZE = struct.calcsize(RING_RECORD_FORMAT)
+
+
+def format_record(cycle, kind, fmt, args):
+    """Format one trace record the way the classic stdout trace did"""
+    message = fmt.format(*args) if args else fmt
+    if kind == KIND_DETAIL:
+        return f"  -> {message}"
+    if kind == KIND_BANNER:
+        return f"\n[Cycle {cycle}] {message}"
+    return f"[Cycle {cycle}] {message}"
+
+
+class PrintSink:
+    """Formats each record and prints it"""
+
+    def __init__(self, stream=None):
+        """Initialize print sink
+
+        Args:
+            stream: File-like object to write to (default: current sys.stdout)
+        """
+        self.stream = stream
+
+    def record(self, cycle, category, kind, fmt, args):
+        print(format_record(cycle, kind, fmt, args), file=self.stream or sys.stdout)
+
+
+class RingBufferSink:
+    """Keeps the most recent records in a fixed-size binary ring
+
+    Each record is packed with struct.pack_into into a fixed-width slot of
+    one preallocated bytearray (RING_RECORD_FORMAT), so the ring holds no
+    references to pipeline objects and its size never changes:
+        cycle     u64  Cycle of the record
+        fmt       u16  Index of the format string (interned: call sites
+                       pass literals, so the table stays small)
+        category  u8   Index in CATEGORIES
+        kind      u8   KIND_*
+        argc      u8   Number of args
+        text_mask u8   Bit i set: arg i is text, not an int
+        args      4 x i64  Integer args
+        text      64 bytes Text args (str() of anything not an int),
+                       NUL-separated, UTF-8, truncated to fit
+    A record with more than RING_MAX_ARGS args is formatted when recorded
+    and kept as one text arg.
+    Formatting only happens when the buffer is dumped, from the unpacked
+    fields, so a text arg prints as its str() at record time.
+    """
+
+    def __init__(self, capacity=4096):
+        """Initialize ring buffer sink
+
+        Args:
+            capacity: Number of records retained
+        """
+        self.capacity = capacity
+        self.buffer = bytearray(capacity * RING_RECORD_SIZE)
+        self.next_slot = 0
+        self.total = 0  # Records seen, including overwritten ones
+        self.formats = []
+        self.format_ids = {}
+
+    def record(self, cycle, category, kind, fmt, args):
+        if len(args) > RING_MAX_ARGS:
+            fmt, args = '{}', (fmt.format(*args),)  # Too many to pack: keep the message text
+        fmt_id = self.format_ids.get(fmt)
+        if fmt_id is None:
+            fmt_id = self.format_ids[fmt] = len(self.formats)
+            self.formats.append(fmt)
+        values = [0] * RING_MAX_ARGS
+        text = []
+        text_mask = 0
+        for index, arg in enumerate(args):
+            if type(arg) is int and -1 << 63 <= arg < 1 << 63:
+                values[index] = arg
+            else:
+                text.append(str(arg))
+                text_mask |= 1 << index
+        struct.pack_into(RING_RECORD_FORMAT, self.buffer, self.next_slot * RING_RECORD_SIZE,
+                         int(cycle), fmt_id, CATEGORY_IDS[category], kind, len(args),
+                         text_mask, *values, '\0'.join(text).encode('utf-8', 'replace'))
+        self.next_slot = (self.next_slot + 1) % self.capacity
+        self.total += 1
+
+    def _unpack(self, slot):
+        cycle, fmt_id, category_id, kind, argc, text_mask, *values, text = \
+            struct.unpack_from(RING_RECORD_FORMAT, self.buffer, slot * RING_RECORD_SIZE)
+        texts = iter(text.rstrip(b'\0').decode('utf-8', 'replace').split('\0'))
+        args = tuple(next(texts, '') if text_mask >> index & 1 else values[index] for index in range(argc))
+        return cycle, CATEGORIES[category_id], kind, self.formats[fmt_id], args
+
+    def records(self):
+        """Get retained records, oldest first
+
+        Returns:
+            List of (cycle, category, kind, fmt, args) tuples
+        """
+        if self.total < self.capacity:
+            slots = range(self.total)
+        else:
+            slots = [(self.next_slot + index) % self.capacity for index in range(self.capacity)]
+        return [self._unpack(slot) for slot in slots]
+
+    def dump(self, stream=None, category=None):
+        """Write retained records as text
+
+        Args:
+            stream: File-like object (default: sys.stdout)
+            category: Only dump this category (default: all)
+        """
+        stream = stream or sys.stdout
+        dropped = self.total - min(self.total, self.capacity)
+        if dropped:
+            print(f"... {dropped} earlier trace records dropped", file=stream)
+        for cycle, record_category, kind, fmt, args in self.records():
+            if category is None or record_category == category:
+                print(format_record(cycle, kind, fmt, args), file=stream)
+
+    def clear(self):
+        """Drop all retained records"""
+        self.next_slot = 0
+        self.total = 0
+
+
+class Tracer:
+    """Level/category filter in front of a trace sink
+
+    Each category is exposed as a boolean attribute (tracer.fetch,
+    tracer.hazard, ...) for cheap guards at call sites.
+    """
+
+    def __init__(self, sink=None, level=TRACE_ALL, categories=None):
+        """Initialize tracer
+
+        Args:
+            sink: PrintSink, RingBufferSink or any object with record()
+                  (default: PrintSink)
+            level: TRACE_OFF, TRACE_EVENTS or TRACE_ALL
+            categories: Iterable of enabled categories (default: all)
+        """
+        self.sink = sink if sink is not None else PrintSink()
+        self.level = level
+        self.categories = set(CATEGORIES if categories is None else categories)
+        self._update_flags()
+
+    def configure(self, level=None, categories=None, sink=None):
+        """Change level, enabled categories and/or sink"""
+        if level is not None:
+            self.level = level
+        if categories is not None:
+            unknown = set(categories) - set(CATEGORIES)
+            if unknown:
+                raise ValueError(f"Unknown trace categories: {sorted(unknown)}")
+            self.categories = set(categories)
+        if sink is not None:
+            self.sink = sink
+        self._update_flags()
+
+    def _update_flags(self):
+        for category, min_level in CATEGORY_LEVELS.items():
+            setattr(self, category, category in self.categories and self.level >= min_level)
+
+    def enabled(self, category):
+        """Check whether a category is currently traced"""
+        return getattr(self, category)
+
+    def event(self, category, cycle, fmt, *args):
+        """Record a "[Cycle N] ..." line"""
+        self.sink.record(cycle, category, KIND_EVENT, fmt, args)
+
+    def detail(self, category, cycle, fmt, *args):
+        """Record a "  -> ..." continuation line"""
+        self.sink.record(cycle, category, KIND_DETAIL, fmt, args)
+
+    def banner(self, category, cycle, fmt, *args):
+        """Record an event preceded by a blank line (start of a new fetch)"""
+        self.sink.record(cycle, category, KIND_BANNER, fmt, args)
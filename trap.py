@@ -1,6 +1,6 @@
 """Trap and Interrupt Mechanism for RISC-V simulator"""
 
-from interrupt import InterruptController
+from interrupt import InterruptController, highest_priority_bit
 
 
 class TrapController:
@@ -41,9 +41,42 @@ class TrapController:
             csr_bank: CSRBank instance for accessing/modifying CSRs
         """
         self.csr_bank = csr_bank
-        self.pending_interrupts = set()  # Set of pending interrupt codes (legacy)
         self.interrupt_controller = InterruptController(csr_bank)  # New interrupt logic
     
+    @property
+    def pending_interrupts(self):
+        """Interrupt codes held pending without a mip bit (legacy)
+        
+        Kept in csr_bank.extra_pending so they take part in the same
+        deliverable mask as mip. Returns a new set: change it through
+        trigger_interrupt(), set/clear_interrupt_pending() or assignment.
+        """
+        extra = self.csr_bank.extra_pending if self.csr_bank is not None else 0
+        return {0x80000000 | bit for bit in (3, 7, 11) if extra & (1 << bit)}
+    
+    @pending_interrupts.setter
+    def pending_interrupts(self, codes):
+        extra = 0
+        for code in codes:
+            bit = code & 0x7FFFFFFF
+            if bit in (3, 7, 11):
+                extra |= 1 << bit
+        self.csr_bank.extra_pending = extra
+        self.csr_bank.update_deliverable()
+    
+    def _hold_interrupt(self, interrupt_code):
+        """Keep an interrupt that could not be taken pending (legacy set)"""
+        bit = interrupt_code & 0x7FFFFFFF
+        if bit in (3, 7, 11):
+            self.csr_bank.extra_pending |= 1 << bit
+            self.csr_bank.update_deliverable()
+    
+    def _release_interrupt(self, interrupt_bit):
+        """Drop an interrupt from the legacy pending set"""
+        if self.csr_bank.extra_pending & (1 << interrupt_bit):
+            self.csr_bank.extra_pending &= ~(1 << interrupt_bit)
+            self.csr_bank.update_deliverable()
+    
     def trigger_exception(self, exception_code, pc, trap_value=0):
         """Trigger a synchronous exception
         
@@ -147,7 +180,7 @@ class TrapController:
         
         if not mie_enabled:
             # Interrupts disabled, add to pending
-            self.pending_interrupts.add(interrupt_code)
+            self._hold_interrupt(interrupt_code)
             return None
         
         # Check if this specific interrupt is enabled in mie CSR
@@ -156,15 +189,15 @@ class TrapController:
         
         if interrupt_bit == 3:  # Software interrupt
             if not (mie & (1 << 3)):
-                self.pending_interrupts.add(interrupt_code)
+                self._hold_interrupt(interrupt_code)
                 return None
         elif interrupt_bit == 7:  # Timer interrupt
             if not (mie & (1 << 7)):
-                self.pending_interrupts.add(interrupt_code)
+                self._hold_interrupt(interrupt_code)
                 return None
         elif interrupt_bit == 11:  # External interrupt
             if not (mie & (1 << 11)):
-                self.pending_interrupts.add(interrupt_code)
+                self._hold_interrupt(interrupt_code)
                 return None
         
         # Interrupt is deliverable - proceed with trap entry
@@ -177,7 +210,9 @@ class TrapController:
         """Check for pending interrupts and deliver if possible
         
         Should be called at the beginning of each instruction fetch to check
-        if any interrupts can be delivered.
+        if any interrupts can be delivered. Pending means a mip bit or the
+        legacy pending set; both feed one deliverable mask (see
+        CSRBank.deliverable), highest priority first.
         
         Args:
             next_pc: The PC of the next instruction to execute
@@ -185,63 +220,27 @@ class TrapController:
         Returns:
             Trap info dictionary if interrupt delivered, None otherwise
         """
-        # Use the InterruptController to get the highest priority interrupt
-        interrupt_code = self.interrupt_controller.get_highest_priority_interrupt()
-        
-        if interrupt_code is None:
-            # Also check legacy pending_interrupts for compatibility
-            if not self.pending_interrupts:
-                return None
-            
-            # Check if interrupts are globally enabled
-            mstatus = self.csr_bank.read(0x300)
-            mie_enabled = (mstatus >> 3) & 0x1
-            
-            if not mie_enabled:
-                return None
-            
-            # Try to deliver highest priority pending interrupt (legacy)
-            priority_order = [
-                self.INTERRUPT_EXTERNAL,
-                self.INTERRUPT_SOFTWARE,
-                self.INTERRUPT_TIMER
-            ]
-            
-            for interrupt_code in priority_order:
-                if interrupt_code in self.pending_interrupts:
-                    # Try to deliver this interrupt
-                    mie = self.csr_bank.read(0x304)
-                    interrupt_bit = interrupt_code & 0x7FFFFFFF
-                    
-                    enabled = False
-                    if interrupt_bit == 3:  # Software
-                        enabled = (mie & (1 << 3)) != 0
-                    elif interrupt_bit == 7:  # Timer
-                        enabled = (mie & (1 << 7)) != 0
-                    elif interrupt_bit == 11:  # External
-                        enabled = (mie & (1 << 11)) != 0
-                    
-                    if enabled:
-                        # Deliver this interrupt
-                        self.pending_interrupts.remove(interrupt_code)
-                        return self._deliver_interrupt(interrupt_code, next_pc)
-            
+        interrupt_bit = highest_priority_bit(self.csr_bank.deliverable)
+        if interrupt_bit is None:
             return None
-        else:
-            # New path: InterruptController has a pending, enabled interrupt
-            # interrupt_code here is just the bit position (3, 7, or 11)
-            # Convert to full interrupt code with MSB set
-            interrupt_bit = interrupt_code
-            full_interrupt_code = 0x80000000 | interrupt_bit
-            
-            # Clear it from the controller and deliver
-            self.interrupt_controller.clear_pending(interrupt_bit)
-            
-            # Also clear from legacy pending_interrupts for compatibility
-            self.pending_interrupts.discard(full_interrupt_code)
-            
-            return self._deliver_interrupt(full_interrupt_code, next_pc)
+        
+        # Clear it from the controller and the legacy set, then deliver
+        self.interrupt_controller.clear_pending(interrupt_bit)
+        self._release_interrupt(interrupt_bit)
+        
+        return self._deliver_interrupt(0x80000000 | interrupt_bit, next_pc)
     
+    def has_deliverable_interrupt(self):
+        """Check whether check_pending_interrupts() would deliver an interrupt
+
+        Same decision as check_pending_interrupts() but without side effects,
+        so the fetch engine can drain the pipeline before taking the trap.
+
+        Returns:
+            True if an interrupt is pending, enabled and globally enabled
+        """
+        return self.csr_bank.deliverable != 0
+
     def _deliver_interrupt(self, interrupt_code, next_pc):
         """Internal method to deliver an interrupt
         
@@ -305,18 +304,18 @@ class TrapController:
             interrupt_type: One of 'software', 'timer', 'external'
         """
         if interrupt_type == 'software':
-            self.pending_interrupts.add(self.INTERRUPT_SOFTWARE)
+            self._hold_interrupt(self.INTERRUPT_SOFTWARE)
             # Also set mip bit
             mip = self.csr_bank.read(0x344)
             mip |= (1 << 3)
             self.csr_bank.write(0x344, mip)
         elif interrupt_type == 'timer':
-            self.pending_interrupts.add(self.INTERRUPT_TIMER)
+            self._hold_interrupt(self.INTERRUPT_TIMER)
             mip = self.csr_bank.read(0x344)
             mip |= (1 << 7)
             self.csr_bank.write(0x344, mip)
         elif interrupt_type == 'external':
-            self.pending_interrupts.add(self.INTERRUPT_EXTERNAL)
+            self._hold_interrupt(self.INTERRUPT_EXTERNAL)
             mip = self.csr_bank.read(0x344)
             mip |= (1 << 11)
             self.csr_bank.write(0x344, mip)
@@ -328,17 +327,17 @@ class TrapController:
             interrupt_type: One of 'software', 'timer', 'external'
         """
         if interrupt_type == 'software':
-            self.pending_interrupts.discard(self.INTERRUPT_SOFTWARE)
+            self._release_interrupt(3)
             mip = self.csr_bank.read(0x344)
             mip &= ~(1 << 3)
             self.csr_bank.write(0x344, mip)
         elif interrupt_type == 'timer':
-            self.pending_interrupts.discard(self.INTERRUPT_TIMER)
+            self._release_interrupt(7)
             mip = self.csr_bank.read(0x344)
             mip &= ~(1 << 7)
             self.csr_bank.write(0x344, mip)
         elif interrupt_type == 'external':
-            self.pending_interrupts.discard(self.INTERRUPT_EXTERNAL)
+            self._release_interrupt(11)
             mip = self.csr_bank.read(0x344)
             mip &= ~(1 << 11)
             self.csr_bank.write(0x344, mip)
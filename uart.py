@@ -5,7 +5,8 @@ in FreeRTOS and bare-metal applications.
 
 Memory Map:
 - 0x10000000: UART TX data register (write a byte to transmit)
-- 0x10000004: UART status register (read-only, bit 0 = TX ready)
+- 0x10000004: UART status register (read-only, bit 0 = TX ready, bit 1 = TX empty)
+- 0x10000008: UART control register (bit 0 = TX-empty interrupt enable)
 
 Usage in C:
     volatile char *uart_tx = (char*)0x10000000;
@@ -19,6 +20,21 @@ Usage in C:
         }
         return count;
     }
+
+Host output is buffered: transmitted bytes collect in a buffer of at most
+flush_threshold bytes, written to output_stream on a newline, when the
+buffer is full, and at the end of every run (flush()). In capture mode
+the bytes accumulate in the captured bytearray instead, for tests.
+
+TX FIFO model (off by default): with tx_fifo_depth set, each transmitted
+byte occupies the FIFO for cycles_per_byte cycles of the CLINT clock
+(connect()), STATUS reports TX ready only while the FIFO has room and TX
+empty once it has drained, and bytes written to a full FIFO are dropped
+(counted in overruns). With CTRL_TX_EMPTY_IE set the UART raises the
+machine external interrupt (mip.MEIP) while the FIFO is empty, so a
+driver can write a FIFO's worth of bytes, sleep (WFI) and refill on the
+interrupt instead of polling STATUS. Without the FIFO model the UART
+transmits instantly: always ready and empty, as before.
 """
 
 import sys
@@ -28,26 +44,149 @@ class UART:
     """Simple UART peripheral for character output
     
     Provides memory-mapped UART functionality for printing to terminal.
-    Characters written to TX register appear immediately on stdout.
+    Characters written to TX register go to a host-side buffer that is
+    written out a line at a time (see the module docstring).
     """
     
     # Memory-mapped register addresses
     TX_DATA_REG = 0x10000000    # Write byte here to transmit
-    STATUS_REG = 0x10000004     # Read-only status (always ready)
+    STATUS_REG = 0x10000004     # Read-only status
+    CTRL_REG = 0x10000008       # Interrupt enables
+    WINDOW_SIZE = 12            # Bytes of address space the registers take
     
     # Status register bits
-    STATUS_TX_READY = 0x01      # Transmitter ready (always set)
+    STATUS_TX_READY = 0x01      # Transmitter can take a byte (TX FIFO not full)
+    STATUS_TX_EMPTY = 0x02      # Everything written has been sent (TX FIFO empty)
+    
+    # Control register bits
+    CTRL_TX_EMPTY_IE = 0x01     # Raise mip.MEIP while the TX FIFO is empty
+    
+    # Machine external interrupt (mie/mip bit) the UART drives
+    INTERRUPT_BIT = 11
     
-    def __init__(self, output_stream=None):
+    def __init__(self, output_stream=None, capture=False, flush_threshold=4096, tx_fifo_depth=0,
+                 cycles_per_byte=10):
         """Initialize UART peripheral
         
         Args:
             output_stream: File-like object for output (default: sys.stdout)
+            capture: Accumulate output in captured instead of writing it
+            flush_threshold: Buffered bytes that force a write to output_stream
+            tx_fifo_depth: TX FIFO entries (0: no FIFO model, transmit instantly)
+            cycles_per_byte: Cycles the FIFO takes to send each byte
         """
         self.output_stream = output_stream or sys.stdout
-        self.tx_buffer = []
+        self.capture = capture
+        self.captured = bytearray()
+        self.flush_threshold = flush_threshold
+        self.tx_fifo_depth = tx_fifo_depth
+        self.cycles_per_byte = cycles_per_byte
         self.char_count = 0
+        self.overruns = 0
+        self.flushes = 0
+        self.ctrl = 0
         
+        self.clint = None          # Clock and interrupt controller (connect())
+        self._pending = bytearray()
+        self._tx_busy_until = 0    # CLINT cycle the last queued byte is sent
+        self._irq = False          # MEIP raised by this UART
+    
+    def connect(self, clint):
+        """Use a CLINT's clock for the TX FIFO and its interrupt controller for MEIP
+        
+        Args:
+            clint: CLINT instance (see CLINT.schedule())
+        """
+        self.clint = clint
+    
+    # Host output
+    def flush(self):
+        """Write the buffered output to output_stream"""
+        if not self._pending:
+            return
+        self.output_stream.write(self._pending.decode('latin-1'))
+        self.output_stream.flush()
+        self._pending.clear()
+        self.flushes += 1
+    
+    def captured_text(self):
+        """Get the output captured so far as a string"""
+        return self.captured.decode('latin-1')
+    
+    def emit(self, data):
+        """Output bytes transmitted elsewhere (e.g. by a hart's UART in another process)
+
+        Args:
+            data: bytes-like object
+        """
+        for byte in data:
+            self._emit(byte)
+        self.char_count += len(data)
+
+    def _emit(self, byte):
+        if self.capture:
+            self.captured.append(byte)
+            return
+        pending = self._pending
+        pending.append(byte)
+        if byte == 0x0A or len(pending) >= self.flush_threshold:
+            self.flush()
+    
+    # TX FIFO and interrupt
+    @property
+    def fifo_enabled(self):
+        """Whether the TX FIFO model is on (a depth and a clock are set)"""
+        return self.tx_fifo_depth > 0 and self.clint is not None
+    
+    def tx_level(self):
+        """Get the number of bytes waiting in the TX FIFO"""
+        if not self.fifo_enabled:
+            return 0
+        remaining = self._tx_busy_until - self.clint.now
+        if remaining <= 0:
+            return 0
+        return -(-remaining // self.cycles_per_byte)
+    
+    def _transmit(self, value):
+        if self.fifo_enabled:
+            if self.tx_level() >= self.tx_fifo_depth:
+                self.overruns += 1  # FIFO full: the byte is lost
+                return
+            self._tx_busy_until = max(self._tx_busy_until, self.clint.now) + self.cycles_per_byte
+        self._emit(value & 0xFF)
+        self.char_count += 1
+        self._update_interrupt()
+    
+    def _update_interrupt(self):
+        """Raise or drop MEIP for the TX-empty interrupt; wait for the FIFO to drain"""
+        if self.clint is None:
+            return
+        enabled = self.ctrl & self.CTRL_TX_EMPTY_IE
+        level = self.tx_level() if enabled else 0
+        asserted = bool(enabled) and level == 0
+        if asserted != self._irq:
+            self._irq = asserted
+            controller = self.clint.interrupt_controller
+            if asserted:
+                controller.set_pending(self.INTERRUPT_BIT)
+            else:
+                controller.clear_pending(self.INTERRUPT_BIT)
+        if level:
+            self.clint.schedule(self._tx_busy_until - self.clint.now, self._update_interrupt)
+    
+    def get_fifo_state(self):
+        """Get (ctrl, cycles until the FIFO drains, interrupt raised) for checkpoints"""
+        remaining = max(0, self._tx_busy_until - self.clint.now) if self.fifo_enabled else 0
+        return self.ctrl, remaining, self._irq
+    
+    def set_fifo_state(self, ctrl, remaining, irq):
+        """Restore get_fifo_state() as of the current cycle"""
+        self.ctrl = ctrl
+        self._irq = bool(irq)
+        self._tx_busy_until = (self.clint.now if self.clint is not None else 0) + remaining
+        self._update_interrupt()
+    
+    # Registers
     def write_register(self, address, value):
         """Write to UART register
         
@@ -59,11 +198,11 @@ class UART:
             True if write was handled, False otherwise
         """
         if address == self.TX_DATA_REG:
-            # Transmit byte
-            char = chr(value & 0xFF)
-            self.output_stream.write(char)
-            self.output_stream.flush()
-            self.char_count += 1
+            self._transmit(value)
+            return True
+        elif address == self.CTRL_REG:
+            self.ctrl = value & self.CTRL_TX_EMPTY_IE
+            self._update_interrupt()
             return True
         elif address == self.STATUS_REG:
             # Status register is read-only, ignore writes
@@ -76,13 +215,20 @@ class UART:
         
         Args:
             address: Register address
-            
+        
         Returns:
             Register value, or None if address not handled
         """
         if address == self.STATUS_REG:
-            # Always ready to transmit
-            return self.STATUS_TX_READY
+            if not self.fifo_enabled:
+                return self.STATUS_TX_READY | self.STATUS_TX_EMPTY
+            level = self.tx_level()
+            status = self.STATUS_TX_EMPTY if level == 0 else 0
+            if level < self.tx_fifo_depth:
+                status |= self.STATUS_TX_READY
+            return status
+        elif address == self.CTRL_REG:
+            return self.ctrl
         elif address == self.TX_DATA_REG:
             # Reading TX register returns 0
             return 0
@@ -94,11 +240,11 @@ class UART:
         
         Args:
             address: Memory address to check
-            
+        
         Returns:
             True if address is a UART register
         """
-        return address in [self.TX_DATA_REG, self.STATUS_REG]
+        return address in (self.TX_DATA_REG, self.STATUS_REG, self.CTRL_REG)
     
     def get_statistics(self):
         """Get UART statistics
@@ -108,12 +254,19 @@ class UART:
         """
         return {
             'chars_transmitted': self.char_count,
+            'overruns': self.overruns,
+            'flushes': self.flushes,
         }
     
     def reset(self):
-        """Reset UART to initial state"""
-        self.tx_buffer.clear()
+        """Reset UART to initial state (buffered output is written out first)"""
+        self.flush()
+        self.captured.clear()
         self.char_count = 0
+        self.overruns = 0
+        self._tx_busy_until = 0
+        self.ctrl = 0
+        self._update_interrupt()
 
 
 # Helper function for test/demo purposes
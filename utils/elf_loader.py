@@ -231,6 +231,8 @@ class ELFTestLoader:
         self.elf_path = elf_path
         self.memory = {}
         self.entry_point = None
+        self.symbols = {}
+        self.functions = []
         
     def load(self):
         """Load ELF file into memory"""
@@ -248,6 +250,65 @@ class ELFTestLoader:
         
         return self.memory, self.entry_point
     
+    def load_into(self, memory):
+        """Load ELF segments straight into simulator memory
+        
+        Each PT_LOAD segment is copied as one slice of the file image into
+        the memory pages (no per-byte dictionary), and the p_memsz tail
+        beyond p_filesz (.bss) is zero-filled.
+        
+        Args:
+            memory: Memory instance with RAM mapped at the segment addresses
+            
+        Returns:
+            Tuple of (entry_point, symbols) where symbols maps symbol names
+            (e.g. 'tohost', '_stack_start') to addresses; the function
+            symbols are also kept in self.functions (see read_functions)
+        """
+        with open(self.elf_path, 'rb') as f:
+            image = memoryview(f.read())
+            elf = ELFFile(f)
+            self.entry_point = elf.header['e_entry']
+            
+            for segment in elf.iter_segments():
+                if segment['p_type'] != 'PT_LOAD':
+                    continue
+                addr = segment['p_vaddr']
+                offset = segment['p_offset']
+                file_size = segment['p_filesz']
+                mem_size = segment['p_memsz']
+                if file_size:
+                    memory.write_bytes(addr, image[offset:offset + file_size])
+                if mem_size > file_size:
+                    memory.write_bytes(addr + file_size, bytes(mem_size - file_size))
+            
+            self.symbols = self.read_symbols(elf)
+            self.functions = self.read_functions(elf)
+        
+        return self.entry_point, self.symbols
+    
+    @staticmethod
+    def read_symbols(elf):
+        """Get {name: address} for the named symbols in .symtab (empty if stripped)"""
+        symtab = elf.get_section_by_name('.symtab')
+        if symtab is None:
+            return {}
+        return {symbol.name: symbol['st_value'] for symbol in symtab.iter_symbols() if symbol.name}
+    
+    @staticmethod
+    def read_functions(elf):
+        """Get the STT_FUNC symbols in .symtab as sorted (address, size, name) tuples"""
+        symtab = elf.get_section_by_name('.symtab')
+        if symtab is None:
+            return []
+        return sorted((symbol['st_value'], symbol['st_size'], symbol.name) for symbol in symtab.iter_symbols()
+                      if symbol.name and symbol['st_info']['type'] == 'STT_FUNC')
+    
+    @property
+    def tohost_address(self):
+        """Address of the riscv-tests tohost word (from the symbol table when loaded)"""
+        return self.symbols.get('tohost', self.TOHOST_ADDR)
+    
     def read_word(self, addr):
         """Read 32-bit word from memory (little-endian)"""
         bytes_data = [self.memory.get(addr + i, 0) for i in range(4)]
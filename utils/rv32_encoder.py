@@ -0,0 +1,88 @@
+"""Minimal RV32I instruction encoders
+
+Builds 32-bit instruction words for hand-written programs that are loaded
+into memory (fetch-engine tests, functional-mode tests, benchmarks).
+Register arguments are numbers (x0-x31); immediates are signed byte offsets.
+"""
+
+
+def r_type(funct7, rs2, rs1, funct3, rd, opcode=0x33):
+    return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode
+
+
+def i_type(imm, rs1, funct3, rd, opcode=0x13):
+    return ((imm & 0xFFF) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode
+
+
+def s_type(imm, rs2, rs1, funct3):
+    imm &= 0xFFF
+    return ((imm >> 5) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((imm & 0x1F) << 7) | 0x23
+
+
+def b_type(imm, rs2, rs1, funct3):
+    imm &= 0x1FFF
+    return (((imm >> 12) & 1) << 31) | (((imm >> 5) & 0x3F) << 25) | (rs2 << 20) | (rs1 << 15) | \
+           (funct3 << 12) | (((imm >> 1) & 0xF) << 8) | (((imm >> 11) & 1) << 7) | 0x63
+
+
+def j_type(imm, rd):
+    imm &= 0x1FFFFF
+    return (((imm >> 20) & 1) << 31) | (((imm >> 1) & 0x3FF) << 21) | (((imm >> 11) & 1) << 20) | \
+           (((imm >> 12) & 0xFF) << 12) | (rd << 7) | 0x6F
+
+
+# Common instructions
+def add(rd, rs1, rs2):
+    return r_type(0x00, rs2, rs1, 0x0, rd)
+
+
+def sub(rd, rs1, rs2):
+    return r_type(0x20, rs2, rs1, 0x0, rd)
+
+
+def addi(rd, rs1, imm):
+    return i_type(imm, rs1, 0x0, rd)
+
+
+def lui(rd, imm20):
+    return ((imm20 & 0xFFFFF) << 12) | (rd << 7) | 0x37
+
+
+def lw(rd, rs1, imm):
+    return i_type(imm, rs1, 0x2, rd, opcode=0x03)
+
+
+def sw(rs2, rs1, imm):
+    return s_type(imm, rs2, rs1, 0x2)
+
+
+def branch(funct3, rs1, rs2, imm):
+    """BEQ=0, BNE=1, BLT=4, BGE=5, BLTU=6, BGEU=7"""
+    return b_type(imm, rs2, rs1, funct3)
+
+
+def jal(rd, imm):
+    return j_type(imm, rd)
+
+
+def jalr(rd, rs1, imm):
+    return i_type(imm, rs1, 0x0, rd, opcode=0x67)
+
+
+def csr(funct3, rd, csr_addr, rs1):
+    """CSRRW=1, CSRRS=2, CSRRC=3 (rs1 is a zimm for the *I forms 5-7)"""
+    return (csr_addr << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | 0x73
+
+
+ECALL = 0x00000073
+EBREAK = 0x00100073
+MRET = 0x30200073
+WFI = 0x10500073
+NOP = addi(0, 0, 0)
+HALT = jal(0, 0)   # j .
+
+
+def load_program(memory, words, base=0):
+    """Write instruction words into memory starting at base"""
+    for i, word in enumerate(words):
+        memory.write_word(base + i * 4, word)